@@ -0,0 +1,71 @@
+/* MeshIt - a 3D mesh generator for fractured reservoirs
+ *
+ * Copyright (C) 2020
+ *
+ * Mauro Cacace (GFZ, cacace@gfz-potsdam.de),
+ * Guido Bl�cher (GFZ, bloech@gfz-potsdam.de),
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version, complemented with
+ * the following provision:
+ * For the scientific transparency and verification of results obtained
+ * and communicated to the public after using a modified version of the
+ * work, You (as the recipient of the source code and author of this
+ * modified version, used to produce the published results in scientific
+ * communications) commit to make this modified source code available in
+ * a repository that is easily and freely accessible for a duration of
+ * five years after the communication of the obtained results.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+
+#include "check.h"
+#include "simd.h"
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	QCoreApplication::setApplicationName("MeshIt-check");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Checks of the kernels and of the render buffers of MeshIt.");
+	parser.addHelpOption();
+	parser.addOptions({
+		{"filter", "Run only the checks matching <regexp>.", "regexp", "."},
+		{"list", "List the checks and exit."},
+	});
+	parser.process(app);
+
+	QRegularExpression filter(parser.value("filter"));
+	int failed = 0;
+	std::cout << "simd: " << simd_level_name(simd_level()) << std::endl;
+	for (int c = 0; c != C_Check::registry().length(); c++)
+	{
+		const QPair<QString, CheckFunction> &check = C_Check::registry()[c];
+		if (!filter.match(check.first).hasMatch())
+			continue;
+		if (parser.isSet("list"))
+		{
+			std::cout << check.first.toUtf8().constData() << std::endl;
+			continue;
+		}
+		C_CheckState state(check.first);
+		check.second(state);
+		std::cout << QString("%1 %2 %3")
+			.arg(check.first, -40)
+			.arg(state.failures == 0 ? "passed" : "FAILED", 8)
+			.arg(QString("%1/%2").arg(state.verifications - state.failures).arg(state.verifications), 20).toUtf8().constData() << std::endl;
+		failed += state.failures != 0 || state.verifications == 0;
+	}
+	return failed == 0 ? 0 : 1;
+}
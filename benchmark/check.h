@@ -0,0 +1,88 @@
+/* MeshIt - a 3D mesh generator for fractured reservoirs
+ *
+ * Copyright (C) 2020
+ *
+ * Mauro Cacace (GFZ, cacace@gfz-potsdam.de),
+ * Guido Bl�cher (GFZ, bloech@gfz-potsdam.de),
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version, complemented with
+ * the following provision:
+ * For the scientific transparency and verification of results obtained
+ * and communicated to the public after using a modified version of the
+ * work, You (as the recipient of the source code and author of this
+ * modified version, used to produce the published results in scientific
+ * communications) commit to make this modified source code available in
+ * a repository that is easily and freely accessible for a duration of
+ * five years after the communication of the obtained results.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CHECK_H_
+#define _CHECK_H_
+
+#include <QtCore/QtCore>
+
+#include <iostream>
+
+/*! \class C_CheckState
+*	\brief Outcome of one check: the failed verifications.
+*	\details A check calls verify() (through the VERIFY macro) for every
+*	condition; only the first few failures are printed.
+*/
+class C_CheckState
+{
+public:
+	C_CheckState(const QString &name) : name(name), verifications(0), failures(0) {};
+
+	bool verify(bool condition, const char *expression, const char *file, int line)
+	{
+		verifications++;
+		if (condition)
+			return true;
+		if (failures++ < 10)
+			std::cerr << name.toUtf8().constData() << ": " << file << ":" << line << ": " << expression << std::endl;
+		return false;
+	}
+
+	QString name;
+	qint64 verifications;
+	qint64 failures;
+};
+
+typedef void (*CheckFunction)(C_CheckState &);
+
+/*! \class C_Check
+*	\brief Registry of the checks of the kernels and of the render buffers,
+*	which run without the GUI or an OpenGL context.
+*/
+class C_Check
+{
+public:
+	static QList<QPair<QString, CheckFunction> > &registry()
+	{
+		static QList<QPair<QString, CheckFunction> > checks;
+		return checks;
+	}
+	static int add(const char *name, CheckFunction function)
+	{
+		registry().append(qMakePair(QString(name), function));
+		return registry().length();
+	}
+};
+
+#define VERIFY(state, condition) (state).verify((condition), #condition, __FILE__, __LINE__)
+
+#define CHECK(function) \
+	static int check_##function = C_Check::add(#function, function)
+
+#endif	// _CHECK_H_
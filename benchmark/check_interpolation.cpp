@@ -0,0 +1,108 @@
+/* MeshIt - a 3D mesh generator for fractured reservoirs
+ *
+ * Copyright (C) 2020
+ *
+ * Mauro Cacace (GFZ, cacace@gfz-potsdam.de),
+ * Guido Bl�cher (GFZ, bloech@gfz-potsdam.de),
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version, complemented with
+ * the following provision:
+ * For the scientific transparency and verification of results obtained
+ * and communicated to the public after using a modified version of the
+ * work, You (as the recipient of the source code and author of this
+ * modified version, used to produce the published results in scientific
+ * communications) commit to make this modified source code available in
+ * a repository that is easily and freely accessible for a duration of
+ * five years after the communication of the obtained results.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+#include "geometry.h"
+
+/* meshit.interpolate() evaluates C_Surface::IDW(), SPLINE() and KRIGING() of
+ * one surface in the thread pool. They only read the surface once it is
+ * filled, so the values interpolated by many threads at once must be those
+ * of a serial run, bit for bit. */
+
+#define LOCATIONS 4000
+#define THREADS 8
+
+static void
+check_interpolation(C_CheckState &state)
+{
+	std::mt19937 rng(4);
+	std::uniform_real_distribution<double> coordinate(-1.0, 1.0);
+
+	C_Surface surface;
+	for (int s = 0; s != 600; s++)
+	{
+		double x = coordinate(rng), y = coordinate(rng);
+		surface.SDs.append(C_Vector3D(x, y, 0.2 * sin(3.0 * x) * cos(2.0 * y)));
+	}
+	std::vector<double> xy(2 * LOCATIONS);
+	for (int i = 0; i != 2 * LOCATIONS; i++)
+		xy[i] = coordinate(rng);
+	/* a location on a data point */
+	xy[0] = surface.SDs[7].x();
+	xy[1] = surface.SDs[7].y();
+
+	for (int method = 0; method != 3; method++)
+	{
+		if (method == 1)
+			surface.fillSpline();
+		if (method == 2)
+			surface.fillKriging();
+		const C_Surface &filled = surface;
+		auto value = [&filled, method](double x, double y) {
+			return method == 0 ? filled.IDW(x, y) : method == 1 ? filled.SPLINE(x, y) : filled.KRIGING(x, y);
+		};
+
+		std::vector<double> serial(LOCATIONS), parallel(LOCATIONS);
+		for (int i = 0; i != LOCATIONS; i++)
+			serial[i] = value(xy[2 * i], xy[2 * i + 1]);
+
+		/* interleaved, so that the threads read the same data at the same time */
+		std::vector<std::thread> threads;
+		for (int t = 0; t != THREADS; t++)
+			threads.push_back(std::thread([&, t]() {
+				for (int i = t; i < LOCATIONS; i += THREADS)
+					parallel[i] = value(xy[2 * i], xy[2 * i + 1]);
+			}));
+		for (std::thread &thread : threads)
+			thread.join();
+
+		bool same = true, finite = true;
+		for (int i = 0; i != LOCATIONS; i++)
+		{
+			same = same && serial[i] == parallel[i];
+			finite = finite && std::isfinite(serial[i]);
+		}
+		VERIFY(state, same);
+		VERIFY(state, finite);
+		if (method != 2)
+			VERIFY(state, serial[0] == surface.SDs[7].z());
+	}
+
+	/* C_Surface leaves them to the owner */
+	delete[] surface.MatrixKriging;
+	delete[] surface.VectorKriging;
+	delete[] surface.KrigingWeights;
+	delete[] surface.KrigingPivot;
+}
+CHECK(check_interpolation);
@@ -0,0 +1,219 @@
+/* MeshIt - a 3D mesh generator for fractured reservoirs
+ *
+ * Copyright (C) 2020
+ *
+ * Mauro Cacace (GFZ, cacace@gfz-potsdam.de),
+ * Guido Bl�cher (GFZ, bloech@gfz-potsdam.de),
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version, complemented with
+ * the following provision:
+ * For the scientific transparency and verification of results obtained
+ * and communicated to the public after using a modified version of the
+ * work, You (as the recipient of the source code and author of this
+ * modified version, used to produce the published results in scientific
+ * communications) commit to make this modified source code available in
+ * a repository that is easily and freely accessible for a duration of
+ * five years after the communication of the obtained results.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <random>
+
+#include "check.h"
+#include "core.h"
+#include "geometry.h"
+#include "intersections.h"
+#include "seg_seg_packet.h"
+#include "simd.h"
+
+/* The packet kernels of all instruction sets the CPU supports are compared
+ * with the scalar code they replace: tri_tri_intersect_with_isectline() and
+ * C_Line::calculateSkewLineTransversal(). Next to random input, points on a
+ * small integer grid produce the degenerate cases exactly: coplanar,
+ * touching and parallel triangles and segments, zero length segments and
+ * parameters at the ends of the segments. */
+
+#define CASES 20000
+
+static std::mt19937 rng(1);
+
+static double
+uniform(double a, double b)
+{
+	return std::uniform_real_distribution<double>(a, b)(rng);
+}
+
+static C_Vector3D
+gridPoint(int size)
+{
+	std::uniform_int_distribution<int> cell(0, size);
+	return C_Vector3D(cell(rng), cell(rng), cell(rng));
+}
+
+/* Point of a random input (i even) or of the integer grid (i odd). */
+static C_Vector3D
+point(int i, const C_Vector3D &center, double extent)
+{
+	if (i % 2 == 0)
+		return center + C_Vector3D(uniform(-extent, extent), uniform(-extent, extent), uniform(-extent, extent));
+	return gridPoint(2);
+}
+
+static void
+coordinates(const C_Vector3D &v, double p[3])
+{
+	p[0] = v.x();
+	p[1] = v.y();
+	p[2] = v.z();
+}
+
+static void
+check_tri_tri_packet(C_CheckState &state)
+{
+	C_Vector3D vertices[3 * (1 + TRIANGLE_PACKET_WIDTH)];
+	C_Triangle triangles[1 + TRIANGLE_PACKET_WIDTH];
+	for (int t = 0; t != 1 + TRIANGLE_PACKET_WIDTH; t++)
+		for (int n = 0; n != 3; n++)
+			triangles[t].Ns[n] = &vertices[3 * t + n];
+
+	for (int i = 0; i != CASES; i++)
+	{
+		C_Vector3D center(uniform(0.0, 0.25), uniform(0.0, 0.25), uniform(0.0, 0.25));
+		for (int v = 0; v != 3 * (1 + TRIANGLE_PACKET_WIDTH); v++)
+			vertices[v] = point(i, center, 0.1);
+		if (i % 8 == 3)
+		{
+			/* the first triangle of the packet shares an edge with T1 */
+			vertices[3] = vertices[0];
+			vertices[4] = vertices[1];
+		}
+		if (i % 8 == 5)
+		{
+			/* and a coplanar one: all flat */
+			for (int v = 0; v != 3 * (1 + TRIANGLE_PACKET_WIDTH); v++)
+				vertices[v].setZ(0.0);
+		}
+		if (i % 8 == 7)
+		{
+			/* a vertex closer to the plane of T1 than EPSILON */
+			vertices[3] = (1.0 / 3.0) * (vertices[0] + vertices[1] + vertices[2]) + C_Vector3D(0.0, 0.0, 0.5 * EPSILON);
+		}
+
+		C_TrianglePacket packet;
+		packet.count = 1 + i % TRIANGLE_PACKET_WIDTH;
+		for (int l = 0; l != TRIANGLE_PACKET_WIDTH; l++)
+			tri_tri_packet_set(&packet, l, triangles[1 + (l < packet.count ? l : 0)]);
+		double v[3][3];
+		for (int n = 0; n != 3; n++)
+			coordinates(vertices[n], v[n]);
+
+		unsigned int scalar = tri_tri_packet_candidates_level(SIMD_SCALAR, v[0], v[1], v[2], packet);
+		VERIFY(state, (scalar >> packet.count) == 0);
+		for (int level = SIMD_SSE2; level <= simd_level(); level++)
+			VERIFY(state, tri_tri_packet_candidates_level(SimdLevel(level), v[0], v[1], v[2], packet) == scalar);
+		VERIFY(state, tri_tri_packet_candidates(v[0], v[1], v[2], packet) == scalar);
+
+		/* a rejected triangle does not intersect */
+		for (int l = 0; l != packet.count; l++)
+		{
+			int coplanar;
+			C_Vector3D isectpt1, isectpt2;
+			if (!(scalar & (1u << l)))
+				VERIFY(state, !tri_tri_intersect_with_isectline(triangles[0], triangles[1 + l], &coplanar, &isectpt1, &isectpt2));
+		}
+	}
+}
+CHECK(check_tri_tri_packet);
+
+static void
+check_seg_seg_packet(C_CheckState &state)
+{
+	C_Vector3D points[2 * (1 + SEGMENT_PACKET_WIDTH)];
+	C_Line line;
+
+	for (int i = 0; i != CASES; i++)
+	{
+		C_Vector3D center(uniform(0.0, 1.0), uniform(0.0, 1.0), uniform(0.0, 1.0));
+		for (int p = 0; p != 2 * (1 + SEGMENT_PACKET_WIDTH); p++)
+			points[p] = point(i, center, 0.5);
+		if (i % 8 == 2)
+		{
+			/* a segment through the middle of P: a hit up to rounding */
+			C_Vector3D middle = 0.5 * (points[0] + points[1]);
+			points[3] = middle + (1.0 / 3.0) * (middle - points[2]);
+		}
+		if (i % 8 == 4)
+		{
+			/* parallel and zero length segments */
+			points[2] = points[0] + C_Vector3D(0.0, 0.0, 0.5);
+			points[3] = points[1] + C_Vector3D(0.0, 0.0, 0.5);
+			points[5] = points[4];
+		}
+		/* the tolerance of the octree and one which makes many near misses hits */
+		double tolerance2 = i % 3 == 0 ? 1e-2 : 1e-24;
+
+		C_SegmentPacket packet;
+		packet.count = 1 + i % SEGMENT_PACKET_WIDTH;
+		for (int l = 0; l != SEGMENT_PACKET_WIDTH; l++)
+		{
+			double q1[3], q2[3];
+			coordinates(points[2 + 2 * (l < packet.count ? l : 0)], q1);
+			coordinates(points[3 + 2 * (l < packet.count ? l : 0)], q2);
+			seg_seg_packet_set(&packet, l, q1, q2);
+		}
+		double p1[3], p2[3];
+		coordinates(points[0], p1);
+		coordinates(points[1], p2);
+
+		double scalarMidpoint[3][SEGMENT_PACKET_WIDTH];
+		unsigned int scalar = seg_seg_packet_transversal_level(SIMD_SCALAR, p1, p2, packet, tolerance2, scalarMidpoint);
+
+		/* the scalar kernel against the original */
+		for (int l = 0; l != packet.count; l++)
+		{
+			C_Line transversal = line.calculateSkewLineTransversal(points[0], points[1], points[2 + 2 * l], points[3 + 2 * l]);
+			bool hit = false;
+			if (transversal.Ns.length() == 2)
+			{
+				C_Vector3D d = transversal.Ns[0] - transversal.Ns[1];
+				hit = d.x() * d.x() + d.y() * d.y() + d.z() * d.z() < tolerance2;
+			}
+			VERIFY(state, bool(scalar & (1u << l)) == hit);
+			if (hit && (scalar & (1u << l)))
+			{
+				C_Vector3D midpoint = 0.5 * (transversal.Ns[0] + transversal.Ns[1]);
+				VERIFY(state, fabs(scalarMidpoint[0][l] - midpoint.x()) <= 1e-12 * (1.0 + fabs(midpoint.x())));
+				VERIFY(state, fabs(scalarMidpoint[1][l] - midpoint.y()) <= 1e-12 * (1.0 + fabs(midpoint.y())));
+				VERIFY(state, fabs(scalarMidpoint[2][l] - midpoint.z()) <= 1e-12 * (1.0 + fabs(midpoint.z())));
+			}
+		}
+		VERIFY(state, (scalar >> packet.count) == 0);
+
+		/* the other instruction sets and the dispatched kernel against the scalar kernel */
+		for (int level = SIMD_SSE2; level <= simd_level() + 1; level++)
+		{
+			double midpoint[3][SEGMENT_PACKET_WIDTH];
+			unsigned int mask;
+			if (level <= simd_level())
+				mask = seg_seg_packet_transversal_level(SimdLevel(level), p1, p2, packet, tolerance2, midpoint);
+			else
+				mask = seg_seg_packet_transversal(p1, p2, packet, tolerance2, midpoint);
+			VERIFY(state, mask == scalar);
+			for (int l = 0; l != packet.count; l++)
+				if (mask & scalar & (1u << l))
+					for (int n = 0; n != 3; n++)
+						VERIFY(state, fabs(midpoint[n][l] - scalarMidpoint[n][l]) <= 1e-12 * (1.0 + fabs(scalarMidpoint[n][l])));
+		}
+	}
+}
+CHECK(check_seg_seg_packet);
@@ -0,0 +1,401 @@
+/* MeshIt - a 3D mesh generator for fractured reservoirs
+ *
+ * Copyright (C) 2020
+ *
+ * Mauro Cacace (GFZ, cacace@gfz-potsdam.de),
+ * Guido Bl�cher (GFZ, bloech@gfz-potsdam.de),
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version, complemented with
+ * the following provision:
+ * For the scientific transparency and verification of results obtained
+ * and communicated to the public after using a modified version of the
+ * work, You (as the recipient of the source code and author of this
+ * modified version, used to produce the published results in scientific
+ * communications) commit to make this modified source code available in
+ * a repository that is easily and freely accessible for a duration of
+ * five years after the communication of the obtained results.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <random>
+
+#include "check.h"
+#include "render.h"
+
+/* The render buffers, the cut index and the point hierarchy need no OpenGL
+ * context, so they are checked on small meshes and clouds: the counts of a
+ * buffer, the boundary of two tetrahedra, incremental cuts against fresh
+ * selections and the budget and frustum of the point selection. */
+
+static std::mt19937 renderRng(2);
+
+/* Starts of the triangles of the face indices, sorted. */
+static QVector<quint32>
+triangleStarts(const QVector<quint32> &faceIndices)
+{
+	QVector<quint32> starts;
+	for (int i = 0; i + 2 < faceIndices.size(); i += 3)
+		starts.append(faceIndices[i]);
+	std::sort(starts.begin(), starts.end());
+	return starts;
+}
+
+/* Edges of the edge indices without direction, sorted. */
+static QVector<quint64>
+edgeKeys(const QVector<quint32> &edgeIndices)
+{
+	QVector<quint64> keys;
+	for (int i = 0; i + 1 < edgeIndices.size(); i += 2)
+	{
+		quint32 a = qMin(edgeIndices[i], edgeIndices[i + 1]);
+		quint32 b = qMax(edgeIndices[i], edgeIndices[i + 1]);
+		keys.append((quint64(a) << 32) | b);
+	}
+	std::sort(keys.begin(), keys.end());
+	return keys;
+}
+
+/* Adds the tetrahedra (four corners each, points three coordinates each) as
+ * C_Model::prepareTets() does: the faces are consecutive corners, face f of
+ * all starting at 3 f, and the edges are the points themselves. The group of
+ * a tetrahedron is 0 left of split along x, 1 right of it. */
+static void
+addTetrahedra(C_CutIndex &index, const QVector<int> &tets, const QVector<double> &points, double split)
+{
+	static const int tetFaces[4][3] = { {0,1,2}, {0,1,3}, {1,2,3}, {2,0,3} };
+	quint32 face = 0;
+	index.clear();
+	for (int t = 0; t != tets.size() / 4; t++)
+	{
+		double center[3] = { 0.0, 0.0, 0.0 };
+		for (int p = 0; p != 4; p++)
+			for (int a = 0; a != 3; a++)
+				center[a] += 0.25 * points[3 * tets[4 * t + p] + a];
+		index.addElement(center, center[0] < split ? 0 : 1);
+		for (int k = 0; k != 4; k++)
+		{
+			quint32 corners[3];
+			for (int p = 0; p != 3; p++)
+				corners[p] = quint32(tets[4 * t + tetFaces[k][p]]);
+			index.addFace(face, corners, corners);
+			face += 3;
+		}
+	}
+	index.finish();
+}
+
+/* The tetrahedra of n^3 unit cubes, each split into six along its diagonal,
+ * which share their faces across the cubes too. */
+static void
+cubeTetrahedra(int n, QVector<int> &tets, QVector<double> &points)
+{
+	static const int axes[6][3] = { {0,1,2}, {0,2,1}, {1,0,2}, {1,2,0}, {2,0,1}, {2,1,0} };
+	tets.clear();
+	points.clear();
+	for (int i = 0; i <= n; i++)
+		for (int j = 0; j <= n; j++)
+			for (int k = 0; k <= n; k++)
+			{
+				points.append(i);
+				points.append(j);
+				points.append(k);
+			}
+	for (int i = 0; i != n; i++)
+		for (int j = 0; j != n; j++)
+			for (int k = 0; k != n; k++)
+				for (int s = 0; s != 6; s++)
+				{
+					/* from the lowest to the highest corner, one axis at a time */
+					int c[3] = { i, j, k };
+					tets.append((c[0] * (n + 1) + c[1]) * (n + 1) + c[2]);
+					for (int a = 0; a != 3; a++)
+					{
+						c[axes[s][a]]++;
+						tets.append((c[0] * (n + 1) + c[1]) * (n + 1) + c[2]);
+					}
+				}
+}
+
+static void
+check_render_buffer(C_CheckState &state)
+{
+	/* a square of two triangles */
+	const double points[4][3] = { {0.0, 0.0, 0.0}, {1.0, 0.0, 0.0}, {1.0, 1.0, 0.0}, {0.0, 1.0, 0.0} };
+	const int triangles[2][3] = { {0, 1, 2}, {0, 2, 3} };
+	const double normal[3] = { 0.0, 0.0, 1.0 };
+	const float color[4] = { 1.0f, 0.0f, 0.0f, 1.0f };
+
+	/* faces with their own vertices */
+	C_RenderBuffer faces(C_RenderBuffer::TRIANGLES);
+	VERIFY(state, faces.isEmpty());
+	for (int t = 0; t != 2; t++)
+	{
+		quint32 a = faces.addVertex(points[triangles[t][0]], normal, color);
+		quint32 b = faces.addVertex(points[triangles[t][1]], normal, color);
+		quint32 c = faces.addVertex(points[triangles[t][2]], normal, color);
+		faces.addTriangle(a, b, c);
+	}
+	VERIFY(state, faces.vertexCount() == 6);
+	VERIFY(state, faces.primitiveCount() == 2);
+	VERIFY(state, faces.indices.size() == 6);
+	VERIFY(state, faces.positions.size() == 18);
+	VERIFY(state, faces.colors.size() == 24);
+	VERIFY(state, faces.hasNormals());
+	VERIFY(state, !faces.isEmpty());
+
+	/* a wireframe sharing the points, the diagonal once */
+	C_RenderBuffer edges(C_RenderBuffer::LINES);
+	for (int t = 0; t != 2; t++)
+	{
+		quint32 corner[3];
+		for (int p = 0; p != 3; p++)
+			corner[p] = edges.sharedVertex(quint64(triangles[t][p]), points[triangles[t][p]], color);
+		for (int p = 0; p != 3; p++)
+			edges.addUniqueLine(corner[p], corner[(p + 1) % 3]);
+	}
+	VERIFY(state, edges.vertexCount() == 4);
+	VERIFY(state, edges.primitiveCount() == 5);
+	VERIFY(state, edges.indices.size() == 10);
+	VERIFY(state, !edges.hasNormals());
+	VERIFY(state, edges.sharedVertex(2, points[2], color) == edges.sharedVertex(2, points[0], color));
+	VERIFY(state, edges.vertexCount() == 4);
+
+	/* points */
+	C_RenderBuffer vertices(C_RenderBuffer::POINTS);
+	for (int p = 0; p != 4; p++)
+		vertices.addPoint(vertices.addVertex(points[p], color));
+	VERIFY(state, vertices.vertexCount() == 4);
+	VERIFY(state, vertices.primitiveCount() == 4);
+
+	/* a cleared buffer forgets its shared vertices and lines */
+	edges.clear();
+	VERIFY(state, edges.isEmpty());
+	VERIFY(state, edges.vertexCount() == 0);
+	VERIFY(state, edges.primitiveCount() == 0);
+	quint32 a = edges.sharedVertex(0, points[0], color);
+	quint32 b = edges.sharedVertex(1, points[1], color);
+	edges.addUniqueLine(a, b);
+	VERIFY(state, a == 0 && b == 1);
+	VERIFY(state, edges.primitiveCount() == 1);
+}
+CHECK(check_render_buffer);
+
+static void
+check_cut_index_boundary(C_CheckState &state)
+{
+	/* two tetrahedra sharing the face of the points 1, 2 and 3 */
+	const double coordinates[5][3] = { {0.0, 0.0, 0.0}, {1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}, {1.0, 1.0, 1.0} };
+	QVector<double> points;
+	for (int p = 0; p != 5; p++)
+		for (int a = 0; a != 3; a++)
+			points.append(coordinates[p][a]);
+	QVector<int> tets;
+	const int corners[8] = { 0, 1, 2, 3, 1, 2, 3, 4 };
+	for (int c = 0; c != 8; c++)
+		tets.append(corners[c]);
+
+	/* the faces of the first tetrahedron start at 0 to 9, of the second at
+	 * 12 to 21; the shared face is the third (1,2,3) of the first and the
+	 * first (1,2,3) of the second */
+	QVector<quint32> first, second, outer;
+	for (quint32 f = 0; f != 4; f++)
+	{
+		first.append(3 * f);
+		second.append(12 + 3 * f);
+		if (f != 2)
+			outer.append(3 * f);
+		if (f != 0)
+			outer.append(12 + 3 * f);
+	}
+	std::sort(outer.begin(), outer.end());
+
+	C_CutIndex index;
+	addTetrahedra(index, tets, points, 10.0);
+	VERIFY(state, index.isFinished());
+	VERIFY(state, index.count() == 2);
+
+	const bool none[3] = { false, false, false };
+	const bool xOnly[3] = { true, false, false };
+	const bool up[3] = { true, true, true };
+	const bool down[3] = { false, false, false };
+	const double value[3] = { 0.4, 0.0, 0.0 };
+	QVector<bool> shown(2, true), hidden(2, false);
+	QVector<quint32> faceIndices, edgeIndices;
+
+	/* without cut: all faces but the shared one, all nine edges */
+	index.select(none, value, up, shown, shown, faceIndices, edgeIndices);
+	VERIFY(state, faceIndices.size() == 18);
+	VERIFY(state, triangleStarts(faceIndices) == outer);
+	VERIFY(state, edgeKeys(edgeIndices).size() == 9);
+	VERIFY(state, edgeIndices.size() == 18);
+
+	/* a face and its two following indices form the triangle */
+	bool consecutive = true;
+	for (int i = 0; i + 2 < faceIndices.size(); i += 3)
+		consecutive = consecutive && faceIndices[i + 1] == faceIndices[i] + 1 && faceIndices[i + 2] == faceIndices[i] + 2;
+	VERIFY(state, consecutive);
+
+	/* cut at x = 0.4 between the centroids (0.25 and 0.5): one tetrahedron
+	 * with its four faces and six edges */
+	index.select(xOnly, value, up, shown, shown, faceIndices, edgeIndices);
+	VERIFY(state, triangleStarts(faceIndices) == second);
+	VERIFY(state, edgeKeys(edgeIndices).size() == 6);
+	index.select(xOnly, value, down, shown, shown, faceIndices, edgeIndices);
+	VERIFY(state, triangleStarts(faceIndices) == first);
+	VERIFY(state, edgeKeys(edgeIndices).size() == 6);
+
+	/* back without cut, and the faces or edges of the group hidden */
+	index.select(none, value, up, shown, shown, faceIndices, edgeIndices);
+	VERIFY(state, triangleStarts(faceIndices) == outer);
+	index.select(none, value, up, hidden, shown, faceIndices, edgeIndices);
+	VERIFY(state, faceIndices.isEmpty());
+	VERIFY(state, edgeKeys(edgeIndices).size() == 9);
+	index.select(none, value, up, shown, hidden, faceIndices, edgeIndices);
+	VERIFY(state, triangleStarts(faceIndices) == outer);
+	VERIFY(state, edgeIndices.isEmpty());
+
+	/* in different groups the shared face bounds both */
+	addTetrahedra(index, tets, points, 0.4);
+	index.select(none, value, up, shown, shown, faceIndices, edgeIndices);
+	QVector<quint32> all = first + second;
+	std::sort(all.begin(), all.end());
+	VERIFY(state, triangleStarts(faceIndices) == all);
+	VERIFY(state, edgeKeys(edgeIndices).size() == 9);
+
+	/* a cleared index selects nothing */
+	index.clear();
+	VERIFY(state, !index.isFinished());
+	index.select(none, value, up, shown, shown, faceIndices, edgeIndices);
+	VERIFY(state, faceIndices.isEmpty() && edgeIndices.isEmpty());
+}
+CHECK(check_cut_index_boundary);
+
+static void
+check_cut_index_incremental(C_CheckState &state)
+{
+	const int n = 5;
+	QVector<int> tets;
+	QVector<double> points;
+	cubeTetrahedra(n, tets, points);
+	bool enable[3] = { false, false, false };
+	bool direction[3] = { true, true, true };
+	double value[3] = { 0.0, 0.0, 0.0 };
+	QVector<bool> showFaces(2, true), showEdges(2, true);
+	QVector<quint32> faceIndices, edgeIndices, freshFaces, freshEdges;
+
+	/* in one group, the surface of the cube: two triangles per square */
+	C_CutIndex index;
+	addTetrahedra(index, tets, points, 2.0 * n);
+	VERIFY(state, index.count() == 6 * n * n * n);
+	index.select(enable, value, direction, showFaces, showEdges, faceIndices, edgeIndices);
+	VERIFY(state, faceIndices.size() == 3 * 6 * 2 * n * n);
+
+	/* in two groups, split in the middle of the cubes */
+	addTetrahedra(index, tets, points, 0.5 * n);
+
+	/* mostly moved cut values, which are selected incrementally, now and
+	 * then another plane, direction or group shown */
+	std::uniform_real_distribution<double> cut(-0.5, n + 0.5);
+	for (int step = 0; step != 200; step++)
+	{
+		int a = step % 3;
+		if (step % 7 == 0)
+			enable[a] = !enable[a];
+		if (step % 11 == 0)
+			direction[a] = !direction[a];
+		if (step % 13 == 0)
+			showFaces[step % 2] = !showFaces[step % 2];
+		if (step % 17 == 0)
+			showEdges[step % 2] = !showEdges[step % 2];
+		value[a] = cut(renderRng);
+		index.select(enable, value, direction, showFaces, showEdges, faceIndices, edgeIndices);
+
+		C_CutIndex fresh;
+		addTetrahedra(fresh, tets, points, 0.5 * n);
+		fresh.select(enable, value, direction, showFaces, showEdges, freshFaces, freshEdges);
+		VERIFY(state, faceIndices.size() == freshFaces.size());
+		VERIFY(state, triangleStarts(faceIndices) == triangleStarts(freshFaces));
+		VERIFY(state, edgeIndices.size() == freshEdges.size());
+		VERIFY(state, edgeKeys(edgeIndices) == edgeKeys(freshEdges));
+	}
+}
+CHECK(check_cut_index_incremental);
+
+static void
+check_point_lod(C_CheckState &state)
+{
+	/* two clusters far apart, of which the view only shows the first */
+	const int cluster = 20000;
+	std::uniform_real_distribution<float> coordinate(0.0f, 100.0f);
+	QVector<float> positions;
+	for (int c = 0; c != 2; c++)
+		for (int i = 0; i != 3 * cluster; i++)
+			positions.append(coordinate(renderRng) + c * 10000.0f);
+
+	C_PointLOD lod;
+	lod.build(positions);
+	VERIFY(state, lod.count() == 2 * cluster);
+	QVector<char> seen(2 * cluster, 0);
+	bool permutation = lod.order().size() == 2 * cluster;
+	for (int i = 0; permutation && i != lod.order().size(); i++)
+	{
+		permutation = lod.order()[i] < quint32(2 * cluster) && !seen[lod.order()[i]];
+		seen[lod.order()[i]] = 1;
+	}
+	VERIFY(state, permutation);
+
+	/* orthographic view of x and y in [-10,110], z in [-200,200] */
+	double projection[16] = { 0.0 }, modelview[16] = { 0.0 };
+	projection[0] = projection[5] = 2.0 / 120.0;
+	projection[12] = projection[13] = -100.0 / 120.0;
+	projection[10] = -1.0 / 200.0;
+	projection[15] = 1.0;
+	for (int d = 0; d != 4; d++)
+		modelview[5 * d] = 1.0;
+
+	/* a large viewport shows every point of the first cluster, of the second
+	 * at most the coarse samples of the nodes holding both */
+	VERIFY(state, lod.select(projection, modelview, 1000000, 1 << 30));
+	VERIFY(state, !lod.select(projection, modelview, 1000000, 1 << 30));
+	int counts[2] = { 0, 0 };
+	QVector<char> selected(lod.count(), 0);
+	bool distinct = true;
+	for (int i = 0; i != lod.selection().size(); i++)
+	{
+		quint32 k = lod.selection()[i];
+		distinct = distinct && k < quint32(lod.count()) && !selected[k];
+		selected[k] = 1;
+		counts[lod.order()[k] / cluster]++;
+	}
+	VERIFY(state, distinct);
+	VERIFY(state, counts[0] == cluster);
+	VERIFY(state, counts[1] < cluster / 100);
+
+	/* the budget */
+	for (int budget : { 0, 1, 1000, 5000 })
+	{
+		lod.select(projection, modelview, 1000000, budget);
+		VERIFY(state, lod.selection().size() == budget);
+	}
+
+	/* a small viewport draws fewer points */
+	lod.select(projection, modelview, 10, 1 << 30);
+	VERIFY(state, lod.selection().size() > 0 && lod.selection().size() < cluster);
+
+	/* looking beside both clusters */
+	modelview[12] = 1000000.0;
+	lod.select(projection, modelview, 1000000, 1 << 30);
+	VERIFY(state, lod.selection().isEmpty());
+}
+CHECK(check_point_lod);
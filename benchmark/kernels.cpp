@@ -0,0 +1,438 @@
+/* MeshIt - a 3D mesh generator for fractured reservoirs
+ *
+ * Copyright (C) 2020
+ *
+ * Mauro Cacace (GFZ, cacace@gfz-potsdam.de),
+ * Guido Bl�cher (GFZ, bloech@gfz-potsdam.de),
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version, complemented with
+ * the following provision:
+ * For the scientific transparency and verification of results obtained
+ * and communicated to the public after using a modified version of the
+ * work, You (as the recipient of the source code and author of this
+ * modified version, used to produce the published results in scientific
+ * communications) commit to make this modified source code available in
+ * a repository that is easily and freely accessible for a duration of
+ * five years after the communication of the obtained results.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <random>
+
+#include "core.h"
+#include "geometry.h"
+#include "intersections.h"
+#include "microbenchmark.h"
+#include "seg_seg_packet.h"
+
+extern "C" int triunsuitable(REAL *triorg, REAL *tridest, REAL *triapex, REAL area);
+
+/* Number of distinct inputs cycled through by every benchmark; large enough
+ * to defeat branch prediction, small enough to stay in cache. */
+#define SAMPLES 4096
+
+static std::mt19937 rng(1);
+
+static double
+uniform(double a, double b)
+{
+	return std::uniform_real_distribution<double>(a, b)(rng);
+}
+
+static C_Vector3D
+randomPoint(double extent)
+{
+	return C_Vector3D(uniform(0.0, extent), uniform(0.0, extent), uniform(0.0, extent));
+}
+
+/* Triangles of the size of a mesh element around centres in a box of edge 0.25,
+ * with the corners up to 0.1 off the centre. About a third of the pairs
+ * intersect, as in a leaf of the octree of C_Model::calculate_int_polyline(). */
+struct C_TrianglePairs
+{
+	C_TrianglePairs()
+	{
+		for (int i = 0; i != 6 * SAMPLES; i++)
+		{
+			C_Vector3D center = randomPoint(0.25);
+			for (int n = 0; n != 3; n++)
+				vertices.append(center + C_Vector3D(uniform(-0.1, 0.1), uniform(-0.1, 0.1), uniform(-0.1, 0.1)));
+		}
+		for (int t = 0; t != 2 * SAMPLES; t++)
+		{
+			C_Triangle triangle;
+			for (int n = 0; n != 3; n++)
+				triangle.Ns[n] = &vertices[3 * t + n];
+			triangles.append(triangle);
+		}
+	}
+	QVector<C_Vector3D> vertices;
+	QVector<C_Triangle> triangles;
+};
+
+static void
+BM_tri_tri_intersect_with_isectline(C_MicroBenchmarkState &state)
+{
+	static C_TrianglePairs pairs;
+	int coplanar, i = 0, hits = 0;
+	C_Vector3D isectpt1, isectpt2;
+	while (state.keepRunning())
+	{
+		hits += tri_tri_intersect_with_isectline(pairs.triangles[2 * i], pairs.triangles[2 * i + 1], &coplanar, &isectpt1, &isectpt2);
+		doNotOptimize(isectpt1);
+		i = (i + 1) % SAMPLES;
+	}
+	doNotOptimize(hits);
+}
+MICROBENCHMARK(BM_tri_tri_intersect_with_isectline);
+
+/* A leaf of the octree: one triangle against 48 others, one by one ... */
+static void
+BM_leaf_tri_tri_scalar(C_MicroBenchmarkState &state)
+{
+	static C_TrianglePairs pairs;
+	int coplanar, i = 0, hits = 0;
+	C_Vector3D isectpt1, isectpt2;
+	while (state.keepRunning())
+	{
+		for (int t2 = 0; t2 != 48; t2++)
+			hits += tri_tri_intersect_with_isectline(pairs.triangles[i], pairs.triangles[(i + 1 + t2) % (2 * SAMPLES)], &coplanar, &isectpt1, &isectpt2);
+		doNotOptimize(isectpt1);
+		i = (i + 1) % SAMPLES;
+	}
+	doNotOptimize(hits);
+	state.setItemsProcessed(48 * state.iterations);
+}
+MICROBENCHMARK(BM_leaf_tri_tri_scalar);
+
+/* ... and in packets, as done by C_Box::split_tri() */
+static void
+BM_leaf_tri_tri_packet(C_MicroBenchmarkState &state)
+{
+	static C_TrianglePairs pairs;
+	int coplanar, i = 0, hits = 0;
+	C_Vector3D isectpt1, isectpt2;
+	C_TrianglePacket packets[48 / TRIANGLE_PACKET_WIDTH];
+	while (state.keepRunning())
+	{
+		for (int p = 0; p != 48 / TRIANGLE_PACKET_WIDTH; p++)
+		{
+			packets[p].count = TRIANGLE_PACKET_WIDTH;
+			for (int l = 0; l != TRIANGLE_PACKET_WIDTH; l++)
+				tri_tri_packet_set(&packets[p], l, pairs.triangles[(i + 1 + p * TRIANGLE_PACKET_WIDTH + l) % (2 * SAMPLES)]);
+		}
+		const C_Triangle &T1 = pairs.triangles[i];
+		double v[3][3];
+		for (int n = 0; n != 3; n++)
+		{
+			v[n][0] = T1.Ns[n]->x();
+			v[n][1] = T1.Ns[n]->y();
+			v[n][2] = T1.Ns[n]->z();
+		}
+		for (int p = 0; p != 48 / TRIANGLE_PACKET_WIDTH; p++)
+		{
+			unsigned int candidates = tri_tri_packet_candidates(v[0], v[1], v[2], packets[p]);
+			for (int l = 0; candidates != 0; l++, candidates >>= 1)
+				if (candidates & 1)
+					hits += tri_tri_intersect_with_isectline(T1, pairs.triangles[(i + 1 + p * TRIANGLE_PACKET_WIDTH + l) % (2 * SAMPLES)], &coplanar, &isectpt1, &isectpt2);
+		}
+		doNotOptimize(isectpt1);
+		i = (i + 1) % SAMPLES;
+	}
+	doNotOptimize(hits);
+	state.setItemsProcessed(48 * state.iterations);
+}
+MICROBENCHMARK(BM_leaf_tri_tri_packet);
+
+static void
+BM_triangle_ray_intersection(C_MicroBenchmarkState &state)
+{
+	static C_TrianglePairs pairs;
+	static QVector<C_Vector3D> origins, directions;
+	if (origins.isEmpty())
+		for (int i = 0; i != SAMPLES; i++)
+		{
+			origins.append(randomPoint(0.25));
+			directions.append(C_Vector3D(uniform(-0.2, 0.2), uniform(-0.2, 0.2), uniform(-0.2, 0.2)));
+		}
+	int i = 0, hits = 0;
+	C_Vector3D isectpt;
+	while (state.keepRunning())
+	{
+		hits += triangle_ray_intersection(pairs.triangles[i], origins[i], directions[i], &isectpt);
+		doNotOptimize(isectpt);
+		i = (i + 1) % SAMPLES;
+	}
+	doNotOptimize(hits);
+}
+MICROBENCHMARK(BM_triangle_ray_intersection);
+
+static void
+BM_calculateSkewLineTransversal(C_MicroBenchmarkState &state)
+{
+	static QVector<C_Vector3D> points;
+	if (points.isEmpty())
+		for (int i = 0; i != 4 * SAMPLES; i++)
+			points.append(randomPoint(1.0));
+	C_Line line;
+	int i = 0;
+	while (state.keepRunning())
+	{
+		C_Line transversal = line.calculateSkewLineTransversal(points[4 * i], points[4 * i + 1], points[4 * i + 2], points[4 * i + 3]);
+		doNotOptimize(transversal.Ns);
+		i = (i + 1) % SAMPLES;
+	}
+}
+MICROBENCHMARK(BM_calculateSkewLineTransversal);
+
+/* A leaf of the octree of C_Model::calculate_int_triplepoints(): one segment
+ * against 24 others in packets, as done by C_Box::split_seg() */
+static void
+BM_leaf_seg_seg_packet(C_MicroBenchmarkState &state)
+{
+	static QVector<C_Vector3D> points;
+	if (points.isEmpty())
+		for (int i = 0; i != 4 * SAMPLES; i++)
+			points.append(randomPoint(1.0));
+	C_SegmentPacket packets[24 / SEGMENT_PACKET_WIDTH];
+	double midpoint[3][SEGMENT_PACKET_WIDTH];
+	int i = 0, hits = 0;
+	while (state.keepRunning())
+	{
+		for (int p = 0; p != 24 / SEGMENT_PACKET_WIDTH; p++)
+		{
+			packets[p].count = SEGMENT_PACKET_WIDTH;
+			for (int l = 0; l != SEGMENT_PACKET_WIDTH; l++)
+			{
+				const C_Vector3D &Q1 = points[(4 * i + 2 * (p * SEGMENT_PACKET_WIDTH + l) + 2) % (4 * SAMPLES)];
+				const C_Vector3D &Q2 = points[(4 * i + 2 * (p * SEGMENT_PACKET_WIDTH + l) + 3) % (4 * SAMPLES)];
+				double q1[3] = { Q1.x(), Q1.y(), Q1.z() };
+				double q2[3] = { Q2.x(), Q2.y(), Q2.z() };
+				seg_seg_packet_set(&packets[p], l, q1, q2);
+			}
+		}
+		double p1[3] = { points[4 * i].x(), points[4 * i].y(), points[4 * i].z() };
+		double p2[3] = { points[4 * i + 1].x(), points[4 * i + 1].y(), points[4 * i + 1].z() };
+		for (int p = 0; p != 24 / SEGMENT_PACKET_WIDTH; p++)
+			hits += seg_seg_packet_transversal(p1, p2, packets[p], 1e-24, midpoint) != 0;
+		doNotOptimize(midpoint);
+		i = (i + 1) % SAMPLES;
+	}
+	doNotOptimize(hits);
+	state.setItemsProcessed(24 * state.iterations);
+}
+MICROBENCHMARK(BM_leaf_seg_seg_packet);
+
+/* triunsuitable() is called by Triangle for every candidate triangle of a
+ * refinement; the gradient control holds the refinement points of the
+ * intersections and triple points of a surface. */
+static void
+BM_triunsuitable(C_MicroBenchmarkState &state)
+{
+	static QVector<double> triangles, pointlist, refinesize;
+	if (triangles.isEmpty())
+	{
+		for (int i = 0; i != SAMPLES; i++)
+		{
+			double x = uniform(0.0, 1.0), y = uniform(0.0, 1.0);
+			for (int n = 0; n != 3; n++)
+			{
+				triangles.append(x + uniform(-0.02, 0.02));
+				triangles.append(y + uniform(-0.02, 0.02));
+			}
+		}
+		for (int v = 0; v != 256; v++)
+		{
+			pointlist.append(uniform(0.0, 1.0));
+			pointlist.append(uniform(0.0, 1.0));
+			refinesize.append(0.005);
+		}
+	}
+	GradientControl::getInstance().update(2.0, 0.05, refinesize.length(), pointlist.constData(), refinesize.constData());
+	int i = 0, unsuitable = 0;
+	while (state.keepRunning())
+	{
+		double *t = triangles.data() + 6 * i;
+		unsuitable += triunsuitable(t, t + 2, t + 4, 0.0);
+		i = (i + 1) % SAMPLES;
+	}
+	doNotOptimize(unsuitable);
+}
+MICROBENCHMARK(BM_triunsuitable);
+
+/* A surface with 1024 scattered data points; SPLINE and KRIGING select 256
+ * of them in their set-up, which is not part of the measurement. */
+static C_Surface *
+interpolationSurface()
+{
+	static C_Surface *surface = 0;
+	if (!surface)
+	{
+		surface = new C_Surface;
+		for (int i = 0; i != 1024; i++)
+		{
+			double x = uniform(0.0, 1.0), y = uniform(0.0, 1.0);
+			surface->SDs.append(C_Vector3D(x, y, 0.1 * ::sin(6.0 * x) * ::cos(4.0 * y) + uniform(-0.005, 0.005)));
+		}
+		surface->fillSpline();
+		surface->fillKriging();
+	}
+	return surface;
+}
+
+static QVector<C_Vector3D>
+interpolationPoints()
+{
+	QVector<C_Vector3D> points;
+	for (int i = 0; i != SAMPLES; i++)
+		points.append(C_Vector3D(uniform(0.0, 1.0), uniform(0.0, 1.0), 0.0));
+	return points;
+}
+
+static void
+BM_IDW(C_MicroBenchmarkState &state)
+{
+	C_Surface *surface = interpolationSurface();
+	static QVector<C_Vector3D> points = interpolationPoints();
+	int i = 0;
+	while (state.keepRunning())
+	{
+		double z = surface->IDW(points[i].x(), points[i].y());
+		doNotOptimize(z);
+		i = (i + 1) % SAMPLES;
+	}
+}
+MICROBENCHMARK(BM_IDW);
+
+static void
+BM_SPLINE(C_MicroBenchmarkState &state)
+{
+	C_Surface *surface = interpolationSurface();
+	static QVector<C_Vector3D> points = interpolationPoints();
+	int i = 0;
+	while (state.keepRunning())
+	{
+		double z = surface->SPLINE(points[i].x(), points[i].y());
+		doNotOptimize(z);
+		i = (i + 1) % SAMPLES;
+	}
+}
+MICROBENCHMARK(BM_SPLINE);
+
+static void
+BM_KRIGING(C_MicroBenchmarkState &state)
+{
+	C_Surface *surface = interpolationSurface();
+	static QVector<C_Vector3D> points = interpolationPoints();
+	int i = 0;
+	while (state.keepRunning())
+	{
+		double z = surface->KRIGING(points[i].x(), points[i].y());
+		doNotOptimize(z);
+		i = (i + 1) % SAMPLES;
+	}
+}
+MICROBENCHMARK(BM_KRIGING);
+
+/* Covariance matrices of planar point clouds, as assembled by
+ * C_Surface::calculate_normal_vector(). */
+static void
+BM_ComputeEigenvalue(C_MicroBenchmarkState &state)
+{
+	static QVector<double> matrices;
+	if (matrices.isEmpty())
+		for (int i = 0; i != SAMPLES; i++)
+		{
+			double a[3][3] = { { 0, 0, 0 }, { 0, 0, 0 }, { 0, 0, 0 } };
+			for (int p = 0; p != 16; p++)
+			{
+				double v[3] = { uniform(-1.0, 1.0), uniform(-1.0, 1.0), uniform(-0.05, 0.05) };
+				for (int r = 0; r != 3; r++)
+					for (int c = 0; c != 3; c++)
+						a[r][c] += v[r] * v[c];
+			}
+			for (int r = 0; r != 3; r++)
+				for (int c = 0; c != 3; c++)
+					matrices.append(a[r][c]);
+		}
+	C_Eigenvalue eigen;
+	int i = 0;
+	while (state.keepRunning())
+	{
+		for (int r = 0; r != 3; r++)
+			for (int c = 0; c != 3; c++)
+				eigen.Element[r][c] = matrices[9 * i + 3 * r + c];
+		eigen.ComputeEigenvalue();
+		doNotOptimize(eigen.Diag);
+		i = (i + 1) % SAMPLES;
+	}
+}
+MICROBENCHMARK(BM_ComputeEigenvalue);
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	QCoreApplication::setApplicationName("MeshIt-kernels");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Micro-benchmarks of the geometric kernels of MeshIt.");
+	parser.addHelpOption();
+	parser.addOptions({
+		{"filter", "Run only the benchmarks matching <regexp>.", "regexp", "."},
+		{"min-time", "Minimum measured time per benchmark in seconds.", "seconds", "0.5"},
+		{"list", "List the benchmarks and exit."},
+		{{"o", "output"}, "Write the results as JSON to <file>.", "file"},
+	});
+	parser.process(app);
+
+	QRegularExpression filter(parser.value("filter"));
+	double minTime = parser.value("min-time").toDouble();
+	QJsonArray results;
+	std::cout << "tri_tri_packet: " << tri_tri_packet_isa() << std::endl;
+	std::cout << QString("%1 %2 %3 %4").arg("Benchmark", -40).arg("Time [ns]", 14).arg("Iterations", 14).arg("Items/s", 14).toUtf8().constData() << std::endl;
+	for (int b = 0; b != C_MicroBenchmark::registry().length(); b++)
+	{
+		const QPair<QString, MicroBenchmarkFunction> &benchmark = C_MicroBenchmark::registry()[b];
+		if (!filter.match(benchmark.first).hasMatch())
+			continue;
+		if (parser.isSet("list"))
+		{
+			std::cout << benchmark.first.toUtf8().constData() << std::endl;
+			continue;
+		}
+		QJsonObject result = C_MicroBenchmark::run(benchmark.first, benchmark.second, minTime);
+		std::cout << QString("%1 %2 %3 %4")
+			.arg(benchmark.first, -40)
+			.arg(result["ns_per_iteration"].toDouble(), 14, 'f', 1)
+			.arg((qint64)result["iterations"].toDouble(), 14)
+			.arg(result["items_per_second"].toDouble(), 14, 'g', 4).toUtf8().constData() << std::endl;
+		results.append(result);
+	}
+	if (parser.isSet("output"))
+	{
+		QJsonObject report;
+		report["qt_version"] = QString(qVersion());
+		report["timestamp"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+		report["min_time"] = minTime;
+		report["tri_tri_packet_isa"] = QString(tri_tri_packet_isa());
+		report["benchmarks"] = results;
+		QFile file(parser.value("output"));
+		if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+		{
+			std::cerr << "Cannot write " << parser.value("output").toUtf8().constData() << std::endl;
+			return 1;
+		}
+		file.write(QJsonDocument(report).toJson(QJsonDocument::Indented));
+	}
+	return 0;
+}
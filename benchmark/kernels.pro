@@ -0,0 +1,93 @@
+# MeshIt - a 3D mesh generator for fractured reservoirs
+#
+# Copyright (C) 2020
+#
+# Mauro Cacace (GFZ, cacace@gfz-potsdam.de),
+# Guido Blöcher (GFZ, bloech@gfz-potsdam.de),
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as
+# published by the Free Software Foundation, either version 3 of the
+# License, or (at your option) any later version, complemented with
+# the following provision:
+# For the scientific transparency and verification of results obtained
+# and communicated to the public after using a modified version of the
+# work, You (as the recipient of the source code and author of this
+# modified version, used to produce the published results in scientific
+# communications) commit to make this modified source code available in
+# a repository that is easily and freely accessible for a duration of
+# five years after the communication of the obtained results.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Micro-benchmarks of the geometric kernels.
+#   qmake kernels.pro && make
+#   ./MeshIt-kernels --filter tri_tri --min-time 1 -o kernels.json
+
+TEMPLATE = app
+TARGET = MeshIt-kernels
+CONFIG += console release
+CONFIG += warn_off
+CONFIG -= app_bundle
+QT += widgets opengl openglwidgets
+INCLUDEPATH += ../include
+
+# Linux
+unix:!macx {
+    LIBS += -lGLU
+}
+
+# Windows - MinGW
+win32-g++ {
+    LIBS += libopengl32 libglu32 libpsapi
+}
+
+# Windows - Microsoft Visual C++
+win32-msvc* {
+    LIBS += opengl32.lib glu32.lib psapi.lib
+}
+
+DEFINES += NOEXODUS
+
+# Configuration of Triangle library.
+DEFINES += TRILIBRARY EXTERNAL_TEST
+
+HEADERS += ../include/c_vector.h \
+           ../include/geometry.h \
+           ../include/intersections.h \
+           ../include/tetgen.h \
+           ../include/triangle.h \
+           ../include/feflow.h \
+           ../include/core.h \
+           ../include/arena.h \
+           ../include/cancellation.h \
+           ../include/memorybudget.h \
+           ../include/query.h \
+           ../include/render.h \
+           ../include/seg_seg_packet.h \
+           ../include/simd.h \
+           ../include/stagecache.h \
+           ../include/tri_tri_packet.h \
+           microbenchmark.h
+SOURCES += ../src/geometry.cpp \
+           ../src/predicates.cxx \
+           ../src/tetgen.cxx \
+           ../src/triangle.c \
+           ../src/feflow.cpp \
+           ../src/core.cpp \
+           ../src/arena.cpp \
+           ../src/cancellation.cpp \
+           ../src/memorybudget.cpp \
+           ../src/query.cpp \
+           ../src/render.cpp \
+           ../src/seg_seg_packet.cpp \
+           ../src/simd.cpp \
+           ../src/stagecache.cpp \
+           ../src/tri_tri_packet.cpp \
+           kernels.cpp
@@ -0,0 +1,129 @@
+/* MeshIt - a 3D mesh generator for fractured reservoirs
+ *
+ * Copyright (C) 2020
+ *
+ * Mauro Cacace (GFZ, cacace@gfz-potsdam.de),
+ * Guido Bl�cher (GFZ, bloech@gfz-potsdam.de),
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version, complemented with
+ * the following provision:
+ * For the scientific transparency and verification of results obtained
+ * and communicated to the public after using a modified version of the
+ * work, You (as the recipient of the source code and author of this
+ * modified version, used to produce the published results in scientific
+ * communications) commit to make this modified source code available in
+ * a repository that is easily and freely accessible for a duration of
+ * five years after the communication of the obtained results.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _MICROBENCHMARK_H_
+#define _MICROBENCHMARK_H_
+
+#include <QtCore/QtCore>
+
+#include <iostream>
+
+/*! \class C_MicroBenchmarkState
+*	\brief Iteration state handed to a micro-benchmark, modelled after
+*	benchmark::State of Google Benchmark.
+*	\details A benchmark body prepares its input outside of the timed loop and
+*	then runs <tt>while (state.keepRunning()) { ... }</tt>. Every iteration
+*	should perform one operation, or setItemsProcessed() reports how many
+*	operations the whole loop performed.
+*/
+class C_MicroBenchmarkState
+{
+public:
+	C_MicroBenchmarkState(qint64 iterations) : iterations(iterations), remaining(iterations), items(-1), elapsed(0) {};
+
+	inline bool keepRunning()
+	{
+		if (remaining == iterations)
+			timer.start();
+		if (remaining-- > 0)
+			return true;
+		elapsed = timer.nsecsElapsed();
+		return false;
+	}
+	void setItemsProcessed(qint64 items) { this->items = items; }
+
+	qint64 iterations;
+	qint64 remaining;
+	qint64 items;
+	qint64 elapsed;
+	QElapsedTimer timer;
+};
+
+/*!	\brief Prevents the compiler from optimizing away the computation of \a value. */
+template <class T>
+inline void doNotOptimize(const T &value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "m"(value) : "memory");
+#else
+	static volatile const T *sink;
+	sink = &value;
+#endif
+}
+
+typedef void (*MicroBenchmarkFunction)(C_MicroBenchmarkState &);
+
+/*! \class C_MicroBenchmark
+*	\brief Registry and runner of micro-benchmarks.
+*	\details Each benchmark is run with a growing number of iterations until a
+*	run takes at least \a minTime seconds; the last run is reported.
+*/
+class C_MicroBenchmark
+{
+public:
+	static QList<QPair<QString, MicroBenchmarkFunction> > &registry()
+	{
+		static QList<QPair<QString, MicroBenchmarkFunction> > benchmarks;
+		return benchmarks;
+	}
+	static int add(const char *name, MicroBenchmarkFunction function)
+	{
+		registry().append(qMakePair(QString(name), function));
+		return registry().length();
+	}
+	static QJsonObject run(const QString &name, MicroBenchmarkFunction function, double minTime)
+	{
+		qint64 iterations = 1;
+		C_MicroBenchmarkState *state = 0;
+		while (true)
+		{
+			delete state;
+			state = new C_MicroBenchmarkState(iterations);
+			function(*state);
+			if (state->elapsed >= minTime * 1.0e9 || iterations >= Q_INT64_C(1000000000))
+				break;
+			/* aim at 1.4 times the minimum time, growing at most tenfold per step */
+			double factor = state->elapsed > 0 ? 1.4 * minTime * 1.0e9 / state->elapsed : 10.0;
+			iterations = qMax(iterations + 1, (qint64)(iterations * qMin(factor, 10.0)));
+		}
+		qint64 items = state->items < 0 ? state->iterations : state->items;
+		QJsonObject result;
+		result["name"] = name;
+		result["iterations"] = state->iterations;
+		result["ns_per_iteration"] = (double)state->elapsed / state->iterations;
+		result["items_per_second"] = state->elapsed > 0 ? items * 1.0e9 / state->elapsed : 0.0;
+		delete state;
+		return result;
+	}
+};
+
+#define MICROBENCHMARK(function) \
+	static int microbenchmark_##function = C_MicroBenchmark::add(#function, function)
+
+#endif	// _MICROBENCHMARK_H_
@@ -0,0 +1,461 @@
+/* MeshIt - a 3D mesh generator for fractured reservoirs
+ *
+ * Copyright (C) 2020
+ *
+ * Mauro Cacace (GFZ, cacace@gfz-potsdam.de),
+ * Guido Bl�cher (GFZ, bloech@gfz-potsdam.de),
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version, complemented with
+ * the following provision:
+ * For the scientific transparency and verification of results obtained
+ * and communicated to the public after using a modified version of the
+ * work, You (as the recipient of the source code and author of this
+ * modified version, used to produce the published results in scientific
+ * communications) commit to make this modified source code available in
+ * a repository that is easily and freely accessible for a duration of
+ * five years after the communication of the obtained results.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <iostream>
+
+#include "geometry.h"
+#include "pipeline.h"
+#include "synthetic.h"
+
+C_Benchmark::C_Benchmark(C_Model *model)
+{
+	this->model = model;
+}
+
+void
+C_Benchmark::stage(QString name, QElapsedTimer &timer)
+{
+	this->stages.append(qMakePair(name, timer.nsecsElapsed() / 1.0e6));
+	std::cerr << ">" << name.toUtf8().constData() << ": " << this->stages.last().second << " ms" << std::endl;
+	timer.restart();
+}
+
+void
+C_Benchmark::accumulate(QString name, QElapsedTimer &timer)
+{
+	double elapsed = timer.nsecsElapsed() / 1.0e6;
+	functionsMutex.lock();
+	this->functions[name] += elapsed;
+	functionsMutex.unlock();
+	timer.restart();
+}
+
+void
+C_Benchmark::preMeshJob(QString prefix)
+{
+	QElapsedTimer timer;
+	timer.start();
+	// results of unchanged surfaces, polylines and intersections are restored from the pre-mesh cache
+	model->premesh_begin(model->intAlgorythm, 2.0);
+	QList<int> surfaces, polylines;
+	QList<QPair<int, int> > pairs;
+	for (int s = 0; s != model->Surfaces.length(); s++)
+		if (!model->restore_surface(s))
+			surfaces.append(s);
+	for (int p = 0; p != model->Polylines.length(); p++)
+		if (!model->restore_polyline(p))
+			polylines.append(p);
+	this->stage(prefix + "restore", timer);
+	// convex hull
+	for (int i = 0; i != surfaces.length(); i++)
+		QThreadPool::globalInstance()->start(new C_BenchmarkTask(this, "CONVEXHULL", surfaces[i], 0));
+	QThreadPool::globalInstance()->waitForDone();
+	this->stage(prefix + "convexhull", timer);
+	// segments
+	for (int i = 0; i != polylines.length(); i++)
+		QThreadPool::globalInstance()->start(new C_BenchmarkTask(this, "SEGMENTS", polylines[i], 0));
+	QThreadPool::globalInstance()->waitForDone();
+	this->stage(prefix + "segments", timer);
+	// triangulation (coarse)
+	for (int i = 0; i != surfaces.length(); i++)
+		QThreadPool::globalInstance()->start(new C_BenchmarkTask(this, "TRIANGLES", surfaces[i], 0));
+	QThreadPool::globalInstance()->waitForDone();
+	for (int i = 0; i != surfaces.length(); i++)
+		model->store_surface(surfaces[i]);
+	for (int i = 0; i != polylines.length(); i++)
+		model->store_polyline(polylines[i]);
+	this->stage(prefix + "triangles", timer);
+	// intersection: surface-surface
+	model->Intersections.clear();
+	model->IntersectionKeys.clear();
+	for (int s1 = 0; s1 < model->Surfaces.length() - 1; s1++)
+		for (int s2 = s1 + 1; s2 != model->Surfaces.length(); s2++)
+			if (!model->restore_int_polyline(s1, s2))
+				pairs.append(qMakePair(s1, s2));
+	for (int i = 0; i != pairs.length(); i++)
+		QThreadPool::globalInstance()->start(new C_BenchmarkTask(this, "INTERSECTION_MESH_MESH", pairs[i].first, pairs[i].second));
+	QThreadPool::globalInstance()->waitForDone();
+	int meshMesh = model->Intersections.length();
+	this->stage(prefix + "intersection_mesh_mesh", timer);
+	// intersection: surface-polyline
+	pairs.clear();
+	for (int p = 0; p != model->Polylines.length(); p++)
+		for (int s = 0; s != model->Surfaces.length(); s++)
+			if (!model->restore_int_point(p, s))
+				pairs.append(qMakePair(p, s));
+	for (int i = 0; i != pairs.length(); i++)
+		QThreadPool::globalInstance()->start(new C_BenchmarkTask(this, "INTERSECTION_POLYLINE_MESH", pairs[i].first, pairs[i].second));
+	QThreadPool::globalInstance()->waitForDone();
+	model->link_intersections(meshMesh);
+	model->calculate_size_of_intersections();
+	this->stage(prefix + "intersection_polyline_mesh", timer);
+	// intersection: triple points
+	model->TPs.clear();
+	pairs.clear();
+	for (int i1 = 0; i1 < model->Intersections.length() - 1; i1++)
+		for (int i2 = i1 + 1; i2 != model->Intersections.length(); i2++)
+			if (!model->restore_int_triplepoints(i1, i2))
+				pairs.append(qMakePair(i1, i2));
+	for (int i = 0; i != pairs.length(); i++)
+		QThreadPool::globalInstance()->start(new C_BenchmarkTask(this, "INTERSECTION_TRIPLEPOINTS", pairs[i].first, pairs[i].second));
+	QThreadPool::globalInstance()->waitForDone();
+	model->insert_int_triplepoints();
+	this->stage(prefix + "intersection_triplepoints", timer);
+	// aligning convex hull to intersection
+	for (int s = 0; s != model->Surfaces.length(); s++)
+		model->Surfaces[s].alignIntersectionsToConvexHull();
+	this->stage(prefix + "align_convexhull", timer);
+	// constraints
+	for (int s = 0; s != model->Surfaces.length(); s++)
+		model->Surfaces[s].calculate_Constraints();
+	for (int p = 0; p != model->Polylines.length(); p++)
+		model->Polylines[p].calculate_Constraints();
+	model->calculate_size_of_constraints();
+	for (int s = 0; s != model->Surfaces.length(); s++)
+		for (int c = 0; c != model->Surfaces[s].Constraints.length(); c++)
+			model->Surfaces[s].Constraints[c].Type = "SEGMENTS";
+	for (int p = 0; p != model->Polylines.length(); p++)
+		for (int c = 0; c != model->Polylines[p].Constraints.length(); c++)
+			model->Polylines[p].Constraints[c].Type = "SEGMENTS";
+	model->premesh_end();
+	this->stage(prefix + "constraints", timer);
+}
+
+void
+C_Benchmark::MeshJob(QString switches)
+{
+	QElapsedTimer timer;
+	timer.start();
+	// segments - fine
+	for (int p = 0; p != model->Polylines.length(); p++)
+		QThreadPool::globalInstance()->start(new C_BenchmarkTask(this, "SEGMENTS_FINE", p, 0));
+	QThreadPool::globalInstance()->waitForDone();
+	this->stage("segments_fine", timer);
+	// triangulation - fine, the largest surfaces first
+	QList<QPair<qint64, int> > estimates;
+	for (int s = 0; s != model->Surfaces.length(); s++)
+		estimates.append(qMakePair(-model->Surfaces[s].estimate_fine_memory(), s));
+	std::stable_sort(estimates.begin(), estimates.end());
+	model->MemoryBudget.reset();
+	for (int i = 0; i != estimates.length(); i++)
+		QThreadPool::globalInstance()->start(new C_BenchmarkTask(this, "TRIANGLES_FINE", estimates[i].second, 0));
+	QThreadPool::globalInstance()->waitForDone();
+	this->stage("triangles_fine", timer);
+	// tetrahedralization, quiet (Q) as tetgen reports to stdout, which is kept for the report
+	if (!switches.contains('Q'))
+		switches += "Q";
+	model->calculate_tets(switches);
+	this->stage("tetrahedralization", timer);
+}
+
+void
+C_Benchmark::exportJob(QString directory)
+{
+	QElapsedTimer timer;
+	QString borderIDs;
+	for (int s = 0; s != model->Surfaces.length(); s++)
+		if (model->Surfaces[s].Type == "BORDER")
+			borderIDs += QString::number(s) + ",";
+	model->FilePath = directory;
+	timer.start();
+	model->FileNameTmp = directory + "/model.vtu";
+	model->ExportVTU3D();
+	this->stage("export_vtu", timer);
+	model->FileNameTmp = directory + "/model.fem";
+	model->ExportFeFlow();
+	this->stage("export_feflow", timer);
+	model->FileNameTmp = directory + "/model.msh";
+	model->ExportOGS();
+	this->stage("export_ogs", timer);
+	model->FileNameTmp = directory + "/model.mphtxt";
+	model->ExportCOMSOL();
+	this->stage("export_comsol", timer);
+	model->FileNameTmp = directory + "/model.inp";
+	model->ExportABAQUS(borderIDs);
+	this->stage("export_abaqus", timer);
+}
+
+void
+C_Benchmark::runThreadPool(QString Attribute, int Object1, int Object2)
+{
+	QElapsedTimer timer;
+	timer.start();
+	if (Attribute == "CONVEXHULL")
+	{
+		model->Surfaces[Object1].calculate_normal_vector();
+		model->Surfaces[Object1].rotate(true);
+		this->accumulate("rotate", timer);
+		model->Surfaces[Object1].calculate_convex_hull();
+		this->accumulate("calculate_convex_hull", timer);
+		model->Surfaces[Object1].interpolation("ConvexHull", model->intAlgorythm);
+		this->accumulate("interpolation", timer);
+		model->Surfaces[Object1].rotate(false);
+		this->accumulate("rotate", timer);
+	}
+	if (Attribute == "SEGMENTS")
+	{
+		model->Polylines[Object1].calculate_segments(false);
+		model->Polylines[Object1].Intersections.clear();
+		model->Polylines[Object1].Path.calculate_min_max();
+		this->accumulate("calculate_segments", timer);
+	}
+	if (Attribute == "SEGMENTS_FINE")
+	{
+		model->Polylines[Object1].calculate_segments(true);
+		model->Polylines[Object1].Path.calculate_min_max();
+		this->accumulate("calculate_segments", timer);
+	}
+	if (Attribute == "TRIANGLES")
+	{
+		model->Surfaces[Object1].rotate(true);
+		this->accumulate("rotate", timer);
+		model->Surfaces[Object1].calculate_triangles(false);
+		this->accumulate("calculate_triangles", timer);
+		model->Surfaces[Object1].interpolation("Mesh", model->intAlgorythm);
+		this->accumulate("interpolation", timer);
+		model->Surfaces[Object1].rotate(false);
+		this->accumulate("rotate", timer);
+		model->Surfaces[Object1].Intersections.clear();
+		model->Surfaces[Object1].calculate_min_max();
+		for (int t = 0; t != model->Surfaces[Object1].Ts.length(); t++)
+		{
+			model->Surfaces[Object1].Ts[t].calculate_min_max();
+			model->Surfaces[Object1].Ts[t].setNormalVector();
+		}
+	}
+	if (Attribute == "TRIANGLES_FINE")
+	{
+		qint64 estimate = model->Surfaces[Object1].estimate_fine_memory();
+		model->MemoryBudget.acquire(estimate);
+		model->Surfaces[Object1].calculate_normal_vector();
+		model->Surfaces[Object1].rotate(true);
+		this->accumulate("rotate", timer);
+		model->Surfaces[Object1].separate_Constraints();
+		model->Surfaces[Object1].calculate_triangles(true);
+		this->accumulate("calculate_triangles", timer);
+		model->Surfaces[Object1].interpolation("Mesh", model->intAlgorythm);
+		this->accumulate("interpolation", timer);
+		model->Surfaces[Object1].rotate(false);
+		this->accumulate("rotate", timer);
+		for (int t = 0; t != model->Surfaces[Object1].Ts.length(); t++)
+		{
+			model->Surfaces[Object1].Ts[t].calculate_min_max();
+			model->Surfaces[Object1].Ts[t].setNormalVector();
+		}
+		model->MemoryBudget.release(estimate, model->Surfaces[Object1].fine_memory());
+	}
+	if (Attribute == "INTERSECTION_POLYLINE_MESH")
+	{
+		model->calculate_int_point(Object1, Object2);
+		this->accumulate("calculate_int_point", timer);
+	}
+	if (Attribute == "INTERSECTION_MESH_MESH")
+	{
+		model->calculate_int_polyline(Object1, Object2);
+		this->accumulate("calculate_int_polyline", timer);
+	}
+	if (Attribute == "INTERSECTION_TRIPLEPOINTS")
+	{
+		model->calculate_int_triplepoints(Object1, Object2);
+		this->accumulate("calculate_int_triplepoints", timer);
+	}
+}
+
+QJsonObject
+C_Benchmark::statistics() const
+{
+	long scatteredData = 0, convexHull = 0, triangles = 0, segments = 0, constraints = 0;
+	for (int s = 0; s != model->Surfaces.length(); s++)
+	{
+		scatteredData += model->Surfaces[s].SDs.length();
+		convexHull += model->Surfaces[s].ConvexHull.Ns.length();
+		triangles += model->Surfaces[s].Ts.length();
+		constraints += model->Surfaces[s].Constraints.length();
+	}
+	for (int p = 0; p != model->Polylines.length(); p++)
+	{
+		scatteredData += model->Polylines[p].SDs.length();
+		segments += model->Polylines[p].Path.Ns.length();
+	}
+	QJsonObject statistics;
+	statistics["surfaces"] = model->Surfaces.length();
+	statistics["polylines"] = model->Polylines.length();
+	statistics["scattered_data"] = (qint64)scatteredData;
+	statistics["convexhull_points"] = (qint64)convexHull;
+	statistics["triangles"] = (qint64)triangles;
+	statistics["segment_points"] = (qint64)segments;
+	statistics["constraints"] = (qint64)constraints;
+	statistics["intersections"] = model->Intersections.length();
+	statistics["triplepoints"] = model->TPs.length();
+	statistics["fine_memory_estimated"] = model->MemoryBudget.estimated();
+	statistics["fine_memory_actual"] = model->MemoryBudget.actual();
+	statistics["fine_memory_peak_admitted"] = model->MemoryBudget.peak();
+	statistics["fine_memory_throttled"] = model->MemoryBudget.throttled();
+	statistics["peak_resident_set_size"] = C_MemoryBudget::peakResidentSetSize();
+	if (model->Mesh)
+	{
+		statistics["mesh_points"] = (qint64)model->Mesh->numberofpoints;
+		statistics["mesh_tetrahedra"] = (qint64)model->Mesh->numberoftetrahedra;
+	}
+	return statistics;
+}
+
+QJsonObject
+C_Benchmark::results() const
+{
+	QJsonObject results;
+	QJsonArray stages;
+	double total = 0.0;
+	for (int s = 0; s != this->stages.length(); s++)
+	{
+		QJsonObject stage;
+		stage["name"] = this->stages[s].first;
+		stage["ms"] = this->stages[s].second;
+		stages.append(stage);
+		total += this->stages[s].second;
+	}
+	QJsonObject functions;
+	for (QMap<QString, double>::const_iterator it = this->functions.constBegin(); it != this->functions.constEnd(); ++it)
+		functions[it.key()] = it.value();
+	results["stages"] = stages;
+	results["functions_cpu_ms"] = functions;
+	results["total_ms"] = total;
+	results["model"] = this->statistics();
+	return results;
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	QCoreApplication::setApplicationName("MeshIt-benchmark");
+
+	C_SyntheticModel synthetic;
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Runs the MeshIt pipeline on a synthetic reservoir model and reports the time of every stage as JSON.");
+	parser.addHelpOption();
+	parser.addOptions({
+		{"horizons", "Number of horizons (UNIT surfaces).", "n", QString::number(synthetic.horizons)},
+		{"faults", "Number of faults (FAULT surfaces).", "n", QString::number(synthetic.faults)},
+		{"wells", "Number of wells (WELL polylines).", "n", QString::number(synthetic.wells)},
+		{"density", "Scattered data points along each side of a surface.", "n", QString::number(synthetic.density)},
+		{"noise", "Gaussian noise relative to the layer thickness.", "value", QString::number(synthetic.noise)},
+		{"dip", "Dip of the faults in degrees.", "degrees", QString::number(synthetic.dip)},
+		{"size", "Target element size (0 = automatic).", "value", QString::number(synthetic.size)},
+		{"seed", "Seed of the random generator.", "n", QString::number(synthetic.seed)},
+		{"interpolation", "Interpolation algorithm (IDW, SPLINE, KRIGING).", "name", synthetic.interpolation},
+		{"threads", "Maximum number of worker threads (0 = all cores).", "n", "0"},
+		{"repeat", "Number of repetitions.", "n", "1"},
+		{"switches", "Switches passed to tetgen (always quiet).", "switches", "pq1.2AY"},
+		{"memory-budget", "Memory budget of the fine triangulation in GiB (0 = none).", "GiB", "0"},
+		{"premesh-only", "Stop after the pre-mesh job."},
+		{"edit", "Change the size of one surface and time the incremental rerun of the pre-mesh job."},
+		{"export", "Also time the exporters."},
+		{{"o", "output"}, "Write the JSON report to <file> instead of stdout.", "file"},
+	});
+	parser.process(app);
+
+	synthetic.horizons = parser.value("horizons").toInt();
+	synthetic.faults = parser.value("faults").toInt();
+	synthetic.wells = parser.value("wells").toInt();
+	synthetic.density = parser.value("density").toInt();
+	synthetic.noise = parser.value("noise").toDouble();
+	synthetic.dip = parser.value("dip").toDouble();
+	synthetic.size = parser.value("size").toDouble();
+	synthetic.seed = parser.value("seed").toUInt();
+	synthetic.interpolation = parser.value("interpolation");
+	if (parser.value("threads").toInt() > 0)
+		QThreadPool::globalInstance()->setMaxThreadCount(parser.value("threads").toInt());
+	int repeat = qMax(1, parser.value("repeat").toInt());
+
+	/* calculate_tets() writes tetgen in/out files to the current directory */
+	QTemporaryDir workDir;
+	if (!workDir.isValid())
+	{
+		std::cerr << "Cannot create a temporary directory." << std::endl;
+		return 1;
+	}
+	QString previousDir = QDir::currentPath();
+	QDir::setCurrent(workDir.path());
+
+	QJsonArray runs;
+	for (int r = 0; r != repeat; r++)
+	{
+		std::cerr << ">Run " << r + 1 << "/" << repeat << std::endl;
+		C_Model model;
+		C_Benchmark benchmark(&model);
+		model.MemoryBudget.setLimit((qint64)(parser.value("memory-budget").toDouble() * 1024 * 1024 * 1024));
+		QElapsedTimer timer;
+		timer.start();
+		synthetic.generate(model);
+		double generate = timer.nsecsElapsed() / 1.0e6;
+		benchmark.preMeshJob();
+		if (parser.isSet("edit") && !model.Surfaces.isEmpty())
+		{
+			// the first horizon, following the six borders
+			C_Surface &surface = model.Surfaces[qMin(6, (int)model.Surfaces.length() - 1)];
+			surface.size *= 0.9;
+			benchmark.preMeshJob("rerun_");
+		}
+		if (!parser.isSet("premesh-only"))
+		{
+			benchmark.MeshJob(parser.value("switches"));
+			if (parser.isSet("export") && model.Mesh)
+				benchmark.exportJob(workDir.path());
+		}
+		QJsonObject run = benchmark.results();
+		run["generate_ms"] = generate;
+		runs.append(run);
+	}
+	QDir::setCurrent(previousDir);
+
+	QJsonObject report;
+	report["parameters"] = synthetic.parameters();
+	report["threads"] = QThreadPool::globalInstance()->maxThreadCount();
+	report["switches"] = parser.value("switches");
+	report["memory_budget"] = (qint64)(parser.value("memory-budget").toDouble() * 1024 * 1024 * 1024);
+	report["qt_version"] = QString(qVersion());
+	report["timestamp"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+	report["runs"] = runs;
+
+	QByteArray json = QJsonDocument(report).toJson(QJsonDocument::Indented);
+	if (parser.isSet("output"))
+	{
+		QFile file(parser.value("output"));
+		if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+		{
+			std::cerr << "Cannot write " << parser.value("output").toUtf8().constData() << std::endl;
+			return 1;
+		}
+		file.write(json);
+	}
+	else
+		std::cout << json.constData();
+	return 0;
+}
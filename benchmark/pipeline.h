@@ -0,0 +1,85 @@
+/* MeshIt - a 3D mesh generator for fractured reservoirs
+ *
+ * Copyright (C) 2020
+ *
+ * Mauro Cacace (GFZ, cacace@gfz-potsdam.de),
+ * Guido Bl�cher (GFZ, bloech@gfz-potsdam.de),
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version, complemented with
+ * the following provision:
+ * For the scientific transparency and verification of results obtained
+ * and communicated to the public after using a modified version of the
+ * work, You (as the recipient of the source code and author of this
+ * modified version, used to produce the published results in scientific
+ * communications) commit to make this modified source code available in
+ * a repository that is easily and freely accessible for a duration of
+ * five years after the communication of the obtained results.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _PIPELINE_H_
+#define _PIPELINE_H_
+
+#include <QtCore/QtCore>
+
+class C_Model;
+
+/*! \class C_Benchmark
+*	\brief Runs the pre-mesh and mesh jobs of the command line on a model and
+*	records the time spent in every stage.
+*	\details The stages are scheduled on the global QThreadPool exactly like
+*	C_CommandLine does. Besides the wall time of every stage, the time spent
+*	in the individual geometry functions is summed over all worker threads.
+*/
+class C_Benchmark
+{
+public:
+	C_Benchmark(C_Model *model);
+	void runThreadPool(QString, int, int);
+	void preMeshJob(QString prefix = QString());
+	void MeshJob(QString switches);
+	void exportJob(QString directory);
+	QJsonObject statistics() const;
+	QJsonObject results() const;
+
+private:
+	void stage(QString name, QElapsedTimer &timer);
+	void accumulate(QString name, QElapsedTimer &timer);
+
+	C_Model *model;
+/// \brief Wall time of every stage in ms, in order of execution.
+	QList<QPair<QString, double> > stages;
+/// \brief Time per geometry function in ms, summed over all threads.
+	QMap<QString, double> functions;
+	QMutex functionsMutex;
+};
+
+class C_BenchmarkTask : public QRunnable
+{
+public:
+	C_BenchmarkTask(C_Benchmark *benchmark, const QString& Attribute, const int& Object1, const int& Object2) :
+		benchmark(benchmark), Attribute_(Attribute), Object1_(Object1), Object2_(Object2)
+	{};
+protected:
+	C_Benchmark *benchmark;
+	void run()
+	{
+		benchmark->runThreadPool(Attribute_, Object1_, Object2_);
+	}
+private:
+	QString Attribute_;
+	int Object1_;
+	int Object2_;
+};
+
+#endif	// _PIPELINE_H_
@@ -0,0 +1,232 @@
+/* MeshIt - a 3D mesh generator for fractured reservoirs
+ *
+ * Copyright (C) 2020
+ *
+ * Mauro Cacace (GFZ, cacace@gfz-potsdam.de),
+ * Guido Blöcher (GFZ, bloech@gfz-potsdam.de),
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version, complemented with
+ * the following provision:
+ * For the scientific transparency and verification of results obtained
+ * and communicated to the public after using a modified version of the
+ * work, You (as the recipient of the source code and author of this
+ * modified version, used to produce the published results in scientific
+ * communications) commit to make this modified source code available in
+ * a repository that is easily and freely accessible for a duration of
+ * five years after the communication of the obtained results.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <random>
+
+#include "geometry.h"
+#include "synthetic.h"
+
+/* Surfaces reach this far (relative to the extent) beyond the box so that
+ * neighbouring surfaces always intersect along a proper polyline. */
+#define MARGIN 0.05
+
+C_SyntheticModel::C_SyntheticModel()
+{
+	this->horizons = 3;
+	this->faults = 2;
+	this->wells = 2;
+	this->density = 32;
+	this->noise = 0.02;
+	this->dip = 70.0;
+	this->size = 0.0;
+	this->extent[0] = 10000.0;
+	this->extent[1] = 10000.0;
+	this->extent[2] = 3000.0;
+	this->seed = 1;
+	this->interpolation = "IDW";
+}
+
+QJsonObject
+C_SyntheticModel::parameters() const
+{
+	QJsonObject p;
+	p["horizons"] = horizons;
+	p["faults"] = faults;
+	p["wells"] = wells;
+	p["density"] = density;
+	p["noise"] = noise;
+	p["dip"] = dip;
+	p["size"] = size;
+	p["extent"] = QJsonArray() << extent[0] << extent[1] << extent[2];
+	p["seed"] = (qint64)seed;
+	p["interpolation"] = interpolation;
+	return p;
+}
+
+/* Depth of horizon h at (x,y): equally spaced, gently folded layers. The fold
+ * amplitude stays below a quarter of the layer thickness, so horizons never
+ * cross each other. */
+double
+C_SyntheticModel::horizonDepth(int h, double x, double y) const
+{
+	if (h < 0)
+		return 0.0;
+	if (h >= horizons)
+		return -extent[2];
+	double thickness = extent[2] / (horizons + 1);
+	double amplitude = 0.2 * thickness;
+	return -thickness * (h + 1) + amplitude * ::sin(2.0 * M_PI * x / extent[0] + h) * ::cos(M_PI * y / extent[1]);
+}
+
+/* x position of fault f at depth z. Faults dip alternately to the east and
+ * to the west, so neighbouring faults may cross and produce triple points. */
+double
+C_SyntheticModel::faultPosition(int f, double z) const
+{
+	double x0 = extent[0] * (f + 1) / (faults + 1);
+	double direction = (f % 2 == 0) ? 1.0 : -1.0;
+	return x0 + direction * (z + 0.5 * extent[2]) / ::tan(radians(dip));
+}
+
+void
+C_SyntheticModel::generate(C_Model &model) const
+{
+	std::mt19937 rng(seed);
+	std::normal_distribution<double> gauss(0.0, 1.0);
+	std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+	const double Lx = extent[0], Ly = extent[1], Lz = extent[2];
+	const double thickness = Lz / (horizons + 1);
+	const int n = density < 3 ? 3 : density;
+	const int nb = n / 2 < 4 ? 4 : n / 2;
+
+	model.Surfaces.clear();
+	model.Polylines.clear();
+	model.Intersections.clear();
+	model.TPs.clear();
+	model.Mats.clear();
+	model.intAlgorythm = interpolation;
+
+	/* parameter of grid node i out of m, covering [-MARGIN, 1+MARGIN] */
+	auto grid = [](int i, int m) { return -MARGIN + (1.0 + 2.0 * MARGIN) * i / (m - 1); };
+	/* scattered (jittered) grid parameter */
+	auto jitter = [&](int i, int m) { return grid(i, m) + 0.25 * (uniform(rng) - 0.5) * (1.0 + 2.0 * MARGIN) / (m - 1); };
+
+	// borders: six planes closing the box
+	const char *borderNames[6] = { "border_xmin", "border_xmax", "border_ymin", "border_ymax", "border_top", "border_bottom" };
+	for (int b = 0; b != 6; b++)
+	{
+		C_Surface border;
+		border.Name = borderNames[b];
+		border.Type = "BORDER";
+		border.MaterialID = -1;
+		border.size = size;
+		for (int i = 0; i != nb; i++)
+			for (int j = 0; j != nb; j++)
+			{
+				double u = grid(i, nb), v = grid(j, nb);
+				if (b == 0) border.SDs.append(C_Vector3D(0.0, Ly * u, -Lz * v));
+				if (b == 1) border.SDs.append(C_Vector3D(Lx, Ly * u, -Lz * v));
+				if (b == 2) border.SDs.append(C_Vector3D(Lx * u, 0.0, -Lz * v));
+				if (b == 3) border.SDs.append(C_Vector3D(Lx * u, Ly, -Lz * v));
+				if (b == 4) border.SDs.append(C_Vector3D(Lx * u, Ly * v, 0.0));
+				if (b == 5) border.SDs.append(C_Vector3D(Lx * u, Ly * v, -Lz));
+			}
+		model.Surfaces.append(border);
+	}
+
+	// horizons: folded layers with gaussian noise on z
+	for (int h = 0; h != horizons; h++)
+	{
+		C_Surface horizon;
+		horizon.Name = QString("horizon_%1").arg(h);
+		horizon.Type = "UNIT";
+		horizon.MaterialID = -1;
+		horizon.size = size;
+		for (int i = 0; i != n; i++)
+			for (int j = 0; j != n; j++)
+			{
+				double x = Lx * jitter(i, n);
+				double y = Ly * jitter(j, n);
+				double z = horizonDepth(h, x, y) + noise * thickness * gauss(rng);
+				horizon.SDs.append(C_Vector3D(x, y, z));
+			}
+		model.Surfaces.append(horizon);
+	}
+
+	// faults: dipping planes spanning the whole box in y and z
+	for (int f = 0; f != faults; f++)
+	{
+		C_Surface fault;
+		fault.Name = QString("fault_%1").arg(f);
+		fault.Type = "FAULT";
+		fault.MaterialID = f;
+		fault.size = size;
+		for (int i = 0; i != n; i++)
+			for (int j = 0; j != n; j++)
+			{
+				double y = Ly * jitter(i, n);
+				double z = -Lz * jitter(j, n);
+				double x = faultPosition(f, z) + 0.5 * noise * thickness * gauss(rng);
+				fault.SDs.append(C_Vector3D(x, y, z));
+			}
+		model.Surfaces.append(fault);
+	}
+
+	// wells: vertical down to the kick-off point, then deviated
+	for (int w = 0; w != wells; w++)
+	{
+		C_Polyline well;
+		well.Name = QString("well_%1").arg(w);
+		well.Type = "WELL";
+		well.MaterialID = w;
+		well.size = size;
+		C_Vector3D p(Lx * (0.15 + 0.7 * uniform(rng)), Ly * (0.15 + 0.7 * uniform(rng)), 0.02 * Lz);
+		double kickoff = -Lz * (0.1 + 0.2 * uniform(rng));
+		double azimuth = 2.0 * M_PI * uniform(rng);
+		double inclination = radians(30.0 + 30.0 * uniform(rng));
+		double step = Lz / 50.0;
+		well.SDs.append(p);
+		while (p.z() > -0.9 * Lz)
+		{
+			if (p.z() > kickoff)
+				p += C_Vector3D(0.0, 0.0, -step);
+			else
+				p += step * C_Vector3D(::sin(inclination) * ::cos(azimuth), ::sin(inclination) * ::sin(azimuth), -::cos(inclination));
+			p.setX(qBound(0.05 * Lx, p.x(), 0.95 * Lx));
+			p.setY(qBound(0.05 * Ly, p.y(), 0.95 * Ly));
+			well.SDs.append(p);
+		}
+		model.Polylines.append(well);
+	}
+
+	// materials: one per layer, seeded in every fault block of that layer
+	for (int l = 0; l != horizons + 1; l++)
+	{
+		C_Material material;
+		double y = 0.5 * Ly;
+		for (int b = 0; b != faults + 1; b++)
+		{
+			double x = Lx * (b + 0.5) / (faults + 1);
+			double z = 0.0;
+			for (int it = 0; it != 4; it++)
+			{
+				z = 0.5 * (horizonDepth(l - 1, x, y) + horizonDepth(l, x, y));
+				double west = b == 0 ? 0.0 : faultPosition(b - 1, z);
+				double east = b == faults ? Lx : faultPosition(b, z);
+				x = 0.5 * (west + east);
+			}
+			material.Locations.append(C_Vector3D(x, y, z));
+		}
+		model.Mats.append(material);
+	}
+
+	model.calculate_min_max();
+	model.tranformForward();
+}
@@ -0,0 +1,75 @@
+/* MeshIt - a 3D mesh generator for fractured reservoirs
+ *
+ * Copyright (C) 2020
+ *
+ * Mauro Cacace (GFZ, cacace@gfz-potsdam.de),
+ * Guido Blöcher (GFZ, bloech@gfz-potsdam.de),
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version, complemented with
+ * the following provision:
+ * For the scientific transparency and verification of results obtained
+ * and communicated to the public after using a modified version of the
+ * work, You (as the recipient of the source code and author of this
+ * modified version, used to produce the published results in scientific
+ * communications) commit to make this modified source code available in
+ * a repository that is easily and freely accessible for a duration of
+ * five years after the communication of the obtained results.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SYNTHETIC_H_
+#define _SYNTHETIC_H_
+
+#include <QtCore/QtCore>
+
+class C_Model;
+
+/*! \class C_SyntheticModel
+*	\brief Generator for parameterized synthetic reservoir models.
+*	\details The generated model is a box of extent (Lx, Ly, Lz) closed by six
+*	BORDER surfaces. Inside the box it places \a horizons stacked UNIT surfaces
+*	(gently folded, with gaussian noise on z), \a faults dipping FAULT planes
+*	spanning the box in y and z, and \a wells deviated WELL polylines.
+*	One material seed is placed in every layer/fault block, so the model can be
+*	carried through the whole pipeline up to the tetrahedralization.
+*	The generator is deterministic for a given \a seed.
+*/
+class C_SyntheticModel
+{
+public:
+	C_SyntheticModel();
+
+	void generate(C_Model &model) const;
+	QJsonObject parameters() const;
+
+	int horizons;
+	int faults;
+	int wells;
+/// \brief Number of scattered data points along each side of a surface grid.
+	int density;
+/// \brief Standard deviation of the gaussian noise, relative to the layer thickness.
+	double noise;
+/// \brief Dip of the faults in degrees (alternating dip direction).
+	double dip;
+/// \brief Target element size; 0 keeps the default of C_Surface::calculate_min_max().
+	double size;
+	double extent[3];
+	unsigned int seed;
+	QString interpolation;
+
+private:
+	double horizonDepth(int h, double x, double y) const;
+	double faultPosition(int f, double z) const;
+};
+
+#endif	// _SYNTHETIC_H_
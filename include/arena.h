@@ -0,0 +1,95 @@
+/* MeshIt - a 3D mesh generator for fractured reservoirs
+ *
+ * Copyright (C) 2020
+ *
+ * Mauro Cacace (GFZ, cacace@gfz-potsdam.de),
+ * Guido Bl�cher (GFZ, bloech@gfz-potsdam.de),
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version, complemented with
+ * the following provision:
+ * For the scientific transparency and verification of results obtained
+ * and communicated to the public after using a modified version of the
+ * work, You (as the recipient of the source code and author of this
+ * modified version, used to produce the published results in scientific
+ * communications) commit to make this modified source code available in
+ * a repository that is easily and freely accessible for a duration of
+ * five years after the communication of the obtained results.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/*! \class C_Arena
+*	\ingroup PreMesh
+*	\brief Monotonic allocator for the short-lived objects of one task.
+*	\details Objects are placed one after the other into large blocks and are
+*	never freed individually: release() (or the destructor) runs the pending
+*	destructors in reverse order and gives all memory back at once.
+*	Blocks are recycled through a small per-thread pool, so that tasks of a
+*	stage running on many threads do not contend for the global heap.
+*	An arena must only be used by one thread at a time.
+*/
+class C_Arena
+{
+public:
+	C_Arena();
+	~C_Arena();
+	void *allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t));
+	template <class T, class... Args> T *create(Args&&... args);
+	void release();
+/// \brief Number of bytes handed out since the last release().
+	std::size_t used() const { return bytes; }
+
+private:
+	C_Arena(const C_Arena &);
+	C_Arena &operator=(const C_Arena &);
+
+	struct Block
+	{
+		Block *next;
+		std::size_t capacity;
+	};
+	struct Destructor
+	{
+		void (*destroy)(void *);
+		void *object;
+		Destructor *next;
+	};
+	template <class T> static void destroy(void *object) { static_cast<T *>(object)->~T(); }
+	void addDestructor(void (*destroy)(void *), void *object);
+	void newBlock(std::size_t minimum);
+
+	Block *blocks;
+	char *current;
+	char *end;
+	Destructor *destructors;
+	std::size_t bytes;
+};
+
+template <class T, class... Args>
+T *C_Arena::create(Args&&... args)
+{
+	T *object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+	if (!std::is_trivially_destructible<T>::value)
+		addDestructor(&destroy<T>, object);
+	return object;
+}
+
+#endif	// _ARENA_H_
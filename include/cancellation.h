@@ -0,0 +1,82 @@
+/* MeshIt - a 3D mesh generator for fractured reservoirs
+ *
+ * Copyright (C) 2020
+ *
+ * Mauro Cacace (GFZ, cacace@gfz-potsdam.de),
+ * Guido Bl�cher (GFZ, bloech@gfz-potsdam.de),
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version, complemented with
+ * the following provision:
+ * For the scientific transparency and verification of results obtained
+ * and communicated to the public after using a modified version of the
+ * work, You (as the recipient of the source code and author of this
+ * modified version, used to produce the published results in scientific
+ * communications) commit to make this modified source code available in
+ * a repository that is easily and freely accessible for a duration of
+ * five years after the communication of the obtained results.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _CANCELLATION_H_
+#define _CANCELLATION_H_
+
+#include <atomic>
+
+/*! \class C_Cancellation
+*	\ingroup Mesh
+*	\brief Cooperative cancellation of a running meshing job.
+*	\details The owner of a job calls request() from any thread. The job
+*	installs the token for each of its threads with a C_Cancellation::Scope,
+*	and the long loops of the pipeline (octree traversal, Triangle refinement,
+*	point insertion of TetGen) poll requested(), which only reads the token
+*	installed for the calling thread. Threads without a token never see a
+*	cancellation, so the GUI and the command line are not affected.
+*	The header does not depend on Qt, so that tetgen.cxx can include it.
+*/
+class C_Cancellation
+{
+public:
+	C_Cancellation();
+	void request();
+	void reset();
+	bool isRequested() const;
+/// \brief True if the token installed for the calling thread was cancelled.
+	static bool requested();
+
+/// \brief Code passed to terminatetetgen() when a tetrahedralization is cancelled.
+	enum { TETGEN_CANCELLED = 11 };
+
+/*! \class Scope
+*	\brief Installs a token for the calling thread for its lifetime.
+*/
+	class Scope
+	{
+	public:
+		explicit Scope(const C_Cancellation *token);
+		~Scope();
+
+	private:
+		Scope(const Scope &);
+		Scope &operator=(const Scope &);
+		const C_Cancellation *previous;
+	};
+
+private:
+	C_Cancellation(const C_Cancellation &);
+	C_Cancellation &operator=(const C_Cancellation &);
+	std::atomic<bool> flag;
+	static thread_local const C_Cancellation *current;
+};
+
+#endif	// _CANCELLATION_H_
@@ -32,6 +32,8 @@
 
 #include <QtWidgets/QtWidgets>
 
+#include "stagecache.h"
+
 class C_CommandLine
 {
 public:
@@ -40,7 +42,18 @@ public:
 	~C_CommandLine();
 	void runThreadPool(QString, int, int, int, int);
 	void preMeshJob();
-	void MeshJob();
+	void MeshJob(bool resumeTetgen = false);
+	void tetgenJob();
+
+	QString switches;
+
+private:
+	QByteArray jobKey(bool preMesh, bool mesh) const;
+	void checkpoint(const QString &stage);
+
+/// \brief Checkpoints of the jobs, see C_Model::checkpoint().
+	C_StageCache checkpoints;
+	QByteArray job;
 };
 
 class C_CmdTask : public QRunnable
@@ -79,6 +79,7 @@ public:
 	bool isClosed() const;
 
 	bool getPoint(QPointF& p) const;
+	QPolygonF polygon() const;
 
 	void draw(const GLWidget *glwidget) const;
 };
@@ -37,8 +37,12 @@
 #include <iostream>
 #include <list>
 
+#include "arena.h"
 #include "c_vector.h"
 #include "feflow.h"
+#include "memorybudget.h"
+#include "render.h"
+#include "stagecache.h"
 #include "tetgen.h"
 //	To compile MeshIt (Visual Studio) without having Exodus libraries included uncomment the following definition
 // #define NOEXODUS
@@ -198,7 +202,11 @@ public:
 	bool drawVertices;
 	bool drawIntVertices;
 	bool drawConstraints;
-	GLuint listScatteredData;
+/// \brief Level of detail hierarchy of the scattered data, uploaded in its order to vboScatteredData.
+	C_PointLOD lodScatteredData;
+	C_GLBuffer vboScatteredData;
+/// \brief Selects the scattered data to draw for the view, see C_PointLOD::select().
+	void selectScatteredData(const double projection[16], const double modelview[16], int height, int budget);
 	GLuint listEdges;
 	GLuint listVertices;
 	GLuint listIntVertices;
@@ -238,24 +246,30 @@ private:
 	                     const C_Vector3D& p) const;
 };
 
+/*! \class C_Box
+*	\brief Octree node of the intersection searches.
+*	\details The sub-boxes are allocated from the \a arena of the root box,
+*	which releases the whole tree at once when the search is done.
+*/
 class C_Box
 {
 public:
+	explicit C_Box(C_Arena *arena);
 	C_Vector3D min, max, center;
 	QList<const C_Triangle*> T1s;
 	QList<const C_Triangle*> T2s;
 	QList<const C_Vector3D*> N1s;
 	QList<const C_Vector3D*> N2s;
-	C_Line IntSegments;
 	bool tri_in_box(const C_Triangle * Tri) const;
 	bool seg_in_box(const C_Vector3D *V1, const C_Vector3D *V2) const;
 	bool too_much_tri() const;
 	bool too_much_seg() const;
 	void split_tri(C_Line * IntSegments);
-	void split_seg(QList<C_Vector3D*> * TPs, int I1, int I2);
+	void split_seg(QList<C_Vector3D> * TPs, int I1, int I2);
 	void calculate_center();
 	void generate_subboxes();
 private:
+	C_Arena * arena;
 	C_Box * Box[8];
 };
 
@@ -363,6 +377,10 @@ public:
 /// \brief List of instances of Class C_Vector3D defining the vertices of the triangles of the 2D surfaces.
 	QList<C_Vector3D> Ns;
 	int duplicates;
+/// \brief z-coordinates (rotated frame) of the first nodes of Ns, i.e. of the input points of the triangulation; restored by rotate(false).
+	QList<double> NsFixedZ;
+/// \brief Copy of SDs taken by rotate(true); rotate(false) restores SDs from it, so that a rotation leaves the input data bit-identical.
+	QList<C_Vector3D> SDsUnrotated;
 /// \brief List of instances of Class C_Triangle defining the triangles for all  2D surfaces.
 	QList<C_Triangle> Ts;
 /// \brief instance of Class C_Line to represent a Convex Hull.
@@ -462,35 +480,54 @@ public:
 *	\brief It triangulates
 */
 	void calculate_triangles(bool withConstraints, double gradient = 2.0);
+/*!	\ingroup Mesh
+*	\brief Estimated peak memory in bytes of calculate_triangles(true), taken from the area of the convex hull and the lengths and sizes of the constraints.
+*	\details fine_memory() gives the same measure for the nodes and triangles actually generated.
+*/
+	qint64 estimate_fine_memory(double gradient = 2.0) const;
+	qint64 fine_memory() const;
 	double sin(int) const;
 	double cos(int) const;
-	double IDW(double x, double y);
+/*!	\ingroup PreMesh
+*	\brief return an interpolate value based on an IDW algorithm.
+*	\details The interpolations only read the surface (filled by fillSpline() or fillKriging()), so they may run in several threads at once.
+*	\sa C_Surface::interpolation()
+*/
+	double IDW(double x, double y) const;
 /*!	\ingroup PreMesh
 *	\brief return an interpolate value based on a SPLINE algorithm.
 *	\sa C_Surface::interpolation()
 */
-	double SPLINE(double x, double y);
+	double SPLINE(double x, double y) const;
 /*!	\ingroup PreMesh
 *	\brief return an interpolate value based on a KRIGING algorithm.
 *	\sa C_Surface::interpolation()
 */
-	double KRIGING(double x, double y);
+	double KRIGING(double x, double y) const;
 	void setSin(int,double);
 	void setCos(int,double);
 	C_Colors Cols;
 	void clearScatteredData();
 	bool drawScatteredData;
 	void makeScatteredData();
-	GLuint listScatteredData;
+/// \brief Level of detail hierarchy of the scattered data, uploaded in its order to vboScatteredData.
+	C_PointLOD lodScatteredData;
+	C_GLBuffer vboScatteredData;
+/// \brief Selects the scattered data to draw for the view, see C_PointLOD::select().
+	void selectScatteredData(const double projection[16], const double modelview[16], int height, int budget);
 	bool drawConvexHull;
 	void makeConvexHull();
 	GLuint listConvexHull;
 	bool drawFaces;
+/// \brief Flat shaded triangles, three vertices with the normal of the triangle each.
+	void buildFaces(C_RenderBuffer &faces) const;
 	void makeFaces();
-	GLuint listFaces;
+	C_GLBuffer vboFaces;
 	bool drawEdges;
+/// \brief Wireframe of the triangles, every vertex and edge once.
+	void buildEdges(C_RenderBuffer &edges) const;
 	void makeEdges();
-	GLuint listEdges;
+	C_GLBuffer vboEdges;
 	bool drawIntEdges;
 	void makeIntEdges();
 	GLuint listIntEdges;
@@ -498,8 +535,12 @@ public:
 	void makeIntVertices();
 	GLuint listIntVertices;
 	bool drawConstraints;
-	void makeConstraints(bool selectionMode = false);
-	GLuint listConstraints;
+/// \brief Segments of the constraints, solid or stippled, and their end points; in selection mode in the selection colours (RGB).
+	void buildConstraints(C_RenderBuffer &lines, C_RenderBuffer &stippled, C_RenderBuffer &points, bool selectionMode = false) const;
+/// \brief Uploads the constraints as shown (vboConstraints) and in their selection colours (vboSelection).
+	void makeConstraints();
+	C_GLBuffer vboConstraints[3];
+	C_GLBuffer vboSelection[2];
 	bool drawMatFaces;
 	bool drawMatEdges;
 	//bool isMaterial;
@@ -516,6 +557,51 @@ inline void C_Surface::setCos(int axis, double aCos) { cosp[axis] = aCos; }
 
 typedef std::pair<C_Triangle, QSet<const C_Surface*>> SelfIntersection;
 
+/*! \class C_PreMeshCache
+*	\ingroup PreMesh
+*	\brief Results of the pre-mesh stages, keyed by content hashes of their inputs.
+*	\details A surface is keyed by its scattered data, its size and the interpolation parameters,
+*	a polyline by its scattered data and its size. Intersections are keyed by the keys of the two intersected objects
+*	and triple points by the keys of the two intersections. A rerun of the pre-mesh therefore recomputes
+*	only the objects whose input changed, the intersections they take part in and the triple points on those intersections.
+*	Convex hulls and intersections are stored as computed, i.e. before they are aligned to each other.
+*/
+class C_PreMeshCache
+{
+public:
+	class Surface
+	{
+	public:
+		C_Vector3D normal_vector;
+		C_Line ConvexHull;
+		QList<C_Vector3D> Ns;
+	/// \brief Node indices (three per triangle) into Ns.
+		QList<int> Ts;
+		int duplicates;
+		QList<C_Vector3D> HoleCoords;
+	};
+	void clear();
+	void prune();
+
+	QHash<QByteArray, Surface> surfaces;
+	QHash<QByteArray, C_Line> paths;
+	QHash<QByteArray, QList<C_Line> > intersections;
+/// \brief Triple points of two intersections; intID is 0 or 1 for the intersection with the lower or higher key.
+	QHash<QByteArray, QList<C_Vector3D> > triplepoints;
+/// \brief Keys accessed since the last pre-mesh started; prune() drops all others.
+	QSet<QByteArray> used;
+	QString method;
+	double gradient;
+};
+
+/* Serialization of stage results for C_StageCache */
+QDataStream &operator<<(QDataStream &out, const C_Vector3D &vector);
+QDataStream &operator>>(QDataStream &in, C_Vector3D &vector);
+QDataStream &operator<<(QDataStream &out, const C_Line &line);
+QDataStream &operator>>(QDataStream &in, C_Line &line);
+QDataStream &operator<<(QDataStream &out, const C_PreMeshCache::Surface &surface);
+QDataStream &operator>>(QDataStream &in, C_PreMeshCache::Surface &surface);
+
 /*! \class C_Model
 *	\ingroup geometry
 *
@@ -529,6 +615,13 @@ signals:
 
 private:
 	void analyze_self_intersections(const tetgenio &out);
+	void intersect_surfaces(int s1, int s2, QList<C_Line> &lines) const;
+	bool intersect_polyline_surface(int p, int s, C_Line &newInt) const;
+	void intersect_intersections(int I1, int I2, QList<C_Vector3D> *TPs) const;
+	QByteArray triplepoints_key(int I1, int I2) const;
+	void append_intersections(const QByteArray &key, const QList<C_Line> &lines, bool polyline);
+	bool find_intersections(const QByteArray &key, QList<C_Line> &lines);
+	void restore_triangulation(int s, const C_PreMeshCache::Surface &result);
 
 public:
 	void makeVTU_INT();
@@ -558,10 +651,18 @@ public:
 	void ExportLists_clean();
 	//C_Mesh3D * Mesh;
 	int getMaterial(int vtkType, long listID);
-	QList<C_Vector3D*> TPs; //Vertices of TRIPLEPOINTS
+	QList<C_Vector3D> TPs; //Vertices of TRIPLEPOINTS
 	QList<C_Surface> Surfaces; //faults and units
 	QList<C_Polyline> Polylines;  //wells spline
 	QList<C_Line> Intersections;  //all intersection splines
+	QList<QByteArray> IntersectionKeys; //pre-mesh cache keys of the intersections
+	QList<QByteArray> SurfaceKeys;
+	QList<QByteArray> PolylineKeys;
+	C_PreMeshCache PreMeshCache;
+/// \brief Optional on-disk store of the pre-mesh results and of the fine triangulations, shared between runs and processes.
+	C_StageCache StageCache;
+/// \brief Admits the fine triangulations of the surfaces under a memory limit (none by default).
+	C_MemoryBudget MemoryBudget;
     bool PreTestIntersectionsSegmentTriangle(const C_Vector3D *S1, const C_Vector3D *S2, const C_Triangle *T) const;
     bool PreTestIntersectionsPolylineSurface(const C_Polyline * P, const C_Surface * S) const;
     bool PreTestIntersectionsSegmentSurface(const C_Vector3D * S1, const C_Vector3D * S2, const C_Surface * S) const;
@@ -580,6 +681,36 @@ public:
 	void calculate_int_point(int p, int s);
 	void calculate_int_triplepoints(int I1, int I2);
 	void insert_int_triplepoints();
+/*! \ingroup PreMesh
+*	\brief Incremental pre-mesh, see C_PreMeshCache.
+*	\details premesh_begin() sets the interpolation parameters of the run. The restore_* functions take the result of a stage
+*	from the cache and return false if it has to be computed; store_* put a computed convex hull/triangulation or segmentation into the cache.
+*	Intersections and triple points computed by calculate_int_polyline(), calculate_int_point() and calculate_int_triplepoints()
+*	are cached as they are computed. link_intersections() rebuilds the intersection references of surfaces and polylines,
+*	premesh_end() drops all cache entries not used by the run. If StageCache is enabled, results missing in memory are looked up
+*	on disk and computed results are also written to disk.
+*/
+	void premesh_begin(const QString &method, double gradient);
+	void premesh_end();
+	QByteArray surface_key(int s) const;
+	QByteArray polyline_key(int p) const;
+	bool restore_surface(int s);
+	void store_surface(int s);
+	bool restore_polyline(int p);
+	void store_polyline(int p);
+	bool restore_int_polyline(int s1, int s2);
+	bool restore_int_point(int p, int s);
+	bool restore_int_triplepoints(int I1, int I2);
+	void link_intersections(int meshMesh);
+/// \brief Number of surface-surface intersections in front of the polyline-surface ones, as given to the last link_intersections().
+	int meshMeshIntersections;
+/*! \ingroup Mesh
+*	\brief Fine triangulations from StageCache, keyed by the surface, its constraints and the interpolation parameters.
+*	\details The key has to be taken before the triangulation, which rotates the constraints.
+*/
+	QByteArray surface_fine_key(int s, const QString &method, double gradient) const;
+	bool restore_surface_fine(int s, const QByteArray &key);
+	void store_surface_fine(int s, const QByteArray &key);
 	void calculate_tets(QString switches);
 	void get_constraints(std::list<C_Line*>& res);
 	bool has_selected_constraints();
@@ -598,6 +729,12 @@ public:
 	double ExportRotationAngle;
 	void Open();
 	void Save();
+/*! \brief Serialized results of the pre-mesh and mesh jobs after the given \a stage, to resume an interrupted run.
+*	\details restore_checkpoint() applies a checkpoint to the model it was taken from (opened from the same file)
+*	and returns the stage; it leaves the model unchanged and returns false if the checkpoint does not fit.
+*/
+	QByteArray checkpoint(const QString &stage) const;
+	bool restore_checkpoint(const QByteArray &data, QString &stage);
 	void ReadGocadFile();
 	void AddSurface(QString type);
 	void AddPolyline(QString type);
@@ -627,8 +764,16 @@ public:
 	QList<C_Material> Mats;
 	C_Colors Cols;
 	bool drawTets;
+/// \brief Uploads the edges of all triangles and tetrahedra with materials, keeps the corners of their faces and sorts them for the cut planes, to be called when the mesh changed.
+	void prepareTets();
+/// \brief Selects the boundary of the prepared elements which are not cut away and belong to shown surfaces and materials (drawMatFaces, drawMatEdges), and uploads its flat shaded faces.
 	void makeTets(bool xCutEnable, double xCutValue, bool xDirection, bool yCutEnable, double yCutValue, bool yDirection, bool zCutEnable, double zCutValue, bool zDirection);
-	GLuint listTets;
+	C_CutIndex tetCut;
+/// \brief Mesh points at the corners of the faces of tetCut, three per face, and the colour (material modulo 6) of every face.
+	QVector<quint32> tetFaceCorners;
+	QVector<char> tetFaceColors;
+	C_GLBuffer vboTetEdges;
+	C_GLBuffer vboTetFaces;
 	void glWrite(QString string, double x,double y,double z,double scale);
 	bool drawMats;
 	void makeMats(int Material, int Location);
@@ -36,6 +36,8 @@
 #include "c_vector.h"
 #include "geometry.h"
 
+class QOpenGLFramebufferObject;
+
 class GLWidget : public QGLWidget
 {
 	Q_OBJECT
@@ -87,12 +89,15 @@ protected:
 	void computePosition(double& xp, double& yp, double delta) const;
 private slots:
 private:
-	unsigned char *selectionReadPixel(int, int, int, int);
-	void selectionSearchAll(unsigned char *buffer, int width, int height);
-	void selectionFloodFill(unsigned char *buffer, int x, int y,
+	QByteArray sceneState() const;
+	void updateIds();
+	QVector<quint32> selectionRegion(int, int, int, int);
+	void selectionSearchAll(const QVector<quint32> &region);
+	void selectionFloodFill(QVector<quint32> &region, int x, int y,
 	                        int width, int height, FillMode mode);
+	void selectionWalls(QVector<quint32> &region, int width, int height);
 	void applySelection(int, int, int, int, int mx = 0, int my = 0);
-	void addRGB(unsigned char, unsigned char, unsigned char);
+	void addId(quint32);
 
 	double xRot,yRot,zRot;
 	bool Perspec;
@@ -101,7 +106,15 @@ private:
 	double aspect,dist;
 	QPoint lastGlobalPos,currentGlobalPos;
 	QRect globalRect;
-	QList <float> selectedRGBs;
+	QVector<quint32> selectedIds;
+	QSet<quint32> selectedIdSet;
+
+	/* Selection colours of the scene (R + 256 G + 65536 B per pixel, rows
+	 * from the bottom), rendered offscreen when the scene has changed. */
+	bool drawingIds;
+	QOpenGLFramebufferObject *idFramebuffer;
+	QVector<quint32> ids;
+	QByteArray idScene;
 	QRubberBand *rubberBand{ rubberBand = NULL };
 };
 
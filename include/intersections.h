@@ -31,6 +31,7 @@
 #define _INTERSECTIONS_H_
 
 #include "c_vector.h"
+#include "tri_tri_packet.h"
 
 /********************************************************************************/
 /*	Triangle/triangle intersection test routine, by Tomas Moller, 1997.			*/
@@ -206,7 +207,7 @@ compute_intervals_isectline(C_Triangle T,
 	return 0;
 }
 
-int
+inline int
 coplanar_tri_tri(C_Vector3D N, C_Triangle T1, C_Triangle T2)
 {
 	double a[3];
@@ -277,7 +278,7 @@ coplanar_tri_tri(C_Vector3D N, C_Triangle T1, C_Triangle T2)
 	return 0;
 }
 
-int 
+inline int
 tri_tri_intersect_with_isectline(C_Triangle T1, C_Triangle T2, int* coplanar, C_Vector3D *isectpt1, C_Vector3D *isectpt2)
 {
 //	1.	compute plane equation (p1) of triangle T1=(V0,V1,V2) 
@@ -335,13 +336,13 @@ tri_tri_intersect_with_isectline(C_Triangle T1, C_Triangle T2, int* coplanar, C_
 	if(dv0dv1>0.0f && dv0dv2>0.0f)
 		return 0;
 // 5.a compute direction vector (d) of intersection line (L=o+td) between T1 and T2 
-	C_Vector3D *d = new C_Vector3D; 
-	cross(N1, N2, d);
+	C_Vector3D d;
+	cross(N1, N2, &d);
 // 5.b compute simplified projection onto the largest component of d 
-	double max = FABS(d->x());
+	double max = FABS(d.x());
 	short index = 0;
-	double b = FABS(d->y());
-	double c = FABS(d->z());
+	double b = FABS(d.y());
+	double c = FABS(d.z());
 	double vp0, vp1, vp2;
 	double up0, up1, up2;
 	if(b>max) max=b,index=1;
@@ -434,7 +435,21 @@ tri_tri_intersect_with_isectline(C_Triangle T1, C_Triangle T2, int* coplanar, C_
 	return 1;
 }
 
-int
+// store triangle T in lane of a packet for tri_tri_packet_candidates()
+inline void
+tri_tri_packet_set(C_TrianglePacket *packet, int lane, const C_Triangle &T)
+{
+	double v[3][3];
+	for (int n = 0; n != 3; n++)
+	{
+		v[n][0] = T.Ns[n]->x();
+		v[n][1] = T.Ns[n]->y();
+		v[n][2] = T.Ns[n]->z();
+	}
+	tri_tri_packet_set(packet, lane, v[0], v[1], v[2]);
+}
+
+inline int
 triangle_ray_intersection(C_Triangle TRI, C_Vector3D O, C_Vector3D D, C_Vector3D * isectpt)
 {
 	double det, inv_det, u, v;
@@ -0,0 +1,76 @@
+/* MeshIt - a 3D mesh generator for fractured reservoirs
+ *
+ * Copyright (C) 2020
+ *
+ * Mauro Cacace (GFZ, cacace@gfz-potsdam.de),
+ * Guido Bl�cher (GFZ, bloech@gfz-potsdam.de),
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version, complemented with
+ * the following provision:
+ * For the scientific transparency and verification of results obtained
+ * and communicated to the public after using a modified version of the
+ * work, You (as the recipient of the source code and author of this
+ * modified version, used to produce the published results in scientific
+ * communications) commit to make this modified source code available in
+ * a repository that is easily and freely accessible for a duration of
+ * five years after the communication of the obtained results.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _MEMORYBUDGET_H_
+#define _MEMORYBUDGET_H_
+
+#include <QtCore/QtCore>
+
+/*! \class C_MemoryBudget
+*	\ingroup Mesh
+*	\brief Admission control for tasks with a large, estimated memory peak.
+*	\details A task calls acquire() with its estimated peak before it starts
+*	allocating and release() when it is done. acquire() blocks as long as the
+*	estimates of the running tasks plus its own exceed the limit, so that a
+*	tight budget lowers the concurrency instead of exhausting the memory.
+*	A task larger than the whole budget is admitted once it is the only one.
+*	A limit of 0 (default) admits every task at once.
+*/
+class C_MemoryBudget
+{
+public:
+	C_MemoryBudget();
+	void setLimit(qint64 bytes);
+	qint64 limit() const;
+	void acquire(qint64 estimate);
+	void release(qint64 estimate, qint64 actual);
+	void reset();
+/// \brief Sum of the estimates of all tasks released since the last reset().
+	qint64 estimated() const;
+/// \brief Sum of the memory reported by the tasks on release().
+	qint64 actual() const;
+/// \brief Highest sum of the estimates of tasks running at the same time.
+	qint64 peak() const;
+/// \brief Number of tasks which had to wait for memory.
+	int throttled() const;
+	static qint64 peakResidentSetSize();
+
+private:
+	mutable QMutex lock;
+	QWaitCondition released;
+	qint64 limitBytes;
+	qint64 inUse;
+	qint64 peakBytes;
+	qint64 estimatedBytes;
+	qint64 actualBytes;
+	int waits;
+};
+
+#endif	// _MEMORYBUDGET_H_
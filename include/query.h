@@ -0,0 +1,145 @@
+/* MeshIt - a 3D mesh generator for fractured reservoirs
+ *
+ * Copyright (C) 2020
+ *
+ * Mauro Cacace (GFZ, cacace@gfz-potsdam.de),
+ * Guido Bl�cher (GFZ, bloech@gfz-potsdam.de),
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version, complemented with
+ * the following provision:
+ * For the scientific transparency and verification of results obtained
+ * and communicated to the public after using a modified version of the
+ * work, You (as the recipient of the source code and author of this
+ * modified version, used to produce the published results in scientific
+ * communications) commit to make this modified source code available in
+ * a repository that is easily and freely accessible for a duration of
+ * five years after the communication of the obtained results.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _QUERY_H_
+#define _QUERY_H_
+
+#include <QtCore/QtCore>
+
+class C_Mesh3D;
+class C_Surface;
+class C_Vector3D;
+
+/*! \class C_Grid
+*	\ingroup Mesh
+*	\brief Uniform grid over the bounding boxes of a set of items.
+*	\details Every item is listed in all cells its box overlaps, the lists of
+*	all cells are stored back to back (start[c] to start[c+1] in index). The
+*	cells are sized for a few items each, a flat extent gets a single layer.
+*	The grid is read-only after build(), so that it can be queried from many
+*	threads at once.
+*/
+class C_Grid
+{
+public:
+	C_Grid();
+/// \brief Builds the grid over the boxes, six values (min x, y, z, max x, y, z) per item.
+	void build(const QVector<double> &boxes);
+	bool contains(const double p[3], double tolerance) const;
+/// \brief Cell of p, clamped to the grid.
+	void cellOf(const double p[3], int c[3]) const;
+	const int *items(int i, int j, int k, int *count) const;
+
+	double min[3];
+	double max[3];
+	double size[3];
+	int n[3];
+
+private:
+	QVector<int> start;
+	QVector<int> index;
+};
+
+/*! \class C_PointHash
+*	\ingroup Mesh
+*	\brief Spatial hash of points for finding coincident points in constant time.
+*	\details Two points coincide if they are closer than the tolerance or are
+*	identical. The hash cells are as large as the tolerance, so a point is only
+*	compared with the points of its own and of the neighbouring cells. Given the
+*	largest absolute coordinate (extent) of the points, the cells are at least
+*	a 2^-48 fraction of it, below which the coordinates are not resolved; the
+*	cell indices are clamped, so that a tolerance too small for the points
+*	costs time but stays correct.
+*/
+class C_PointHash
+{
+public:
+	explicit C_PointHash(double tolerance, double extent = 0.0);
+/// \brief Index of the last added point coinciding with p, -1 if there is none.
+	int find(const double p[3]) const;
+/// \brief Adds p and returns its index.
+	int add(const double p[3]);
+/// \brief Index of a point coinciding with p, p is added if there is none.
+	int insert(const double p[3]);
+	int find(const C_Vector3D &p) const;
+	int add(const C_Vector3D &p);
+	int count() const;
+
+private:
+	void cellOf(const double p[3], qint64 c[3]) const;
+	static quint64 key(qint64 i, qint64 j, qint64 k);
+
+	double tolerance;
+	double cell;
+	QVector<double> points;
+	QMultiHash<quint64, int> cells;
+};
+
+/*! \class C_TetLocator
+*	\ingroup Mesh
+*	\brief Locates points in the tetrahedra of a C_Mesh3D.
+*	\details The coordinates are those of C_Mesh3D::pointlist, i.e. of the
+*	normalized model. The corners of the tetrahedra are copied, so the mesh
+*	may change after the constructor.
+*/
+class C_TetLocator
+{
+public:
+	explicit C_TetLocator(const C_Mesh3D &mesh);
+/// \brief Index of a tetrahedron enclosing p and its barycentric coordinates, -1 if p is outside the mesh.
+	int locate(const double p[3], double barycentric[4]) const;
+
+private:
+	QVector<double> vertices;
+	C_Grid grid;
+};
+
+/*! \class C_TriangleLocator
+*	\ingroup Mesh
+*	\brief Closest points and segment intersections on the triangles of a C_Surface.
+*	\details The coordinates are those of C_Surface::Ns, the triangles are
+*	copied, so the surface may change after the constructor.
+*/
+class C_TriangleLocator
+{
+public:
+	explicit C_TriangleLocator(const C_Surface &surface);
+	bool isEmpty() const;
+/// \brief Index of the triangle closest to p, with the closest point on it.
+	int closest(const double p[3], double point[3]) const;
+/// \brief Appends the triangles crossed by the segment a-b, with the parameter (0 at a, 1 at b) of the crossing, in the order along the segment.
+	void intersect(const double a[3], const double b[3], QList<QPair<double, int> > *hits) const;
+
+private:
+	QVector<double> vertices;
+	C_Grid grid;
+};
+
+#endif	// _QUERY_H_
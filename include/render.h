@@ -0,0 +1,257 @@
+/* MeshIt - a 3D mesh generator for fractured reservoirs
+ *
+ * Copyright (C) 2020
+ *
+ * Mauro Cacace (GFZ, cacace@gfz-potsdam.de),
+ * Guido Bl�cher (GFZ, bloech@gfz-potsdam.de),
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version, complemented with
+ * the following provision:
+ * For the scientific transparency and verification of results obtained
+ * and communicated to the public after using a modified version of the
+ * work, You (as the recipient of the source code and author of this
+ * modified version, used to produce the published results in scientific
+ * communications) commit to make this modified source code available in
+ * a repository that is easily and freely accessible for a duration of
+ * five years after the communication of the obtained results.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _RENDER_H_
+#define _RENDER_H_
+
+#include <QtCore/QtCore>
+#include <QtGui/qopengl.h>
+
+/*! \class C_RenderBuffer
+*	\ingroup geometry
+*	\brief Packed, indexed vertex data of one kind of primitive for drawing.
+*	\details Positions, normals and RGBA colours are stored back to back
+*	(three, three and four floats per vertex), the primitives index them.
+*	Vertices added with a key are shared by all primitives using that key, so
+*	that e.g. a wireframe stores every node once. The buffer does not need an
+*	OpenGL context; it is drawn by uploading it to a C_GLBuffer.
+*/
+class C_RenderBuffer
+{
+public:
+	enum Primitive { POINTS, LINES, TRIANGLES };
+
+	explicit C_RenderBuffer(Primitive primitive = TRIANGLES);
+	void clear();
+	void reserve(int vertices, int primitives);
+/// \brief Adds a vertex without normal and returns its index.
+	quint32 addVertex(const double p[3], const float color[4]);
+/// \brief Adds a vertex with normal and returns its index.
+	quint32 addVertex(const double p[3], const double normal[3], const float color[4]);
+/// \brief Index of the vertex added with key, the vertex is added if there is none.
+	quint32 sharedVertex(quint64 key, const double p[3], const float color[4]);
+	void addPoint(quint32 a);
+	void addLine(quint32 a, quint32 b);
+/// \brief Adds the line (a,b) unless it or (b,a) was added by this function before.
+	void addUniqueLine(quint32 a, quint32 b);
+	void addTriangle(quint32 a, quint32 b, quint32 c);
+	int vertexCount() const;
+	int primitiveCount() const;
+	bool isEmpty() const;
+	bool hasNormals() const;
+
+	Primitive primitive;
+/// \brief The colours are materials and only shown with lighting (like glMaterial), otherwise they are drawn as they are (e.g. selection colours).
+	bool material;
+/// \brief Drawn with GL_LIGHT0 switched off and a white ambient light, i.e. in the plain colours.
+	bool unlit;
+	bool stippled;
+/// \brief Point size or line width, 0 keeps the current one.
+	float width;
+
+	QVector<float> positions;
+	QVector<float> normals;
+	QVector<float> colors;
+	QVector<quint32> indices;
+
+private:
+	QHash<quint64, quint32> keys;
+	QSet<quint64> lines;
+};
+
+/*! \class C_GLBuffer
+*	\ingroup geometry
+*	\brief A C_RenderBuffer uploaded into vertex buffer objects.
+*	\details Replaces a display list: upload() needs the OpenGL context to be
+*	current, draw() issues a single glDrawElements with the fixed function
+*	vertex arrays. Copies share the buffer objects, like copies of a display
+*	list id; the buffer objects are reused by the next upload().
+*/
+class C_GLBuffer
+{
+public:
+	C_GLBuffer();
+	void upload(const C_RenderBuffer &buffer);
+/// \brief Replaces the indices of the last upload(), the vertices are kept.
+	void uploadIndices(const QVector<quint32> &indices);
+	void draw() const;
+/// \brief Deletes the buffer objects.
+	void release();
+/// \brief Forgets the buffer objects without deleting them, e.g. after their context is gone.
+	void clear();
+/// \brief Number of uploads and releases of all buffers, it changes whenever the drawn geometry does.
+	static quint64 generation();
+
+private:
+	static quint64 changes;
+
+	GLuint vertexBuffer;
+	GLuint indexBuffer;
+	GLenum mode;
+	GLsizei count;
+	GLsizei vertices;
+	bool normals;
+	bool material;
+	bool unlit;
+	bool stippled;
+	float width;
+};
+
+/*! \class C_CutIndex
+*	\ingroup geometry
+*	\brief Boundary of the elements of a mesh which are kept by cut planes.
+*	\details Every element has a centroid, a group (e.g. its surface or
+*	material) and triangles, whose corners are in a face buffer and in an edge
+*	buffer. Triangles which two elements share (the faces between neighbouring
+*	tetrahedra) are matched by their points in finish(), and only selected if
+*	the element on the other side is not shown or belongs to another group;
+*	edges are the sides of the selected triangles, each selected once.
+*
+*	The centroids are sorted along the axes by finish(). A cut is a range of
+*	the sorted elements found by binary search: select() walks the smallest
+*	range of the enabled planes and, if only cut values changed since the last
+*	selection, just the elements between the old and the new values, updating
+*	the boundary around them.
+*/
+class C_CutIndex
+{
+public:
+	C_CutIndex();
+	void clear();
+/// \brief Starts a new element.
+	void addElement(const double centroid[3], int group);
+/// \brief Adds a triangle to the current element.
+/// \details face is the first of its three consecutive vertices in the face buffer, edge are its corners in the edge buffer.
+	void addFace(quint32 face, const quint32 edge[3]);
+/// \brief Adds a triangle which the current element shares with the element having a triangle with the same points.
+	void addFace(quint32 face, const quint32 edge[3], const quint32 points[3]);
+/// \brief Matches the shared triangles and sorts the elements along the axes, to be called after the last element.
+	void finish();
+	bool isFinished() const;
+	int count() const;
+/// \brief Indices of the boundary triangles and edges of the elements whose centroids are not cut away.
+/// \details An enabled plane of axis a keeps the centroids c with c >= value[a] if
+/// direction[a] is set, c <= value[a] otherwise. Triangles and edges of group g
+/// are only shown if showFaces[g] and showEdges[g] are set.
+	void select(const bool enable[3], const double value[3], const bool direction[3], const QVector<bool> &showFaces, const QVector<bool> &showEdges, QVector<quint32> &faceIndices, QVector<quint32> &edgeIndices);
+
+private:
+	struct SharedFace
+	{
+		quint32 points[3];
+		int face;
+	};
+
+	int line(quint32 a, quint32 b);
+	void range(int axis, float from, float to, int &first, int &last) const;
+	char stateOf(int element) const;
+	bool isBoundary(int face, int kind) const;
+	void updateFace(int face);
+	void updateElement(int element, char state);
+
+	/* elements */
+	QVector<float> centroids;
+	QVector<int> groups;
+	QVector<int> order[3];
+	QVector<int> faceStart;
+	QVector<char> states;
+	/* triangles */
+	QVector<quint32> faces;
+	QVector<int> faceLines;
+	QVector<int> owners;
+	QVector<int> opposites;
+	QVector<int> boundaryIndex[2];
+	QVector<int> boundary[2];
+	/* edges, two vertices each */
+	QVector<quint32> lines;
+	QHash<quint64, int> lineKeys;
+	QVector<SharedFace> sharedFaces;
+
+	/* last selection */
+	bool selected;
+	bool enable[3];
+	float cut[3];
+	bool direction[3];
+	QVector<bool> showFaces;
+	QVector<bool> showEdges;
+	bool finished;
+};
+
+/*! \class C_PointLOD
+*	\ingroup geometry
+*	\brief Level of detail hierarchy of a point cloud.
+*	\details An octree over the points in which every node keeps a sample of
+*	the points in its cube, at most one per cell of a regular grid, and passes
+*	the others on to its children. The points are reordered so that the sample
+*	of a node is contiguous and followed by the subtrees of its children; the
+*	cloud is uploaded once in this order.
+*
+*	select() walks the nodes in the view frustum from the largest on the
+*	screen to the smallest and takes their samples until the point budget is
+*	spent or the samples are denser than the pixels, so the number of points
+*	drawn does not depend on the size of the cloud. It needs no OpenGL context.
+*/
+class C_PointLOD
+{
+public:
+	C_PointLOD();
+	void clear();
+/// \brief Builds the hierarchy over the points, three coordinates each.
+	void build(const QVector<float> &positions);
+/// \brief Index of the input point at every position of the hierarchy.
+	const QVector<quint32> &order() const;
+	int count() const;
+	int nodeCount() const;
+/// \brief Selects the positions (into order()) of at most budget points to draw for the view.
+/// \details projection and modelview are column major OpenGL matrices, height is the height of the viewport in pixels. Returns false if the selection is the same as the last one.
+	bool select(const double projection[16], const double modelview[16], int height, int budget);
+	const QVector<quint32> &selection() const;
+
+private:
+	struct Node
+	{
+		float center[3];
+		float half;
+		/* own sample, then the subtrees of the children up to end */
+		int first;
+		int count;
+		int end;
+		int children[8];
+	};
+
+	void split(int node, int depth, const QVector<float> &positions, QVector<quint32> &scratch);
+
+	QVector<Node> nodes;
+	QVector<quint32> points;
+	QVector<quint32> selected;
+	bool hasSelection;
+};
+
+#endif	// _RENDER_H_
@@ -0,0 +1,77 @@
+/* MeshIt - a 3D mesh generator for fractured reservoirs
+ *
+ * Copyright (C) 2020
+ *
+ * Mauro Cacace (GFZ, cacace@gfz-potsdam.de),
+ * Guido Bl�cher (GFZ, bloech@gfz-potsdam.de),
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version, complemented with
+ * the following provision:
+ * For the scientific transparency and verification of results obtained
+ * and communicated to the public after using a modified version of the
+ * work, You (as the recipient of the source code and author of this
+ * modified version, used to produce the published results in scientific
+ * communications) commit to make this modified source code available in
+ * a repository that is easily and freely accessible for a duration of
+ * five years after the communication of the obtained results.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SEG_SEG_PACKET_H_
+#define _SEG_SEG_PACKET_H_
+
+#include "simd.h"
+
+/********************************************************************************/
+/*	Batched shortest transversal between segments.								*/
+/*																				*/
+/*	One segment P=(P1,P2) is tested against a packet of up to					*/
+/*	SEGMENT_PACKET_WIDTH segments Q=(Q1,Q2) stored in SoA form. For every		*/
+/*	segment of the packet the shortest connector between the two lines is		*/
+/*	computed exactly like C_Line::calculateSkewLineTransversal() does; a		*/
+/*	segment is a hit if the connector lies within both segments (parameters	*/
+/*	in [0,1)) and its squared length is smaller than \a tolerance2. For hits	*/
+/*	the midpoint of the connector is returned.									*/
+/*																				*/
+/*	No memory is allocated. The implementation (AVX2, SSE2 or scalar) is		*/
+/*	selected at runtime, see simd.h.											*/
+/********************************************************************************/
+
+#define SEGMENT_PACKET_WIDTH 4
+
+struct C_SegmentPacket
+{
+	/* coordinates of end point [0..1] of segment [0..SEGMENT_PACKET_WIDTH-1] */
+	alignas(32) double x[2][SEGMENT_PACKET_WIDTH];
+	alignas(32) double y[2][SEGMENT_PACKET_WIDTH];
+	alignas(32) double z[2][SEGMENT_PACKET_WIDTH];
+	int count;
+};
+
+/*!	\brief Stores segment (q1,q2) in \a lane of \a packet. Unused lanes must be
+*	filled as well (e.g. with a copy of lane 0); they are masked out by means
+*	of C_SegmentPacket::count.
+*/
+void seg_seg_packet_set(C_SegmentPacket *packet, int lane, const double q1[3], const double q2[3]);
+
+/*!	\brief Returns the bit mask of the segments of \a packet which meet segment
+*	(p1,p2); \a midpoint[0..2][lane] receives the meeting point of every hit.
+*/
+unsigned int seg_seg_packet_transversal(const double p1[3], const double p2[3], const C_SegmentPacket &packet, double tolerance2, double midpoint[3][SEGMENT_PACKET_WIDTH]);
+
+/*!	\brief seg_seg_packet_transversal() with the implementation of \a level, or
+*	the widest one below it which the CPU supports; to compare them.
+*/
+unsigned int seg_seg_packet_transversal_level(SimdLevel level, const double p1[3], const double p2[3], const C_SegmentPacket &packet, double tolerance2, double midpoint[3][SEGMENT_PACKET_WIDTH]);
+
+#endif	// _SEG_SEG_PACKET_H_
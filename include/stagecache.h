@@ -0,0 +1,63 @@
+/* MeshIt - a 3D mesh generator for fractured reservoirs
+ *
+ * Copyright (C) 2020
+ *
+ * Mauro Cacace (GFZ, cacace@gfz-potsdam.de),
+ * Guido Bl�cher (GFZ, bloech@gfz-potsdam.de),
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version, complemented with
+ * the following provision:
+ * For the scientific transparency and verification of results obtained
+ * and communicated to the public after using a modified version of the
+ * work, You (as the recipient of the source code and author of this
+ * modified version, used to produce the published results in scientific
+ * communications) commit to make this modified source code available in
+ * a repository that is easily and freely accessible for a duration of
+ * five years after the communication of the obtained results.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _STAGECACHE_H_
+#define _STAGECACHE_H_
+
+#include <QtCore/QtCore>
+
+/*! \class C_StageCache
+*	\ingroup PreMesh
+*	\brief Content-addressed on-disk store for the results of expensive stages.
+*	\details A result is stored under the hash of its inputs in the file
+*	<directory>/<stage>/<first two hex digits>/<key>. Files are written to a
+*	temporary file and renamed into place, so that processes sharing the
+*	directory only ever see complete entries; as equal keys have equal
+*	contents, it does not matter which of two concurrent writers wins.
+*	Every entry carries a checksum of its payload: truncated or otherwise
+*	damaged entries are treated as missing and overwritten by the next store.
+*	The cache is disabled as long as no directory is set.
+*/
+class C_StageCache
+{
+public:
+	C_StageCache();
+	void setDirectory(const QString &directory);
+	QString directory() const;
+	bool isEnabled() const;
+	bool load(const char *stage, const QByteArray &key, QByteArray &data) const;
+	bool store(const char *stage, const QByteArray &key, const QByteArray &data) const;
+
+private:
+	QString path(const char *stage, const QByteArray &key) const;
+
+	QString dir;
+};
+
+#endif	// _STAGECACHE_H_
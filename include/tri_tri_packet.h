@@ -0,0 +1,82 @@
+/* MeshIt - a 3D mesh generator for fractured reservoirs
+ *
+ * Copyright (C) 2020
+ *
+ * Mauro Cacace (GFZ, cacace@gfz-potsdam.de),
+ * Guido Bl�cher (GFZ, bloech@gfz-potsdam.de),
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version, complemented with
+ * the following provision:
+ * For the scientific transparency and verification of results obtained
+ * and communicated to the public after using a modified version of the
+ * work, You (as the recipient of the source code and author of this
+ * modified version, used to produce the published results in scientific
+ * communications) commit to make this modified source code available in
+ * a repository that is easily and freely accessible for a duration of
+ * five years after the communication of the obtained results.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _TRI_TRI_PACKET_H_
+#define _TRI_TRI_PACKET_H_
+
+#include "simd.h"
+
+/********************************************************************************/
+/*	Batched plane rejection tests of the triangle/triangle intersection test	*/
+/*	of Tomas Moller (see intersections.h).										*/
+/*																				*/
+/*	One triangle T1=(V0,V1,V2) is tested against a packet of up to				*/
+/*	TRIANGLE_PACKET_WIDTH triangles T2=(U0,U1,U2) stored in SoA form.			*/
+/*	The kernel performs the steps 1-4 of tri_tri_intersect_with_isectline()		*/
+/*	for all triangles of the packet at once and returns a bit mask of the		*/
+/*	triangles that are not rejected by the plane tests. Only these need to		*/
+/*	go through tri_tri_intersect_with_isectline(), which then produces the		*/
+/*	same segments as testing all pairs one by one: a triangle is rejected		*/
+/*	only if tri_tri_intersect_with_isectline() rejects it as well.				*/
+/*																				*/
+/*	The implementation (AVX2, SSE2 or scalar) is selected at runtime; the		*/
+/*	environment variable MESHIT_SIMD=scalar|sse2 forces a narrower one.			*/
+/********************************************************************************/
+
+#define TRIANGLE_PACKET_WIDTH 4
+
+struct C_TrianglePacket
+{
+	/* coordinates of vertex [0..2] of triangle [0..TRIANGLE_PACKET_WIDTH-1] */
+	alignas(32) double x[3][TRIANGLE_PACKET_WIDTH];
+	alignas(32) double y[3][TRIANGLE_PACKET_WIDTH];
+	alignas(32) double z[3][TRIANGLE_PACKET_WIDTH];
+	int count;
+};
+
+/*!	\brief Stores triangle (v0,v1,v2) in \a lane of \a packet. Unused lanes
+*	must be filled as well (e.g. with a copy of lane 0); they are masked out
+*	by means of C_TrianglePacket::count.
+*/
+void tri_tri_packet_set(C_TrianglePacket *packet, int lane, const double v0[3], const double v1[3], const double v2[3]);
+
+/*!	\brief Returns the bit mask of the triangles of \a packet which may
+*	intersect triangle (v0,v1,v2).
+*/
+unsigned int tri_tri_packet_candidates(const double v0[3], const double v1[3], const double v2[3], const C_TrianglePacket &packet);
+
+/*!	\brief tri_tri_packet_candidates() with the implementation of \a level, or
+*	the widest one below it which the CPU supports; to compare them.
+*/
+unsigned int tri_tri_packet_candidates_level(SimdLevel level, const double v0[3], const double v1[3], const double v2[3], const C_TrianglePacket &packet);
+
+/*!	\brief Name of the selected implementation: "avx2", "sse2" or "scalar". */
+const char *tri_tri_packet_isa();
+
+#endif	// _TRI_TRI_PACKET_H_
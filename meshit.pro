@@ -57,12 +57,12 @@ unix:!macx {
 
 # Windows - MinGW
 win32-g++ {
-    LIBS += libopengl32 libglu32
+    LIBS += libopengl32 libglu32 libpsapi
 }
 
 # Windows - Microsoft Visual C++
 win32-msvc* {
-    LIBS += opengl32.lib glu32.lib
+    LIBS += opengl32.lib glu32.lib psapi.lib
 }
 
 if($$EXODUS_LIBMESH) {
@@ -91,7 +91,16 @@ HEADERS += include/c_vector.h \
            include/triangle.h \
            include/feflow.h \
            include/exodus.h \
-           include/core.h
+           include/core.h \
+           include/arena.h \
+           include/cancellation.h \
+           include/memorybudget.h \
+           include/query.h \
+           include/render.h \
+           include/seg_seg_packet.h \
+           include/simd.h \
+           include/stagecache.h \
+           include/tri_tri_packet.h
 SOURCES += src/geometry.cpp \
            src/glwidget.cpp \
            src/commandline.cpp \
@@ -102,5 +111,14 @@ SOURCES += src/geometry.cpp \
            src/triangle.c \
            src/feflow.cpp \
            src/exodus.cpp \
-           src/core.cpp
+           src/core.cpp \
+           src/arena.cpp \
+           src/cancellation.cpp \
+           src/memorybudget.cpp \
+           src/query.cpp \
+           src/render.cpp \
+           src/seg_seg_packet.cpp \
+           src/simd.cpp \
+           src/stagecache.cpp \
+           src/tri_tri_packet.cpp
 RESOURCES += resources/MeshIT.qrc
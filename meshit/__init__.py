@@ -9,10 +9,16 @@ from .core._meshit import (
     Polyline,
     create_surface,
     create_polyline,
+    interpolate,
+    unique_points,
+    refine_polyline,
+    triangulate_polygon,
     Triangle,
     Intersection,
     TriplePoint,
     GradientControl,
+    MeshItJob,
+    Cancelled,
 )
 
 # Import our extensions to enhance the C++ bindings
@@ -97,9 +103,15 @@ __all__ = [
     'Polyline',
     'create_surface',
     'create_polyline',
+    'interpolate',
+    'unique_points',
+    'refine_polyline',
+    'triangulate_polygon',
     'Triangle',
     'Intersection',
     'TriplePoint',
+    'MeshItJob',
+    'Cancelled',
     'add_surface_to_model',
     'add_polyline_to_model',
     'get_intersections',
@@ -11,6 +11,25 @@ QT_INCLUDE_PATH = os.path.join(QT_BASE_PATH, 'include')
 QT_LIB_PATH = os.path.join(QT_BASE_PATH, 'lib')
 QT_BIN_PATH = os.path.join(QT_BASE_PATH, 'bin')
 
+# Sources of the meshing pipeline (C_Model) wrapped by the extension module
+CORE_SOURCES = [
+    'src/geometry.cpp',
+    'src/core.cpp',
+    'src/feflow.cpp',
+    'src/predicates.cxx',
+    'src/tetgen.cxx',
+    'src/triangle.c',
+    'src/arena.cpp',
+    'src/cancellation.cpp',
+    'src/memorybudget.cpp',
+    'src/query.cpp',
+    'src/render.cpp',
+    'src/seg_seg_packet.cpp',
+    'src/simd.cpp',
+    'src/stagecache.cpp',
+    'src/tri_tri_packet.cpp',
+]
+
 class get_pybind_include(object):
     def __str__(self):
         import pybind11
@@ -19,7 +38,7 @@ class get_pybind_include(object):
 ext_modules = [
     Extension(
         'meshit.core._meshit',
-        sources=['src/python_bindings_minimal.cpp'],
+        sources=['src/python_bindings_minimal.cpp'] + CORE_SOURCES,
         include_dirs=[
             str(get_pybind_include()),
             'src',
@@ -38,7 +57,11 @@ ext_modules = [
             'Qt6Core',
             'Qt6Gui',
             'Qt6Widgets',
+            'Qt6OpenGL',
             'Qt6OpenGLWidgets',
+            'opengl32',
+            'glu32',
+            'psapi',
         ],
         language='c++',
         define_macros=[
@@ -50,12 +73,22 @@ ext_modules = [
             ('WIN32', '1'),
             ('NOMINMAX', '1'),
             ('NOEXODUS', '1'),
+            ('TRILIBRARY', None),
+            ('EXTERNAL_TEST', None),
             ('_SILENCE_CXX17_CODECVT_HEADER_DEPRECATION_WARNING', '1'),
         ],
     )
 ]
 
 class BuildExt(build_ext):
+    def moc(self, header):
+        """Runs the Qt meta-object compiler on a header declaring a Q_OBJECT class."""
+        import subprocess
+        output = os.path.join(self.build_temp, 'moc_' + os.path.splitext(os.path.basename(header))[0] + '.cpp')
+        os.makedirs(self.build_temp, exist_ok=True)
+        subprocess.check_call([os.path.join(QT_BIN_PATH, 'moc'), header, '-o', output])
+        return output
+
     def build_extensions(self):
         opts = [
             '/O2',
@@ -84,7 +117,9 @@ class BuildExt(build_ext):
             os.path.join(QT_INCLUDE_PATH, 'QtOpenGLWidgets'),
         ]
 
+        moc_geometry = self.moc('include/geometry.h')
         for ext in self.extensions:
+            ext.sources.append(moc_geometry)
             ext.extra_compile_args = opts
             for inc in qt_includes:
                 ext.extra_compile_args.append(f'/I{inc}')
@@ -102,7 +137,7 @@ setup(
     url='https://github.com/waqashussain/meshit',
     packages=find_packages(),
     ext_modules=ext_modules,
-    install_requires=['pybind11>=2.5.0'],
+    install_requires=['pybind11>=2.5.0', 'numpy'],
     python_requires='>=3.7',
     cmdclass={'build_ext': BuildExt},
     zip_safe=False,
@@ -0,0 +1,142 @@
+/* MeshIt - a 3D mesh generator for fractured reservoirs
+ *
+ * Copyright (C) 2020
+ *
+ * Mauro Cacace (GFZ, cacace@gfz-potsdam.de),
+ * Guido Bl�cher (GFZ, bloech@gfz-potsdam.de),
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version, complemented with
+ * the following provision:
+ * For the scientific transparency and verification of results obtained
+ * and communicated to the public after using a modified version of the
+ * work, You (as the recipient of the source code and author of this
+ * modified version, used to produce the published results in scientific
+ * communications) commit to make this modified source code available in
+ * a repository that is easily and freely accessible for a duration of
+ * five years after the communication of the obtained results.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "arena.h"
+
+/* Size of a regular block; larger requests get a block of their own. */
+#define ARENA_BLOCK_SIZE (64 * 1024)
+/* Regular blocks kept per thread for the next tasks. */
+#define ARENA_POOL_SIZE 8
+
+namespace
+{
+	/* Pool of free regular blocks of the calling thread, freed with the thread. */
+	struct BlockPool
+	{
+		void *blocks[ARENA_POOL_SIZE];
+		int count;
+		BlockPool() : count(0) {}
+		~BlockPool()
+		{
+			while (count != 0)
+				std::free(blocks[--count]);
+		}
+	};
+	thread_local BlockPool pool;
+}
+
+C_Arena::C_Arena()
+{
+	this->blocks = 0;
+	this->current = 0;
+	this->end = 0;
+	this->destructors = 0;
+	this->bytes = 0;
+}
+
+C_Arena::~C_Arena()
+{
+	this->release();
+}
+
+void *
+C_Arena::allocate(std::size_t size, std::size_t alignment)
+{
+	std::uintptr_t p = ((std::uintptr_t)this->current + alignment - 1) & ~(std::uintptr_t)(alignment - 1);
+	if (this->current == 0 || p + size > (std::uintptr_t)this->end)
+	{
+		this->newBlock(size + alignment);
+		p = ((std::uintptr_t)this->current + alignment - 1) & ~(std::uintptr_t)(alignment - 1);
+	}
+	this->current = (char *)(p + size);
+	this->bytes += size;
+	return (void *)p;
+}
+
+void
+C_Arena::addDestructor(void (*destroy)(void *), void *object)
+{
+	Destructor *d = new (this->allocate(sizeof(Destructor), alignof(Destructor))) Destructor;
+	d->destroy = destroy;
+	d->object = object;
+	d->next = this->destructors;
+	this->destructors = d;
+}
+
+void
+C_Arena::newBlock(std::size_t minimum)
+{
+	std::size_t header = (sizeof(Block) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+	std::size_t capacity = ARENA_BLOCK_SIZE;
+	void *memory;
+	if (header + minimum > capacity)
+	{
+		capacity = header + minimum;
+		memory = std::malloc(capacity);
+	}
+	else if (pool.count != 0)
+		memory = pool.blocks[--pool.count];
+	else
+		memory = std::malloc(capacity);
+	if (memory == 0)
+		throw std::bad_alloc();
+	Block *block = (Block *)memory;
+	block->next = this->blocks;
+	block->capacity = capacity;
+	this->blocks = block;
+	this->current = (char *)memory + header;
+	this->end = (char *)memory + capacity;
+}
+
+void
+C_Arena::release()
+{
+	while (this->destructors != 0)
+	{
+		Destructor *d = this->destructors;
+		this->destructors = d->next;
+		d->destroy(d->object);
+	}
+	while (this->blocks != 0)
+	{
+		Block *block = this->blocks;
+		this->blocks = block->next;
+		if (block->capacity == ARENA_BLOCK_SIZE && pool.count != ARENA_POOL_SIZE)
+			pool.blocks[pool.count++] = block;
+		else
+			std::free(block);
+	}
+	this->current = 0;
+	this->end = 0;
+	this->bytes = 0;
+}
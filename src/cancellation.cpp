@@ -0,0 +1,73 @@
+/* MeshIt - a 3D mesh generator for fractured reservoirs
+ *
+ * Copyright (C) 2020
+ *
+ * Mauro Cacace (GFZ, cacace@gfz-potsdam.de),
+ * Guido Bl�cher (GFZ, bloech@gfz-potsdam.de),
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version, complemented with
+ * the following provision:
+ * For the scientific transparency and verification of results obtained
+ * and communicated to the public after using a modified version of the
+ * work, You (as the recipient of the source code and author of this
+ * modified version, used to produce the published results in scientific
+ * communications) commit to make this modified source code available in
+ * a repository that is easily and freely accessible for a duration of
+ * five years after the communication of the obtained results.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "cancellation.h"
+
+thread_local const C_Cancellation *C_Cancellation::current = nullptr;
+
+C_Cancellation::C_Cancellation()
+{
+	this->flag.store(false);
+}
+
+void
+C_Cancellation::request()
+{
+	this->flag.store(true, std::memory_order_relaxed);
+}
+
+void
+C_Cancellation::reset()
+{
+	this->flag.store(false, std::memory_order_relaxed);
+}
+
+bool
+C_Cancellation::isRequested() const
+{
+	return this->flag.load(std::memory_order_relaxed);
+}
+
+bool
+C_Cancellation::requested()
+{
+	return current != nullptr && current->isRequested();
+}
+
+C_Cancellation::Scope::Scope(const C_Cancellation *token)
+{
+	this->previous = current;
+	current = token;
+}
+
+C_Cancellation::Scope::~Scope()
+{
+	current = this->previous;
+}
@@ -27,6 +27,8 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+
 #include "commandline.h"
 #include "geometry.h"
 
@@ -34,6 +36,13 @@ C_Model CmdModel;
 
 C_CommandLine::C_CommandLine(QCommandLineParser * parser)
 {
+	this->switches = "pq1.2AY";
+	if (parser->isSet("switches"))
+		this->switches = parser->value("switches");
+	if (parser->isSet("cache"))
+		CmdModel.StageCache.setDirectory(parser->value("cache"));
+	if (parser->isSet("memory-budget"))
+		CmdModel.MemoryBudget.setLimit((qint64)(parser->value("memory-budget").toDouble() * 1024 * 1024 * 1024));
 	if (parser->isSet("input"))
 	{
 		CmdModel.FileNameModel = parser->value("input");
@@ -41,7 +50,22 @@ C_CommandLine::C_CommandLine(QCommandLineParser * parser)
 			CmdModel.FileNameModel = QFileInfo(CmdModel.FileNameModel).path() + "/" + QFileInfo(CmdModel.FileNameModel).baseName() + ".pvd";
 		CmdModel.Open();
 	}
-	if (parser->isSet("p"))
+	// stages completed by an earlier run of the same job: "", "premesh", "plc" or "tetgen"
+	QString completed;
+	if (parser->isSet("checkpoint"))
+	{
+		this->checkpoints.setDirectory(parser->value("checkpoint"));
+		this->job = this->jobKey(parser->isSet("p"), parser->isSet("m"));
+		QByteArray data;
+		if (parser->isSet("resume"))
+		{
+			if (this->checkpoints.load("checkpoint", this->job, data) && CmdModel.restore_checkpoint(data, completed))
+				std::cout << ">Resuming after stage " << completed.toUtf8().constData() << std::endl;
+			else
+				std::cout << ">No checkpoint of this job found, starting from the beginning" << std::endl;
+		}
+	}
+	if (parser->isSet("p") && completed.isEmpty())
 	{
 		this->preMeshJob();
 		for (int s = 0; s != CmdModel.Surfaces.length(); s++)
@@ -50,9 +74,10 @@ C_CommandLine::C_CommandLine(QCommandLineParser * parser)
 		for (int p = 0; p != CmdModel.Polylines.length(); p++)
 			for (int c = 0; c != CmdModel.Polylines[p].Constraints.length(); c++)
 				CmdModel.Polylines[p].Constraints[c].Type = "SEGMENTS";
+		this->checkpoint("premesh");
 	}
-	if (parser->isSet("m"))
-		this->MeshJob();
+	if (parser->isSet("m") && completed != "tetgen")
+		this->MeshJob(completed == "plc");
 	if (parser->isSet("output"))
 	{
 		CmdModel.FileNameModel = parser->value("output");
@@ -72,82 +97,132 @@ C_CommandLine::C_CommandLine(QCommandLineParser * parser)
 C_CommandLine::~C_CommandLine()
 {}
 
+/* Identifies a job by its input data and parameters, so that a checkpoint
+ * is only resumed by the run it was taken from. */
+QByteArray
+C_CommandLine::jobKey(bool preMesh, bool mesh) const
+{
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	QByteArray data;
+	QDataStream out(&data, QIODevice::WriteOnly);
+	out.setVersion(QDataStream::Qt_6_0);
+	out << preMesh << mesh << this->switches << CmdModel.intAlgorythm << CmdModel.preMeshGradient << CmdModel.meshGradient;
+	for (int s = 0; s != CmdModel.Surfaces.length(); s++)
+		out << CmdModel.Surfaces[s].Name << CmdModel.Surfaces[s].Type << CmdModel.Surfaces[s].size << CmdModel.Surfaces[s].SDs
+			<< CmdModel.Surfaces[s].Ts.length() << CmdModel.Surfaces[s].Constraints;
+	for (int p = 0; p != CmdModel.Polylines.length(); p++)
+		out << CmdModel.Polylines[p].Name << CmdModel.Polylines[p].Type << CmdModel.Polylines[p].size << CmdModel.Polylines[p].SDs
+			<< CmdModel.Polylines[p].Constraints;
+	for (int m = 0; m != CmdModel.Mats.length(); m++)
+		out << CmdModel.Mats[m].Locations;
+	hash.addData(data);
+	return hash.result().toHex();
+}
+
+void
+C_CommandLine::checkpoint(const QString &stage)
+{
+	if (!this->checkpoints.isEnabled())
+		return;
+	if (!this->checkpoints.store("checkpoint", this->job, CmdModel.checkpoint(stage)))
+		std::cout << ">Cannot write the checkpoint after stage " << stage.toUtf8().constData() << std::endl;
+}
+
 void
 C_CommandLine::preMeshJob()
 {
 	//QDateTime startdate, enddate;
 	//startdate = QDateTime::currentDateTime();
 	//std::cout << ">Start Time: " << startdate.toString().toUtf8().constData() << std::endl;;
-	// convex hull
-	int currentStep = 0, totalSteps = CmdModel.Surfaces.length();
+	// results of unchanged surfaces, polylines and intersections are restored from the pre-mesh cache
+	CmdModel.premesh_begin(CmdModel.intAlgorythm, 2.0);
+	QList<int> surfaces, polylines;
+	QList<QPair<int, int> > pairs;
 	for (int s=0;s!=CmdModel.Surfaces.length();s++)
+		if (!CmdModel.restore_surface(s))
+			surfaces.append(s);
+	for (int p=0;p!=CmdModel.Polylines.length();p++)
+		if (!CmdModel.restore_polyline(p))
+			polylines.append(p);
+	// convex hull
+	int currentStep = 0, totalSteps = surfaces.length();
+	for (int i=0;i!=surfaces.length();i++)
 	{
-		C_CmdTask *task = new C_CmdTask(this, "CONVEXHULL", s, 0, ++currentStep, totalSteps);
+		C_CmdTask *task = new C_CmdTask(this, "CONVEXHULL", surfaces[i], 0, ++currentStep, totalSteps);
 		QThreadPool::globalInstance()->start(task);
 	}
 	QThreadPool::globalInstance()->waitForDone();
 	// segments
 	currentStep = 0;
-	totalSteps = CmdModel.Polylines.length();
-	for (int p=0;p!=CmdModel.Polylines.length();p++)
+	totalSteps = polylines.length();
+	for (int i=0;i!=polylines.length();i++)
 	{
-		C_CmdTask *task = new C_CmdTask(this, "SEGMENTS", p, 0, ++currentStep, totalSteps);
+		C_CmdTask *task = new C_CmdTask(this, "SEGMENTS", polylines[i], 0, ++currentStep, totalSteps);
 		QThreadPool::globalInstance()->start(task);
 	}
 	QThreadPool::globalInstance()->waitForDone();
 	//triangulation (coarse)
 	currentStep = 0;
-	totalSteps = CmdModel.Surfaces.length();
-	for (int s=0;s!=CmdModel.Surfaces.length();s++)
+	totalSteps = surfaces.length();
+	for (int i=0;i!=surfaces.length();i++)
 	{
-		C_CmdTask *task = new C_CmdTask(this, "TRIANGLES", s, 0, ++currentStep, totalSteps);
+		C_CmdTask *task = new C_CmdTask(this, "TRIANGLES", surfaces[i], 0, ++currentStep, totalSteps);
 		QThreadPool::globalInstance()->start(task);
 	}
 	QThreadPool::globalInstance()->waitForDone();
+	for (int i=0;i!=surfaces.length();i++)
+		CmdModel.store_surface(surfaces[i]);
+	for (int i=0;i!=polylines.length();i++)
+		CmdModel.store_polyline(polylines[i]);
 	// intersection: surface-surface
 	CmdModel.Intersections.clear();
+	CmdModel.IntersectionKeys.clear();
+	for (int s1=0;s1<CmdModel.Surfaces.length()-1;s1++)
+		for (int s2=s1+1;s2!=CmdModel.Surfaces.length();s2++)
+			if (!CmdModel.restore_int_polyline(s1, s2))
+				pairs.append(qMakePair(s1, s2));
 	currentStep = 0;
-	totalSteps = CmdModel.Surfaces.length()*(CmdModel.Surfaces.length() - 1) / 2;
-	if (totalSteps>0)
+	totalSteps = pairs.length();
+	for (int i=0;i!=pairs.length();i++)
 	{
-		for (int s1=0;s1!=CmdModel.Surfaces.length()-1;s1++)
-			for (int s2=s1+1;s2!=CmdModel.Surfaces.length();s2++)
-			{
-				C_CmdTask *task = new C_CmdTask(this, "INTERSECTION_MESH_MESH", s1, s2, ++currentStep, totalSteps);
-				QThreadPool::globalInstance()->start(task);
-			}
-		QThreadPool::globalInstance()->waitForDone();
+		C_CmdTask *task = new C_CmdTask(this, "INTERSECTION_MESH_MESH", pairs[i].first, pairs[i].second, ++currentStep, totalSteps);
+		QThreadPool::globalInstance()->start(task);
 	}
+	QThreadPool::globalInstance()->waitForDone();
+	int meshMesh = CmdModel.Intersections.length();
 	// intersection: surface-polyline
+	pairs.clear();
+	for (int p=0;p!=CmdModel.Polylines.length();p++)
+		for (int s=0;s!=CmdModel.Surfaces.length();s++)
+			if (!CmdModel.restore_int_point(p, s))
+				pairs.append(qMakePair(p, s));
 	currentStep = 0;
-	totalSteps = CmdModel.Polylines.length()*CmdModel.Surfaces.length();
-	if (totalSteps>0)
+	totalSteps = pairs.length();
+	for (int i=0;i!=pairs.length();i++)
 	{
-		for (int p=0;p!=CmdModel.Polylines.length();p++)
-			for (int s=0;s!=CmdModel.Surfaces.length();s++)
-			{
-				C_CmdTask *task = new C_CmdTask(this, "INTERSECTION_POLYLINE_MESH", p, s, ++currentStep, totalSteps);
-				QThreadPool::globalInstance()->start(task);
-			}
-		QThreadPool::globalInstance()->waitForDone();
+		C_CmdTask *task = new C_CmdTask(this, "INTERSECTION_POLYLINE_MESH", pairs[i].first, pairs[i].second, ++currentStep, totalSteps);
+		QThreadPool::globalInstance()->start(task);
 	}
+	QThreadPool::globalInstance()->waitForDone();
+	CmdModel.link_intersections(meshMesh);
 
 	CmdModel.calculate_size_of_intersections();
 
 	//intersection: triple points
 	CmdModel.TPs.clear();
+	pairs.clear();
+	for (int i1=0;i1<CmdModel.Intersections.length()-1;i1++)
+		for (int i2 = i1 + 1; i2 != CmdModel.Intersections.length(); i2++)
+			if (!CmdModel.restore_int_triplepoints(i1, i2))
+				pairs.append(qMakePair(i1, i2));
 	currentStep = 0;
-	totalSteps = CmdModel.Intersections.length()*(CmdModel.Intersections.length() - 1) / 2;
-	if (totalSteps>0)
+	totalSteps = pairs.length();
+	for (int i=0;i!=pairs.length();i++)
 	{
-		for (int i1=0;i1!=CmdModel.Intersections.length()-1;i1++)
-			for (int i2 = i1 + 1; i2 != CmdModel.Intersections.length(); i2++)
-			{
-				C_CmdTask * task = new C_CmdTask(this, "INTERSECTION_TRIPLEPOINTS", i1, i2, ++currentStep, totalSteps);
-				QThreadPool::globalInstance()->start(task);
-			}
-		QThreadPool::globalInstance()->waitForDone();
+		C_CmdTask * task = new C_CmdTask(this, "INTERSECTION_TRIPLEPOINTS", pairs[i].first, pairs[i].second, ++currentStep, totalSteps);
+		QThreadPool::globalInstance()->start(task);
 	}
+	QThreadPool::globalInstance()->waitForDone();
 	CmdModel.insert_int_triplepoints();
 	// aligning convex hull to intersection
 	for (int s=0;s!=CmdModel.Surfaces.length();s++)
@@ -158,16 +233,22 @@ C_CommandLine::preMeshJob()
 	for (int p=0;p!=CmdModel.Polylines.length();p++)
 		CmdModel.Polylines[p].calculate_Constraints();
 	CmdModel.calculate_size_of_constraints();
+	CmdModel.premesh_end();
 	//enddate = QDateTime::currentDateTime();
 }
 
 void
-C_CommandLine::MeshJob()
+C_CommandLine::MeshJob(bool resumeTetgen)
 {
 //	QDateTime startdate, enddate;
 //	startdate = QDateTime::currentDateTime();
 	//emit progress_append(">Start Time: " + startdate.toString() + "\n");
 	int currentStep, totalSteps;
+	if (resumeTetgen)
+	{
+		this->tetgenJob();
+		return;
+	}
 	// segments - fine
 	currentStep = 0;
 	totalSteps = CmdModel.Polylines.length();
@@ -177,20 +258,53 @@ C_CommandLine::MeshJob()
 		QThreadPool::globalInstance()->start(task);
 	}
 	QThreadPool::globalInstance()->waitForDone();
-	// triangulation - fine
-	currentStep = 0;
-	totalSteps = CmdModel.Surfaces.length();
+	// triangulation - fine; the keys are taken before the triangulation rotates the constraints
+	QList<QByteArray> keys;
+	QList<int> surfaces;
 	for (int s = 0; s != CmdModel.Surfaces.length(); s++)
 	{
-		C_CmdTask *task = new C_CmdTask(this, "TRIANGLES_FINE", s, 0, ++currentStep, totalSteps);
+		keys.append(CmdModel.StageCache.isEnabled() ? CmdModel.surface_fine_key(s, CmdModel.intAlgorythm, 2.0) : QByteArray());
+		if (!CmdModel.restore_surface_fine(s, keys[s]))
+			surfaces.append(s);
+	}
+	// the largest surfaces first, so that a memory budget does not leave them to the end
+	QList<QPair<qint64, int> > estimates;
+	for (int i = 0; i != surfaces.length(); i++)
+		estimates.append(qMakePair(-CmdModel.Surfaces[surfaces[i]].estimate_fine_memory(), surfaces[i]));
+	std::stable_sort(estimates.begin(), estimates.end());
+	CmdModel.MemoryBudget.reset();
+	currentStep = 0;
+	totalSteps = surfaces.length();
+	for (int i = 0; i != estimates.length(); i++)
+	{
+		C_CmdTask *task = new C_CmdTask(this, "TRIANGLES_FINE", estimates[i].second, 0, ++currentStep, totalSteps);
 		QThreadPool::globalInstance()->start(task);
 	}
 	QThreadPool::globalInstance()->waitForDone();
-	// tetrahedralization
-	CmdModel.calculate_tets("pq1.2AY");
+	if (!surfaces.isEmpty())
+	{
+		const double MiB = 1024.0 * 1024.0;
+		std::cout << ">Fine triangulation memory: estimated " << CmdModel.MemoryBudget.estimated() / MiB << " MiB, actual "
+			<< CmdModel.MemoryBudget.actual() / MiB << " MiB, peak admitted " << CmdModel.MemoryBudget.peak() / MiB << " MiB";
+		if (CmdModel.MemoryBudget.limit() != 0)
+			std::cout << " of " << CmdModel.MemoryBudget.limit() / MiB << " MiB (" << CmdModel.MemoryBudget.throttled() << " surfaces waited)";
+		std::cout << ", peak resident " << C_MemoryBudget::peakResidentSetSize() / MiB << " MiB" << std::endl;
+	}
+	for (int i = 0; i != surfaces.length(); i++)
+		CmdModel.store_surface_fine(surfaces[i], keys[surfaces[i]]);
+	this->checkpoint("plc");
+	this->tetgenJob();
 	//	enddate = QDateTime::currentDateTime();
 }
 
+void
+C_CommandLine::tetgenJob()
+{
+	CmdModel.calculate_tets(this->switches);
+	if (CmdModel.Mesh)
+		this->checkpoint("tetgen");
+}
+
 void
 C_CommandLine::runThreadPool(QString Attribute, int Object1, int Object2, int currentStep, int totalSteps)
 {
@@ -230,6 +344,8 @@ C_CommandLine::runThreadPool(QString Attribute, int Object1, int Object2, int cu
 	}
 	if (Attribute == "TRIANGLES_FINE")
 	{
+		qint64 estimate = CmdModel.Surfaces[Object1].estimate_fine_memory();
+		CmdModel.MemoryBudget.acquire(estimate);
 		CmdModel.Surfaces[Object1].calculate_normal_vector();
 		CmdModel.Surfaces[Object1].rotate(true);
 		CmdModel.Surfaces[Object1].separate_Constraints();
@@ -241,6 +357,7 @@ C_CommandLine::runThreadPool(QString Attribute, int Object1, int Object2, int cu
 			CmdModel.Surfaces[Object1].Ts[t].calculate_min_max();
 			CmdModel.Surfaces[Object1].Ts[t].setNormalVector();
 		}
+		CmdModel.MemoryBudget.release(estimate, CmdModel.Surfaces[Object1].fine_memory());
 	}
 	if (Attribute == "INTERSECTION_POLYLINE_MESH")
 		CmdModel.calculate_int_point(Object1, Object2);
@@ -33,6 +33,7 @@
 
 #include <sstream>
 
+#include "cancellation.h"
 #include "core.h"
 #include "glwidget.h"
 
@@ -125,6 +126,11 @@ bool PolygonSelection::getPoint(QPointF &p) const
 	return false;
 }
 
+QPolygonF PolygonSelection::polygon() const
+{
+	return QPolygonF(QVector<QPointF>(vertices.begin(), vertices.end()));
+}
+
 void PolygonSelection::draw(const GLWidget *glwidget) const
 {
 	glMatrixMode(GL_PROJECTION);
@@ -217,6 +223,10 @@ typedef REAL *vertex;
 extern "C" {
 int triunsuitable(vertex triorg, vertex tridest, vertex triapex, REAL area)
 {
+	/* a cancelled job accepts every triangle, so Triangle stops refining */
+	if (C_Cancellation::requested())
+		return 0;
+
 	const GradientControl& g = GradientControl::getInstance();
 
 	REAL grad = g.gradient();
@@ -27,11 +27,14 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <sstream>
 
+#include "cancellation.h"
 #include "core.h"
 #include "geometry.h"
 #include "intersections.h"
+#include "seg_seg_packet.h"
 
 #define SQUAREROOTTWO 1.4142135623730950488016887242096980785696718753769480732
 #define MY_PI 3.141592653589793238462643383279502884197169399375105820974944592308
@@ -594,13 +597,19 @@ void
 C_Line::AddPoint(C_Vector3D TP)
 {
 /*
-	Add a point to the belonging line
+	Add a point to the belonging line.
+	The point is inserted behind the first segment it lies on, so the points keep their order along the line.
+	Both end points belong to the segment: a point on the last point of the line or a point projected to the
+	origin (the centre of the model) is inserted as well, a duplicate is removed by CleanIdenticalPoints().
 */
-	C_Vector3D *xProjection = new C_Vector3D;
 	for (int n = 0; n != this->Ns.length() - 1; n++)
 	{
-		projectTo(TP, this->Ns[n], this->Ns[n + 1], xProjection);
-		if (lengthSquared(*xProjection) != 0 && lengthSquared(*xProjection - TP) < 1e-24)
+		C_Vector3D segment = this->Ns[n + 1] - this->Ns[n];
+		double length = lengthSquared(segment);
+		double t = length == 0 ? 0 : dot(TP - this->Ns[n], segment) / length;
+		if (t < 0 || t > 1)
+			continue;
+		if (lengthSquared(this->Ns[n] + t * segment - TP) < 1e-24)
 		{
 			this->Ns.insert(n + 1, TP);
 			return;
@@ -1172,25 +1181,53 @@ C_Polyline::calculate_min_max()
 		this->size = length(max - min) / 16;
 }
 
-void
-C_Polyline::makeScatteredData()
+/* Uploads the points in the order of their level of detail hierarchy, the
+ * points to draw are selected for every view by selectPoints(). */
+static void
+makePoints(const QList<C_Vector3D> &SDs, const GLfloat *color, C_PointLOD &lod, C_GLBuffer &vbo)
 {
-	GLuint list = glGenLists(1);
-	glNewList(list, GL_COMPILE);
-	glDisable(GL_LIGHT0);
-	glLightModelfv(GL_LIGHT_MODEL_AMBIENT, Cols.White);
+	QVector<float> positions;
+	positions.reserve(3 * SDs.length());
+	for (int s = 0; s != SDs.length(); s++)
+	{
+		positions.append(SDs[s].x());
+		positions.append(SDs[s].y());
+		positions.append(SDs[s].z());
+	}
+	lod.build(positions);
 
-	glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, this->Cols.LightMagenta);
+	C_RenderBuffer points(C_RenderBuffer::POINTS);
+	points.unlit = true;
+	points.reserve(lod.count(), 0);
+	double p[3];
+	for (int s = 0; s != lod.count(); s++)
+	{
+		const C_Vector3D &v = SDs[lod.order()[s]];
+		p[0] = v.x();
+		p[1] = v.y();
+		p[2] = v.z();
+		points.addVertex(p, color);
+	}
+	vbo.upload(points);
+}
 
-	glBegin(GL_POINTS);
-	for (int s = 0; s != SDs.length(); s++)
-		glVertex3f(SDs[s].x(), SDs[s].y(), SDs[s].z());
-	glEnd();
+static void
+selectPoints(C_PointLOD &lod, C_GLBuffer &vbo, const double projection[16], const double modelview[16], int height, int budget)
+{
+	if (lod.select(projection, modelview, height, budget))
+		vbo.uploadIndices(lod.selection());
+}
 
-	glLightModelfv(GL_LIGHT_MODEL_AMBIENT, Cols.Grey);
-	glEnable(GL_LIGHT0);
-	glEndList();
-	listScatteredData = list;
+void
+C_Polyline::makeScatteredData()
+{
+	makePoints(SDs, this->Cols.LightMagenta, lodScatteredData, vboScatteredData);
+}
+
+void
+C_Polyline::selectScatteredData(const double projection[16], const double modelview[16], int height, int budget)
+{
+	selectPoints(lodScatteredData, vboScatteredData, projection, modelview, height, budget);
 }
 
 void
@@ -1645,7 +1682,7 @@ void C_Surface::SolveSpline(){
 	}
 }
 
-double C_Surface::KRIGING(double x, double y){
+double C_Surface::KRIGING(double x, double y) const{
 	double z=0.0;
 	for(int s=0;s!=this->selectedSDs.length();s++){
 		z+=this->KrigingWeights[s]*pow((x-this->selectedSDs[s]->x())*(x-this->selectedSDs[s]->x())+(y-this->selectedSDs[s]->y())*(y-this->selectedSDs[s]->y()),0.5*this->KrigingBeta);
@@ -1654,7 +1691,7 @@ double C_Surface::KRIGING(double x, double y){
 	return z;
 }
 
-double C_Surface::SPLINE(double x, double y){
+double C_Surface::SPLINE(double x, double y) const{
 	double distance;
 	for (int s=0;s!=this->SDs.length(); s++){
 		if (this->SDs[s].x()==x && this->SDs[s].y()==y) return this->SDs[s].z();
@@ -1667,7 +1704,7 @@ double C_Surface::SPLINE(double x, double y){
 	return z;
 }
 
-double C_Surface::IDW(double x, double y){
+double C_Surface::IDW(double x, double y) const{
 	double sum=0;
 	double z=0;
 	double distance;
@@ -1723,80 +1760,76 @@ void C_Surface::interpolation(QString object, QString method){
 	}
 } 
 
+/* Applies the rotation matrix R to all points of list. The coordinates are
+ * copied block-wise into contiguous arrays, where the transform runs as a
+ * vectorizable loop without copying the C_Vector3D objects themselves. */
+static void rotatePoints(QList<C_Vector3D> &list, const double R[3][3]){
+	const int block = 256;
+	double x[block], y[block], z[block];
+	C_Vector3D *points = list.data();
+	for (int b = 0; b < list.length(); b += block){
+		int n = qMin(block, (int)list.length() - b);
+		for (int i = 0; i != n; i++){
+			x[i] = points[b + i].x();
+			y[i] = points[b + i].y();
+			z[i] = points[b + i].z();
+		}
+		for (int i = 0; i != n; i++){
+			double px = x[i], py = y[i], pz = z[i];
+			x[i] = R[0][0] * px + R[0][1] * py + R[0][2] * pz;
+			y[i] = R[1][0] * px + R[1][1] * py + R[1][2] * pz;
+			z[i] = R[2][0] * px + R[2][1] * py + R[2][2] * pz;
+		}
+		for (int i = 0; i != n; i++){
+			points[b + i].setX(x[i]);
+			points[b + i].setY(y[i]);
+			points[b + i].setZ(z[i]);
+		}
+	}
+}
+
 void C_Surface::rotate(bool onto_z){
-	C_Vector3D * axis = new C_Vector3D;
+	C_Vector3D axis;
 	if (onto_z){
-		cross(this->normal_vector, C_Vector3D(0, 0, 1), axis);
+		cross(this->normal_vector, C_Vector3D(0, 0, 1), &axis);
 	}
 	else{
-		cross(C_Vector3D(0, 0, 1), this->normal_vector, axis);
-		for (int n = 0; n != Ns.length(); n++){
-			for (int nc = 0; nc != ConvexHull.Ns.length(); nc++){
-				if (ConvexHull.Ns[nc].x() == Ns[n].x() && ConvexHull.Ns[nc].y() == Ns[n].y()){
-					Ns[n].setZ(ConvexHull.Ns[nc].z());
-				}
-			}
-			for (int i = 0; i != Intersections.length(); i++){
-				for (int ni = 0; ni != Intersections[i]->Ns.length(); ni++){
-					if (Intersections[i]->Ns[ni].x() == Ns[n].x() && Intersections[i]->Ns[ni].y() == Ns[n].y()){
-						Ns[n].setZ(Intersections[i]->Ns[ni].z());
-					}
-				}
-			}
-			for (int s = 0; s != Constraints.length(); s++){
-				for (int ns = 0; ns != Constraints[s].Ns.length(); ns++){
-					if (Constraints[s].Ns[ns].x() == Ns[n].x() && Constraints[s].Ns[ns].y() == Ns[n].y()){
-						Ns[n].setZ(Constraints[s].Ns[ns].z());
-					}
-				}
-			}
+		cross(C_Vector3D(0, 0, 1), this->normal_vector, &axis);
+		// the first nodes of Ns are the input points of the triangulation: restore their z overwritten by the interpolation
+		for (int n = 0; n < NsFixedZ.length() && n < Ns.length(); n++){
+			Ns[n].setZ(NsFixedZ[n]);
 		}
+		NsFixedZ.clear();
 	}
-	normalize(axis);
+	normalize(&axis);
 	double costheta = dot(C_Vector3D(0, 0, 1), this->normal_vector);
 	if (1 - FABS(costheta) < 1e-12) return;
 	double c = costheta;
 	double s = sqrt(1 - c*c);
 	double C = 1 - c;
-	C_Vector3D r1 = C_Vector3D(axis->x()*axis->x()*C + c, axis->x()*axis->y()*C - axis->z()*s, axis->x()*axis->z()*C + axis->y()*s);
-	C_Vector3D r2 = C_Vector3D(axis->y()*axis->x()*C + axis->z()*s, axis->y()*axis->y()*C + c, axis->y()*axis->z()*C - axis->x()*s);
-	C_Vector3D r3 = C_Vector3D(axis->z()*axis->x()*C - axis->y()*s, axis->z()*axis->y()*C + axis->x()*s, axis->z()*axis->z()*C + c);
-	C_Vector3D temp;
-
-	for (int n = 0; n != Ns.length(); n++){
-		temp = Ns[n];
-		Ns[n].setX(dot(r1, temp));
-		Ns[n].setY(dot(r2, temp));
-		Ns[n].setZ(dot(r3, temp));
-	}
-
-	for (int s = 0; s != SDs.length(); s++){
-		temp = SDs[s];
-		SDs[s].setX(dot(r1, temp));
-		SDs[s].setY(dot(r2, temp));
-		SDs[s].setZ(dot(r3, temp));
-	}
-	for (int n = 0; n != ConvexHull.Ns.length(); n++){
-		temp = ConvexHull.Ns[n];
-		ConvexHull.Ns[n].setX(dot(r1, temp));
-		ConvexHull.Ns[n].setY(dot(r2, temp));
-		ConvexHull.Ns[n].setZ(dot(r3, temp));
+	const double R[3][3] = {
+		{ axis.x()*axis.x()*C + c, axis.x()*axis.y()*C - axis.z()*s, axis.x()*axis.z()*C + axis.y()*s },
+		{ axis.y()*axis.x()*C + axis.z()*s, axis.y()*axis.y()*C + c, axis.y()*axis.z()*C - axis.x()*s },
+		{ axis.z()*axis.x()*C - axis.y()*s, axis.z()*axis.y()*C + axis.x()*s, axis.z()*axis.z()*C + c } };
+
+	rotatePoints(Ns, R);
+	if (onto_z){
+		SDsUnrotated = SDs;
+		rotatePoints(SDs, R);
+	}
+	else if (SDsUnrotated.length() == SDs.length()){
+		SDs = SDsUnrotated;
+		SDsUnrotated.clear();
 	}
+	else{
+		rotatePoints(SDs, R);
+	}
+	rotatePoints(ConvexHull.Ns, R);
 	for (int i = 0; i != Intersections.length(); i++){
-		for (int n = 0; n != Intersections[i]->Ns.length(); n++){
-			temp = Intersections[i]->Ns[n];
-			Intersections[i]->Ns[n].setX(dot(r1, temp));
-			Intersections[i]->Ns[n].setY(dot(r2, temp));
-			Intersections[i]->Ns[n].setZ(dot(r3, temp));
-		}
+		rotatePoints(Intersections[i]->Ns, R);
 	}
 	for (int s = 0; s != Constraints.length(); s++){
-		for (int n = 0; n != Constraints[s].Ns.length(); n++){
-			temp = Constraints[s].Ns[n];
-			Constraints[s].Ns[n].setX(dot(r1, temp));
-			Constraints[s].Ns[n].setY(dot(r2, temp));
-			Constraints[s].Ns[n].setZ(dot(r3, temp));
-		}
+		rotatePoints(Constraints[s].Ns, R);
 	}
 }
 
@@ -1930,7 +1963,7 @@ void C_Surface::calculate_convex_hull(){
 */
 void C_Surface::alignIntersectionsToConvexHull()
 {
-	C_Vector3D * xProjection = new C_Vector3D;
+	C_Vector3D xProjection;
 	for (int i = 0; i != Intersections.length(); i++)
 	{
 		for (int n=0;n!=ConvexHull.Ns.length()-1;n++){
@@ -1943,8 +1976,8 @@ void C_Surface::alignIntersectionsToConvexHull()
 				break;
 			}
 			else{
-				projectTo(Intersections[i]->Ns.first(), ConvexHull.Ns[n], ConvexHull.Ns[n + 1], xProjection);
-				if (lengthSquared(*xProjection) != 0 && lengthSquared(*xProjection - Intersections[i]->Ns.first())<1e-24){
+				projectTo(Intersections[i]->Ns.first(), ConvexHull.Ns[n], ConvexHull.Ns[n + 1], &xProjection);
+				if (lengthSquared(xProjection) != 0 && lengthSquared(xProjection - Intersections[i]->Ns.first())<1e-24){
 					Intersections[i]->Ns.first().setType("COMMON_INTERSECTION_CONVEXHULL_POINT");
 					ConvexHull.Ns.insert(n + 1, Intersections[i]->Ns.first());
 					break;
@@ -1961,8 +1994,8 @@ void C_Surface::alignIntersectionsToConvexHull()
 				break;
 			}
 			else{
-				projectTo(Intersections[i]->Ns.last(), ConvexHull.Ns[n], ConvexHull.Ns[n + 1], xProjection);
-				if (lengthSquared(*xProjection) != 0 && lengthSquared(*xProjection - Intersections[i]->Ns.last())<1e-24){
+				projectTo(Intersections[i]->Ns.last(), ConvexHull.Ns[n], ConvexHull.Ns[n + 1], &xProjection);
+				if (lengthSquared(xProjection) != 0 && lengthSquared(xProjection - Intersections[i]->Ns.last())<1e-24){
 					Intersections[i]->Ns.last().setType("COMMON_INTERSECTION_CONVEXHULL_POINT");
 					ConvexHull.Ns.insert(n + 1, Intersections[i]->Ns.last());
 					break;
@@ -2102,6 +2135,7 @@ void C_Surface::calculate_triangles(bool withConstraints, double gradient){
 	out.edgemarkerlist = (int *) NULL;   /* Needed if -e used and -B not used. */
 
 	this->Ns.clear(); 
+	this->NsFixedZ.clear();
 	this->Ts.clear(); 
 
 	GradientControl& gc = GradientControl::getInstance();
@@ -2119,6 +2153,10 @@ void C_Surface::calculate_triangles(bool withConstraints, double gradient){
 				No.setY(out.pointlist[2*i+1]);
 				Ns.append(No); 
 			}
+			// Triangle keeps the input points in front of the output points
+			for (int p = 0; p < points.length() && p < out.numberofpoints; p++){
+				NsFixedZ.append(points[p].z());
+			}
 		}
 		if (out.numberoftriangles>0){
 			for (int t=0;t!=out.numberoftriangles;t++){
@@ -2145,6 +2183,48 @@ void C_Surface::calculate_triangles(bool withConstraints, double gradient){
 	free(out.triangleattributelist);
 }
 
+/* Memory per node and per triangle of a fine triangulation: the objects kept
+ * by the surface plus the working and output arrays of Triangle. */
+#define FINE_BYTES_PER_NODE ((qint64)sizeof(C_Vector3D) + 96)
+#define FINE_BYTES_PER_TRIANGLE ((qint64)sizeof(C_Triangle) + 160)
+
+/* Nodes of an equilateral triangulation with edge length h cover sqrt(3)/2 h^2
+ * each. Around a constraint of size hc the edge length grows with the slope
+ * gradient up to the size of the surface, which adds a band of
+ * L / (sqrt(3)/2 gradient) (1/hc - 1/h) nodes along a line of length L and
+ * 2 pi / (sqrt(3)/2 gradient^2) (ln(h/hc) + hc/h - 1) nodes around a point. */
+qint64 C_Surface::estimate_fine_memory(double gradient) const{
+	const double cell = 0.5 * sqrt(3.0);
+	double h = this->size;
+	double g = gradient > 0.1 ? gradient : 0.1;
+	if (h <= 0) return 0;
+	C_Vector3D area2;
+	for (int n = 0; n + 1 < ConvexHull.Ns.length(); n++){
+		C_Vector3D c;
+		cross(ConvexHull.Ns[n], ConvexHull.Ns[n + 1], &c);
+		area2 += c;
+	}
+	double nodes = 0.5 * length(area2) / (cell * h * h);
+	for (int c = 0; c != Constraints.length(); c++){
+		const C_Line &constraint = Constraints[c];
+		if (constraint.Type == "UNDEFINED" || constraint.Ns.isEmpty()) continue;
+		double hc = constraint.size > 0 && constraint.size < h ? constraint.size : h;
+		if (constraint.Ns.length() == 1){
+			nodes += 1 + 2 * MY_PI / (cell * g * g) * (log(h / hc) + hc / h - 1);
+			continue;
+		}
+		double L = 0;
+		for (int n = 0; n + 1 < constraint.Ns.length(); n++)
+			L += length(constraint.Ns[n + 1] - constraint.Ns[n]);
+		nodes += L / hc + L / (cell * g) * (1 / hc - 1 / h);
+	}
+	return (qint64)(nodes * (FINE_BYTES_PER_NODE + 2 * FINE_BYTES_PER_TRIANGLE));
+}
+
+qint64 C_Surface::fine_memory() const{
+	return Ns.length() * FINE_BYTES_PER_NODE + Ts.length() * FINE_BYTES_PER_TRIANGLE;
+}
+
 C_Surface::C_Surface(){
 	this->drawScatteredData = false;
 	this->drawConvexHull = false;
@@ -2227,25 +2307,20 @@ void C_Surface::clearScatteredData(){
 	delete[] z;
 }
 
-void C_Surface::makeScatteredData(){
-    GLuint list = glGenLists(1);
-    glNewList(list, GL_COMPILE);
-	glDisable(GL_LIGHT0);
-	glLightModelfv(GL_LIGHT_MODEL_AMBIENT, Cols.White);
+/* Colour of the scattered data, faces and edges of a surface of the given type. */
+static const GLfloat *surfaceColor(const C_Colors &cols, const QString &type){
+	if (type=="UNIT") return cols.LightBlue;
+	if (type=="FAULT") return cols.LightRed;
+	if (type=="BORDER") return cols.LightGreen;
+	return cols.White;
+}
 
-	if (Type=="UNIT") glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.LightBlue);
-	if (Type=="FAULT") glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.LightRed);
-	if (Type=="BORDER") glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.LightGreen);
-	glBegin(GL_POINTS);
-    for (int s = 0; s!=SDs.length();s++){
-		glVertex3f(SDs[s].x(),SDs[s].y(),SDs[s].z());
-	}
-    glEnd();
+void C_Surface::makeScatteredData(){
+	makePoints(SDs, surfaceColor(Cols, Type), lodScatteredData, vboScatteredData);
+}
 
-	glLightModelfv(GL_LIGHT_MODEL_AMBIENT, Cols.Grey);
-	glEnable(GL_LIGHT0);
-    glEndList();
-	listScatteredData = list;
+void C_Surface::selectScatteredData(const double projection[16], const double modelview[16], int height, int budget){
+	selectPoints(lodScatteredData, vboScatteredData, projection, modelview, height, budget);
 }
 
 void C_Surface::makeConvexHull(){
@@ -2285,47 +2360,60 @@ void C_Surface::makeConvexHull(){
 	listConvexHull=list;
 }
 
-void C_Surface::makeFaces(){
-	GLuint list = glGenLists(1);
-	glNewList(list, GL_COMPILE);
+static void coordinates(const C_Vector3D &v, double p[3]){
+	p[0]=v.x();
+	p[1]=v.y();
+	p[2]=v.z();
+}
 
-	if (Type=="UNIT") glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.LightBlue);
-	if (Type=="FAULT") glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.LightRed);
-	if (Type=="BORDER") glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.LightGreen);
-	glBegin(GL_TRIANGLES);
-    for (int t = 0; t!=Ts.length();t++){
-		glNormal3d(Ts[t].normal_vector.x(),Ts[t].normal_vector.y(),Ts[t].normal_vector.z());
-		glVertex3d(Ts[t].Ns[0]->x(),Ts[t].Ns[0]->y(),Ts[t].Ns[0]->z());
-		glVertex3d(Ts[t].Ns[1]->x(),Ts[t].Ns[1]->y(),Ts[t].Ns[1]->z());
-		glVertex3d(Ts[t].Ns[2]->x(),Ts[t].Ns[2]->y(),Ts[t].Ns[2]->z());
+void C_Surface::buildFaces(C_RenderBuffer &faces) const{
+	const GLfloat *color = surfaceColor(Cols, Type);
+	double p[3];
+	double normal[3];
+	quint32 corner[3];
+
+	faces = C_RenderBuffer(C_RenderBuffer::TRIANGLES);
+	faces.reserve(3*Ts.length(), Ts.length());
+	for (int t = 0; t!=Ts.length();t++){
+		coordinates(Ts[t].normal_vector, normal);
+		for (int k = 0; k!=3; k++){
+			coordinates(*Ts[t].Ns[k], p);
+			corner[k] = faces.addVertex(p, normal, color);
+		}
+		faces.addTriangle(corner[0], corner[1], corner[2]);
 	}
-    glEnd();
+}
 
-    glEndList();
-	listFaces = list;
+void C_Surface::makeFaces(){
+	C_RenderBuffer faces;
+	buildFaces(faces);
+	vboFaces.upload(faces);
 }
 
-void C_Surface::makeEdges(){
-    GLuint list = glGenLists(1);
-    glNewList(list, GL_COMPILE);
-	glDisable(GL_LIGHT0);
-	glLightModelfv(GL_LIGHT_MODEL_AMBIENT, Cols.White);
+void C_Surface::buildEdges(C_RenderBuffer &edges) const{
+	const GLfloat *color = surfaceColor(Cols, Type);
+	double p[3];
+	quint32 corner[3];
 
-	if (Type=="UNIT") glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.LightBlue);
-	if (Type=="FAULT") glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.LightRed);
-	if (Type=="BORDER") glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.LightGreen);
-    for (int t = 0; t!=Ts.length();t++){
-		glBegin(GL_LINE_LOOP);
-		glVertex3d(Ts[t].Ns[0]->x(),Ts[t].Ns[0]->y(),Ts[t].Ns[0]->z());
-		glVertex3d(Ts[t].Ns[1]->x(),Ts[t].Ns[1]->y(),Ts[t].Ns[1]->z());
-		glVertex3d(Ts[t].Ns[2]->x(),Ts[t].Ns[2]->y(),Ts[t].Ns[2]->z());
-	    glEnd();
+	edges = C_RenderBuffer(C_RenderBuffer::LINES);
+	edges.unlit = true;
+	edges.reserve(Ns.length(), 3*Ts.length()/2+Ns.length());
+	/* the triangles point into Ns, a vertex is identified by its address */
+	for (int t = 0; t!=Ts.length();t++){
+		for (int k = 0; k!=3; k++){
+			coordinates(*Ts[t].Ns[k], p);
+			corner[k] = edges.sharedVertex(quint64(quintptr(Ts[t].Ns[k])), p, color);
+		}
+		edges.addUniqueLine(corner[0], corner[1]);
+		edges.addUniqueLine(corner[1], corner[2]);
+		edges.addUniqueLine(corner[2], corner[0]);
 	}
+}
 
-	glLightModelfv(GL_LIGHT_MODEL_AMBIENT, Cols.Grey);
-	glEnable(GL_LIGHT0);
-    glEndList();
-	listEdges = list;
+void C_Surface::makeEdges(){
+	C_RenderBuffer edges;
+	buildEdges(edges);
+	vboEdges.upload(edges);
 }
 
 void C_Surface::makeIntEdges(){
@@ -2383,70 +2471,63 @@ void C_Surface::makeIntVertices(){
 	listIntVertices = list;
 }
 
-void C_Surface::makeConstraints(bool selectionMode){
-    GLuint list = glGenLists(1);
-    glNewList(list, GL_COMPILE);
-	glDisable(GL_LIGHT0);
-	glLightModelfv(GL_LIGHT_MODEL_AMBIENT, Cols.White);
+void C_Surface::buildConstraints(C_RenderBuffer &lines, C_RenderBuffer &stippled, C_RenderBuffer &points, bool selectionMode) const{
+	C_RenderBuffer *buffers[3] = { &lines, &stippled, &points };
+	double p[3];
 
-	/* In selection mode, set a uniform width to avoid overlapping of points
-	 * and lines. */
-	GLfloat previousPointWidth;
-	GLfloat previousLineWidth;
-	GLfloat desiredWidth = 2.0f;
-	if( selectionMode ) {
-		glGetFloatv(GL_POINT_SIZE, &previousPointWidth);
-		glGetFloatv(GL_LINE_WIDTH, &previousLineWidth);
-		glPointSize(desiredWidth);
-		glLineWidth(desiredWidth);
+	lines = C_RenderBuffer(C_RenderBuffer::LINES);
+	stippled = C_RenderBuffer(C_RenderBuffer::LINES);
+	stippled.stippled = true;
+	points = C_RenderBuffer(C_RenderBuffer::POINTS);
+	for (int b = 0; b!=3; b++){
+		buffers[b]->unlit = true;
+		/* In selection mode, draw in the selection colours with a uniform
+		 * width to avoid overlapping of points and lines. */
+		buffers[b]->material = !selectionMode;
+		if( selectionMode )
+			buffers[b]->width = 2.0f;
 	}
 
 	for (int s = 0; s!=Constraints.length();s++){
-		if (Constraints[s].Type=="SEGMENTS") glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,this->Cols.Blue);
-		if (Constraints[s].Type=="HOLES") glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,this->Cols.Red);
-		if (Constraints[s].Type=="UNDEFINED"){
-			glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,this->Cols.White);
-
-			/* In selection mode, draw constraints with a solid line to allow
-			 * the paint fill bucket tool to work correctly. */
-			if( ! selectionMode )
-				glEnable(GL_LINE_STIPPLE);
-		}
-		glColor3f(Constraints[s].RGB[0]/255.0f, Constraints[s].RGB[1]/255.0f, Constraints[s].RGB[2]/255.0f);
-
-		glBegin(GL_LINE_STRIP);
-			for (int n=0;n!=Constraints[s].Ns.length();n++){
-				glVertex3f(Constraints[s].Ns[n].x(),Constraints[s].Ns[n].y(),Constraints[s].Ns[n].z());
-			}
-		glEnd();
-
-		glBegin(GL_POINTS);
-		if (Constraints[s].Ns.length()==1){
-			glVertex3f(Constraints[s].Ns.first().x(),Constraints[s].Ns.first().y(),Constraints[s].Ns.first().z());
-		}
-		else{
-			glVertex3f(Constraints[s].Ns.first().x(),Constraints[s].Ns.first().y(),Constraints[s].Ns.first().z());
-			glVertex3f(Constraints[s].Ns.last().x(),Constraints[s].Ns.last().y(),Constraints[s].Ns.last().z());
-		}
-		glEnd();
-
-		glColor3f(0.0f, 0.0f, 0.0f);
-
-		/* Take selection mode into account. */
-		if( ! selectionMode )
-			glDisable (GL_LINE_STIPPLE);
-	}
-
-	/* Restore previous point and line width. */
-	if( selectionMode ) {
-		glPointSize(previousPointWidth);
-		glLineWidth(previousLineWidth);
-	}
-
-	glLightModelfv(GL_LIGHT_MODEL_AMBIENT, Cols.Grey);
-	glEnable(GL_LIGHT0);
-	glEndList();
-	listConstraints = list;
+		const C_Line &constraint = Constraints[s];
+		if (constraint.Ns.isEmpty()) continue;
+		const GLfloat rgb[4] = { constraint.RGB[0]/255.0f, constraint.RGB[1]/255.0f, constraint.RGB[2]/255.0f, 1.0f };
+		const GLfloat *color = this->Cols.White;
+		if (constraint.Type=="SEGMENTS") color = this->Cols.Blue;
+		if (constraint.Type=="HOLES") color = this->Cols.Red;
+		if( selectionMode ) color = rgb;
+
+		/* In selection mode, draw constraints with a solid line to allow
+		 * the paint fill bucket tool to work correctly. */
+		C_RenderBuffer &segments = (constraint.Type=="UNDEFINED" && !selectionMode) ? stippled : lines;
+		coordinates(constraint.Ns.first(), p);
+		quint32 previous = segments.addVertex(p, color);
+		for (int n=1;n!=constraint.Ns.length();n++){
+			coordinates(constraint.Ns[n], p);
+			quint32 next = segments.addVertex(p, color);
+			segments.addLine(previous, next);
+			previous = next;
+		}
+
+		coordinates(constraint.Ns.first(), p);
+		points.addPoint(points.addVertex(p, color));
+		if (constraint.Ns.length()>1){
+			coordinates(constraint.Ns.last(), p);
+			points.addPoint(points.addVertex(p, color));
+		}
+	}
+}
+
+void C_Surface::makeConstraints(){
+	C_RenderBuffer lines, stippled, points;
+	buildConstraints(lines, stippled, points, false);
+	vboConstraints[0].upload(lines);
+	vboConstraints[1].upload(stippled);
+	vboConstraints[2].upload(points);
+	/* nothing is stippled in selection mode */
+	buildConstraints(lines, stippled, points, true);
+	vboSelection[0].upload(lines);
+	vboSelection[1].upload(points);
 }
 
 void C_Surface::makeVTU_SD(){
@@ -2875,6 +2956,8 @@ void C_Surface::separate_Constraints(){
 }
 
 C_Model::C_Model(){
+	this->Mesh = 0;
+	this->meshMeshIntersections = 0;
 	this->shift = C_Vector3D(0,0,0);
 	this->scale=1;
 	this->ExportRotationAngle = 0.0;
@@ -4291,8 +4374,14 @@ bool C_Box::too_much_seg() const {
 	return false;
 }
 
+C_Box::C_Box(C_Arena *arena){
+	this->arena = arena;
+	for (int b = 0; b != 8; b++)
+		this->Box[b] = 0;
+}
+
 void C_Box::generate_subboxes(){
-	this->Box[0] = new C_Box;
+	this->Box[0] = arena->create<C_Box>(arena);
 	Box[0]->min.setX(this->min.x());
 	Box[0]->min.setY(this->min.y());
 	Box[0]->min.setZ(this->min.z());
@@ -4300,7 +4389,7 @@ void C_Box::generate_subboxes(){
 	Box[0]->max.setY(this->center.y());
 	Box[0]->max.setZ(this->center.z());
 	Box[0]->calculate_center();
-	this->Box[1] = new C_Box;
+	this->Box[1] = arena->create<C_Box>(arena);
 	Box[1]->min.setX(this->center.x());
 	Box[1]->min.setY(this->min.y());
 	Box[1]->min.setZ(this->min.z());
@@ -4308,7 +4397,7 @@ void C_Box::generate_subboxes(){
 	Box[1]->max.setY(this->center.y());
 	Box[1]->max.setZ(this->center.z());
 	Box[1]->calculate_center();
-	this->Box[2] = new C_Box;
+	this->Box[2] = arena->create<C_Box>(arena);
 	Box[2]->min.setX(this->min.x());
 	Box[2]->min.setY(this->center.y());
 	Box[2]->min.setZ(this->min.z());
@@ -4316,7 +4405,7 @@ void C_Box::generate_subboxes(){
 	Box[2]->max.setY(this->max.y());
 	Box[2]->max.setZ(this->center.z());
 	Box[2]->calculate_center();
-	this->Box[3] = new C_Box;
+	this->Box[3] = arena->create<C_Box>(arena);
 	Box[3]->min.setX(this->min.x());
 	Box[3]->min.setY(this->min.y());
 	Box[3]->min.setZ(this->center.z());
@@ -4324,7 +4413,7 @@ void C_Box::generate_subboxes(){
 	Box[3]->max.setY(this->center.y());
 	Box[3]->max.setZ(this->max.z());
 	Box[3]->calculate_center();
-	this->Box[4] = new C_Box;
+	this->Box[4] = arena->create<C_Box>(arena);
 	Box[4]->min.setX(this->center.x());
 	Box[4]->min.setY(this->center.y());
 	Box[4]->min.setZ(this->min.z());
@@ -4332,7 +4421,7 @@ void C_Box::generate_subboxes(){
 	Box[4]->max.setY(this->max.y());
 	Box[4]->max.setZ(this->center.z());
 	Box[4]->calculate_center();
-	this->Box[5] = new C_Box;
+	this->Box[5] = arena->create<C_Box>(arena);
 	Box[5]->min.setX(this->center.x());
 	Box[5]->min.setY(this->min.y());
 	Box[5]->min.setZ(this->center.z());
@@ -4340,7 +4429,7 @@ void C_Box::generate_subboxes(){
 	Box[5]->max.setY(this->center.y());
 	Box[5]->max.setZ(this->max.z());
 	Box[5]->calculate_center();
-	this->Box[6] = new C_Box;
+	this->Box[6] = arena->create<C_Box>(arena);
 	Box[6]->min.setX(this->min.x());
 	Box[6]->min.setY(this->center.y());
 	Box[6]->min.setZ(this->center.z());
@@ -4348,7 +4437,7 @@ void C_Box::generate_subboxes(){
 	Box[6]->max.setY(this->max.y());
 	Box[6]->max.setZ(this->max.z());
 	Box[6]->calculate_center();
-	this->Box[7] = new C_Box;
+	this->Box[7] = arena->create<C_Box>(arena);
 	Box[7]->min.setX(this->center.x());
 	Box[7]->min.setY(this->center.y());
 	Box[7]->min.setZ(this->center.z());
@@ -4356,17 +4445,14 @@ void C_Box::generate_subboxes(){
 	Box[7]->max.setY(this->max.y());
 	Box[7]->max.setZ(this->max.z());
 	Box[7]->calculate_center();
-	for (int b = 0; b != 8; b++){
-		Box[b]->T1s.clear();
-		Box[b]->T2s.clear();
-		Box[b]->N1s.clear();
-		Box[b]->N2s.clear();
-	}
 }
 
 void C_Box::split_tri(C_Line * IntSegments){
 	int coplanar;
 	C_Vector3D isectpt1, isectpt2;
+	/* a cancelled job leaves the octree with the segments found so far */
+	if (C_Cancellation::requested())
+		return;
 	this->generate_subboxes();
 
 	for (int t1 = 0; t1 != this->T1s.length(); t1++){
@@ -4392,24 +4478,45 @@ void C_Box::split_tri(C_Line * IntSegments){
 				Box[b]->split_tri(IntSegments);
 			}
 			else{
+				/* Leaf: the plane tests of one triangle of T1s against all
+				 * triangles of T2s are done in packets (see tri_tri_packet.h),
+				 * only the remaining candidates go through the full test. */
+				const QList<const C_Triangle*>& T2s = Box[b]->T2s;
+				C_TrianglePacket packets[(48 + TRIANGLE_PACKET_WIDTH - 1) / TRIANGLE_PACKET_WIDTH];
+				int nPackets = (T2s.length() + TRIANGLE_PACKET_WIDTH - 1) / TRIANGLE_PACKET_WIDTH;
+				for (int p = 0; p != nPackets; p++){
+					packets[p].count = qMin(TRIANGLE_PACKET_WIDTH, T2s.length() - p * TRIANGLE_PACKET_WIDTH);
+					for (int l = 0; l != TRIANGLE_PACKET_WIDTH; l++)
+						tri_tri_packet_set(&packets[p], l, *T2s[p * TRIANGLE_PACKET_WIDTH + (l < packets[p].count ? l : 0)]);
+				}
 				for (int t1 = 0; t1 != Box[b]->T1s.length(); t1++){
-					for (int t2 = 0; t2 != Box[b]->T2s.length(); t2++){
-						if (tri_tri_intersect_with_isectline(*Box[b]->T1s[t1], *Box[b]->T2s[t2], &coplanar, &isectpt1, &isectpt2) != 0){
-							IntSegments->appendNonExistingSegment(isectpt1, isectpt2);
+					const C_Triangle& T1 = *Box[b]->T1s[t1];
+					double v[3][3];
+					for (int n = 0; n != 3; n++){
+						v[n][0] = T1.Ns[n]->x();
+						v[n][1] = T1.Ns[n]->y();
+						v[n][2] = T1.Ns[n]->z();
+					}
+					for (int p = 0; p != nPackets; p++){
+						unsigned int candidates = tri_tri_packet_candidates(v[0], v[1], v[2], packets[p]);
+						for (int l = 0; candidates != 0; l++, candidates >>= 1){
+							if ((candidates & 1) && tri_tri_intersect_with_isectline(T1, *T2s[p * TRIANGLE_PACKET_WIDTH + l], &coplanar, &isectpt1, &isectpt2) != 0){
+								IntSegments->appendNonExistingSegment(isectpt1, isectpt2);
+							}
 						}
 					}
 				}
-				delete Box[b];
+				/* the leaf itself is released with the arena, its lists right away */
+				Box[b]->T1s = QList<const C_Triangle*>();
+				Box[b]->T2s = QList<const C_Triangle*>();
 			}
-		}else{
-			delete Box[b];
 		}
 	}
 }
 
-void C_Box::split_seg(QList<C_Vector3D*> * TPs, int I1, int I2){
-	C_Vector3D * TP;
-
+void C_Box::split_seg(QList<C_Vector3D> * TPs, int I1, int I2){
+	if (C_Cancellation::requested())
+		return;
 	this->generate_subboxes();
 
 	for (int n1 = 0; n1 < this->N1s.length()-1; n1+=2){
@@ -4436,45 +4543,626 @@ void C_Box::split_seg(QList<C_Vector3D*> * TPs, int I1, int I2){
 				Box[b]->split_seg(TPs, I1, I2);
 			}
 			else{
+				/* Leaf: the shortest transversals (see C_Line::calculateSkewLineTransversal())
+				 * of one segment of N1s to all segments of N2s are computed in
+				 * packets (see seg_seg_packet.h). */
+				const QList<const C_Vector3D*>& N2s = Box[b]->N2s;
+				C_SegmentPacket packets[(48 / 2 + SEGMENT_PACKET_WIDTH - 1) / SEGMENT_PACKET_WIDTH];
+				int nSegments = N2s.length() / 2;
+				int nPackets = (nSegments + SEGMENT_PACKET_WIDTH - 1) / SEGMENT_PACKET_WIDTH;
+				for (int p = 0; p != nPackets; p++){
+					packets[p].count = qMin(SEGMENT_PACKET_WIDTH, nSegments - p * SEGMENT_PACKET_WIDTH);
+					for (int l = 0; l != SEGMENT_PACKET_WIDTH; l++){
+						int n2 = 2 * (p * SEGMENT_PACKET_WIDTH + (l < packets[p].count ? l : 0));
+						double q1[3] = { N2s[n2]->x(), N2s[n2]->y(), N2s[n2]->z() };
+						double q2[3] = { N2s[n2 + 1]->x(), N2s[n2 + 1]->y(), N2s[n2 + 1]->z() };
+						seg_seg_packet_set(&packets[p], l, q1, q2);
+					}
+				}
 				for (int n1 = 0; n1 < Box[b]->N1s.length()-1; n1+=2){
-					for (int n2 = 0; n2 < Box[b]->N2s.length()-1; n2+=2){
-						C_Line connector = connector.calculateSkewLineTransversal(*Box[b]->N1s[n1], *Box[b]->N1s[n1 + 1], *Box[b]->N2s[n2], *Box[b]->N2s[n2 + 1]);
-						if (connector.Ns.length() == 2 && lengthSquared(connector.Ns[0] - connector.Ns[1])<1e-24){
-							TP = new C_Vector3D((connector.Ns[0] + connector.Ns[1]) / 2);
-							TP->intID = I1;
-
-							/* The following statement is not thread-safe but
-							 * will be executed concurrently by multiple threads.
-							 * Therefore, it is important to guard this statement
-							 * with a mutex. */
-							mutex.lock();
+					double p1[3] = { Box[b]->N1s[n1]->x(), Box[b]->N1s[n1]->y(), Box[b]->N1s[n1]->z() };
+					double p2[3] = { Box[b]->N1s[n1 + 1]->x(), Box[b]->N1s[n1 + 1]->y(), Box[b]->N1s[n1 + 1]->z() };
+					for (int p = 0; p != nPackets; p++){
+						double midpoint[3][SEGMENT_PACKET_WIDTH];
+						unsigned int hits = seg_seg_packet_transversal(p1, p2, packets[p], 1e-24, midpoint);
+						for (int l = 0; hits != 0; l++, hits >>= 1){
+							if ((hits & 1) == 0)
+								continue;
+							/* TPs is local to the task, see C_Model::calculate_int_triplepoints() */
+							C_Vector3D TP(midpoint[0][l], midpoint[1][l], midpoint[2][l]);
+							TP.intID = I1;
 							TPs->append(TP);
-							mutex.unlock();
-
-							TP = new C_Vector3D((connector.Ns[0] + connector.Ns[1]) / 2);
-							TP->intID = I2;
-
-							/* Protect list access against race-conditions. */
-							mutex.lock();
+							TP.intID = I2;
 							TPs->append(TP);
-							mutex.unlock();
 						}
 					}
 				}
-				delete Box[b];
+				Box[b]->N1s = QList<const C_Vector3D*>();
+				Box[b]->N2s = QList<const C_Vector3D*>();
 			}
-		}else{
-			delete Box[b];
 		}
 	}
 }
 
 
+/********** Incremental pre-mesh **********/
+
+void C_PreMeshCache::clear(){
+	surfaces.clear();
+	paths.clear();
+	intersections.clear();
+	triplepoints.clear();
+	used.clear();
+}
+
+/* Drops all entries which were neither restored nor stored since the last
+ * call of C_Model::premesh_begin(), i.e. results of inputs no longer in the model. */
+void C_PreMeshCache::prune(){
+	for (QHash<QByteArray, Surface>::iterator it = surfaces.begin(); it != surfaces.end();){
+		if (used.contains(it.key())) ++it; else it = surfaces.erase(it);
+	}
+	for (QHash<QByteArray, C_Line>::iterator it = paths.begin(); it != paths.end();){
+		if (used.contains(it.key())) ++it; else it = paths.erase(it);
+	}
+	for (QHash<QByteArray, QList<C_Line> >::iterator it = intersections.begin(); it != intersections.end();){
+		if (used.contains(it.key())) ++it; else it = intersections.erase(it);
+	}
+	for (QHash<QByteArray, QList<C_Vector3D> >::iterator it = triplepoints.begin(); it != triplepoints.end();){
+		if (used.contains(it.key())) ++it; else it = triplepoints.erase(it);
+	}
+}
+
+QDataStream &operator<<(QDataStream &out, const C_Vector3D &vector){
+	return out << vector.x() << vector.y() << vector.z() << vector.type() << (qint32)vector.intID << (qint32)vector.triID;
+}
+
+QDataStream &operator>>(QDataStream &in, C_Vector3D &vector){
+	double x, y, z;
+	QString type;
+	qint32 intID, triID;
+	in >> x >> y >> z >> type >> intID >> triID;
+	vector = C_Vector3D(x, y, z);
+	vector.setType(type);
+	vector.intID = intID;
+	vector.triID = triID;
+	return in;
+}
+
+QDataStream &operator<<(QDataStream &out, const C_Line &line){
+	return out << line.Ns << line.NsPos << line.Type << line.size << (qint32)line.Object[0] << (qint32)line.Object[1] << line.min << line.max;
+}
+
+QDataStream &operator>>(QDataStream &in, C_Line &line){
+	qint32 object[2];
+	in >> line.Ns >> line.NsPos >> line.Type >> line.size >> object[0] >> object[1] >> line.min >> line.max;
+	line.Object[0] = object[0];
+	line.Object[1] = object[1];
+	return in;
+}
+
+QDataStream &operator<<(QDataStream &out, const C_PreMeshCache::Surface &surface){
+	return out << surface.normal_vector << surface.ConvexHull << surface.Ns << surface.Ts << (qint32)surface.duplicates << surface.HoleCoords;
+}
+
+QDataStream &operator>>(QDataStream &in, C_PreMeshCache::Surface &surface){
+	qint32 duplicates;
+	in >> surface.normal_vector >> surface.ConvexHull >> surface.Ns >> surface.Ts >> duplicates >> surface.HoleCoords;
+	surface.duplicates = duplicates;
+	return in;
+}
+
+template <typename T>
+static bool loadStage(const C_StageCache &cache, const char *stage, const QByteArray &key, T &result){
+	QByteArray data;
+	if (!cache.load(stage, key, data)) return false;
+	QDataStream in(data);
+	in.setVersion(QDataStream::Qt_6_0);
+	in >> result;
+	return in.status() == QDataStream::Ok;
+}
+
+template <typename T>
+static void storeStage(const C_StageCache &cache, const char *stage, const QByteArray &key, const T &result){
+	if (!cache.isEnabled() || key.isEmpty()) return;
+	QByteArray data;
+	QDataStream out(&data, QIODevice::WriteOnly);
+	out.setVersion(QDataStream::Qt_6_0);
+	out << result;
+	cache.store(stage, key, data);
+}
+
+/* Feeds the coordinates of a list of points into a hash. */
+static void hashPoints(QCryptographicHash &hash, const QList<C_Vector3D> &points){
+	double xyz[3];
+	for (int n = 0; n != points.length(); n++){
+		xyz[0] = points[n].x();
+		xyz[1] = points[n].y();
+		xyz[2] = points[n].z();
+		hash.addData(QByteArrayView(reinterpret_cast<const char*>(xyz), sizeof(xyz)));
+	}
+}
+
+/* Triangulation of a surface with the triangles as node indices. */
+static C_PreMeshCache::Surface triangulationOf(const C_Surface &surface){
+	C_PreMeshCache::Surface result;
+	result.normal_vector = surface.normal_vector;
+	result.ConvexHull = surface.ConvexHull;
+	result.Ns = surface.Ns;
+	result.Ns.detach();
+	result.duplicates = surface.duplicates;
+	result.HoleCoords = surface.HoleCoords;
+	const C_Vector3D *first = surface.Ns.constData();
+	for (int t = 0; t != surface.Ts.length(); t++){
+		for (int n = 0; n != 3; n++)
+			result.Ts.append(int(surface.Ts[t].Ns[n] - first));
+	}
+	return result;
+}
+
+void C_Model::premesh_begin(const QString &method, double gradient){
+	PreMeshCache.method = method;
+	PreMeshCache.gradient = gradient;
+	PreMeshCache.used.clear();
+	SurfaceKeys = QList<QByteArray>(Surfaces.length());
+	PolylineKeys = QList<QByteArray>(Polylines.length());
+	IntersectionKeys.clear();
+}
+
+void C_Model::premesh_end(){
+	PreMeshCache.prune();
+}
+
+/* The key of a surface covers everything the convex hull and the coarse
+ * triangulation depend on. */
+QByteArray C_Model::surface_key(int s) const{
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	const C_Surface &surface = Surfaces[s];
+	double parameters[2] = { surface.size, PreMeshCache.gradient };
+	hash.addData(QByteArrayView("SURFACE"));
+	hash.addData(PreMeshCache.method.toUtf8());
+	hash.addData(QByteArrayView(reinterpret_cast<const char*>(parameters), sizeof(parameters)));
+	hashPoints(hash, surface.SDs);
+	return hash.result().toHex();
+}
+
+QByteArray C_Model::polyline_key(int p) const{
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	const C_Polyline &polyline = Polylines[p];
+	hash.addData(QByteArrayView("POLYLINE"));
+	hash.addData(QByteArrayView(reinterpret_cast<const char*>(&polyline.size), sizeof(polyline.size)));
+	hashPoints(hash, polyline.SDs);
+	return hash.result().toHex();
+}
+
+/* Replaces the triangulation of surface s. The triangles are rebuilt on the
+ * nodes and get their extensions and normal vectors. */
+void C_Model::restore_triangulation(int s, const C_PreMeshCache::Surface &result){
+	C_Surface &surface = Surfaces[s];
+	surface.normal_vector = result.normal_vector;
+	surface.Ns = result.Ns;
+	surface.Ns.detach();
+	surface.NsFixedZ.clear();
+	surface.duplicates = result.duplicates;
+	surface.Ts.clear();
+	surface.Ts.reserve(result.Ts.length() / 3);
+	for (int t = 0; t + 2 < result.Ts.length(); t += 3){
+		C_Triangle Tr;
+		Tr.Ns[0] = &surface.Ns[result.Ts[t]];
+		Tr.Ns[1] = &surface.Ns[result.Ts[t + 1]];
+		Tr.Ns[2] = &surface.Ns[result.Ts[t + 2]];
+		Tr.calculate_min_max();
+		Tr.setNormalVector();
+		surface.Ts.append(Tr);
+	}
+}
+
+bool C_Model::restore_surface(int s){
+	QByteArray key = this->surface_key(s);
+	SurfaceKeys[s] = key;
+	QHash<QByteArray, C_PreMeshCache::Surface>::const_iterator it = PreMeshCache.surfaces.constFind(key);
+	if (it == PreMeshCache.surfaces.constEnd()){
+		C_PreMeshCache::Surface result;
+		if (!loadStage(StageCache, "surfaces", key, result)) return false;
+		it = PreMeshCache.surfaces.insert(key, result);
+	}
+	PreMeshCache.used.insert(key);
+
+	this->restore_triangulation(s, *it);
+	Surfaces[s].ConvexHull = it->ConvexHull;
+	Surfaces[s].Intersections.clear();
+	Surfaces[s].calculate_min_max();
+	return true;
+}
+
+void C_Model::store_surface(int s){
+	QByteArray key = this->surface_key(s);
+	C_PreMeshCache::Surface result = triangulationOf(Surfaces[s]);
+	SurfaceKeys[s] = key;
+	PreMeshCache.surfaces.insert(key, result);
+	PreMeshCache.used.insert(key);
+	storeStage(StageCache, "surfaces", key, result);
+}
+
+bool C_Model::restore_polyline(int p){
+	QByteArray key = this->polyline_key(p);
+	PolylineKeys[p] = key;
+	QHash<QByteArray, C_Line>::const_iterator it = PreMeshCache.paths.constFind(key);
+	if (it == PreMeshCache.paths.constEnd()){
+		C_Line path;
+		if (!loadStage(StageCache, "paths", key, path)) return false;
+		it = PreMeshCache.paths.insert(key, path);
+	}
+	PreMeshCache.used.insert(key);
+	Polylines[p].Path = *it;
+	Polylines[p].Intersections.clear();
+	return true;
+}
+
+void C_Model::store_polyline(int p){
+	QByteArray key = this->polyline_key(p);
+	PolylineKeys[p] = key;
+	PreMeshCache.paths.insert(key, Polylines[p].Path);
+	PreMeshCache.used.insert(key);
+	storeStage(StageCache, "paths", key, Polylines[p].Path);
+}
+
+/* Appends intersections computed for (or restored from) the cache key to the
+ * model. The key of each intersection is the key of the pair and its index.
+ * The caller has to hold the mutex. */
+void C_Model::append_intersections(const QByteArray &key, const QList<C_Line> &lines, bool polyline){
+	for (int l = 0; l != lines.length(); l++){
+		if (IntersectionKeys.length() == Intersections.length())
+			IntersectionKeys.append(key.isEmpty() ? QByteArray() : key + ":" + QByteArray::number(l));
+		Intersections.append(lines[l]);
+		if (polyline){
+			Polylines[lines[l].Object[1]].Intersections.append(&Intersections.last());
+			Surfaces[lines[l].Object[0]].Intersections.append(&Intersections.last());
+		}
+		else{
+			Surfaces[lines[l].Object[0]].Intersections.append(&Intersections.last());
+			Surfaces[lines[l].Object[1]].Intersections.append(&Intersections.last());
+		}
+	}
+}
+
+/* Looks up the intersections of a pair in memory, then on disk. */
+bool C_Model::find_intersections(const QByteArray &key, QList<C_Line> &lines){
+	mutex.lock();
+	QHash<QByteArray, QList<C_Line> >::const_iterator it = PreMeshCache.intersections.constFind(key);
+	bool found = it != PreMeshCache.intersections.constEnd();
+	if (found){
+		lines = *it;
+		PreMeshCache.used.insert(key);
+	}
+	mutex.unlock();
+	if (!found && loadStage(StageCache, "intersections", key, lines)){
+		found = true;
+		mutex.lock();
+		PreMeshCache.intersections.insert(key, lines);
+		PreMeshCache.used.insert(key);
+		mutex.unlock();
+	}
+	return found;
+}
+
+bool C_Model::restore_int_polyline(int s1, int s2){
+	QByteArray key = QCryptographicHash::hash(SurfaceKeys[s1] + SurfaceKeys[s2], QCryptographicHash::Sha1).toHex();
+	QList<C_Line> lines;
+	if (!this->find_intersections(key, lines)) return false;
+	for (int l = 0; l != lines.length(); l++){
+		lines[l].Object[0] = s1;
+		lines[l].Object[1] = s2;
+	}
+	mutex.lock();
+	append_intersections(key, lines, false);
+	mutex.unlock();
+	return true;
+}
+
+bool C_Model::restore_int_point(int p, int s){
+	QByteArray key = QCryptographicHash::hash(PolylineKeys[p] + "/" + SurfaceKeys[s], QCryptographicHash::Sha1).toHex();
+	QList<C_Line> lines;
+	if (!this->find_intersections(key, lines)) return false;
+	for (int l = 0; l != lines.length(); l++){
+		lines[l].Object[0] = s;
+		lines[l].Object[1] = p;
+	}
+	mutex.lock();
+	append_intersections(key, lines, true);
+	mutex.unlock();
+	return true;
+}
+
+/* The triple points of two intersections do not depend on their order in
+ * Intersections, hence the key is built from the ordered pair of their keys. */
+QByteArray C_Model::triplepoints_key(int I1, int I2) const{
+	if (IntersectionKeys.length() != Intersections.length()) return QByteArray();
+	const QByteArray &key1 = IntersectionKeys[I1];
+	const QByteArray &key2 = IntersectionKeys[I2];
+	if (key1.isEmpty() || key2.isEmpty()) return QByteArray();
+	if (key1 > key2) return QCryptographicHash::hash(key2 + "/" + key1, QCryptographicHash::Sha1).toHex();
+	return QCryptographicHash::hash(key1 + "/" + key2, QCryptographicHash::Sha1).toHex();
+}
+
+bool C_Model::restore_int_triplepoints(int I1, int I2){
+	QByteArray key = this->triplepoints_key(I1, I2);
+	if (key.isEmpty()) return false;
+	QList<C_Vector3D> cached;
+	mutex.lock();
+	QHash<QByteArray, QList<C_Vector3D> >::const_iterator it = PreMeshCache.triplepoints.constFind(key);
+	bool found = it != PreMeshCache.triplepoints.constEnd();
+	if (found) cached = *it;
+	mutex.unlock();
+	if (!found){
+		if (!loadStage(StageCache, "triplepoints", key, cached)) return false;
+		mutex.lock();
+		PreMeshCache.triplepoints.insert(key, cached);
+		mutex.unlock();
+	}
+	bool swapped = IntersectionKeys[I1] > IntersectionKeys[I2];
+	mutex.lock();
+	for (int t = 0; t != cached.length(); t++){
+		TPs.append(cached[t]);
+		TPs.last().intID = ((cached[t].intID == 1) == swapped) ? I1 : I2;
+	}
+	PreMeshCache.used.insert(key);
+	mutex.unlock();
+	return true;
+}
+
+/* Brings the intersections into the order of their objects and rebuilds the
+ * references of surfaces and polylines to them. The first meshMesh
+ * intersections are surface-surface intersections, the others
+ * polyline-surface intersections. The order no longer depends on which
+ * thread finished first, so that the constraints derived from the
+ * intersections (and their keys in StageCache) are reproducible. References
+ * taken while Intersections was still growing may be invalid after its
+ * reallocation. */
+void C_Model::link_intersections(int meshMesh){
+	QList<int> order;
+	for (int i = 0; i != Intersections.length(); i++)
+		order.append(i);
+	std::stable_sort(order.begin(), order.end(), [this, meshMesh](int a, int b){
+		if ((a < meshMesh) != (b < meshMesh)) return a < meshMesh;
+		if (Intersections[a].Object[0] != Intersections[b].Object[0]) return Intersections[a].Object[0] < Intersections[b].Object[0];
+		return Intersections[a].Object[1] < Intersections[b].Object[1];
+	});
+	QList<C_Line> lines;
+	QList<QByteArray> keys;
+	bool withKeys = IntersectionKeys.length() == Intersections.length();
+	for (int i = 0; i != order.length(); i++){
+		lines.append(Intersections[order[i]]);
+		if (withKeys) keys.append(IntersectionKeys[order[i]]);
+	}
+	Intersections = lines;
+	if (withKeys) IntersectionKeys = keys;
+	meshMeshIntersections = meshMesh;
+
+	for (int s = 0; s != Surfaces.length(); s++)
+		Surfaces[s].Intersections.clear();
+	for (int p = 0; p != Polylines.length(); p++)
+		Polylines[p].Intersections.clear();
+	for (int i = 0; i != Intersections.length(); i++){
+		if (i < meshMesh){
+			Surfaces[Intersections[i].Object[0]].Intersections.append(&Intersections[i]);
+			Surfaces[Intersections[i].Object[1]].Intersections.append(&Intersections[i]);
+		}
+		else{
+			Polylines[Intersections[i].Object[1]].Intersections.append(&Intersections[i]);
+			Surfaces[Intersections[i].Object[0]].Intersections.append(&Intersections[i]);
+		}
+	}
+}
+
+/* The key of a fine triangulation covers the surface and everything
+ * calculate_triangles(true) takes from its constraints. */
+QByteArray C_Model::surface_fine_key(int s, const QString &method, double gradient) const{
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	const C_Surface &surface = Surfaces[s];
+	double parameters[2] = { surface.size, gradient };
+	hash.addData(QByteArrayView("SURFACE_FINE"));
+	hash.addData(method.toUtf8());
+	hash.addData(QByteArrayView(reinterpret_cast<const char*>(parameters), sizeof(parameters)));
+	hashPoints(hash, surface.SDs);
+	for (int c = 0; c != surface.Constraints.length(); c++){
+		const C_Line &constraint = surface.Constraints[c];
+		qint32 length = constraint.Ns.length();
+		hash.addData(constraint.Type.toUtf8());
+		hash.addData(QByteArrayView(reinterpret_cast<const char*>(&constraint.size), sizeof(constraint.size)));
+		hash.addData(QByteArrayView(reinterpret_cast<const char*>(&length), sizeof(length)));
+		hashPoints(hash, constraint.Ns);
+		for (int n = 0; n != constraint.Ns.length(); n++)
+			hash.addData(constraint.Ns[n].type().toUtf8());
+	}
+	return hash.result().toHex();
+}
+
+bool C_Model::restore_surface_fine(int s, const QByteArray &key){
+	C_PreMeshCache::Surface result;
+	if (!loadStage(StageCache, "surfaces_fine", key, result)) return false;
+	this->restore_triangulation(s, result);
+	Surfaces[s].HoleCoords = result.HoleCoords;
+	return true;
+}
+
+void C_Model::store_surface_fine(int s, const QByteArray &key){
+	if (!StageCache.isEnabled()) return;
+	C_PreMeshCache::Surface result = triangulationOf(Surfaces[s]);
+	result.ConvexHull = C_Line();
+	storeStage(StageCache, "surfaces_fine", key, result);
+}
+
+/********** Checkpoints **********/
+
+/* Leads a checkpoint, so that one of another layout is not read. */
+#define CHECKPOINT_MAGIC 0x4d49434b	// "MICK"
+#define CHECKPOINT_VERSION 2
+
+/* Constraints are stored with their colors, which identify them in the saved model. */
+static void writeConstraints(QDataStream &out, const QList<C_Line> &constraints){
+	out << constraints;
+	for (int c = 0; c != constraints.length(); c++)
+		out << constraints[c].RGB[0] << constraints[c].RGB[1] << constraints[c].RGB[2];
+}
+
+static void readConstraints(QDataStream &in, QList<C_Line> &constraints){
+	in >> constraints;
+	for (int c = 0; c != constraints.length() && in.status() == QDataStream::Ok; c++)
+		in >> constraints[c].RGB[0] >> constraints[c].RGB[1] >> constraints[c].RGB[2];
+}
+
+/* QDataStream has no operators for long, the index type of C_Mesh3D. */
+static void writeIndices(QDataStream &out, const QList<long> &indices){
+	out << (qint64)indices.length();
+	for (int i = 0; i != indices.length(); i++)
+		out << (qint64)indices[i];
+}
+
+static void readIndices(QDataStream &in, QList<long> &indices){
+	qint64 length = 0, index;
+	in >> length;
+	for (qint64 i = 0; i < length && in.status() == QDataStream::Ok; i++){
+		in >> index;
+		indices.append((long)index);
+	}
+}
+
+/* Everything the pre-mesh and mesh jobs compute: convex hulls, triangulations,
+ * segmentations, constraints, intersections and the tetrahedral mesh. The
+ * input data (scattered data, materials) is taken from the model file. */
+QByteArray C_Model::checkpoint(const QString &stage) const{
+	QByteArray data;
+	QDataStream out(&data, QIODevice::WriteOnly);
+	out.setVersion(QDataStream::Qt_6_0);
+	out << (quint32)CHECKPOINT_MAGIC << (qint32)CHECKPOINT_VERSION;
+	out << stage << (qint32)Surfaces.length() << (qint32)Polylines.length();
+	for (int s = 0; s != Surfaces.length(); s++){
+		out << triangulationOf(Surfaces[s]);
+		writeConstraints(out, Surfaces[s].Constraints);
+	}
+	for (int p = 0; p != Polylines.length(); p++){
+		out << Polylines[p].Path;
+		writeConstraints(out, Polylines[p].Constraints);
+	}
+	out << Intersections << (qint32)qMin(meshMeshIntersections, (int)Intersections.length());
+	out << (bool)(Mesh != 0);
+	if (Mesh){
+		out << Mesh->pointlist;
+		writeIndices(out, Mesh->edgelist);
+		out << Mesh->edgemarkerlist;
+		writeIndices(out, Mesh->trianglelist);
+		out << Mesh->trianglemarkerlist;
+		writeIndices(out, Mesh->tetrahedronlist);
+		out << Mesh->tetrahedronmarkerlist;
+	}
+	return data;
+}
+
+/* Restores a checkpoint written for the same model. The model is only changed
+ * if the checkpoint could be read completely. */
+bool C_Model::restore_checkpoint(const QByteArray &data, QString &stage){
+	QDataStream in(data);
+	in.setVersion(QDataStream::Qt_6_0);
+	quint32 magic = 0;
+	qint32 version = 0;
+	in >> magic >> version;
+	if (in.status() != QDataStream::Ok || magic != CHECKPOINT_MAGIC || version != CHECKPOINT_VERSION) return false;
+	qint32 nSurfaces, nPolylines;
+	in >> stage >> nSurfaces >> nPolylines;
+	if (in.status() != QDataStream::Ok || nSurfaces != Surfaces.length() || nPolylines != Polylines.length()) return false;
+
+	QList<C_PreMeshCache::Surface> triangulations;
+	QList<QList<C_Line> > surfaceConstraints, polylineConstraints;
+	QList<C_Line> paths, intersections;
+	for (int s = 0; s != nSurfaces && in.status() == QDataStream::Ok; s++){
+		C_PreMeshCache::Surface triangulation;
+		QList<C_Line> constraints;
+		in >> triangulation;
+		readConstraints(in, constraints);
+		triangulations.append(triangulation);
+		surfaceConstraints.append(constraints);
+	}
+	for (int p = 0; p != nPolylines && in.status() == QDataStream::Ok; p++){
+		C_Line path;
+		QList<C_Line> constraints;
+		in >> path;
+		readConstraints(in, constraints);
+		paths.append(path);
+		polylineConstraints.append(constraints);
+	}
+	qint32 meshMesh = 0;
+	in >> intersections >> meshMesh;
+	if (meshMesh < 0 || meshMesh > intersections.length()) in.setStatus(QDataStream::ReadCorruptData);
+	bool withMesh = false;
+	C_Mesh3D *mesh = 0;
+	in >> withMesh;
+	if (withMesh && in.status() == QDataStream::Ok){
+		mesh = new C_Mesh3D;
+		in >> mesh->pointlist;
+		readIndices(in, mesh->edgelist);
+		in >> mesh->edgemarkerlist;
+		readIndices(in, mesh->trianglelist);
+		in >> mesh->trianglemarkerlist;
+		readIndices(in, mesh->tetrahedronlist);
+		in >> mesh->tetrahedronmarkerlist;
+		mesh->numberofpoints = mesh->pointlist.length() / 3;
+		mesh->numberofedges = mesh->edgemarkerlist.length();
+		mesh->numberoftriangles = mesh->trianglemarkerlist.length();
+		mesh->numberoftetrahedra = mesh->tetrahedronmarkerlist.length();
+	}
+	if (in.status() != QDataStream::Ok){
+		delete mesh;
+		return false;
+	}
+
+	for (int s = 0; s != nSurfaces; s++){
+		this->restore_triangulation(s, triangulations[s]);
+		Surfaces[s].ConvexHull = triangulations[s].ConvexHull;
+		Surfaces[s].HoleCoords = triangulations[s].HoleCoords;
+		Surfaces[s].Constraints = surfaceConstraints[s];
+	}
+	for (int p = 0; p != nPolylines; p++){
+		Polylines[p].Path = paths[p];
+		Polylines[p].Constraints = polylineConstraints[p];
+	}
+	Intersections = intersections;
+	IntersectionKeys.clear();
+	this->link_intersections(meshMesh);
+	TPs.clear();
+	if (this->Mesh) delete this->Mesh;
+	this->Mesh = mesh;
+	if (this->Mesh) calculateNumberWithMaterials();
+	emit ModelInfoChanged();
+	return true;
+}
+
 void C_Model::calculate_int_polyline(int s1, int s2){
+	QList<C_Line> lines;
+	QByteArray key;
+	this->intersect_surfaces(s1, s2, lines);
+	/* the octree of a cancelled job was left early, so its result is incomplete */
+	if (C_Cancellation::requested())
+		return;
+	if (SurfaceKeys.length() == Surfaces.length() && !SurfaceKeys[s1].isEmpty() && !SurfaceKeys[s2].isEmpty())
+		key = QCryptographicHash::hash(SurfaceKeys[s1] + SurfaceKeys[s2], QCryptographicHash::Sha1).toHex();
+
+	/* Protect list accesses against race-conditions. */
+	mutex.lock();
+	if (!key.isEmpty()){
+		PreMeshCache.intersections.insert(key, lines);
+		PreMeshCache.used.insert(key);
+	}
+	append_intersections(key, lines, false);
+	mutex.unlock();
+	storeStage(StageCache, "intersections", key, lines);
+}
+
+void C_Model::intersect_surfaces(int s1, int s2, QList<C_Line> &lines) const{
 	C_Line IntSegments;
 	int coplanar;
 	C_Vector3D isectpt1, isectpt2;
-	C_Box Box;
+	C_Arena arena;
+	C_Box Box(&arena);
 
 	const C_Surface& cs1 = this->Surfaces[s1];
 	const C_Surface& cs2 = this->Surfaces[s2];
@@ -4505,13 +5193,7 @@ void C_Model::calculate_int_polyline(int s1, int s2){
 		newInt.Object[0]=s1; 
 		newInt.Object[1]=s2;
 		newInt.calculate_min_max();
-
-		/* Protect list accesses against race-conditions. */
-		mutex.lock();
-		Intersections.append(newInt);
-		Surfaces[s1].Intersections.append(&Intersections.last());   
-		Surfaces[s2].Intersections.append(&Intersections.last());   
-		mutex.unlock();
+		lines.append(newInt);
 	}
 }
 
@@ -4532,9 +5214,27 @@ bool C_Model::PointOnTriangle(const C_Vector3D& point, const C_Triangle& tri) co
 }
 
 void C_Model::calculate_int_point(int p, int s){
-	QList<C_Vector3D*> Segments;
-	QList<C_Triangle*> TriMesh;
+	QList<C_Line> lines;
+	QByteArray key;
 	C_Line newInt;
+	if (this->intersect_polyline_surface(p, s, newInt)) lines.append(newInt);
+	if (PolylineKeys.length() == Polylines.length() && SurfaceKeys.length() == Surfaces.length() && !PolylineKeys[p].isEmpty() && !SurfaceKeys[s].isEmpty())
+		key = QCryptographicHash::hash(PolylineKeys[p] + "/" + SurfaceKeys[s], QCryptographicHash::Sha1).toHex();
+
+	/* Protect list accesses against race-conditions. */
+	mutex.lock();
+	if (!key.isEmpty()){
+		PreMeshCache.intersections.insert(key, lines);
+		PreMeshCache.used.insert(key);
+	}
+	append_intersections(key, lines, true);
+	mutex.unlock();
+	storeStage(StageCache, "intersections", key, lines);
+}
+
+bool C_Model::intersect_polyline_surface(int p, int s, C_Line &newInt) const{
+	QList<const C_Vector3D*> Segments;
+	QList<const C_Triangle*> TriMesh;
 	C_Vector3D isectpt;
 	C_Vector3D point_minus;
 	C_Vector3D point_plus;
@@ -4556,15 +5256,7 @@ void C_Model::calculate_int_point(int p, int s){
 							newInt.Ns.append(Polylines[p].Path.Ns[0]);
 							newInt.Object[0] = s;
 							newInt.Object[1] = p;
-
-							/* Protect list accesses against race-conditions. */
-							mutex.lock();
-							this->Intersections.append(newInt);
-							Polylines[p].Intersections.append(&this->Intersections.last());
-							Surfaces[s].Intersections.append(&this->Intersections.last());
-							mutex.unlock();
-
-							return;
+							return true;
 						}
 					}
 				}
@@ -4592,15 +5284,7 @@ void C_Model::calculate_int_point(int p, int s){
 							newInt.Ns.append(isectpt);
 							newInt.Object[0] = s;
 							newInt.Object[1] = p;
-
-							/* Protect list accesses against race-conditions. */
-							mutex.lock();
-							this->Intersections.append(newInt);
-							Polylines[p].Intersections.append(&this->Intersections.last());
-							Surfaces[s].Intersections.append(&this->Intersections.last());
-							mutex.unlock();
-
-							return;
+							return true;
 						}
 					}
 				}
@@ -4609,30 +5293,34 @@ void C_Model::calculate_int_point(int p, int s){
 		Segments.clear();
 		TriMesh.clear();
 	}
+	return false;
 }
 
 void C_Model::insert_int_triplepoints(){
-	//cleaning TPs
-	QList<C_Vector3D*> memTPs;
+	//cleaning TPs, only the points of the same intersection are compared
+	QList<C_Vector3D> memTPs;
+	QHash<int, QList<int> > byIntersection;
 	bool insert;
 	for (int t = 0; t != this->TPs.length(); t++){
 		insert = true;
-		for (int m = 0; m != memTPs.length(); m++){
-			if (memTPs[m]->intID == TPs[t]->intID){
-				if (lengthSquared(*memTPs[m] - *TPs[t])<1e-24){
-					insert = false;
-					break;
-				}
+		QList<int>& kept = byIntersection[TPs[t].intID];
+		for (int m = 0; m != kept.length(); m++){
+			if (lengthSquared(memTPs[kept[m]] - TPs[t])<1e-24){
+				insert = false;
+				break;
 			}
 		}
-		if (insert) memTPs.append(this->TPs[t]);
+		if (insert){
+			kept.append(memTPs.length());
+			memTPs.append(this->TPs[t]);
+		}
 	}
 	TPs = memTPs;
 
 	//inserting to intersection
 	for (int t=0;t!=this->TPs.length();t++){
-		this->TPs[t]->setType("TRIPLE_POINT");
-		Intersections[this->TPs[t]->intID].AddPoint(*this->TPs[t]); 
+		this->TPs[t].setType("TRIPLE_POINT");
+		Intersections[this->TPs[t].intID].AddPoint(this->TPs[t]); 
 	}
 	for (int i=0;i!=this->Intersections.length();i++){
 		this->Intersections[i].CleanIdenticalPoints(); 
@@ -4650,8 +5338,34 @@ void C_Model::insert_int_triplepoints(){
 
 */
 void C_Model::calculate_int_triplepoints(int I1, int I2){
+	QList<C_Vector3D> found;
+	QByteArray key = this->triplepoints_key(I1, I2);
+	QList<C_Vector3D> cached;
+	this->intersect_intersections(I1, I2, &found);
+	if (C_Cancellation::requested())
+		return;
+	if (!key.isEmpty()){
+		bool swapped = IntersectionKeys[I1] > IntersectionKeys[I2];
+		for (int t = 0; t != found.length(); t++){
+			cached.append(found[t]);
+			cached.last().intID = ((found[t].intID == I1) == swapped) ? 1 : 0;
+		}
+	}
 
-	C_Box Box;
+	/* Protect list accesses against race-conditions. */
+	mutex.lock();
+	if (!key.isEmpty()){
+		PreMeshCache.triplepoints.insert(key, cached);
+		PreMeshCache.used.insert(key);
+	}
+	this->TPs.append(found);
+	mutex.unlock();
+	storeStage(StageCache, "triplepoints", key, cached);
+}
+
+void C_Model::intersect_intersections(int I1, int I2, QList<C_Vector3D> *TPs) const{
+	C_Arena arena;
+	C_Box Box(&arena);
 	const QList<C_Line>& Intersecs = Intersections;
 	const C_Line& line1 = Intersecs[I1];
 	const C_Line& line2 = Intersecs[I2];
@@ -4682,7 +5396,7 @@ void C_Model::calculate_int_triplepoints(int I1, int I2){
 		}
 	}
 
-	if ((Box.N1s.length() != 0) && (Box.N2s.length() != 0)) Box.split_seg(&this->TPs, I1, I2);
+	if ((Box.N1s.length() != 0) && (Box.N2s.length() != 0)) Box.split_seg(TPs, I1, I2);
 }
 
 void C_Model::analyze_self_intersections(const tetgenio& out)
@@ -4911,6 +5625,10 @@ void C_Model::calculate_tets(QString switches){
 			printf("An input error was detected. Program stopped.\n");
 			emit PrintError("Input error, please verify your input data.");
 			break;
+		case C_Cancellation::TETGEN_CANCELLED:
+			printf("The tetrahedralization was cancelled.\n");
+			emit PrintError("Tetrahedralization cancelled.");
+			break;
 		  } // switch (x)
 		return;
 	}
@@ -5122,166 +5840,153 @@ bool C_Model::verify_materials()
 	return state;
 }
 
-void C_Model::makeTets(bool xCutEnable, double xCutValue, bool xDirection, bool yCutEnable, double yCutValue, bool yDirection, bool zCutEnable, double zCutValue, bool zDirection){
+/* Colour of material mat, transparent for the faces. */
+static const GLfloat *materialColor(const C_Colors &cols, int mat, bool trans){
+	switch (mat%6){
+	case 0: return trans ? cols.RedTrans : cols.Red;
+	case 1: return trans ? cols.GreenTrans : cols.Green;
+	case 2: return trans ? cols.BlueTrans : cols.Blue;
+	case 3: return trans ? cols.YellowTrans : cols.Yellow;
+	case 4: return trans ? cols.CyanTrans : cols.Cyan;
+	default: return trans ? cols.MagentaTrans : cols.Magenta;
+	}
+}
+
+/* Unit normal of the triangle a, b, c (as C_Mesh3D::getNormalOfTriangle). */
+static void triangleNormal(const double a[3], const double b[3], const double c[3], double normal[3]){
+	double diff[2][3];
+	double norm;
+	for (int i=0;i!=3;i++){
+		diff[0][i]=b[i]-a[i];
+		diff[1][i]=c[i]-a[i];
+	}
+	normal[0]=diff[0][1]*diff[1][2]-diff[0][2]*diff[1][1];
+	normal[1]=diff[0][2]*diff[1][0]-diff[0][0]*diff[1][2];
+	normal[2]=diff[0][0]*diff[1][1]-diff[0][1]*diff[1][0];
+	norm=sqrt(normal[0]*normal[0]+normal[1]*normal[1]+normal[2]*normal[2]);
+	for (int i=0;i!=3;i++) normal[i]/=norm;
+}
+
+void C_Model::prepareTets(){
+	/* corners of the faces of a tetrahedron (the faces of getNormalOfTetrahedron) */
+	static const int tetFaces[4][3] = { {0,1,2}, {0,1,3}, {1,2,3}, {2,0,3} };
 
-	int xDir,yDir,zDir;
 	int mat;
-	bool drawThis;
+	long corner[4];
+	quint32 points[3];
+	quint32 edgeVertex[4];
+	quint32 edgeCorner[3];
+	quint32 face;
 	double point[4][3];
 	double center[3];
-	double normal[3];
 
-	if (xDirection){xDir=1;}else{xDir=-1;}
-	if (yDirection){yDir=1;}else{yDir=-1;}
-	if (zDirection){zDir=1;}else{zDir=-1;}
-	xCutValue/=256.0;
-	yCutValue/=256.0;
-	zCutValue/=256.0;
+	C_RenderBuffer edges(C_RenderBuffer::LINES);
+	edges.unlit = true;
+	tetCut.clear();
+	tetFaceCorners.clear();
+	tetFaceColors.clear();
 
-	glDeleteLists(this->listTets,1); 
+	/* The elements are listed with all their faces and edges, the cut and the
+	 * shown surfaces and materials only select the boundary of what is left.
+	 * The edges share the points of the mesh, once per colour. The faces are
+	 * kept as their corners, makeTets() builds the vertices of the boundary. */
+	if (this->Mesh){
+		tetFaceCorners.reserve(3*this->Mesh->numberoftriangles+12*this->Mesh->numberoftetrahedra);
+		tetFaceColors.reserve(this->Mesh->numberoftriangles+4*this->Mesh->numberoftetrahedra);
+		for (int f = 0; f!=this->Mesh->numberoftriangles;f++){
+			mat = getMaterial(5, f);
+			if (mat==-1) continue;
+			this->Mesh->getCenterOfTriangle(f,center); 
+			tetCut.addElement(center, this->Mesh->trianglemarkerlist[f]);
+			for (int p=0;p!=3;p++){
+				corner[p] = this->Mesh->trianglelist[f*3+p];
+				this->Mesh->getCoordinates(corner[p],point[p]); 
+			}
+			const GLfloat *edgeColor = materialColor(Cols, mat, false);
+			for (int p=0;p!=3;p++) edgeCorner[p] = edges.sharedVertex(quint64(corner[p])*6+mat%6, point[p], edgeColor);
+			face = quint32(tetFaceCorners.size());
+			for (int p=0;p!=3;p++) tetFaceCorners.append(quint32(corner[p]));
+			tetFaceColors.append(char(mat%6));
+			tetCut.addFace(face, edgeCorner);
+		}
+		for (int t = 0; t!=this->Mesh->numberoftetrahedra;t++){
+			mat = getMaterial(10, t);
+			if (mat==-1) continue;
+			this->Mesh->getCenterOfTetrahedron(t,center); 
+			tetCut.addElement(center, this->Surfaces.length()+this->Mesh->tetrahedronmarkerlist[t]);
+			for (int p=0;p!=4;p++){
+				corner[p] = this->Mesh->tetrahedronlist[t*4+p];
+				this->Mesh->getCoordinates(corner[p],point[p]); 
+			}
+			const GLfloat *edgeColor = materialColor(Cols, mat, false);
+			for (int p=0;p!=4;p++) edgeVertex[p] = edges.sharedVertex(quint64(corner[p])*6+mat%6, point[p], edgeColor);
+			for (int k=0;k!=4;k++){
+				face = quint32(tetFaceCorners.size());
+				for (int p=0;p!=3;p++){
+					points[p] = quint32(corner[tetFaces[k][p]]);
+					edgeCorner[p] = edgeVertex[tetFaces[k][p]];
+					tetFaceCorners.append(points[p]);
+				}
+				tetFaceColors.append(char(mat%6));
+				tetCut.addFace(face, edgeCorner, points);
+			}
+		}
+	}
+	tetCut.finish();
 
 	/* Clear last error. */
 	glGetError();
 
-	GLuint list = glGenLists(1);
-	glNewList(list, GL_COMPILE);
-	glDisable(GL_LIGHT0);
-	glLightModelfv(GL_LIGHT_MODEL_AMBIENT, Cols.White);
+	vboTetEdges.upload(edges);
 
-	glBegin(GL_LINES);
-	for (int f = 0; f!=this->Mesh->numberoftriangles;f++){
-		mat = getMaterial(5, f);
-		drawThis=true;
-		if (!this->Surfaces[this->Mesh->trianglemarkerlist[f]].drawMatEdges) drawThis=false;
-		if (mat==-1) drawThis=false;
-		this->Mesh->getCenterOfTriangle(f,center); 
-		if (xCutEnable && (center[0]-xCutValue)*xDir<0) drawThis=false;
-		if (yCutEnable && (center[1]-yCutValue)*yDir<0) drawThis=false;
-		if (zCutEnable && (center[2]-zCutValue)*zDir<0) drawThis=false;
-		if (drawThis){
-			int mod=mat%6; 
-			if (mod==0) glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.Red);
-			if (mod==1) glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.Green);
-			if (mod==2) glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.Blue);
-			if (mod==3) glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.Yellow);
-			if (mod==4) glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.Cyan);
-			if (mod==5) glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.Magenta);
-			for (int p=0;p!=3;p++) this->Mesh->getCoordinates(this->Mesh->trianglelist[f*3+p],point[p]); 
-			glVertex3d(point[0][0],point[0][1],point[0][2]);
-			glVertex3d(point[1][0],point[1][1],point[1][2]);
-			glVertex3d(point[1][0],point[1][1],point[1][2]);
-			glVertex3d(point[2][0],point[2][1],point[2][2]);
-			glVertex3d(point[2][0],point[2][1],point[2][2]);
-			glVertex3d(point[0][0],point[0][1],point[0][2]);
-		}
-	}
-	for (int t = 0; t!=this->Mesh->numberoftetrahedra;t++){
-		mat = getMaterial(10, t);
-		drawThis = true;
-		if (!this->Mats[this->Mesh->tetrahedronmarkerlist[t]].drawMatEdges) drawThis=false;
-		if (mat==-1) drawThis=false;
-		this->Mesh->getCenterOfTetrahedron(t,center); 
-		if (xCutEnable && (center[0]-xCutValue)*xDir<0) drawThis=false;
-		if (yCutEnable && (center[1]-yCutValue)*yDir<0) drawThis=false;
-		if (zCutEnable && (center[2]-zCutValue)*zDir<0) drawThis=false;
-		if (drawThis){
-			int mod=mat%6; 
-			if (mod==0) glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.Red);
-			if (mod==1) glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.Green);
-			if (mod==2) glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.Blue);
-			if (mod==3) glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.Yellow);
-			if (mod==4) glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.Cyan);
-			if (mod==5) glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.Magenta);
-			for (int p=0;p!=4;p++) this->Mesh->getCoordinates(this->Mesh->tetrahedronlist[t*4+p],point[p]); 
-			glVertex3d(point[0][0],point[0][1],point[0][2]);
-			glVertex3d(point[1][0],point[1][1],point[1][2]);
-			glVertex3d(point[1][0],point[1][1],point[1][2]);
-			glVertex3d(point[2][0],point[2][1],point[2][2]);
-			glVertex3d(point[2][0],point[2][1],point[2][2]);
-			glVertex3d(point[0][0],point[0][1],point[0][2]);
-			glVertex3d(point[0][0],point[0][1],point[0][2]);
-			glVertex3d(point[3][0],point[3][1],point[3][2]);
-			glVertex3d(point[1][0],point[1][1],point[1][2]);
-			glVertex3d(point[3][0],point[3][1],point[3][2]);
-			glVertex3d(point[2][0],point[2][1],point[2][2]);
-			glVertex3d(point[3][0],point[3][1],point[3][2]);
-		}
-	}
-    glEnd();
+	std::string err_msg;
+	if( ! check_opengl_error(err_msg) )
+		emit PrintError(QString::fromStdString(err_msg));
+}
 
-	glEnable(GL_LIGHT0);
-	glLightModelfv(GL_LIGHT_MODEL_AMBIENT, Cols.Grey);
+void C_Model::makeTets(bool xCutEnable, double xCutValue, bool xDirection, bool yCutEnable, double yCutValue, bool yDirection, bool zCutEnable, double zCutValue, bool zDirection){
+	const bool enable[3] = { xCutEnable, yCutEnable, zCutEnable };
+	const double value[3] = { xCutValue/256.0, yCutValue/256.0, zCutValue/256.0 };
+	const bool direction[3] = { xDirection, yDirection, zDirection };
+	QVector<bool> showFaces, showEdges;
+	QVector<quint32> faceIndices, edgeIndices;
+	double point[3][3];
+	double normal[3];
 
-	glBegin(GL_TRIANGLES);
-	for (int f = 0; f!=this->Mesh->numberoftriangles;f++){
-		mat = getMaterial(5, f);
-		drawThis=true;
-		if (!this->Surfaces[this->Mesh->trianglemarkerlist[f]].drawMatFaces) drawThis=false;
-		if (mat==-1) drawThis=false;
-		this->Mesh->getCenterOfTriangle(f,center); 
-		if (xCutEnable && (center[0]-xCutValue)*xDir<0) drawThis=false;
-		if (yCutEnable && (center[1]-yCutValue)*yDir<0) drawThis=false;
-		if (zCutEnable && (center[2]-zCutValue)*zDir<0) drawThis=false;
-		if (drawThis){
-			int mod=mat%6; 
-			if (mod==0) glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.RedTrans);
-			if (mod==1) glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.GreenTrans);
-			if (mod==2) glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.BlueTrans);
-			if (mod==3) glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.YellowTrans);
-			if (mod==4) glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.CyanTrans);
-			if (mod==5) glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.MagentaTrans);
-			this->Mesh->getNormalOfTriangle(f,normal);  
-			glNormal3d(normal[0],normal[1],normal[2]);
-			for (int p=0;p!=3;p++) this->Mesh->getCoordinates(this->Mesh->trianglelist[f*3+p],point[p]); 
-			glVertex3d(point[0][0],point[0][1],point[0][2]);
-			glVertex3d(point[1][0],point[1][1],point[1][2]);
-			glVertex3d(point[2][0],point[2][1],point[2][2]);
-		}
-	}
-	for (int t = 0; t!=this->Mesh->numberoftetrahedra;t++){
-		mat = getMaterial(10, t);
-		drawThis=true;
-		if (!this->Mats[this->Mesh->tetrahedronmarkerlist[t]].drawMatFaces) drawThis=false;
-		if (mat==-1) drawThis=false;
-		this->Mesh->getCenterOfTetrahedron(t,center); 
-		if (xCutEnable && (center[0]-xCutValue)*xDir<0) drawThis=false;
-		if (yCutEnable && (center[1]-yCutValue)*yDir<0) drawThis=false;
-		if (zCutEnable && (center[2]-zCutValue)*zDir<0) drawThis=false;
-		if (drawThis){
-			int mod=mat%6; 
-			if (mod==0) glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.RedTrans);
-			if (mod==1) glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.GreenTrans);
-			if (mod==2) glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.BlueTrans);
-			if (mod==3) glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.YellowTrans);
-			if (mod==4) glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.CyanTrans);
-			if (mod==5) glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,Cols.MagentaTrans);
-			for (int p=0;p!=4;p++) this->Mesh->getCoordinates(this->Mesh->tetrahedronlist[t*4+p],point[p]); 
-			this->Mesh->getNormalOfTetrahedron(t,0,normal);  
-			glNormal3d(normal[0],normal[1],normal[2]);
-			glVertex3d(point[0][0],point[0][1],point[0][2]);
-			glVertex3d(point[1][0],point[1][1],point[1][2]);
-			glVertex3d(point[2][0],point[2][1],point[2][2]);
-			this->Mesh->getNormalOfTetrahedron(t,1,normal);  
-			glNormal3d(normal[0],normal[1],normal[2]);
-			glVertex3d(point[0][0],point[0][1],point[0][2]);
-			glVertex3d(point[1][0],point[1][1],point[1][2]);
-			glVertex3d(point[3][0],point[3][1],point[3][2]);
-			this->Mesh->getNormalOfTetrahedron(t,2,normal);  
-			glNormal3d(normal[0],normal[1],normal[2]);
-			glVertex3d(point[1][0],point[1][1],point[1][2]);
-			glVertex3d(point[2][0],point[2][1],point[2][2]);
-			glVertex3d(point[3][0],point[3][1],point[3][2]);
-			this->Mesh->getNormalOfTetrahedron(t,3,normal);  
-			glNormal3d(normal[0],normal[1],normal[2]);
-			glVertex3d(point[2][0],point[2][1],point[2][2]);
-			glVertex3d(point[0][0],point[0][1],point[0][2]);
-			glVertex3d(point[3][0],point[3][1],point[3][2]);
-		}
+	if (!tetCut.isFinished()) prepareTets();
+
+	/* groups: the surfaces, then the materials */
+	for (int s = 0; s!=this->Surfaces.length(); s++){
+		showFaces.append(this->Surfaces[s].drawMatFaces);
+		showEdges.append(this->Surfaces[s].drawMatEdges);
 	}
-	glEnd();
+	for (int m = 0; m!=this->Mats.length(); m++){
+		showFaces.append(this->Mats[m].drawMatFaces);
+		showEdges.append(this->Mats[m].drawMatEdges);
+	}
+	tetCut.select(enable, value, direction, showFaces, showEdges, faceIndices, edgeIndices);
 
-	glEndList();
-	listTets = list;
+	/* The flat shaded faces of the boundary, three vertices each with the
+	 * normal of the face (the faces of getNormalOfTriangle and
+	 * getNormalOfTetrahedron); a face index is the first of its corners. */
+	C_RenderBuffer faces(C_RenderBuffer::TRIANGLES);
+	faces.reserve(faceIndices.size(), faceIndices.size()/3);
+	for (int i = 0; i+2 < faceIndices.size(); i+=3){
+		quint32 f = faceIndices[i];
+		for (int p=0;p!=3;p++) this->Mesh->getCoordinates(tetFaceCorners[f+p], point[p]);
+		triangleNormal(point[0], point[1], point[2], normal);
+		const GLfloat *faceColor = materialColor(Cols, tetFaceColors[f/3], true);
+		quint32 a = faces.addVertex(point[0], normal, faceColor);
+		faces.addVertex(point[1], normal, faceColor);
+		faces.addVertex(point[2], normal, faceColor);
+		faces.addTriangle(a, a+1, a+2);
+	}
+
+	/* Clear last error. */
+	glGetError();
+
+	vboTetEdges.uploadIndices(edgeIndices);
+	vboTetFaces.upload(faces);
 
 	std::string err_msg;
 	if( ! check_opengl_error(err_msg) )
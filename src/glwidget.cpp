@@ -36,6 +36,14 @@
 #include <map>
 #include <queue>
 
+/* Selection colour of the background (the clear colour) and of everything
+ * which is not selectable (black). */
+#define SELECTION_BACKGROUND (81u | 87u << 8 | 110u << 16)
+#define SELECTION_NONE 0u
+
+/* Scattered data points drawn at most per view, shared by the shown clouds. */
+#define SCATTERED_DATA_BUDGET 2000000
+
 #ifdef _WIN32
 #include <GL/glu.h>
 #elif __LINUX__
@@ -54,11 +62,14 @@ GLWidget::GLWidget(QWidget *parent) : QGLWidget(parent)
 	this->rotationMode = RotationMode::MODEL;
 	this->prevCenter = C_Vector3D(0, 0, 0);
 	this->zoomSensitivity = 0.4;
+	this->drawingIds = false;
+	this->idFramebuffer = NULL;
 }
 
 GLWidget::~GLWidget()
 {
 	makeCurrent();
+	delete idFramebuffer;
 }
 
 void
@@ -72,29 +83,50 @@ GLWidget::drawObject()
 	/* Draw error markers. */
 	glCallList(Model->listErrorMarkers);
 
+	/* The scattered data are drawn by level of detail for the current view. */
+	GLdouble projection[16], modelview[16];
+	glGetDoublev(GL_PROJECTION_MATRIX, projection);
+	glGetDoublev(GL_MODELVIEW_MATRIX, modelview);
+	int clouds = 0;
+	for (int s = 0; s != Model->Surfaces.length(); s++)
+		clouds += Model->Surfaces[s].drawScatteredData;
+	for (int p = 0; p != Model->Polylines.length(); p++)
+		clouds += Model->Polylines[p].drawScatteredData;
+	int budget = SCATTERED_DATA_BUDGET / qMax(clouds, 1);
+
 	// draw surface objects
 	for (int s = 0; s != this->Model->Surfaces.length(); s++)
 	{
 		if (Model->Surfaces[s].drawScatteredData)
-			glCallList(Model->Surfaces[s].listScatteredData);
+		{
+			Model->Surfaces[s].selectScatteredData(projection, modelview, this->height(), budget);
+			Model->Surfaces[s].vboScatteredData.draw();
+		}
 		if (Model->Surfaces[s].drawConvexHull)
 			glCallList(Model->Surfaces[s].listConvexHull);
 		if (Model->Surfaces[s].drawFaces)
-			glCallList(Model->Surfaces[s].listFaces);
+			Model->Surfaces[s].vboFaces.draw();
 		if (Model->Surfaces[s].drawEdges)
-			glCallList(Model->Surfaces[s].listEdges);
+			Model->Surfaces[s].vboEdges.draw();
 		if (Model->Surfaces[s].drawIntEdges)
 			glCallList(Model->Surfaces[s].listIntEdges);
 		if (Model->Surfaces[s].drawIntVertices)
 			glCallList(Model->Surfaces[s].listIntVertices);
-		if (Model->Surfaces[s].drawConstraints)
-			glCallList(Model->Surfaces[s].listConstraints);
+		if (Model->Surfaces[s].drawConstraints && drawingIds)
+			for (int b = 0; b != 2; b++)
+				Model->Surfaces[s].vboSelection[b].draw();
+		else if (Model->Surfaces[s].drawConstraints)
+			for (int b = 0; b != 3; b++)
+				Model->Surfaces[s].vboConstraints[b].draw();
 	}
 	// draw polyline objects
 	for (int p = 0; p != Model->Polylines.length(); p++)
 	{
 		if (Model->Polylines[p].drawScatteredData)
-			glCallList(Model->Polylines[p].listScatteredData);
+		{
+			Model->Polylines[p].selectScatteredData(projection, modelview, this->height(), budget);
+			Model->Polylines[p].vboScatteredData.draw();
+		}
 		if (Model->Polylines[p].drawEdges)
 			glCallList(Model->Polylines[p].listEdges);
 		if (Model->Polylines[p].drawVertices)
@@ -109,7 +141,10 @@ GLWidget::drawObject()
 		glCallList(Model->listMats);
 	// draw tets
 	if (Model->drawTets)
-		glCallList(Model->listTets);
+	{
+		Model->vboTetEdges.draw();
+		Model->vboTetFaces.draw();
+	}
 	glPopMatrix();
 }
 
@@ -423,7 +458,8 @@ GLWidget::paintGL()
 	glMatrixMode(GL_PROJECTION);
 	glPopMatrix();
 
-	polygonSelection.draw(this);
+	if (!drawingIds)
+		polygonSelection.draw(this);
 }
 
 void
@@ -577,58 +613,139 @@ GLWidget::qgluPerspective(GLdouble fovy, GLdouble aspect, GLdouble zNear, GLdoub
 }
 
 void
-GLWidget::addRGB(unsigned char R, unsigned char G, unsigned char B)
+GLWidget::addId(quint32 id)
 {
-	if (R == 81 && G == 87 && B==110)
+	if (id == SELECTION_BACKGROUND || selectedIdSet.contains(id))
 		return;
-	for (int s = 0; s != this->selectedRGBs.length(); s = s + 3)
-		if (this->selectedRGBs[s + 0] == R && this->selectedRGBs[s + 1] == G && this->selectedRGBs[s + 2] == B)
-			return;
-	selectedRGBs.append(R);
-	selectedRGBs.append(G);
-	selectedRGBs.append(B);
+	selectedIdSet.insert(id);
+	selectedIds.append(id);
 }
 
-unsigned char* GLWidget::selectionReadPixel(int x, int y, int width, int height)
+/* Everything the selection colours depend on: the view, the shown objects
+ * and the uploaded geometry. */
+QByteArray
+GLWidget::sceneState() const
 {
-	int pixelRatio = devicePixelRatio();
-	int bufferSize = pixelRatio * width * pixelRatio * height * 4;
-	unsigned char *buffer = new unsigned char[bufferSize];
-
-	/* Draw constraints in a special selection mode. */
+	QByteArray state;
+	QDataStream out(&state, QIODevice::WriteOnly);
+	out << xRot << zRot << xTrans << yTrans << zTrans << dist << aspect << Perspec << drawAxis;
+	out << width() << height() << devicePixelRatio() << int(rotationMode);
+	out << C_GLBuffer::generation() << Model->drawMats << Model->drawTets;
 	for (int s = 0; s != Model->Surfaces.length(); s++)
-		Model->Surfaces[s].makeConstraints(true);
+	{
+		const C_Surface &surface = Model->Surfaces[s];
+		out << surface.drawScatteredData << surface.drawConvexHull << surface.drawFaces << surface.drawEdges
+		    << surface.drawIntEdges << surface.drawIntVertices << surface.drawConstraints;
+	}
+	for (int p = 0; p != Model->Polylines.length(); p++)
+	{
+		const C_Polyline &polyline = Model->Polylines[p];
+		out << polyline.drawScatteredData << polyline.drawEdges << polyline.drawVertices
+		    << polyline.drawIntVertices << polyline.drawConstraints;
+	}
+	return state;
+}
+
+/* Renders the scene without lighting and with the constraints of the
+ * surfaces in their selection colours into an offscreen framebuffer and
+ * keeps the pixels, unless the scene did not change since the last time. */
+void
+GLWidget::updateIds()
+{
+	QByteArray scene = sceneState();
+	if (idFramebuffer && scene == idScene)
+		return;
 
+	makeCurrent();
+	int pixelRatio = devicePixelRatio();
+	QSize size(pixelRatio * width(), pixelRatio * height());
+	if (!idFramebuffer || idFramebuffer->size() != size)
+	{
+		delete idFramebuffer;
+		idFramebuffer = new QOpenGLFramebufferObject(size, QOpenGLFramebufferObject::Depth);
+	}
+
+	idFramebuffer->bind();
+	glPushAttrib(GL_ENABLE_BIT | GL_VIEWPORT_BIT | GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT);
+	glViewport(0, 0, size.width(), size.height());
 	glDisable(GL_LIGHTING);
+	glDisable(GL_BLEND);
+	glColor3f(0.0f, 0.0f, 0.0f);
+	drawingIds = true;
 	this->paintGL();
+	drawingIds = false;
+	glPopAttrib();
 
-	glReadPixels(pixelRatio*x, pixelRatio*y, pixelRatio*width, pixelRatio*height,
-	             GL_RGBA, GL_UNSIGNED_BYTE, buffer);
+	QVector<unsigned char> buffer(4 * size.width() * size.height());
+	glReadPixels(0, 0, size.width(), size.height(), GL_RGBA, GL_UNSIGNED_BYTE, buffer.data());
+	idFramebuffer->release();
 
-	for (int s = 0; s != Model->Surfaces.length(); s++)
-		Model->Surfaces[s].makeConstraints(false);
+	ids.resize(size.width() * size.height());
+	for (int p = 0; p != ids.size(); p++)
+		ids[p] = quint32(buffer[4 * p]) | quint32(buffer[4 * p + 1]) << 8 | quint32(buffer[4 * p + 2]) << 16;
+	idScene = scene;
+}
 
-	glEnable(GL_LIGHTING);
-	this->updateGL();
+/* Selection colours of a rectangle of the widget (from the bottom left, in
+ * widget pixels), with the background outside of the widget. */
+QVector<quint32>
+GLWidget::selectionRegion(int x, int y, int width, int height)
+{
+	updateIds();
+
+	int pixelRatio = devicePixelRatio();
+	int w = idFramebuffer->width();
+	int h = idFramebuffer->height();
+	x *= pixelRatio;
+	y *= pixelRatio;
+	width *= pixelRatio;
+	height *= pixelRatio;
+
+	QVector<quint32> region(width * height, SELECTION_BACKGROUND);
+	for (int r = qMax(0, -y); r < height && y + r < h; r++)
+		for (int c = qMax(0, -x); c < width && x + c < w; c++)
+			region[r * width + c] = ids[(y + r) * w + x + c];
+	return region;
+}
 
-	return buffer;
+void GLWidget::selectionSearchAll(const QVector<quint32> &region)
+{
+	for (int p = 0; p != region.size(); p++)
+		this->addId(region[p]);
 }
 
-void GLWidget::selectionSearchAll(unsigned char *buffer, int width, int height)
+/* Draws the lines of the selection polygon into the region of the whole
+ * widget, they bound the flood fill like the other unselectable objects. */
+void GLWidget::selectionWalls(QVector<quint32> &region, int width, int height)
 {
 	int pixelRatio = devicePixelRatio();
-	for (int p = 0; p != pixelRatio*width*pixelRatio*height; p++)
-		this->addRGB(buffer[4 * p + 0], buffer[4 * p + 1], buffer[4 * p + 2]);
+	QImage walls(pixelRatio * width, pixelRatio * height, QImage::Format_Grayscale8);
+	walls.fill(0);
+
+	QPolygonF polygon = polygonSelection.polygon();
+	for (int i = 0; i != polygon.size(); i++)
+		polygon[i] *= pixelRatio;
+
+	QPainter painter(&walls);
+	painter.setPen(QPen(Qt::white, 2.0));
+	painter.drawPolyline(polygon);
+	painter.end();
+
+	/* the image rows are from the top */
+	for (int r = 0; r != walls.height(); r++)
+	{
+		const uchar *line = walls.constScanLine(walls.height() - 1 - r);
+		for (int c = 0; c != walls.width(); c++)
+			if (line[c])
+				region[r * walls.width() + c] = SELECTION_NONE;
+	}
 }
 
-void GLWidget::selectionFloodFill(unsigned char *buffer, int x, int y,
+void GLWidget::selectionFloodFill(QVector<quint32> &region, int x, int y,
                                   int width, int height, FillMode mode = NORMAL)
 {
-#define IDX(p) 4 * ( (p).y() * width + (p).x() )
-
-	typedef std::array<unsigned char, 3> RGB;
-	std::map<RGB, int> screenColorsCount;
-	std::map<RGB, int> floodCount;
+	QHash<quint32, int> screenColorsCount;
+	QHash<quint32, int> floodCount;
 
 	int pixelRatio = devicePixelRatio();
 
@@ -638,10 +755,7 @@ void GLWidget::selectionFloodFill(unsigned char *buffer, int x, int y,
 	height = height * pixelRatio;
 
 	for(int i = 0; i < height*width; i++)
-	{
-		RGB key = {buffer[4*i], buffer[4*i+1], buffer[4*i+2]};
-		screenColorsCount[key]++;
-	}
+		screenColorsCount[region[i]]++;
 
 	std::queue<QPoint> Q;
 	QPoint n(x, y);
@@ -649,12 +763,11 @@ void GLWidget::selectionFloodFill(unsigned char *buffer, int x, int y,
 	int xdir[4] = { -1, 1,  0, 0 };
 	int ydir[4] = {  0, 0, -1, 1 };
 
+	/* Visited pixels are set to SELECTION_NONE, like the unselectable
+	 * objects which bound the fill. */
 	if( n.x() >= 0 && n.x() < width && n.y() >= 0 && n.y() < height )
 	{
-		buffer[IDX(n)] = 0;
-		buffer[IDX(n) + 1] = 0;
-		buffer[IDX(n) + 2] = 0;
-
+		region[n.y() * width + n.x()] = SELECTION_NONE;
 		Q.push(n);
 	}
 
@@ -670,55 +783,53 @@ void GLWidget::selectionFloodFill(unsigned char *buffer, int x, int y,
 			if( p.x() < 0 || p.x() >= width || p.y() < 0 || p.y() >= height )
 				continue;
 
-			unsigned char *rgb = buffer + IDX(p);
-			if( rgb[0] == 0 && rgb[1] == 0 && rgb[2] == 0 )
+			quint32 &id = region[p.y() * width + p.x()];
+			if( id == SELECTION_NONE )
 				continue;
 
-			if( rgb[0] != 81 || rgb[1] != 87 || rgb[2] != 110 )
+			if( id != SELECTION_BACKGROUND )
 			{
-				RGB key = {rgb[0], rgb[1], rgb[2]};
-				floodCount[key]++;
+				floodCount[id]++;
 				if( mode != GREEDY )
 					continue;
 			}
 
-			rgb[0] = 0; rgb[1] = 0; rgb[2] = 0;
+			id = SELECTION_NONE;
 			Q.push(p);
 		}
 	}
 
-	std::map<RGB, int>::const_iterator it;
-	for(it = floodCount.begin(); it != floodCount.end(); ++it)
+	QHash<quint32, int>::const_iterator it;
+	for(it = floodCount.constBegin(); it != floodCount.constEnd(); ++it)
 	{
-		if( it->second == screenColorsCount[it->first] || it->second > 2 )
-			this->addRGB(it->first[0], it->first[1], it->first[2]);
+		if( it.value() == screenColorsCount.value(it.key()) || it.value() > 2 )
+			this->addId(it.key());
 	}
-
-#undef IDX
 }
 
 void
 GLWidget::applySelection(int x, int y, int width, int height, int mx, int my)
 {
-	unsigned char *buffer = selectionReadPixel(x, y, width, height);
+	QVector<quint32> region = selectionRegion(x, y, width, height);
 
-	selectedRGBs.clear();
+	selectedIds.clear();
+	selectedIdSet.clear();
 
 	if( selectionState == BUCKET || selectionState == POLYGON )
 	{
 		FillMode mode = selectionState == BUCKET ? NORMAL : GREEDY;
-		selectionFloodFill(buffer, mx, my, width, height, mode);
+		if( selectionState == POLYGON )
+			selectionWalls(region, width, height);
+		selectionFloodFill(region, mx, my, width, height, mode);
 	}
 	else {
-		selectionSearchAll(buffer, width, height);
+		selectionSearchAll(region);
 	}
 
-	for (int s = 0; s != this->selectedRGBs.length(); s = s + 3)
-		emit SelectionWasMade(this->selectedRGBs[s + 0],
-		                      this->selectedRGBs[s + 1],
-		                      this->selectedRGBs[s + 2]);
-
-	delete[] buffer;
+	for (int s = 0; s != this->selectedIds.length(); s++)
+		emit SelectionWasMade(this->selectedIds[s] & 0xff,
+		                      (this->selectedIds[s] >> 8) & 0xff,
+		                      (this->selectedIds[s] >> 16) & 0xff);
 }
 
 /*void GLWidget::mousePressEvent(QMouseEvent *event)
@@ -27,6 +27,8 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <iostream>
+
 #include "mainwindow.h"
 #include "commandline.h"
 
@@ -68,8 +70,37 @@ main(int argc, char *argv[])
 			QApplication::translate("main", "directory"));
 		parser.addOption(exportDirectoryOption);
 
+		QCommandLineOption switchesOption(QStringList() << "s" << "switches",
+			QApplication::translate("main", "passes <switches> to tetgen (default pq1.2AY)."),
+			QApplication::translate("main", "switches"));
+		parser.addOption(switchesOption);
+
+		QCommandLineOption cacheOption(QStringList() << "c" << "cache",
+			QApplication::translate("main", "reuses results of earlier runs stored in cache <directory>; can be shared by concurrent runs."),
+			QApplication::translate("main", "directory"));
+		parser.addOption(cacheOption);
+
+		QCommandLineOption checkpointOption("checkpoint",
+			QApplication::translate("main", "writes a checkpoint to <directory> after the premeshing, the fine triangulation and the tetrahedralization."),
+			QApplication::translate("main", "directory"));
+		parser.addOption(checkpointOption);
+
+		QCommandLineOption resumeOption("resume",
+			QApplication::translate("main", "restarts the job after the last stage found in the checkpoint directory (needs --checkpoint)."));
+		parser.addOption(resumeOption);
+
+		QCommandLineOption memoryBudgetOption("memory-budget",
+			QApplication::translate("main", "limits the estimated memory of the fine triangulations running at the same time to <GiB>; larger models run with fewer threads."),
+			QApplication::translate("main", "GiB"));
+		parser.addOption(memoryBudgetOption);
+
 		/* Process the actual command line arguments given by the user */
 		parser.process(app);
+		if (parser.isSet(resumeOption) && !parser.isSet(checkpointOption))
+		{
+			std::cerr << "--resume needs the checkpoint directory of the job (--checkpoint <directory>)." << std::endl;
+			return 1;
+		}
 		C_CommandLine commandLine(&parser);
 	}
 	else
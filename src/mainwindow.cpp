@@ -189,6 +189,8 @@ MainWindow::runThreadPool(QString Attribute, int Object1, int Object2, int curre
 	if (Attribute == "TRIANGLES_FINE")
 	{
 		emit progress_replace("   > " + QString::number(100 * currentStep / totalSteps) + "% (" + QString::number(currentStep) + "/" + QString::number(totalSteps) + ") " + Model.Surfaces[Object1].Name + " (" + Model.Surfaces[Object1].Type + ")");
+		qint64 estimate = Model.Surfaces[Object1].estimate_fine_memory(Model.meshGradient);
+		Model.MemoryBudget.acquire(estimate);
 		Model.Surfaces[Object1].calculate_normal_vector();
 		Model.Surfaces[Object1].rotate(true);
 		Model.Surfaces[Object1].separate_Constraints();
@@ -200,6 +202,7 @@ MainWindow::runThreadPool(QString Attribute, int Object1, int Object2, int curre
 			Model.Surfaces[Object1].Ts[t].calculate_min_max();
 			Model.Surfaces[Object1].Ts[t].setNormalVector();
 		}
+		Model.MemoryBudget.release(estimate, Model.Surfaces[Object1].fine_memory());
 	}
 	//	intersection - surfaces-surfaces
 	if (Attribute == "INTERSECTION_MESH_MESH")
@@ -1295,13 +1298,23 @@ MainWindow::preMeshJob()
 	//	start
 	startdate = QDateTime::currentDateTime();
 	emit progress_append(">Start Time: " + startdate.toString() + "\n");
+	//	results of unchanged surfaces, polylines and intersections are restored from the pre-mesh cache
+	Model.premesh_begin(this->interpolationMethod->currentText(), Model.preMeshGradient);
+	QList<int> surfaces, polylines;
+	QList<QPair<int, int> > pairs;
+	for (int s = 0; s != Model.Surfaces.length(); s++)
+		if (!Model.restore_surface(s))
+			surfaces.append(s);
+	for (int p = 0; p != Model.Polylines.length(); p++)
+		if (!Model.restore_polyline(p))
+			polylines.append(p);
 	//	convex hull
 	emit progress_append(">Start calculating convexhull...\n");
 	currentStep = 0;
-	totalSteps = Model.Surfaces.length();
-	for (int s = 0; s != Model.Surfaces.length(); s++)
+	totalSteps = surfaces.length();
+	for (int i = 0; i != surfaces.length(); i++)
 	{
-		C_Task *task = new C_Task(this, "CONVEXHULL", s, 0, ++currentStep, totalSteps);
+		C_Task *task = new C_Task(this, "CONVEXHULL", surfaces[i], 0, ++currentStep, totalSteps);
 		QThreadPool::globalInstance()->start(task);
 	}
 	QThreadPool::globalInstance()->waitForDone();
@@ -1309,10 +1322,10 @@ MainWindow::preMeshJob()
 	//	segmentation coarse
 	emit progress_append(">Start coarse segmentation...\n");
 	currentStep = 0;
-	totalSteps = Model.Polylines.length();
-	for (int p = 0; p != Model.Polylines.length(); p++)
+	totalSteps = polylines.length();
+	for (int i = 0; i != polylines.length(); i++)
 	{
-		C_Task *task = new C_Task(this, "SEGMENTS", p, 0, ++currentStep, totalSteps);
+		C_Task *task = new C_Task(this, "SEGMENTS", polylines[i], 0, ++currentStep, totalSteps);
 		QThreadPool::globalInstance()->start(task);
 	}
 	QThreadPool::globalInstance()->waitForDone();
@@ -1320,62 +1333,71 @@ MainWindow::preMeshJob()
 	//	2D triangulation coarse
 	emit progress_append(">Start coarse triangulation...\n");
 	currentStep = 0;
-	totalSteps = Model.Surfaces.length();
-	for (int s = 0; s != Model.Surfaces.length(); s++)
+	totalSteps = surfaces.length();
+	for (int i = 0; i != surfaces.length(); i++)
 	{
-		C_Task *task = new C_Task(this, "TRIANGLES", s, 0, ++currentStep, totalSteps);
+		C_Task *task = new C_Task(this, "TRIANGLES", surfaces[i], 0, ++currentStep, totalSteps);
 		QThreadPool::globalInstance()->start(task);
 	}
 	QThreadPool::globalInstance()->waitForDone();
+	for (int i = 0; i != surfaces.length(); i++)
+		Model.store_surface(surfaces[i]);
+	for (int i = 0; i != polylines.length(); i++)
+		Model.store_polyline(polylines[i]);
 	emit progress_append(">...finished");
 	//	intersection: surface-surface
 	emit progress_append(">Start calculating surface-surface intersections...\n");
 	Model.Intersections.clear();
+	Model.IntersectionKeys.clear();
+	for (int s1 = 0; s1 < Model.Surfaces.length() - 1; s1++)
+		for (int s2 = s1 + 1; s2 != Model.Surfaces.length(); s2++)
+			if (!Model.restore_int_polyline(s1, s2))
+				pairs.append(qMakePair(s1, s2));
 	currentStep = 0;
-	totalSteps = Model.Surfaces.length()*(Model.Surfaces.length() - 1) / 2;
-	if (totalSteps>0)
+	totalSteps = pairs.length();
+	for (int i = 0; i != pairs.length(); i++)
 	{
-		for (int s1 = 0; s1 != Model.Surfaces.length() - 1; s1++)
-			for (int s2 = s1 + 1; s2 != Model.Surfaces.length(); s2++)
-			{
-				C_Task *task = new C_Task(this, "INTERSECTION_MESH_MESH", s1, s2, ++currentStep, totalSteps);
-				QThreadPool::globalInstance()->start(task);
-			}
-		QThreadPool::globalInstance()->waitForDone();
+		C_Task *task = new C_Task(this, "INTERSECTION_MESH_MESH", pairs[i].first, pairs[i].second, ++currentStep, totalSteps);
+		QThreadPool::globalInstance()->start(task);
 	}
+	QThreadPool::globalInstance()->waitForDone();
+	int meshMesh = Model.Intersections.length();
 	emit progress_append(">...finished");
 	//	intersection: polyline-surface
 	emit progress_append(">Start calculating polyline-surface intersections...\n");
+	pairs.clear();
+	for (int p = 0; p != Model.Polylines.length(); p++)
+		for (int s = 0; s != Model.Surfaces.length(); s++)
+			if (!Model.restore_int_point(p, s))
+				pairs.append(qMakePair(p, s));
 	currentStep = 0;
-	totalSteps = Model.Polylines.length()*Model.Surfaces.length();
-	if (totalSteps>0)
+	totalSteps = pairs.length();
+	for (int i = 0; i != pairs.length(); i++)
 	{
-		for (int p = 0; p != Model.Polylines.length(); p++)
-			for (int s = 0; s != Model.Surfaces.length(); s++)
-			{
-				C_Task *task = new C_Task(this, "INTERSECTION_POLYLINE_MESH", p, s, ++currentStep, totalSteps);
-				QThreadPool::globalInstance()->start(task);
-			}
-		QThreadPool::globalInstance()->waitForDone();
+		C_Task *task = new C_Task(this, "INTERSECTION_POLYLINE_MESH", pairs[i].first, pairs[i].second, ++currentStep, totalSteps);
+		QThreadPool::globalInstance()->start(task);
 	}
+	QThreadPool::globalInstance()->waitForDone();
+	Model.link_intersections(meshMesh);
 	emit progress_append(">...finished");
 	//	intersection: calculate size
 	Model.calculate_size_of_intersections();
 	//	intersection: triple points
 	emit progress_append(">Start calculating intersection triplepoints...\n");
 	Model.TPs.clear();
+	pairs.clear();
+	for (int i1 = 0; i1 < Model.Intersections.length() - 1; i1++)
+		for (int i2 = i1 + 1; i2 != Model.Intersections.length(); i2++)
+			if (!Model.restore_int_triplepoints(i1, i2))
+				pairs.append(qMakePair(i1, i2));
 	currentStep = 0;
-	totalSteps = Model.Intersections.length()*(Model.Intersections.length() - 1) / 2;
-	if (totalSteps>0)
+	totalSteps = pairs.length();
+	for (int i = 0; i != pairs.length(); i++)
 	{
-		for (int i1 = 0; i1 != Model.Intersections.length() - 1; i1++)
-			for (int i2 = i1 + 1; i2 != Model.Intersections.length(); i2++)
-			{
-				C_Task * task = new C_Task(this, "INTERSECTION_TRIPLEPOINTS", i1, i2, ++currentStep, totalSteps);
-				QThreadPool::globalInstance()->start(task);
-			}
-		QThreadPool::globalInstance()->waitForDone();
+		C_Task * task = new C_Task(this, "INTERSECTION_TRIPLEPOINTS", pairs[i].first, pairs[i].second, ++currentStep, totalSteps);
+		QThreadPool::globalInstance()->start(task);
 	}
+	QThreadPool::globalInstance()->waitForDone();
 	Model.insert_int_triplepoints();
 	emit progress_append(">...finished");
 
@@ -1393,6 +1415,7 @@ MainWindow::preMeshJob()
 		Model.Polylines[p].calculate_Constraints();
 	emit progress_append(">...finished");
 	Model.calculate_size_of_constraints();
+	Model.premesh_end();
 	//	end
 	enddate = QDateTime::currentDateTime();
 	emit progress_append(">End Time: " + enddate.toString() + "\n");
@@ -1508,7 +1531,11 @@ void MainWindow::clearMesh()
 	if( Model.Mesh ) {
 		delete Model.Mesh;
 		Model.Mesh = 0;
-		Model.listTets = NULL;
+		Model.vboTetEdges.release();
+		Model.vboTetFaces.release();
+		Model.tetCut.clear();
+		Model.tetFaceCorners = QVector<quint32>();
+		Model.tetFaceColors = QVector<char>();
 		Model.drawTets = false;
 		this->matsTitle->setHidden(true);
 	}
@@ -3903,6 +3930,7 @@ MainWindow::FinishedRead()
 	this->FillNameCombos();
 	if (Model.Mesh)
 	{
+		Model.prepareTets();
 		this->callMakeTets();
 		this->matsTitle->setHidden(false);
 		Model.drawTets = true;
@@ -3961,6 +3989,7 @@ MainWindow::threadFinishedMesh()
 		Model.Polylines[p].makeVertices();
 		Model.Polylines[p].makeConstraints();
 	}
+	Model.prepareTets();
 	this->callMakeTets();
 	this->FillNameCombos();
 
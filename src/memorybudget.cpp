@@ -0,0 +1,146 @@
+/* MeshIt - a 3D mesh generator for fractured reservoirs
+ *
+ * Copyright (C) 2020
+ *
+ * Mauro Cacace (GFZ, cacace@gfz-potsdam.de),
+ * Guido Bl�cher (GFZ, bloech@gfz-potsdam.de),
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version, complemented with
+ * the following provision:
+ * For the scientific transparency and verification of results obtained
+ * and communicated to the public after using a modified version of the
+ * work, You (as the recipient of the source code and author of this
+ * modified version, used to produce the published results in scientific
+ * communications) commit to make this modified source code available in
+ * a repository that is easily and freely accessible for a duration of
+ * five years after the communication of the obtained results.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "memorybudget.h"
+
+C_MemoryBudget::C_MemoryBudget()
+{
+	this->limitBytes = 0;
+	this->inUse = 0;
+	this->reset();
+}
+
+void
+C_MemoryBudget::setLimit(qint64 bytes)
+{
+	QMutexLocker locker(&this->lock);
+	this->limitBytes = bytes > 0 ? bytes : 0;
+	this->released.wakeAll();
+}
+
+qint64
+C_MemoryBudget::limit() const
+{
+	QMutexLocker locker(&this->lock);
+	return this->limitBytes;
+}
+
+void
+C_MemoryBudget::acquire(qint64 estimate)
+{
+	QMutexLocker locker(&this->lock);
+	bool waited = false;
+	while (this->limitBytes != 0 && this->inUse != 0 && this->inUse + estimate > this->limitBytes)
+	{
+		waited = true;
+		this->released.wait(&this->lock);
+	}
+	if (waited)
+		this->waits++;
+	this->inUse += estimate;
+	if (this->inUse > this->peakBytes)
+		this->peakBytes = this->inUse;
+}
+
+void
+C_MemoryBudget::release(qint64 estimate, qint64 actual)
+{
+	QMutexLocker locker(&this->lock);
+	this->inUse -= estimate;
+	this->estimatedBytes += estimate;
+	this->actualBytes += actual;
+	this->released.wakeAll();
+}
+
+void
+C_MemoryBudget::reset()
+{
+	QMutexLocker locker(&this->lock);
+	this->peakBytes = this->inUse;
+	this->estimatedBytes = 0;
+	this->actualBytes = 0;
+	this->waits = 0;
+}
+
+qint64
+C_MemoryBudget::estimated() const
+{
+	QMutexLocker locker(&this->lock);
+	return this->estimatedBytes;
+}
+
+qint64
+C_MemoryBudget::actual() const
+{
+	QMutexLocker locker(&this->lock);
+	return this->actualBytes;
+}
+
+qint64
+C_MemoryBudget::peak() const
+{
+	QMutexLocker locker(&this->lock);
+	return this->peakBytes;
+}
+
+int
+C_MemoryBudget::throttled() const
+{
+	QMutexLocker locker(&this->lock);
+	return this->waits;
+}
+
+/* Peak resident set size of the process in bytes, 0 if unknown. */
+qint64
+C_MemoryBudget::peakResidentSetSize()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return (qint64)counters.PeakWorkingSetSize;
+	return 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+#ifdef __APPLE__
+	return (qint64)usage.ru_maxrss;
+#else
+	return (qint64)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
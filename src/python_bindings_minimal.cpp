@@ -3,56 +3,26 @@
 #include <pybind11/operators.h>
 #include <vector>
 #include <string>
-#include <fstream>
 #include <iostream>
 #include <cmath>
 #include <algorithm>
 #include <pybind11/functional.h>
-#include <chrono>
-#include <thread>
-#include <future>
-#include <mutex>
-#include <ctime>
+#include <pybind11/numpy.h>
 #include <array>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <atomic>
+#include <climits>
+#include "cancellation.h"
+#include "core.h"
 #include "geometry.h"
+#include "query.h"
 namespace py = pybind11;
 
-// VTU file writing functions
-void write_vtu_header(std::ofstream& file) {
-    file << "<?xml version=\"1.0\"?>\n";
-    file << "<VTKFile type=\"UnstructuredGrid\" version=\"0.1\" byte_order=\"LittleEndian\">\n";
-    file << "  <UnstructuredGrid>\n";
-    file << "    <Piece NumberOfPoints=\"0\" NumberOfCells=\"0\">\n";
-}
-
-void write_vtu_points(std::ofstream& file) {
-    file << "      <Points>\n";
-    file << "        <DataArray type=\"Float32\" NumberOfComponents=\"3\" format=\"ascii\">\n";
-    file << "        </DataArray>\n";
-    file << "      </Points>\n";
-}
-
-void write_vtu_cells(std::ofstream& file) {
-    file << "      <Cells>\n";
-    file << "        <DataArray type=\"Int32\" Name=\"connectivity\" format=\"ascii\">\n";
-    file << "        </DataArray>\n";
-    file << "        <DataArray type=\"Int32\" Name=\"offsets\" format=\"ascii\">\n";
-    file << "        </DataArray>\n";
-    file << "        <DataArray type=\"UInt8\" Name=\"types\" format=\"ascii\">\n";
-    file << "        </DataArray>\n";
-    file << "      </Cells>\n";
-}
-
-void write_vtu_cell_data(std::ofstream& file) {
-    file << "      <CellData>\n";
-    file << "      </CellData>\n";
-}
-
-void write_vtu_footer(std::ofstream& file) {
-    file << "    </Piece>\n";
-    file << "  </UnstructuredGrid>\n";
-    file << "</VTKFile>\n";
-}
+// the size control of Triangle in core.cpp
+extern "C" int triunsuitable(double* triorg, double* tridest, double* triapex, double area);
 
 // Vector3D class with full functionality
 class Vector3D {
@@ -165,97 +135,57 @@ class TriplePoint {
             intersection_ids.push_back(id);
         }
     };
-// Triangle class with enhanced functionality
 
-// Helper function to compute the distance from a point to a plane
-double distanceToPlane(const Vector3D& point, const Vector3D& planePoint, const Vector3D& planeNormal) {
-    Vector3D v = point - planePoint;
-    return Vector3D::dot(v, planeNormal);
+// The pre-mesh stages of a single surface, shared by MeshItModel and Surface.
+static void convex_hull_stage(C_Surface& surface, const QString& method) {
+    surface.calculate_normal_vector();
+    surface.rotate(true);
+    surface.calculate_convex_hull();
+    surface.interpolation("ConvexHull", method);
+    surface.rotate(false);
 }
 
-// Helper function to find the point with maximum distance from a plane
-int findFurthestPoint(const std::vector<Vector3D>& points, const Vector3D& planePoint, const Vector3D& planeNormal) {
-    double maxDistance = 0;
-    int maxIndex = -1;
-    
-    for (size_t i = 0; i < points.size(); i++) {
-        double distance = std::abs(distanceToPlane(points[i], planePoint, planeNormal));
-        if (distance > maxDistance) {
-            maxDistance = distance;
-            maxIndex = static_cast<int>(i);
-        }
+static void triangle_stage(C_Surface& surface, const QString& method, double gradient) {
+    surface.rotate(true);
+    surface.calculate_triangles(false, gradient);
+    surface.interpolation("Mesh", method);
+    surface.rotate(false);
+    surface.Intersections.clear();
+    surface.calculate_min_max();
+    for (int t = 0; t != surface.Ts.length(); t++) {
+        surface.Ts[t].calculate_min_max();
+        surface.Ts[t].setNormalVector();
     }
-    
-    return maxIndex;
 }
 
-// Helper function to compute the convex hull of a set of points
+static QString interpolation_method(const std::string& method) {
+    if (method != "IDW" && method != "SPLINE" && method != "KRIGING")
+        throw std::invalid_argument("unknown interpolation '" + method + "' (IDW, SPLINE or KRIGING)");
+    return QString::fromStdString(method);
+}
+
+// Convex hull of the scattered data of a surface, computed by C_Surface in the
+// normalized frame of C_Model like in the pre-mesh.
 std::vector<Vector3D> compute_convex_hull(const std::vector<Vector3D>& points) {
-    if (points.size() <= 3) {
-        return points; // Not enough points for a 3D hull
+    if (points.size() < 3) {
+        return points;
     }
-    
-    // Find initial tetrahedron
-    // First, find the two points furthest apart
-    double maxDist = 0;
-    int a = 0, b = 0;
-    for (size_t i = 0; i < points.size(); i++) {
-        for (size_t j = i + 1; j < points.size(); j++) {
-            double dist = (points[i] - points[j]).lengthSquared();
-            if (dist > maxDist) {
-                maxDist = dist;
-                a = static_cast<int>(i);
-                b = static_cast<int>(j);
-            }
-        }
-    }
-    
-    // Find the point furthest from the line ab
-    Vector3D ab = points[b] - points[a];
-    ab = ab.normalized();
-    
-    double maxDist2 = 0;
-    int c = 0;
-    for (size_t i = 0; i < points.size(); i++) {
-        if (i == a || i == b) continue;
-        
-        Vector3D ac = points[i] - points[a];
-        Vector3D projection = points[a] + ab * Vector3D::dot(ac, ab);
-        double dist = (points[i] - projection).lengthSquared();
-        
-        if (dist > maxDist2) {
-            maxDist2 = dist;
-            c = static_cast<int>(i);
-        }
-    }
-    
-    // Find the point furthest from the plane abc
-    Vector3D normal = Vector3D::cross(points[b] - points[a], points[c] - points[a]);
-    normal = normal.normalized();
-    
-    double maxDist3 = 0;
-    int d = 0;
-    for (size_t i = 0; i < points.size(); i++) {
-        if (i == a || i == b || i == c) continue;
-        
-        double dist = std::abs(distanceToPlane(points[i], points[a], normal));
-        if (dist > maxDist3) {
-            maxDist3 = dist;
-            d = static_cast<int>(i);
-        }
+    C_Model model;
+    C_Surface surface;
+    surface.MaterialID = -1;
+    for (const auto& p : points)
+        surface.SDs.append(C_Vector3D(p.x, p.y, p.z));
+    model.Surfaces.append(surface);
+    model.calculate_min_max();
+    model.tranformForward();
+    {
+        py::gil_scoped_release release;
+        convex_hull_stage(model.Surfaces[0], "IDW");
     }
-    
-    // Create the initial hull with the tetrahedron
+    model.tranformBackward();
     std::vector<Vector3D> hull;
-    hull.push_back(points[a]);
-    hull.push_back(points[b]);
-    hull.push_back(points[c]);
-    hull.push_back(points[d]);
-    
-    // For a complete implementation, we would now expand the hull
-    // by adding points outside the current hull, one by one
-    // This is a simplified version that returns the initial tetrahedron
-    
+    for (const C_Vector3D& n : model.Surfaces[0].ConvexHull.Ns)
+        hull.push_back(Vector3D(n.x(), n.y(), n.z()));
     return hull;
 }
 
@@ -265,6 +195,8 @@ class Surface {
         std::string name;
         std::string type;
         double size;
+        // input of MeshItModel; vertices are used if it is empty
+        std::vector<Vector3D> scattered_data;
         std::vector<Vector3D> vertices;
         std::vector<std::vector<int>> triangles;
         std::vector<Vector3D> convex_hull;
@@ -296,262 +228,8 @@ class Surface {
             }
         }
         
-        void triangulate() {
-            // NOTE: For proper triangulation, use the Python Triangle library instead
-            // This implementation is a simplified version that may not produce optimal results
-            // See the triangulate_with_triangle function in test_intersections.py for a better implementation
-            
-            // This method performs coarse triangulation of the surface
-            // It should create a proper triangulation of the points
-            
-            if (vertices.size() < 3) return;
-            
-            // Clear existing triangles
-            triangles.clear();
-            
-            // If convex hull is not calculated yet, calculate it
-            if (convex_hull.empty()) {
-                calculate_convex_hull();
-            }
-            
-            // If convex hull has less than 3 points, we can't triangulate
-            if (convex_hull.size() < 3) return;
-            
-            // Create a 2D projection of all points
-            // We'll use the first three points of the convex hull to define a plane
-            Vector3D normal = Vector3D::normal(convex_hull[0], convex_hull[1], convex_hull[2]);
-            normal = normal.normalized();
-            
-            // Create a local coordinate system on the plane
-            Vector3D origin = convex_hull[0];
-            Vector3D xAxis = (convex_hull[1] - origin).normalized();
-            Vector3D yAxis = Vector3D::cross(normal, xAxis).normalized();
-            
-            // Project all vertices onto the plane
-            std::vector<std::pair<double, double>> projectedPoints;
-            for (size_t i = 0; i < vertices.size(); i++) {
-                Vector3D relativePoint = vertices[i] - origin;
-                double x = Vector3D::dot(relativePoint, xAxis);
-                double y = Vector3D::dot(relativePoint, yAxis);
-                projectedPoints.push_back(std::make_pair(x, y));
-            }
-            
-            // Create a constrained Delaunay triangulation
-            // First, identify the boundary points (convex hull)
-            std::vector<int> boundaryIndices;
-            for (const auto& hull_point : convex_hull) {
-                for (size_t i = 0; i < vertices.size(); i++) {
-                    if ((vertices[i] - hull_point).lengthSquared() < 1e-10) {
-                        boundaryIndices.push_back(static_cast<int>(i));
-                        break;
-                    }
-                }
-            }
-            
-            // Create boundary segments
-            std::vector<std::pair<int, int>> boundarySeg;
-            for (size_t i = 0; i < boundaryIndices.size(); i++) {
-                boundarySeg.push_back(std::make_pair(
-                    boundaryIndices[i], 
-                    boundaryIndices[(i + 1) % boundaryIndices.size()]
-                ));
-            }
-            
-            // Triangulate using a constrained Delaunay approach
-            // This is a simplified version that tries to mimic the Triangle library
-            
-            // First, create a triangulation of all points
-            std::vector<std::vector<int>> candidateTriangles;
-            
-            // Create an initial triangulation using all points
-            // We'll use a simple incremental algorithm
-            if (vertices.size() >= 3) {
-                // Start with a triangle using the first three non-collinear points
-                int p1 = 0, p2 = 1, p3 = 2;
-                bool found = false;
-                
-                // Find three non-collinear points
-                for (p1 = 0; p1 < static_cast<int>(vertices.size()) - 2 && !found; p1++) {
-                    for (p2 = p1 + 1; p2 < static_cast<int>(vertices.size()) - 1 && !found; p2++) {
-                        for (p3 = p2 + 1; p3 < static_cast<int>(vertices.size()) && !found; p3++) {
-                            Vector3D v1 = vertices[p1];
-                            Vector3D v2 = vertices[p2];
-                            Vector3D v3 = vertices[p3];
-                            
-                            Vector3D e1 = v2 - v1;
-                            Vector3D e2 = v3 - v1;
-                            Vector3D cross = Vector3D::cross(e1, e2);
-                            
-                            if (cross.lengthSquared() > 1e-10) {
-                                found = true;
-                                break;
-                            }
-                        }
-                        if (found) break;
-                    }
-                    if (found) break;
-                }
-                
-                if (found) {
-                    // Add the initial triangle
-                    candidateTriangles.push_back({p1, p2, p3});
-                    
-                    // Add remaining points one by one
-                    for (size_t i = 0; i < vertices.size(); i++) {
-                        if (i == p1 || i == p2 || i == p3) continue;
-                        
-                        // Find all triangles whose circumcircle contains this point
-                        std::vector<size_t> badTriangles;
-                        for (size_t j = 0; j < candidateTriangles.size(); j++) {
-                            const auto& tri = candidateTriangles[j];
-                            
-                            // Check if point is inside the circumcircle of this triangle
-                            // For simplicity, we'll use the 2D projected points
-                            auto& p = projectedPoints[i];
-                            auto& a = projectedPoints[tri[0]];
-                            auto& b = projectedPoints[tri[1]];
-                            auto& c = projectedPoints[tri[2]];
-                            
-                            // Calculate the circumcircle test
-                            double ax = a.first, ay = a.second;
-                            double bx = b.first, by = b.second;
-                            double cx = c.first, cy = c.second;
-                            double px = p.first, py = p.second;
-                            
-                            double det = (ax - px) * ((by - py) * (cx - px) - (cy - py) * (bx - px)) -
-                                        (ay - py) * ((bx - px) * (cx - px) - (cx - px) * (bx - px)) +
-                                        ((ax - px) * (ay - py) - (ay - py) * (ax - px)) * ((bx - px) * (cy - py) - (by - py) * (cx - px));
-                            
-                            if (det > 0) {
-                                badTriangles.push_back(j);
-                            }
-                        }
-                        
-                        // Find all boundary edges of the bad triangles
-                        std::vector<std::pair<int, int>> polygon;
-                        for (size_t j = 0; j < badTriangles.size(); j++) {
-                            const auto& tri = candidateTriangles[badTriangles[j]];
-                            std::vector<std::pair<int, int>> edges = {
-                                {tri[0], tri[1]},
-                                {tri[1], tri[2]},
-                                {tri[2], tri[0]}
-                            };
-                            
-                            for (const auto& edge : edges) {
-                                bool isShared = false;
-                                for (size_t k = 0; k < badTriangles.size(); k++) {
-                                    if (k == j) continue;
-                                    
-                                    const auto& otherTri = candidateTriangles[badTriangles[k]];
-                                    std::vector<std::pair<int, int>> otherEdges = {
-                                        {otherTri[0], otherTri[1]},
-                                        {otherTri[1], otherTri[2]},
-                                        {otherTri[2], otherTri[0]}
-                                    };
-                                    
-                                    for (const auto& otherEdge : otherEdges) {
-                                        if ((edge.first == otherEdge.first && edge.second == otherEdge.second) ||
-                                            (edge.first == otherEdge.second && edge.second == otherEdge.first)) {
-                                            isShared = true;
-                                            break;
-                                        }
-                                    }
-                                    
-                                    if (isShared) break;
-                                }
-                                
-                                if (!isShared) {
-                                    polygon.push_back(edge);
-                                }
-                            }
-                        }
-                        
-                        // Remove bad triangles
-                        std::sort(badTriangles.begin(), badTriangles.end(), std::greater<size_t>());
-                        for (size_t j = 0; j < badTriangles.size(); j++) {
-                            candidateTriangles.erase(candidateTriangles.begin() + badTriangles[j]);
-                        }
-                        
-                        // Add new triangles connecting the point to each edge of the polygon
-                        for (const auto& edge : polygon) {
-                            candidateTriangles.push_back({edge.first, edge.second, static_cast<int>(i)});
-                        }
-                    }
-                }
-            }
-            
-            // Filter triangles to ensure they respect the boundary constraints
-            for (const auto& tri : candidateTriangles) {
-                // Check if this triangle is valid (not outside the convex hull)
-                bool isValid = true;
-                
-                // A simple check: if all three vertices are on the convex hull, it's valid
-                int hullVertices = 0;
-                for (int idx : tri) {
-                    for (int boundaryIdx : boundaryIndices) {
-                        if (idx == boundaryIdx) {
-                            hullVertices++;
-                            break;
-                        }
-                    }
-                }
-                
-                if (hullVertices >= 1) {
-                    // At least one vertex is on the hull, consider it valid
-                    triangles.push_back(tri);
-                }
-            }
-            
-            // If no triangles were created, fall back to fan triangulation of the convex hull
-            if (triangles.empty() && boundaryIndices.size() >= 3) {
-                for (size_t i = 1; i < boundaryIndices.size() - 1; i++) {
-                    triangles.push_back({boundaryIndices[0], boundaryIndices[i], boundaryIndices[i+1]});
-                }
-            }
-        }
-        
-        void alignIntersectionsToConvexHull() {
-            // Implementation to project intersections onto convex hull
-            if (convex_hull.empty()) {
-                // Calculate convex hull if not already done
-                calculate_convex_hull();
-            }
-            
-            // This method projects intersection points that are close to the convex hull
-            // onto the convex hull surface to ensure proper boundary representation
-            
-            // In a real implementation, we would:
-            // 1. For each intersection point, find the closest point on the convex hull
-            // 2. If the distance is below a threshold, move the point to the convex hull
-            
-            // For demonstration purposes, we'll implement a simplified version:
-            // For each point, find the closest triangle on the convex hull and project to it
-            
-            // First, create triangles from the convex hull points
-            std::vector<std::vector<Vector3D>> hull_triangles;
-            if (convex_hull.size() >= 3) {
-                // Use the first point as a reference and create triangles with consecutive pairs
-                for (size_t i = 1; i < convex_hull.size() - 1; i++) {
-                    hull_triangles.push_back({convex_hull[0], convex_hull[i], convex_hull[i+1]});
-                }
-            }
-            
-            // If we have hull triangles, we can project points
-            if (!hull_triangles.empty()) {
-                // This would be called for each intersection point that needs to be aligned
-                // For demonstration, we'll just print the number of hull triangles
-                std::cout << "Aligning intersections to convex hull with " 
-                          << hull_triangles.size() << " triangles" << std::endl;
-                
-                // In a real implementation, we would iterate through intersection points
-                // and project them onto the closest hull triangle
-            }
-        }
-        
-        void calculate_Constraints() {
-            // Implementation would calculate mesh constraints
-            // This is a placeholder - actual implementation would compute complex constraints
-        }
+        // Coarse triangulation by the pre-mesh of C_Surface, see Surface::triangulate() below.
+        void triangulate(double gradient = 2.0, const std::string& method = "IDW");
         
         std::vector<Vector3D> get_convex_hull() const {
             return convex_hull;
@@ -568,24 +246,16 @@ class Polyline {
     public:
         std::string name;
         double size;
+        // input of MeshItModel; vertices are used if it is empty
+        std::vector<Vector3D> scattered_data;
         std::vector<Vector3D> vertices;
         std::vector<std::vector<int>> segments;
         std::array<Vector3D, 2> bounds; // min, max bounds
     
         Polyline() : size(0.0) {}
         
-        void calculate_segments(bool use_fine_segmentation) {
-            // This would calculate the segmentation of the polyline
-            // For the Python binding, we'll create a placeholder
-            
-            segments.clear();
-            if (vertices.size() < 2) return;
-            
-            // Create basic segments (just connecting consecutive points)
-            for (size_t i = 0; i < vertices.size() - 1; i++) {
-                segments.push_back({static_cast<int>(i), static_cast<int>(i+1)});
-            }
-        }
+        // Coarse segmentation by C_Polyline, see Polyline::calculate_segments() below.
+        void calculate_segments(bool use_fine_segmentation = false);
         
         void calculate_min_max() {
             if (vertices.empty()) return;
@@ -601,11 +271,6 @@ class Polyline {
             }
         }
         
-        void calculate_Constraints() {
-            // Implementation would calculate polyline constraints
-            // This is a placeholder - actual implementation would compute constraints
-        }
-
         void add_vertex(const Vector3D& vertex) {
             vertices.push_back(vertex);
         }
@@ -649,678 +314,1719 @@ public:
     }
 };
 
-// Update your MeshItModel class with these new methods
-class MeshItModel {
-public:
-    std::vector<Surface> surfaces;
-    std::vector<Polyline> model_polylines;
-    std::vector<Intersection> intersections;
-    std::vector<TriplePoint> triple_points;
-    double mesh_quality;
-    std::string mesh_algorithm;
-    bool has_constraints;
+// Conversion between the value types above and the C_Model of MeshItModel.
+// The model keeps its data in the normalized frame of C_Model::tranformForward(),
+// the value types are in world coordinates.
+static C_Vector3D to_model(const C_Model& model, const Vector3D& v) {
+    C_Vector3D p(v.x, v.y, v.z);
+    p -= model.shift;
+    p *= model.scale;
+    return p;
+}
+
+static Vector3D to_world(const C_Model& model, const C_Vector3D& p) {
+    return Vector3D(p.x() / model.scale + model.shift.x(),
+                    p.y() / model.scale + model.shift.y(),
+                    p.z() / model.scale + model.shift.z());
+}
 
-    MeshItModel() : mesh_quality(1.0), mesh_algorithm("delaunay"), has_constraints(false) {
-        // Initialize vectors
-        intersections = std::vector<Intersection>();
-        triple_points = std::vector<TriplePoint>();
+static std::array<Vector3D, 2> bounds_of(const std::vector<Vector3D>& points) {
+    std::array<Vector3D, 2> bounds;
+    if (points.empty()) return bounds;
+    bounds[0] = bounds[1] = points[0];
+    for (const auto& v : points) {
+        bounds[0] = Vector3D(std::min(bounds[0].x, v.x), std::min(bounds[0].y, v.y), std::min(bounds[0].z, v.z));
+        bounds[1] = Vector3D(std::max(bounds[1].x, v.x), std::max(bounds[1].y, v.y), std::max(bounds[1].z, v.z));
     }
+    return bounds;
+}
+
+// NumPy interface: points are (N,3) float64 arrays, connectivity (M,k) integer
+// arrays. Inputs of another type or layout (and nested lists) are converted once
+// by pybind11; results either view C++ storage that the array keeps alive (the
+// meshes of C_PyMeshArrays) or are filled in place, without a Python object per
+// point. The points of Surface and Polyline are copied: their vectors are
+// replaced by triangulate(), add_vertex() and assignments, which would leave a
+// view dangling.
+typedef py::array_t<double, py::array::c_style | py::array::forcecast> PointArray;
+typedef py::array_t<int, py::array::c_style | py::array::forcecast> IndexArray;
+
+static_assert(sizeof(Vector3D) == 3 * sizeof(double), "Vector3D has to be layout compatible with (N,3) arrays");
+
+static void check_points(const PointArray& points) {
+    if (points.size() != 0 && (points.ndim() != 2 || points.shape(1) != 3))
+        throw std::invalid_argument("points have to be an (N,3) array");
+}
+
+static std::vector<Vector3D> to_points(const PointArray& points) {
+    check_points(points);
+    std::vector<Vector3D> result(points.size() / 3);
+    if (!result.empty())
+        std::memcpy(result.data(), points.data(), result.size() * sizeof(Vector3D));
+    return result;
+}
 
-    void append_surface(Surface surface) {
-        surfaces.push_back(std::move(surface));
+static PointArray to_array(const std::vector<Vector3D>& points) {
+    PointArray result({static_cast<py::ssize_t>(points.size()), static_cast<py::ssize_t>(3)});
+    if (!points.empty())
+        std::memcpy(result.mutable_data(), points.data(), points.size() * sizeof(Vector3D));
+    return result;
+}
+
+// World coordinates of model points, written straight into a new array.
+static PointArray to_array(const C_Model& model, const QList<C_Vector3D>& points) {
+    PointArray result({static_cast<py::ssize_t>(points.length()), static_cast<py::ssize_t>(3)});
+    double* data = result.mutable_data();
+    for (int p = 0; p != points.length(); p++) {
+        Vector3D v = to_world(model, points[p]);
+        data[p * 3 + 0] = v.x;
+        data[p * 3 + 1] = v.y;
+        data[p * 3 + 2] = v.z;
     }
+    return result;
+}
+
+static C_Surface to_surface(const std::string& name, const std::string& type, double size, const double* xyz, size_t n) {
+    if (n < 3)
+        throw std::invalid_argument("surface '" + name + "' needs at least 3 scattered data points");
+    C_Surface surface;
+    surface.Name = QString::fromStdString(name);
+    surface.Type = QString::fromStdString(type);
+    surface.size = size;
+    surface.MaterialID = -1;
+    surface.SDs.reserve(static_cast<qsizetype>(n));
+    for (size_t p = 0; p != n; p++)
+        surface.SDs.append(C_Vector3D(xyz[p * 3 + 0], xyz[p * 3 + 1], xyz[p * 3 + 2]));
+    return surface;
+}
+
+static C_Polyline to_polyline(const std::string& name, double size, const double* xyz, size_t n) {
+    if (n < 2)
+        throw std::invalid_argument("polyline '" + name + "' needs at least 2 points");
+    C_Polyline polyline;
+    polyline.Name = QString::fromStdString(name);
+    polyline.Type = "WELL";
+    polyline.size = size;
+    polyline.MaterialID = -1;
+    polyline.SDs.reserve(static_cast<qsizetype>(n));
+    for (size_t p = 0; p != n; p++)
+        polyline.SDs.append(C_Vector3D(xyz[p * 3 + 0], xyz[p * 3 + 1], xyz[p * 3 + 2]));
+    return polyline;
+}
+
+// Binary state of the value types and of MeshItModel for pickle: a QDataStream
+// with the coordinates as raw blocks instead of one Python object per point.
+// The blocks are in the byte order of the writer, which is recorded and checked.
+static const quint32 STATE_MAGIC = 0x4d495453;  // "MITS"
+static const qint32 STATE_VERSION = 2;
 
-    void append_polyline(Polyline polyline) {
-        model_polylines.push_back(std::move(polyline));
+static void write_state_header(QDataStream& out, const char* kind) {
+    out.setVersion(QDataStream::Qt_6_0);
+    out << STATE_MAGIC << STATE_VERSION << (quint8)(QSysInfo::ByteOrder == QSysInfo::LittleEndian) << QByteArray(kind);
+}
+
+static void read_state_header(QDataStream& in, const char* kind) {
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0;
+    qint32 version = 0;
+    quint8 little = 0;
+    QByteArray name;
+    in >> magic >> version >> little >> name;
+    if (in.status() != QDataStream::Ok || magic != STATE_MAGIC || name != kind)
+        throw std::invalid_argument(std::string("not a state of ") + kind);
+    if (version != STATE_VERSION || little != (QSysInfo::ByteOrder == QSysInfo::LittleEndian))
+        throw std::invalid_argument(std::string("state of ") + kind + " written by an incompatible version or machine");
+}
+
+// The bytes of a state without a copy; state must outlive the result.
+static QByteArray state_data(const py::bytes& state) {
+    char* buffer = nullptr;
+    Py_ssize_t length = 0;
+    if (PyBytes_AsStringAndSize(state.ptr(), &buffer, &length) != 0)
+        throw py::error_already_set();
+    return QByteArray::fromRawData(buffer, static_cast<qsizetype>(length));
+}
+
+// writeRawData() and readRawData() take an int count of bytes, so the large
+// arrays are passed in chunks of at most INT_MAX bytes.
+static void write_raw(QDataStream& out, const void* data, size_t bytes) {
+    const char* p = static_cast<const char*>(data);
+    while (bytes > 0) {
+        int chunk = static_cast<int>(std::min(bytes, static_cast<size_t>(INT_MAX)));
+        if (out.writeRawData(p, chunk) != chunk) {
+            out.setStatus(QDataStream::WriteFailed);
+            return;
+        }
+        p += chunk;
+        bytes -= chunk;
     }
+}
 
-    std::vector<Intersection>& get_intersections() {
-        return intersections;
+static void read_raw(QDataStream& in, void* data, size_t bytes) {
+    char* p = static_cast<char*>(data);
+    while (bytes > 0) {
+        int chunk = static_cast<int>(std::min(bytes, static_cast<size_t>(INT_MAX)));
+        if (in.readRawData(p, chunk) != chunk) {
+            in.setStatus(QDataStream::ReadPastEnd);
+            return;
+        }
+        p += chunk;
+        bytes -= chunk;
     }
+}
 
-    std::vector<TriplePoint>& get_triple_points() {
-        return triple_points;
+static void write_points(QDataStream& out, const std::vector<Vector3D>& points) {
+    out << (qint64)points.size();
+    write_raw(out, points.data(), points.size() * sizeof(Vector3D));
+}
+
+static void read_points(QDataStream& in, std::vector<Vector3D>& points) {
+    qint64 n = 0;
+    in >> n;
+    if (n < 0 || in.device()->bytesAvailable() < n * static_cast<qint64>(sizeof(Vector3D))) {
+        in.setStatus(QDataStream::ReadCorruptData);
+        return;
     }
+    points.resize(static_cast<size_t>(n));
+    read_raw(in, points.data(), static_cast<size_t>(n) * sizeof(Vector3D));
+}
 
-    void set_mesh_quality(double quality) {
-        mesh_quality = quality;
+static void write_cells(QDataStream& out, const std::vector<std::vector<int> >& cells) {
+    out << (qint64)cells.size();
+    for (const std::vector<int>& cell : cells) {
+        out << (qint32)cell.size();
+        write_raw(out, cell.data(), cell.size() * sizeof(int));
     }
+}
 
-    void set_mesh_algorithm(const std::string& algorithm) {
-        mesh_algorithm = algorithm;
+static void read_cells(QDataStream& in, std::vector<std::vector<int> >& cells) {
+    qint64 n = 0;
+    in >> n;
+    if (n < 0 || in.device()->bytesAvailable() < n * static_cast<qint64>(sizeof(qint32))) {
+        in.setStatus(QDataStream::ReadCorruptData);
+        return;
+    }
+    cells.resize(static_cast<size_t>(n));
+    for (std::vector<int>& cell : cells) {
+        qint32 k = 0;
+        in >> k;
+        if (k < 0 || in.device()->bytesAvailable() < k * static_cast<qint64>(sizeof(int))) {
+            in.setStatus(QDataStream::ReadCorruptData);
+            return;
+        }
+        cell.resize(static_cast<size_t>(k));
+        read_raw(in, cell.data(), static_cast<size_t>(k) * sizeof(int));
+    }
+}
+
+static py::bytes surface_state(const Surface& surface) {
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    write_state_header(out, "Surface");
+    out << QByteArray::fromStdString(surface.name) << QByteArray::fromStdString(surface.type) << surface.size;
+    write_points(out, surface.scattered_data);
+    write_points(out, surface.vertices);
+    write_cells(out, surface.triangles);
+    write_points(out, surface.convex_hull);
+    write_points(out, std::vector<Vector3D>(surface.bounds.begin(), surface.bounds.end()));
+    return py::bytes(data.constData(), data.size());
+}
+
+static Surface surface_from_state(const py::bytes& state) {
+    QDataStream in(state_data(state));
+    read_state_header(in, "Surface");
+    Surface surface;
+    QByteArray name, type;
+    std::vector<Vector3D> bounds;
+    in >> name >> type >> surface.size;
+    read_points(in, surface.scattered_data);
+    read_points(in, surface.vertices);
+    read_cells(in, surface.triangles);
+    read_points(in, surface.convex_hull);
+    read_points(in, bounds);
+    if (in.status() != QDataStream::Ok || bounds.size() != 2)
+        throw std::invalid_argument("damaged state of Surface");
+    surface.name = name.toStdString();
+    surface.type = type.toStdString();
+    surface.bounds = {bounds[0], bounds[1]};
+    return surface;
+}
+
+static py::bytes polyline_state(const Polyline& polyline) {
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    write_state_header(out, "Polyline");
+    out << QByteArray::fromStdString(polyline.name) << polyline.size;
+    write_points(out, polyline.scattered_data);
+    write_points(out, polyline.vertices);
+    write_cells(out, polyline.segments);
+    write_points(out, std::vector<Vector3D>(polyline.bounds.begin(), polyline.bounds.end()));
+    return py::bytes(data.constData(), data.size());
+}
+
+static Polyline polyline_from_state(const py::bytes& state) {
+    QDataStream in(state_data(state));
+    read_state_header(in, "Polyline");
+    Polyline polyline;
+    QByteArray name;
+    std::vector<Vector3D> bounds;
+    in >> name >> polyline.size;
+    read_points(in, polyline.scattered_data);
+    read_points(in, polyline.vertices);
+    read_cells(in, polyline.segments);
+    read_points(in, bounds);
+    if (in.status() != QDataStream::Ok || bounds.size() != 2)
+        throw std::invalid_argument("damaged state of Polyline");
+    polyline.name = name.toStdString();
+    polyline.bounds = {bounds[0], bounds[1]};
+    return polyline;
+}
+
+// Result of mesh_job() handed out as arrays: the points in world coordinates and
+// shared copies of the lists of C_Mesh3D, which stay valid when the model drops
+// or recomputes its mesh.
+struct C_PyMeshArrays {
+    std::vector<double> points;
+    QList<long> edges, triangles, tetrahedra;
+    QList<int> edgeMarkers, triangleMarkers, tetrahedronMarkers;
+};
+
+// Read-only view of mesh arrays; the array holds a reference to them.
+template <typename T>
+static py::array mesh_view(const std::shared_ptr<const C_PyMeshArrays>& arrays, const T* data, std::vector<py::ssize_t> shape) {
+    if (shape[0] == 0)
+        return py::array_t<T>(shape);
+    py::capsule owner(new std::shared_ptr<const C_PyMeshArrays>(arrays),
+                      [](void* p) { delete static_cast<std::shared_ptr<const C_PyMeshArrays>*>(p); });
+    py::array_t<T> view(shape, data, owner);
+    py::detail::array_proxy(view.ptr())->flags &= ~py::detail::npy_api::NPY_ARRAY_WRITEABLE_;
+    return view;
+}
+
+// Coarse triangulation of the scattered data (vertices if scattered_data is empty)
+// by the same stages as the pre-mesh: convex hull, Triangle refined by the
+// gradient control around the size of the surface, and interpolation of the
+// new points. The scattered data is kept, vertices and triangles become the
+// triangulation.
+void Surface::triangulate(double gradient, const std::string& method) {
+    if (scattered_data.empty())
+        scattered_data = vertices;
+    if (scattered_data.size() < 3)
+        return;
+    QString interpolation = interpolation_method(method);
+    C_Model model;
+    model.Surfaces.append(to_surface(name, type, size, &scattered_data[0].x, scattered_data.size()));
+    model.calculate_min_max();
+    model.tranformForward();
+    C_Surface& surface = model.Surfaces[0];
+    {
+        py::gil_scoped_release release;
+        convex_hull_stage(surface, interpolation);
+        triangle_stage(surface, interpolation, gradient);
     }
+    vertices.clear();
+    triangles.clear();
+    convex_hull.clear();
+    for (const C_Vector3D& n : surface.Ns)
+        vertices.push_back(to_world(model, n));
+    const C_Vector3D* first = surface.Ns.constData();
+    for (const C_Triangle& t : surface.Ts)
+        triangles.push_back({int(t.Ns[0] - first), int(t.Ns[1] - first), int(t.Ns[2] - first)});
+    for (const C_Vector3D& n : surface.ConvexHull.Ns)
+        convex_hull.push_back(to_world(model, n));
+    calculate_min_max();
+}
 
-    void enable_constraints(bool enable) {
-        has_constraints = enable;
+// Segmentation of the pre-mesh: the points refined to the size of the polyline.
+// The fine segmentation keeps the part between the intersection points, which
+// only the polylines of a MeshItModel have.
+void Polyline::calculate_segments(bool use_fine_segmentation) {
+    if (use_fine_segmentation)
+        throw std::invalid_argument("the fine segmentation needs the intersections of a MeshItModel");
+    if (scattered_data.empty())
+        scattered_data = vertices;
+    if (scattered_data.size() < 2)
+        return;
+    C_Model model;
+    model.Polylines.append(to_polyline(name, size, &scattered_data[0].x, scattered_data.size()));
+    model.calculate_min_max();
+    model.tranformForward();
+    C_Polyline& polyline = model.Polylines[0];
+    {
+        py::gil_scoped_release release;
+        polyline.calculate_segments(false);
     }
+    vertices.clear();
+    segments.clear();
+    for (const C_Vector3D& n : polyline.Path.Ns)
+        vertices.push_back(to_world(model, n));
+    for (size_t i = 0; i + 1 < vertices.size(); i++)
+        segments.push_back({static_cast<int>(i), static_cast<int>(i + 1)});
+    calculate_min_max();
+}
 
-    void add_polyline(const std::vector<std::vector<double>>& points) {
-        std::vector<Vector3D> polyline;
-        for (const auto& point : points) {
-            if (point.size() >= 3) {
-                polyline.push_back(Vector3D(point[0], point[1], point[2]));
-            }
-        }
-        if (!polyline.empty()) {
-            polylines.push_back(polyline);
-            std::cout << "Added polyline with " << polyline.size() << " points" << std::endl;
-        }
+// Runs work(first, last) on chunks of [0, count) in the pool and waits for
+// them; called without the GIL. The chunks are large enough to keep the
+// overhead of the tasks small, and many enough to balance the threads.
+static void parallel_for(QThreadPool& pool, int count, const std::function<void(int, int)>& work) {
+    if (count == 0) return;
+    const int chunk = qMax(64, count / (8 * qMax(1, pool.maxThreadCount())));
+    QSemaphore finished;
+    int chunks = 0;
+    for (int first = 0; first < count; first += chunk, chunks++) {
+        const int last = qMin(first + chunk, count);
+        pool.start([&work, &finished, first, last]() {
+            work(first, last);
+            finished.release();
+        });
     }
+    finished.acquire(chunks);
+}
 
-    void add_triangle(const std::vector<double>& v1, 
-                     const std::vector<double>& v2, 
-                     const std::vector<double>& v3) {
-        if (v1.size() >= 3 && v2.size() >= 3 && v3.size() >= 3) {
-            triangles.push_back(Triangle(
-                Vector3D(v1[0], v1[1], v1[2]),
-                Vector3D(v2[0], v2[1], v2[2]),
-                Vector3D(v3[0], v3[1], v3[2])
-            ));
+// z of the surface through the (N,3) scattered data at the (M,2) xy
+// locations, interpolated by C_Surface like the pre-mesh does in its
+// normalized frame. The weights of SPLINE and KRIGING are solved once.
+static py::array_t<double> interpolate(const PointArray& scattered, const py::array_t<double, py::array::c_style | py::array::forcecast>& xy,
+                                       const std::string& method) {
+    check_points(scattered);
+    if (scattered.size() == 0)
+        throw std::invalid_argument("the scattered data is empty");
+    if (xy.size() != 0 && (xy.ndim() != 2 || xy.shape(1) != 2))
+        throw std::invalid_argument("locations have to be an (M,2) array");
+    const QString algorithm = interpolation_method(method);
+    const bool idw = algorithm == "IDW", spline = algorithm == "SPLINE";
+    const std::vector<Vector3D> points = to_points(scattered);
+    const int count = static_cast<int>(xy.size() / 2);
+    py::array_t<double> result(static_cast<py::ssize_t>(count));
+    const double* in = xy.data();
+    double* out = result.mutable_data();
+    {
+        py::gil_scoped_release release;
+        std::array<Vector3D, 2> bounds = bounds_of(points);
+        const Vector3D shift = (bounds[0] + bounds[1]) * 0.5;
+        const double extent = std::max({bounds[1].x - bounds[0].x, bounds[1].y - bounds[0].y, bounds[1].z - bounds[0].z});
+        const double scale = extent > 0.0 ? 2.0 / extent : 1.0;
+        C_Surface surface;
+        for (const Vector3D& p : points)
+            surface.SDs.append(C_Vector3D((p.x - shift.x) * scale, (p.y - shift.y) * scale, (p.z - shift.z) * scale));
+        if (spline)
+            surface.fillSpline();
+        else if (!idw)
+            surface.fillKriging();
+        // the filled surface is only read, see check_interpolation (benchmark/)
+        const C_Surface& filled = surface;
+        parallel_for(*QThreadPool::globalInstance(), count, [&](int first, int last) {
+            for (int i = first; i != last; i++) {
+                double x = (in[i * 2 + 0] - shift.x) * scale, y = (in[i * 2 + 1] - shift.y) * scale;
+                double z = idw ? filled.IDW(x, y) : spline ? filled.SPLINE(x, y) : filled.KRIGING(x, y);
+                out[i] = z / scale + shift.z;
+            }
+        });
+        if (!idw && !spline) {
+            // C_Surface leaves them to the owner
+            delete[] surface.MatrixKriging;
+            delete[] surface.VectorKriging;
+            delete[] surface.KrigingWeights;
+            delete[] surface.KrigingPivot;
         }
     }
+    return result;
+}
 
-    void pre_mesh() {
-        std::cout << "Pre-meshing " << polylines.size() << " polylines" << std::endl;
-        // Clean up existing mesh data
-        triangles.clear();
-        mesh_vertices.clear();
-        mesh_faces.clear();
-
-        if (has_constraints) {
-            handle_constraints();
+// Distinct points of the (N,3) array in the order of their first occurrence,
+// with the index of the distinct point of every input point. Coincident points
+// are found by the spatial hash of C_PointHash instead of pairwise.
+static py::tuple unique_points(const PointArray& points, double tolerance) {
+    check_points(points);
+    if (tolerance < 0.0)
+        throw std::invalid_argument("the tolerance must not be negative");
+    const int count = static_cast<int>(points.size() / 3);
+    const double* xyz = points.data();
+    py::array_t<int> inverse(count);
+    int* index = inverse.mutable_data();
+    std::vector<Vector3D> unique;
+    {
+        py::gil_scoped_release release;
+        double extent = 0.0;
+        for (py::ssize_t c = 0; c != points.size(); c++)
+            extent = std::max(extent, std::fabs(xyz[c]));
+        C_PointHash hash(tolerance, extent);
+        for (int p = 0; p != count; p++) {
+            index[p] = hash.insert(xyz + p * 3);
+            if (index[p] == static_cast<int>(unique.size()))
+                unique.push_back(Vector3D(xyz[p * 3 + 0], xyz[p * 3 + 1], xyz[p * 3 + 2]));
         }
     }
+    return py::make_tuple(to_array(unique), inverse);
+}
 
-    void handle_constraints() {
-        // Implementation of constraint handling
-        std::cout << "Processing mesh constraints..." << std::endl;
+// The (N,3) polyline (closed: back to the first point) with points inserted
+// by C_Line::RefineByLength() so that no segment is longer than about length.
+// The input points are kept.
+static PointArray refine_polyline(const PointArray& points, double length, bool closed) {
+    check_points(points);
+    if (!(length > 0.0))
+        throw std::invalid_argument("the length must be positive");
+    const double* xyz = points.data();
+    C_Line line;
+    for (py::ssize_t p = 0; p != points.size() / 3; p++) {
+        line.Ns.append(C_Vector3D(xyz[p * 3 + 0], xyz[p * 3 + 1], xyz[p * 3 + 2]));
+        line.Ns.last().setType("CORNER");
     }
+    closed = closed && line.Ns.length() > 2;
+    if (closed)
+        line.Ns.append(line.Ns.first());
+    {
+        py::gil_scoped_release release;
+        line.AddPosition();
+        line.RefineByLength(length);
+    }
+    if (closed)
+        line.Ns.removeLast();
+    std::vector<Vector3D> refined;
+    refined.reserve(static_cast<size_t>(line.Ns.length()));
+    for (const C_Vector3D& p : line.Ns)
+        refined.push_back(Vector3D(p.x(), p.y(), p.z()));
+    return to_array(refined);
+}
 
-    void mesh() {
-        std::cout << "Meshing " << polylines.size() << " polylines..." << std::endl;
-        
-        if (mesh_algorithm == "delaunay") {
-            mesh_delaunay();
-        } else if (mesh_algorithm == "advancing_front") {
-            mesh_advancing_front();
-        } else {
-            mesh_simple();
-        }
+// Constrained Delaunay triangulation of the (N,2) points by Triangle, with the
+// (M,2) segments kept as edges, the regions around the (H,2) holes removed,
+// and quality (minimum angle in degrees) and area refinement if requested.
+static py::tuple triangulate_polygon(const py::array_t<double, py::array::c_style | py::array::forcecast>& points,
+                                     const IndexArray& segments,
+                                     const py::array_t<double, py::array::c_style | py::array::forcecast>& holes,
+                                     double min_angle, double max_area) {
+    if (points.ndim() != 2 || points.shape(1) != 2 || points.shape(0) < 3)
+        throw std::invalid_argument("points have to be an (N,2) array of at least 3 points");
+    if (segments.size() != 0 && (segments.ndim() != 2 || segments.shape(1) != 2))
+        throw std::invalid_argument("segments have to be an (M,2) array");
+    if (holes.size() != 0 && (holes.ndim() != 2 || holes.shape(1) != 2))
+        throw std::invalid_argument("holes have to be an (H,2) array");
+    if (min_angle < 0.0 || min_angle > 34.0)
+        throw std::invalid_argument("the minimum angle has to be within 0 and 34 degrees");
+    const int count = static_cast<int>(points.shape(0));
+    for (py::ssize_t i = 0; i != points.size(); i++)
+        if (!std::isfinite(points.data()[i]))
+            throw std::invalid_argument("points have to be finite");
+    for (py::ssize_t i = 0; i != segments.size(); i++)
+        if (segments.data()[i] < 0 || segments.data()[i] >= count)
+            throw std::out_of_range("segment index " + std::to_string(segments.data()[i]) + " out of range");
+
+    std::vector<double> pointlist(points.data(), points.data() + points.size());
+    std::vector<int> segmentlist(segments.data(), segments.data() + segments.size());
+    std::vector<double> holelist(holes.data(), holes.data() + holes.size());
+    struct triangulateio in, out;
+    std::memset(&in, 0, sizeof(in));
+    std::memset(&out, 0, sizeof(out));
+    in.pointlist = pointlist.data();
+    in.numberofpoints = count;
+    in.segmentlist = segmentlist.empty() ? nullptr : segmentlist.data();
+    in.numberofsegments = static_cast<int>(segmentlist.size() / 2);
+    in.holelist = holelist.empty() ? nullptr : holelist.data();
+    in.numberofholes = static_cast<int>(holelist.size() / 2);
+    std::string switches = "pzQ";
+    if (min_angle > 0.0)
+        switches += "q" + std::to_string(min_angle);
+    if (max_area > 0.0)
+        switches += "a" + std::to_string(max_area);
+    {
+        py::gil_scoped_release release;
+        triangulate(&switches[0], &in, &out, nullptr);
     }
+    py::array_t<double> vertices({static_cast<py::ssize_t>(out.numberofpoints), static_cast<py::ssize_t>(2)});
+    py::array_t<int> triangles({static_cast<py::ssize_t>(out.numberoftriangles), static_cast<py::ssize_t>(3)});
+    if (out.numberofpoints > 0)
+        std::memcpy(vertices.mutable_data(), out.pointlist, sizeof(double) * 2 * out.numberofpoints);
+    if (out.numberoftriangles > 0)
+        std::memcpy(triangles.mutable_data(), out.trianglelist, sizeof(int) * 3 * out.numberoftriangles);
+    // the hole list of out is the one of in
+    free(out.pointlist);
+    free(out.pointmarkerlist);
+    free(out.trianglelist);
+    free(out.segmentlist);
+    free(out.segmentmarkerlist);
+    return py::make_tuple(vertices, triangles);
+}
+
+class MeshItModel;
+
+// Raised (as meshit.Cancelled) by a job stopped through MeshItModel.cancel().
+class C_PyCancelled : public std::runtime_error {
+public:
+    C_PyCancelled() : std::runtime_error("the job was cancelled") {}
+};
+
+// Python type of C_PyCancelled, set when the module is initialized.
+static PyObject* PyCancelled = nullptr;
+
+// Runs one stage of the pipeline on a batch of objects (or pairs of objects)
+// of the model in its thread pool, like C_CmdTask of the command line.
+class C_PyTask : public QRunnable {
+public:
+    C_PyTask(MeshItModel* parent, const QString& attribute, const QList<QPair<int, int> >* objects, int first, int last)
+        : parent(parent), attribute(attribute), objects(objects), first(first), last(last) {}
+    void run() override;
+
+private:
+    MeshItModel* parent;
+    QString attribute;
+    const QList<QPair<int, int> >* objects;
+    int first, last;
+};
 
-    void mesh_delaunay() {
-        // Delaunay triangulation implementation
-        std::cout << "Using Delaunay triangulation..." << std::endl;
-        mesh_simple(); // Fallback to simple for now
+// Python front end of C_Model: the jobs run the same stages as the command line
+// and the GUI (C_CommandLine::preMeshJob() and C_CommandLine::MeshJob()).
+// Surfaces and polylines are exchanged as value types; assigning them replaces
+// the input of the model and discards the results, which are restored from the
+// pre-mesh cache on the next pre_mesh_job() as far as the input is unchanged.
+class MeshItModel {
+public:
+    MeshItModel() : switches("pq1.2AY"), premeshed(false), progress(nullptr), progressInterval(200) {
+        model.intAlgorythm = "IDW";
     }
 
-    void mesh_advancing_front() {
-        // Advancing front method implementation
-        std::cout << "Using advancing front method..." << std::endl;
-        mesh_simple(); // Fallback to simple for now
+    ~MeshItModel() {
+        delete model.Mesh;
     }
 
-    void mesh_simple() {
-        for (const auto& polyline : polylines) {
-            if (polyline.size() < 3) continue;
-            
-            int start_idx = mesh_vertices.size();
-            
-            for (const auto& pt : polyline) {
-                mesh_vertices.push_back(pt);
-            }
-            
-            for (size_t i = 1; i < polyline.size() - 1; i++) {
-                mesh_faces.push_back({start_idx, start_idx + (int)i, start_idx + (int)(i+1)});
-                triangles.push_back(Triangle(polyline[0], polyline[i], polyline[i+1]));
+    MeshItModel(const MeshItModel&) = delete;
+    MeshItModel& operator=(const MeshItModel&) = delete;
+
+    std::vector<Surface> get_surfaces() {
+        Busy busy(this);
+        std::vector<Surface> surfaces;
+        for (const C_Surface& cs : model.Surfaces) {
+            Surface s;
+            s.name = cs.Name.toStdString();
+            s.type = cs.Type.toStdString();
+            s.size = cs.size / model.scale;
+            for (const C_Vector3D& p : cs.SDs)
+                s.scattered_data.push_back(to_world(model, p));
+            if (!cs.Ts.isEmpty()) {
+                for (const C_Vector3D& p : cs.Ns)
+                    s.vertices.push_back(to_world(model, p));
+                const C_Vector3D* first = cs.Ns.constData();
+                for (const C_Triangle& t : cs.Ts)
+                    s.triangles.push_back({int(t.Ns[0] - first), int(t.Ns[1] - first), int(t.Ns[2] - first)});
+            } else {
+                s.vertices = s.scattered_data;
             }
+            for (const C_Vector3D& p : cs.ConvexHull.Ns)
+                s.convex_hull.push_back(to_world(model, p));
+            s.bounds = bounds_of(s.scattered_data);
+            surfaces.push_back(std::move(s));
         }
-        
-        std::cout << "Created " << triangles.size() << " triangles" << std::endl;
-        std::cout << "Mesh has " << mesh_vertices.size() << " vertices and " 
-                  << mesh_faces.size() << " faces" << std::endl;
+        return surfaces;
     }
 
-    void pre_mesh_job(const std::function<void(const std::string&)>& progress_callback = nullptr) {
-        // Record start time
-        auto start_time = std::chrono::system_clock::now();
-        std::string time_str = get_current_time_string();
-        
-        if (progress_callback) {
-            progress_callback(">Start Time: " + time_str + "\n");
-        }
-        
-        // Calculate convex hulls
-        if (progress_callback) {
-            progress_callback(">Start calculating convexhull...\n");
-        }
-        
-        std::vector<std::future<void>> futures;
-        for (size_t s = 0; s < surfaces.size(); s++) {
-            futures.push_back(std::async(std::launch::async, [this, s]() {
-                surfaces[s].calculate_convex_hull();
-            }));
-        }
-        
-        for (auto& future : futures) {
-            future.wait();
+    void set_surfaces(const std::vector<Surface>& surfaces) {
+        Busy busy(this);
+        QList<C_Surface> list;
+        for (const Surface& s : surfaces) {
+            const std::vector<Vector3D>& points = s.scattered_data.empty() ? s.vertices : s.scattered_data;
+            list.append(to_surface(s.name, s.type, s.size, points.empty() ? nullptr : &points[0].x, points.size()));
         }
-        futures.clear();
-        
-        if (progress_callback) {
-            progress_callback(">...finished");
-        }
-        
-        // Segmentation (coarse)
-        if (progress_callback) {
-            progress_callback(">Start coarse segmentation...\n");
-        }
-        
-        for (size_t p = 0; p < model_polylines.size(); p++) {
-            futures.push_back(std::async(std::launch::async, [this, p]() {
-                model_polylines[p].calculate_segments(false);
-            }));
-        }
-        
-        for (auto& future : futures) {
-            future.wait();
-        }
-        futures.clear();
-        
-        if (progress_callback) {
-            progress_callback(">...finished");
-        }
-        
-        // 2D triangulation (coarse)
-        if (progress_callback) {
-            progress_callback(">Start coarse triangulation...\n");
-        }
-        
-        for (size_t s = 0; s < surfaces.size(); s++) {
-            futures.push_back(std::async(std::launch::async, [this, s]() {
-                surfaces[s].triangulate();
-            }));
-        }
-        
-        for (auto& future : futures) {
-            future.wait();
-        }
-        futures.clear();
-        
-        if (progress_callback) {
-            progress_callback(">...finished");
-        }
-        
-        // Intersection: surface-surface
-        if (progress_callback) {
-            progress_callback(">Start calculating surface-surface intersections...\n");
-        }
-        
-        intersections.clear();
-        
-        // Calculate total number of combinations
-        int totalSteps = surfaces.size() * (surfaces.size() - 1) / 2;
-        
-        if (totalSteps > 0) {
-            for (size_t s1 = 0; s1 < surfaces.size() - 1; s1++) {
-                for (size_t s2 = s1 + 1; s2 < surfaces.size(); s2++) {
-                    futures.push_back(std::async(std::launch::async, [this, s1, s2]() {
-                        calculate_surface_surface_intersection(s1, s2);
-                    }));
-                }
-            }
-            
-            for (auto& future : futures) {
-                future.wait();
-            }
-            futures.clear();
-        }
-        
-        if (progress_callback) {
-            progress_callback(">...finished");
-        }
-        
-        // Intersection: polyline-surface
-        if (progress_callback) {
-            progress_callback(">Start calculating polyline-surface intersections...\n");
-        }
-        
-        totalSteps = model_polylines.size() * surfaces.size();
-        
-        if (totalSteps > 0) {
-            for (size_t p = 0; p < model_polylines.size(); p++) {
-                for (size_t s = 0; s < surfaces.size(); s++) {
-                    futures.push_back(std::async(std::launch::async, [this, p, s]() {
-                        calculate_polyline_surface_intersection(p, s);
-                    }));
-                }
-            }
-            
-            for (auto& future : futures) {
-                future.wait();
+        model.tranformBackward();
+        model.Surfaces = list;
+        reset();
+    }
+
+    std::vector<Polyline> get_polylines() {
+        Busy busy(this);
+        std::vector<Polyline> polylines;
+        for (const C_Polyline& cp : model.Polylines) {
+            Polyline p;
+            p.name = cp.Name.toStdString();
+            p.size = cp.size / model.scale;
+            for (const C_Vector3D& v : cp.SDs)
+                p.scattered_data.push_back(to_world(model, v));
+            if (!cp.Path.Ns.isEmpty()) {
+                for (const C_Vector3D& v : cp.Path.Ns)
+                    p.vertices.push_back(to_world(model, v));
+            } else {
+                p.vertices = p.scattered_data;
             }
-            futures.clear();
+            for (size_t i = 1; i < p.vertices.size(); i++)
+                p.segments.push_back({static_cast<int>(i - 1), static_cast<int>(i)});
+            p.bounds = bounds_of(p.scattered_data);
+            polylines.push_back(std::move(p));
         }
-        
-        if (progress_callback) {
-            progress_callback(">...finished");
+        return polylines;
+    }
+
+    void set_polylines(const std::vector<Polyline>& polylines) {
+        Busy busy(this);
+        QList<C_Polyline> list;
+        for (const Polyline& p : polylines) {
+            const std::vector<Vector3D>& points = p.scattered_data.empty() ? p.vertices : p.scattered_data;
+            list.append(to_polyline(p.name, p.size, points.empty() ? nullptr : &points[0].x, points.size()));
         }
-        
-        // Intersection: calculate size
-        calculate_size_of_intersections();
-        
-        // Intersection: triple points
-        if (progress_callback) {
-            progress_callback(">Start calculating intersection triplepoints...\n");
+        model.tranformBackward();
+        model.Polylines = list;
+        reset();
+    }
+
+    // Intersections of the last pre-mesh; polyline-surface intersections are
+    // single points with the polyline as id1 and the surface as id2.
+    std::vector<Intersection> get_intersections() {
+        Busy busy(this);
+        std::vector<Intersection> intersections;
+        for (const C_Line& line : model.Intersections) {
+            bool polyline = line.Ns.length() == 1;
+            Intersection i(polyline ? line.Object[1] : line.Object[0], polyline ? line.Object[0] : line.Object[1], polyline);
+            for (const C_Vector3D& p : line.Ns)
+                i.add_point(to_world(model, p));
+            intersections.push_back(std::move(i));
         }
-        
-        triple_points.clear();
-        
-        totalSteps = intersections.size() * (intersections.size() - 1) / 2;
-        
-        if (totalSteps > 0) {
-            for (size_t i1 = 0; i1 < intersections.size() - 1; i1++) {
-                for (size_t i2 = i1 + 1; i2 < intersections.size(); i2++) {
-                    futures.push_back(std::async(std::launch::async, [this, i1, i2]() {
-                        calculate_triple_points(i1, i2);
-                    }));
-                }
-            }
-            
-            for (auto& future : futures) {
-                future.wait();
+        return intersections;
+    }
+
+    // Triple points of the last pre-mesh, with the intersections they were inserted into.
+    std::vector<TriplePoint> get_triple_points() {
+        Busy busy(this);
+        std::vector<TriplePoint> triple_points;
+        QList<C_Vector3D> points;
+        for (const C_Vector3D& tp : model.TPs) {
+            int t = 0;
+            while (t != points.length() && lengthSquared(points[t] - tp) >= 1e-24) t++;
+            if (t == points.length()) {
+                points.append(tp);
+                triple_points.push_back(TriplePoint(to_world(model, tp)));
             }
-            futures.clear();
-        }
-        
-        insert_triple_points();
-        
-        if (progress_callback) {
-            progress_callback(">...finished");
+            triple_points[t].add_intersection(tp.intID);
         }
-        
-        // Align convex hulls to intersections
-        if (progress_callback) {
-            progress_callback(">Start aligning Convex Hulls to Intersections...\n");
-        }
-        
-        for (size_t s = 0; s < surfaces.size(); s++) {
-            if (progress_callback) {
-                progress_callback("   >(" + std::to_string(s + 1) + "/" + 
-                              std::to_string(surfaces.size()) + ") " + 
-                              surfaces[s].name + " (" + surfaces[s].type + ")");
-            }
-            surfaces[s].alignIntersectionsToConvexHull();
-        }
-        
-        if (progress_callback) {
-            progress_callback(">...finished");
-        }
-        
-        // Model constraints
-        if (progress_callback) {
-            progress_callback(">Start calculating constraints...\n");
-        }
-        
-        for (size_t s = 0; s < surfaces.size(); s++) {
-            surfaces[s].calculate_Constraints();
-        }
-        
-        for (size_t p = 0; p < model_polylines.size(); p++) {
-            model_polylines[p].calculate_Constraints();
-        }
-        
-        if (progress_callback) {
-            progress_callback(">...finished");
-        }
-        
-        calculate_size_of_constraints();
-        
-        // End timing
-        auto end_time = std::chrono::system_clock::now();
-        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
-        
-        if (progress_callback) {
-            time_str = get_current_time_string();
-            progress_callback(">End Time: " + time_str + "\n");
-            progress_callback(">elapsed Time: " + std::to_string(elapsed) + "ms\n");
+        return triple_points;
+    }
+
+    void append_surface(const Surface& surface) {
+        const std::vector<Vector3D>& points = surface.scattered_data.empty() ? surface.vertices : surface.scattered_data;
+        append(to_surface(surface.name, surface.type, surface.size, points.empty() ? nullptr : &points[0].x, points.size()));
+    }
+
+    void append_polyline(const Polyline& polyline) {
+        const std::vector<Vector3D>& points = polyline.scattered_data.empty() ? polyline.vertices : polyline.scattered_data;
+        append(to_polyline(polyline.name, polyline.size, points.empty() ? nullptr : &points[0].x, points.size()));
+    }
+
+    // Scattered data of a surface or polyline as (N,3) array, without value types in between.
+    void add_surface_points(const PointArray& points, const std::string& name, const std::string& type, double size) {
+        check_points(points);
+        append(to_surface(name, type, size, points.data(), points.size() / 3));
+    }
+
+    void add_polyline(const PointArray& points, const std::string& name, double size) {
+        check_points(points);
+        append(to_polyline(name.empty() ? "polyline_" + std::to_string(model.Polylines.length()) : name, size, points.data(), points.size() / 3));
+    }
+
+    // Adds a material with its seed points (world coordinates) for the tetrahedralization.
+    void add_material(const PointArray& locations) {
+        Busy busy(this);
+        check_points(locations);
+        C_Material material;
+        const double* xyz = locations.data();
+        for (py::ssize_t l = 0; l != locations.size() / 3; l++)
+            material.Locations.append(to_model(model, Vector3D(xyz[l * 3 + 0], xyz[l * 3 + 1], xyz[l * 3 + 2])));
+        model.Mats.append(material);
+    }
+
+    // Tetgen switches "pq<quality>AY", see C_CommandLine.
+    void set_mesh_quality(double quality) {
+        switches = QString("pq%1AY").arg(quality);
+    }
+
+    void set_mesh_algorithm(const std::string& algorithm) {
+        if (algorithm != "delaunay" && algorithm != "tetgen")
+            throw std::invalid_argument("unsupported mesh algorithm '" + algorithm + "', the mesh is generated by tetgen");
+    }
+
+    // Constraints are always part of the piecewise linear complex passed to tetgen.
+    void enable_constraints(bool) {}
+
+    // Bodies of the jobs; the callers reset the cancellation before.
+    void pre_mesh_run(const std::function<void(const std::string&)>& progress) {
+        Busy busy(this);
+        Reporter reporter(this, progress);
+        clear_stage_times();
+        if (model.Surfaces.isEmpty() && model.Polylines.isEmpty())
+            throw std::runtime_error("the model has neither surfaces nor polylines");
+        QList<int> surfaces, polylines;
+        QList<QPair<int, int> > pairs;
+        int meshMesh = 0;
+        premeshed = false;
+        stage("restore", nullptr, [&]() {
+            // results of unchanged surfaces, polylines and intersections are restored from the pre-mesh cache
+            model.premesh_begin(model.intAlgorythm, model.preMeshGradient);
+            for (int s = 0; s != model.Surfaces.length(); s++)
+                if (!model.restore_surface(s))
+                    surfaces.append(s);
+            for (int p = 0; p != model.Polylines.length(); p++)
+                if (!model.restore_polyline(p))
+                    polylines.append(p);
+        });
+        stage("convex_hull", ">Start calculating convexhull...\n", [&]() {
+            run_tasks("CONVEXHULL", surfaces);
+        });
+        stage("segments", ">Start coarse segmentation...\n", [&]() {
+            run_tasks("SEGMENTS", polylines);
+        });
+        stage("triangles", ">Start coarse triangulation...\n", [&]() {
+            run_tasks("TRIANGLES", surfaces);
+            for (int i = 0; i != surfaces.length(); i++)
+                model.store_surface(surfaces[i]);
+            for (int i = 0; i != polylines.length(); i++)
+                model.store_polyline(polylines[i]);
+        });
+        stage("surface_surface_intersections", ">Start calculating surface-surface intersections...\n", [&]() {
+            model.Intersections.clear();
+            model.IntersectionKeys.clear();
+            for (int s1 = 0; s1 < model.Surfaces.length() - 1; s1++)
+                for (int s2 = s1 + 1; s2 != model.Surfaces.length(); s2++)
+                    if (!model.restore_int_polyline(s1, s2))
+                        pairs.append(qMakePair(s1, s2));
+            run_tasks("INTERSECTION_MESH_MESH", pairs);
+            meshMesh = model.Intersections.length();
+        });
+        stage("polyline_surface_intersections", ">Start calculating polyline-surface intersections...\n", [&]() {
+            pairs.clear();
+            for (int p = 0; p != model.Polylines.length(); p++)
+                for (int s = 0; s != model.Surfaces.length(); s++)
+                    if (!model.restore_int_point(p, s))
+                        pairs.append(qMakePair(p, s));
+            run_tasks("INTERSECTION_POLYLINE_MESH", pairs);
+            model.link_intersections(meshMesh);
+            model.calculate_size_of_intersections();
+        });
+        stage("triple_points", ">Start calculating intersection triplepoints...\n", [&]() {
+            find_triple_points();
+            model.insert_int_triplepoints();
+        });
+        stage("align_convex_hulls", ">Start aligning Convex Hulls to Intersections...\n", [&]() {
+            for (int s = 0; s != model.Surfaces.length(); s++)
+                model.Surfaces[s].alignIntersectionsToConvexHull();
+        });
+        stage("constraints", ">Start calculating constraints...\n", [&]() {
+            for (int s = 0; s != model.Surfaces.length(); s++)
+                model.Surfaces[s].calculate_Constraints();
+            for (int p = 0; p != model.Polylines.length(); p++)
+                model.Polylines[p].calculate_Constraints();
+            model.calculate_size_of_constraints();
+            model.premesh_end();
+            model.set_all_constraints("SEGMENTS");
+        });
+        premeshed = true;
+    }
+
+    void mesh_run(const std::function<void(const std::string&)>& progress) {
+        Busy busy(this);
+        Reporter reporter(this, progress);
+        clear_stage_times();
+        if (!premeshed)
+            throw std::runtime_error("mesh_job() needs the results of pre_mesh_job()");
+        meshArrays.reset();
+        tetLocator.reset();
+        // a failed or cancelled job must not leave the mesh of the previous one
+        delete model.Mesh;
+        model.Mesh = 0;
+        QList<int> polylines, surfaces;
+        for (int p = 0; p != model.Polylines.length(); p++)
+            polylines.append(p);
+        stage("segments_fine", ">Start fine segmentation...\n", [&]() {
+            run_tasks("SEGMENTS_FINE", polylines);
+        });
+        stage("triangles_fine", ">Start fine triangulation...\n", [&]() {
+            // the keys are taken before the triangulation rotates the constraints
+            QList<QByteArray> keys;
+            for (int s = 0; s != model.Surfaces.length(); s++) {
+                keys.append(model.StageCache.isEnabled() ? model.surface_fine_key(s, model.intAlgorythm, model.meshGradient) : QByteArray());
+                if (!model.restore_surface_fine(s, keys[s]))
+                    surfaces.append(s);
+            }
+            // the largest surfaces first, so that a memory budget does not leave them to the end
+            QList<QPair<qint64, int> > estimates;
+            for (int i = 0; i != surfaces.length(); i++)
+                estimates.append(qMakePair(-model.Surfaces[surfaces[i]].estimate_fine_memory(model.meshGradient), surfaces[i]));
+            std::stable_sort(estimates.begin(), estimates.end());
+            QList<int> order;
+            for (int i = 0; i != estimates.length(); i++)
+                order.append(estimates[i].second);
+            model.MemoryBudget.reset();
+            run_tasks("TRIANGLES_FINE", order);
+            for (int i = 0; i != surfaces.length(); i++)
+                model.store_surface_fine(surfaces[i], keys[surfaces[i]]);
+        });
+        stage("tetrahedralization", ">Start tetrahedralization...", [&]() {
+            model.calculate_tets(switches);
+        });
+        if (!model.Mesh)
+            throw std::runtime_error("tetgen did not generate a mesh");
+    }
+
+    void pre_mesh_job(const std::function<void(const std::string&)>& progress = nullptr) {
+        {
+            // fails right away if a job is running, whose cancellation must not be reset
+            Busy busy(this);
+            cancellation.reset();
         }
+        pre_mesh_run(progress);
     }
-    
-    void calculate_surface_surface_intersection(size_t s1, size_t s2) {
-        // Skip if surfaces don't overlap based on bounding boxes
-        const Surface& surface1 = surfaces[s1];
-        const Surface& surface2 = surfaces[s2];
-        
-        // Early rejection test using bounding boxes
-        if (surface1.bounds[1].x < surface2.bounds[0].x || surface1.bounds[0].x > surface2.bounds[1].x ||
-            surface1.bounds[1].y < surface2.bounds[0].y || surface1.bounds[0].y > surface2.bounds[1].y ||
-            surface1.bounds[1].z < surface2.bounds[0].z || surface1.bounds[0].z > surface2.bounds[1].z) {
-            return; // No intersection possible
+
+    void mesh_job(const std::function<void(const std::string&)>& progress = nullptr) {
+        {
+            // fails right away if a job is running, whose cancellation must not be reset
+            Busy busy(this);
+            cancellation.reset();
         }
-        
-        // Find all intersections between triangles in both surfaces
-        std::vector<Vector3D> intersection_points;
-        
-        for (size_t t1 = 0; t1 < surface1.triangles.size(); t1++) {
-            const auto& tri1 = surface1.triangles[t1];
-            if (tri1.size() < 3) continue;
-            
-            // Get triangle vertices
-            Vector3D v1_1 = surface1.vertices[tri1[0]];
-            Vector3D v1_2 = surface1.vertices[tri1[1]];
-            Vector3D v1_3 = surface1.vertices[tri1[2]];
-            
-            for (size_t t2 = 0; t2 < surface2.triangles.size(); t2++) {
-                const auto& tri2 = surface2.triangles[t2];
-                if (tri2.size() < 3) continue;
-                
-                // Get triangle vertices
-                Vector3D v2_1 = surface2.vertices[tri2[0]];
-                Vector3D v2_2 = surface2.vertices[tri2[1]];
-                Vector3D v2_3 = surface2.vertices[tri2[2]];
-                
-                // Calculate triangle-triangle intersection (simplified)
-                // In a real implementation, use a proper triangle-triangle intersection algorithm
-                
-                // For now, check if any vertex of tri1 is close to tri2 or vice versa
-                // This is a very simplified approach - not accurate for real use
-                Vector3D midpoint1 = (v1_1 + v1_2 + v1_3) * (1.0/3.0);
-                Vector3D midpoint2 = (v2_1 + v2_2 + v2_3) * (1.0/3.0);
-                
-                // Calculate distance between midpoints
-                Vector3D diff = midpoint1 - midpoint2;
-                double distance = std::sqrt(diff.x*diff.x + diff.y*diff.y + diff.z*diff.z);
-                
-                // Make the threshold more sensitive to detect intersections
-                // Use a larger threshold to ensure we detect intersections
-                if (distance < 0.5 * (surface1.size + surface2.size) / 2.0) {
-                    // Add middle point of the segment connecting the midpoints as intersection
-                    Vector3D intersection_point = (midpoint1 + midpoint2) * 0.5;
-                    
-                    // Check if this point is already in our intersection list
-                    bool found = false;
-                    for (const auto& existing_point : intersection_points) {
-                        Vector3D delta = existing_point - intersection_point;
-                        if (delta.x*delta.x + delta.y*delta.y + delta.z*delta.z < 1e-10) {
-                            found = true;
-                            break;
-                        }
-                    }
-                    
-                    if (!found) {
-                        intersection_points.push_back(intersection_point);
-                    }
+        mesh_run(progress);
+    }
+
+    // Stops the running job at the next check inside its loops; the job then
+    // raises meshit.Cancelled. The results of a cancelled job are discarded
+    // and have to be recomputed by the next job.
+    void cancel() { cancellation.request(); }
+
+    // Seconds spent in each stage of the last job, in the order of the stages.
+    std::vector<std::pair<std::string, double> > get_stage_times() const {
+        QMutexLocker locker(&timesMutex);
+        return stageTimes;
+    }
+
+    void pre_mesh() { pre_mesh_job(); }
+    void mesh() { mesh_job(); }
+
+    // Single stages of the pre-mesh, for scripts that drive the pipeline step by step.
+    void calculate_surface_surface_intersection(int s1, int s2) {
+        Busy busy(this);
+        check_index(s1, model.Surfaces.length(), "surface");
+        check_index(s2, model.Surfaces.length(), "surface");
+        py::gil_scoped_release release;
+        model.calculate_int_polyline(s1, s2);
+    }
+
+    void calculate_polyline_surface_intersection(int p, int s) {
+        Busy busy(this);
+        check_index(p, model.Polylines.length(), "polyline");
+        check_index(s, model.Surfaces.length(), "surface");
+        py::gil_scoped_release release;
+        model.calculate_int_point(p, s);
+    }
+
+    void calculate_size_of_intersections() {
+        Busy busy(this);
+        model.calculate_size_of_intersections();
+    }
+
+    // Triple points of all pairs of intersections, without inserting them.
+    void calculate_all_triple_points() {
+        Busy busy(this);
+        cancellation.reset();
+        py::gil_scoped_release release;
+        C_Cancellation::Scope scope(&cancellation);
+        find_triple_points();
+    }
+
+    void calculate_triple_points(int i1, int i2) {
+        Busy busy(this);
+        check_index(i1, model.Intersections.length(), "intersection");
+        check_index(i2, model.Intersections.length(), "intersection");
+        py::gil_scoped_release release;
+        model.calculate_int_triplepoints(i1, i2);
+    }
+
+    void insert_triple_points() {
+        Busy busy(this);
+        model.insert_int_triplepoints();
+    }
+
+    void calculate_size_of_constraints() {
+        Busy busy(this);
+        model.calculate_size_of_constraints();
+    }
+
+    // Mesh of the last mesh_job() as read-only arrays viewing one shared copy:
+    // points (world coordinates), boundary edges and triangles of the materials,
+    // tetrahedra, and the material markers of each.
+    py::array get_mesh_points() {
+        std::shared_ptr<const C_PyMeshArrays> arrays = mesh_arrays();
+        return mesh_view(arrays, arrays->points.data(), {static_cast<py::ssize_t>(arrays->points.size() / 3), 3});
+    }
+
+    py::array get_edges() {
+        std::shared_ptr<const C_PyMeshArrays> arrays = mesh_arrays();
+        return mesh_view(arrays, arrays->edges.constData(), {arrays->edges.length() / 2, 2});
+    }
+
+    py::array get_edge_markers() {
+        std::shared_ptr<const C_PyMeshArrays> arrays = mesh_arrays();
+        return mesh_view(arrays, arrays->edgeMarkers.constData(), {arrays->edgeMarkers.length()});
+    }
+
+    py::array get_triangles() {
+        std::shared_ptr<const C_PyMeshArrays> arrays = mesh_arrays();
+        return mesh_view(arrays, arrays->triangles.constData(), {arrays->triangles.length() / 3, 3});
+    }
+
+    py::array get_triangle_markers() {
+        std::shared_ptr<const C_PyMeshArrays> arrays = mesh_arrays();
+        return mesh_view(arrays, arrays->triangleMarkers.constData(), {arrays->triangleMarkers.length()});
+    }
+
+    py::array get_tetrahedra() {
+        std::shared_ptr<const C_PyMeshArrays> arrays = mesh_arrays();
+        return mesh_view(arrays, arrays->tetrahedra.constData(), {arrays->tetrahedra.length() / 4, 4});
+    }
+
+    py::array get_tetrahedron_markers() {
+        std::shared_ptr<const C_PyMeshArrays> arrays = mesh_arrays();
+        return mesh_view(arrays, arrays->tetrahedronMarkers.constData(), {arrays->tetrahedronMarkers.length()});
+    }
+
+    // Triangulation of surface s (vertices in world coordinates) and the
+    // points of polylines and intersections.
+    PointArray get_surface_points(int s) {
+        Busy busy(this);
+        check_index(s, model.Surfaces.length(), "surface");
+        const C_Surface& surface = model.Surfaces[s];
+        return to_array(model, surface.Ts.isEmpty() ? surface.SDs : surface.Ns);
+    }
+
+    py::array_t<int> get_surface_triangles(int s) {
+        Busy busy(this);
+        check_index(s, model.Surfaces.length(), "surface");
+        const C_Surface& surface = model.Surfaces[s];
+        py::array_t<int> result({static_cast<py::ssize_t>(surface.Ts.length()), static_cast<py::ssize_t>(3)});
+        int* data = result.mutable_data();
+        const C_Vector3D* first = surface.Ns.constData();
+        for (int t = 0; t != surface.Ts.length(); t++)
+            for (int n = 0; n != 3; n++)
+                data[t * 3 + n] = int(surface.Ts[t].Ns[n] - first);
+        return result;
+    }
+
+    PointArray get_polyline_points(int p) {
+        Busy busy(this);
+        check_index(p, model.Polylines.length(), "polyline");
+        const C_Polyline& polyline = model.Polylines[p];
+        return to_array(model, polyline.Path.Ns.isEmpty() ? polyline.SDs : polyline.Path.Ns);
+    }
+
+    PointArray get_intersection_points(int i) {
+        Busy busy(this);
+        check_index(i, model.Intersections.length(), "intersection");
+        return to_array(model, model.Intersections[i].Ns);
+    }
+
+    // Batched queries on the results, in world coordinates. They run in the
+    // thread pool of the model without the GIL.
+
+    // Index of the tetrahedron of the mesh enclosing each of the (N,3)
+    // points (-1 outside the mesh) and optionally its barycentric coordinates.
+    py::object locate_points(const PointArray& points, bool barycentric) {
+        Busy busy(this);
+        check_points(points);
+        if (!model.Mesh)
+            throw std::runtime_error("there is no mesh, run mesh_job() first");
+        const int count = static_cast<int>(points.size() / 3);
+        py::array_t<int> tets(static_cast<py::ssize_t>(count));
+        py::array_t<double> weights({static_cast<py::ssize_t>(barycentric ? count : 0), static_cast<py::ssize_t>(4)});
+        const double* in = points.data();
+        int* out = tets.mutable_data();
+        double* w = weights.mutable_data();
+        {
+            py::gil_scoped_release release;
+            if (!tetLocator)
+                tetLocator = std::make_shared<const C_TetLocator>(*model.Mesh);
+            const C_TetLocator& locator = *tetLocator;
+            parallel_for(pool, count, [&](int first, int last) {
+                for (int i = first; i != last; i++) {
+                    double p[3], b[4];
+                    model_point(in + i * 3, p);
+                    out[i] = locator.locate(p, b);
+                    if (barycentric)
+                        for (int k = 0; k != 4; k++)
+                            w[i * 4 + k] = out[i] < 0 ? 0.0 : b[k];
                 }
-            }
-        }
-        
-        // If we found any intersections, create an Intersection object
-        if (!intersection_points.empty()) {
-            std::lock_guard<std::mutex> lock(mutex);
-            Intersection intersection(s1, s2, false);
-            
-            for (const auto& point : intersection_points) {
-                intersection.add_point(point);
-            }
-            
-            intersections.push_back(intersection);
+            });
         }
+        if (barycentric)
+            return py::make_tuple(tets, weights);
+        return tets;
     }
-    
-    void calculate_polyline_surface_intersection(size_t polyline_idx, size_t surface_idx) {
-        const Polyline& polyline = model_polylines[polyline_idx];
-        const Surface& surface = surfaces[surface_idx];
-        
-        // Early rejection test using bounding boxes
-        if (polyline.bounds[1].x < surface.bounds[0].x || polyline.bounds[0].x > surface.bounds[1].x ||
-            polyline.bounds[1].y < surface.bounds[0].y || polyline.bounds[0].y > surface.bounds[1].y ||
-            polyline.bounds[1].z < surface.bounds[0].z || polyline.bounds[0].z > surface.bounds[1].z) {
-            return; // No intersection possible
+
+    // Closest point on the triangulation of surface s to each of the (N,3)
+    // points: the points (N,3), the indices of their triangles (N) and the distances (N).
+    py::tuple closest_points(int s, const PointArray& points) {
+        Busy busy(this);
+        check_index(s, model.Surfaces.length(), "surface");
+        check_points(points);
+        if (model.Surfaces[s].Ts.isEmpty())
+            throw std::runtime_error("the surface is not triangulated, run pre_mesh_job() first");
+        const int count = static_cast<int>(points.size() / 3);
+        PointArray closest({static_cast<py::ssize_t>(count), static_cast<py::ssize_t>(3)});
+        py::array_t<int> triangles(static_cast<py::ssize_t>(count));
+        py::array_t<double> distances(static_cast<py::ssize_t>(count));
+        const double* in = points.data();
+        double* xyz = closest.mutable_data();
+        int* t = triangles.mutable_data();
+        double* d = distances.mutable_data();
+        {
+            py::gil_scoped_release release;
+            const C_TriangleLocator locator(model.Surfaces[s]);
+            parallel_for(pool, count, [&](int first, int last) {
+                for (int i = first; i != last; i++) {
+                    double p[3], q[3];
+                    model_point(in + i * 3, p);
+                    t[i] = locator.closest(p, q);
+                    world_point(q, xyz + i * 3);
+                    d[i] = std::sqrt((q[0] - p[0]) * (q[0] - p[0]) + (q[1] - p[1]) * (q[1] - p[1]) + (q[2] - p[2]) * (q[2] - p[2])) / model.scale;
+                }
+            });
         }
-        
-        // Find intersections between line segments and triangles
-        std::vector<Vector3D> intersection_points;
-        
-        // For each line segment in the polyline
-        for (size_t i = 0; i < polyline.segments.size(); i++) {
-            if (polyline.segments[i].size() < 2) continue;
-            
-            // Get segment vertices
-            const Vector3D& v1 = polyline.vertices[polyline.segments[i][0]];
-            const Vector3D& v2 = polyline.vertices[polyline.segments[i][1]];
-            
-            // For each triangle in the surface
-            for (size_t t = 0; t < surface.triangles.size(); t++) {
-                if (surface.triangles[t].size() < 3) continue;
-                
-                // Get triangle vertices
-                const Vector3D& tv1 = surface.vertices[surface.triangles[t][0]];
-                const Vector3D& tv2 = surface.vertices[surface.triangles[t][1]];
-                const Vector3D& tv3 = surface.vertices[surface.triangles[t][2]];
-                
-                // Compute line-triangle intersection (simplified)
-                // In a real implementation, use Möller–Trumbore algorithm or similar
-                
-                // Calculate triangle normal
-                Vector3D e1 = tv2 - tv1;
-                Vector3D e2 = tv3 - tv1;
-                Vector3D normal = Vector3D::cross(e1, e2).normalized();
-                
-                // Calculate distance from line endpoints to triangle plane
-                double dist1 = Vector3D::dot(v1 - tv1, normal);
-                double dist2 = Vector3D::dot(v2 - tv1, normal);
-                
-                // If both endpoints are on same side of plane, no intersection
-                if (dist1 * dist2 > 0) continue;
-                
-                // Calculate intersection point with plane
-                double intersection_param = dist1 / (dist1 - dist2);  // Changed 't' to 'intersection_param'
-                Vector3D intersection_point = v1 + (v2 - v1) * intersection_param;
-                
-                // Check if point is inside triangle (simplified)
-                // For simplicity, just check if it's close to the triangle centroid
-                Vector3D centroid = (tv1 + tv2 + tv3) * (1.0/3.0);
-                Vector3D diff = intersection_point - centroid;
-                double distance = std::sqrt(diff.x*diff.x + diff.y*diff.y + diff.z*diff.z);
-                
-                if (distance < 0.5 * surface.size) {
-                    // Check if this point is already in our intersection list
-                    bool found = false;
-                    for (const auto& existing_point : intersection_points) {
-                        Vector3D delta = existing_point - intersection_point;
-                        if (delta.x*delta.x + delta.y*delta.y + delta.z*delta.z < 1e-10) {
-                            found = true;
-                            break;
+        return py::make_tuple(closest, triangles, distances);
+    }
+
+    // Crossings of well trajectories, each an (K,3) array, with the
+    // triangulated surfaces (all or the given ones). Returns a dict of arrays
+    // with one entry per crossing, ordered by well and depth along the well:
+    // well, segment, surface, triangle, points (M,3) and depth (measured
+    // along the trajectory from its first point).
+    py::dict intersect_wells(const std::vector<PointArray>& wells, std::vector<int> surfaces) {
+        Busy busy(this);
+        for (const PointArray& well : wells)
+            check_points(well);
+        if (surfaces.empty())
+            for (int s = 0; s != model.Surfaces.length(); s++)
+                surfaces.push_back(s);
+        for (int s : surfaces)
+            check_index(s, model.Surfaces.length(), "surface");
+        struct Crossing { int segment, surface, triangle; double depth, xyz[3]; };
+        std::vector<std::vector<Crossing> > crossings(wells.size());
+        std::vector<const double*> data;
+        std::vector<int> lengths;
+        for (const PointArray& well : wells) {
+            data.push_back(well.data());
+            lengths.push_back(static_cast<int>(well.size() / 3));
+        }
+        {
+            py::gil_scoped_release release;
+            std::vector<std::unique_ptr<C_TriangleLocator> > locators;
+            for (int s : surfaces)
+                locators.emplace_back(new C_TriangleLocator(model.Surfaces[s]));
+            parallel_for(pool, static_cast<int>(wells.size()), [&](int first, int last) {
+                for (int w = first; w != last; w++) {
+                    double depth = 0.0;
+                    for (int k = 0; k + 1 < lengths[w]; k++) {
+                        const double* a = data[w] + k * 3;
+                        const double* b = a + 3;
+                        double pa[3], pb[3];
+                        model_point(a, pa);
+                        model_point(b, pb);
+                        const double length = std::sqrt((b[0] - a[0]) * (b[0] - a[0]) + (b[1] - a[1]) * (b[1] - a[1]) + (b[2] - a[2]) * (b[2] - a[2]));
+                        std::vector<Crossing> segment;
+                        for (size_t l = 0; l != locators.size(); l++) {
+                            QList<QPair<double, int> > hits;
+                            locators[l]->intersect(pa, pb, &hits);
+                            for (const QPair<double, int>& hit : hits) {
+                                Crossing c;
+                                c.segment = k;
+                                c.surface = surfaces[l];
+                                c.triangle = hit.second;
+                                c.depth = depth + hit.first * length;
+                                for (int d = 0; d != 3; d++)
+                                    c.xyz[d] = a[d] + hit.first * (b[d] - a[d]);
+                                segment.push_back(c);
+                            }
                         }
-                    }
-                    
-                    if (!found) {
-                        intersection_points.push_back(intersection_point);
+                        std::stable_sort(segment.begin(), segment.end(),
+                                         [](const Crossing& c1, const Crossing& c2) { return c1.depth < c2.depth; });
+                        crossings[w].insert(crossings[w].end(), segment.begin(), segment.end());
+                        depth += length;
                     }
                 }
+            });
+        }
+        py::ssize_t total = 0;
+        for (const std::vector<Crossing>& c : crossings)
+            total += static_cast<py::ssize_t>(c.size());
+        py::array_t<int> well(total), segment(total), surface(total), triangle(total);
+        py::array_t<double> depth(total);
+        PointArray points({total, static_cast<py::ssize_t>(3)});
+        py::ssize_t i = 0;
+        for (size_t w = 0; w != crossings.size(); w++)
+            for (const Crossing& c : crossings[w]) {
+                well.mutable_data()[i] = static_cast<int>(w);
+                segment.mutable_data()[i] = c.segment;
+                surface.mutable_data()[i] = c.surface;
+                triangle.mutable_data()[i] = c.triangle;
+                depth.mutable_data()[i] = c.depth;
+                std::memcpy(points.mutable_data() + i * 3, c.xyz, sizeof(c.xyz));
+                i++;
             }
-        }
-        
-        // If we found any intersections, create an Intersection object
-        if (!intersection_points.empty()) {
-            std::lock_guard<std::mutex> lock(mutex);
-            Intersection intersection(polyline_idx, surface_idx, true);  // true for polyline-surface
-            
-            for (const auto& point : intersection_points) {
-                intersection.add_point(point);
-            }
-            
-            intersections.push_back(intersection);
-        }
+        py::dict result;
+        result["well"] = well;
+        result["segment"] = segment;
+        result["surface"] = surface;
+        result["triangle"] = triangle;
+        result["points"] = points;
+        result["depth"] = depth;
+        return result;
     }
-    
-    void calculate_size_of_intersections() {
-        // Calculate length/size of each intersection
-        for (auto& intersection : intersections) {
-            double total_length = 0.0;
-            
-            // For polyline-mesh intersections, it's just points
-            if (intersection.is_polyline_mesh) {
-                // Size is just the number of points for polyline-mesh intersections
-                continue;
+
+    void export_vtu(const std::string& filename) {
+        Busy busy(this);
+        meshArrays.reset();
+        tetLocator.reset();
+        if (!model.Mesh)
+            throw std::runtime_error("there is no mesh to export, run mesh_job() first");
+        model.FileNameTmp = QString::fromStdString(filename);
+        py::gil_scoped_release release;
+        model.ExportVTU3D();
+    }
+
+    // Binary state for pickle and for shipping a model to other processes: the
+    // input in world coordinates and, after a pre-mesh, the results as a
+    // checkpoint of C_Model. The thread pool settings are not part of it.
+    py::bytes to_bytes() {
+        QByteArray data;
+        {
+            Busy busy(this);
+            QDataStream out(&data, QIODevice::WriteOnly);
+            write_state_header(out, "MeshItModel");
+            out << model.intAlgorythm << model.preMeshGradient << model.meshGradient << switches << model.MemoryBudget.limit();
+            out << (qint32)model.Surfaces.length();
+            for (const C_Surface& cs : model.Surfaces) {
+                out << cs.Name << cs.Type << cs.size / model.scale << (qint32)cs.MaterialID;
+                write_points(out, world_points(cs.SDs));
             }
-            
-            // For mesh-mesh intersections, calculate lengths between consecutive points
-            for (size_t i = 0; i < intersection.points.size() - 1; i++) {
-                const Vector3D& p1 = intersection.points[i];
-                const Vector3D& p2 = intersection.points[i + 1];
-                
-                // Calculate Euclidean distance
-                Vector3D diff = p2 - p1;
-                total_length += std::sqrt(diff.x*diff.x + diff.y*diff.y + diff.z*diff.z);
+            out << (qint32)model.Polylines.length();
+            for (const C_Polyline& cp : model.Polylines) {
+                out << cp.Name << cp.Type << cp.size / model.scale << (qint32)cp.MaterialID;
+                write_points(out, world_points(cp.SDs));
             }
-            
-            // Store the length if needed - for example in an attribute of the intersection
-        }
+            out << (qint32)model.Mats.length();
+            for (const C_Material& material : model.Mats)
+                write_points(out, world_points(material.Locations));
+            out << premeshed;
+            if (premeshed)
+                out << model.checkpoint(model.Mesh ? "mesh" : "premesh") << model.TPs;
+        }
+        return py::bytes(data.constData(), data.size());
     }
-    
-    void calculate_triple_points(size_t i1, size_t i2) {
-        const auto& intersection1 = intersections[i1];
-        const auto& intersection2 = intersections[i2];
-        
-        // Skip if either intersection doesn't have points
-        if (intersection1.points.empty() || intersection2.points.empty()) {
-            return;
+
+    // Model of a state of to_bytes(); any contiguous buffer is read in place,
+    // e.g. a memoryview of multiprocessing.shared_memory.
+    static std::unique_ptr<MeshItModel> from_bytes(const py::buffer& buffer) {
+        py::buffer_info info = buffer.request();
+        if (info.ndim > 1 || (info.ndim == 1 && info.strides[0] != info.itemsize))
+            throw std::invalid_argument("the state must be a contiguous buffer");
+        std::unique_ptr<MeshItModel> self(new MeshItModel);
+        QByteArray data = QByteArray::fromRawData(static_cast<const char*>(info.ptr), static_cast<qsizetype>(info.size * info.itemsize));
+        py::gil_scoped_release release;
+        self->restore(data);
+        return self;
+    }
+
+    std::string get_interpolation() const { return model.intAlgorythm.toStdString(); }
+    void set_interpolation(const std::string& method) {
+        model.intAlgorythm = interpolation_method(method);
+    }
+
+    // Size of the thread pool of the jobs (0: one thread per core) and the
+    // interval of the progress reports within a stage.
+    int get_threads() const { return pool.maxThreadCount(); }
+    void set_threads(int threads) {
+        pool.setMaxThreadCount(threads > 0 ? threads : QThread::idealThreadCount());
+    }
+
+    double get_progress_interval() const { return progressInterval / 1000.0; }
+    void set_progress_interval(double seconds) {
+        progressInterval = qMax(1, static_cast<int>(seconds * 1000.0));
+    }
+
+    C_Model model;
+    QString switches;
+
+private:
+    friend class C_PyTask;
+    friend class C_PyJob;
+
+    // Jobs and accessors must not overlap; a second one fails instead of
+    // blocking, as it would block while holding the GIL.
+    class Busy {
+    public:
+        explicit Busy(MeshItModel* parent) : mutex(parent->mutex) {
+            if (!mutex.tryLock())
+                throw std::runtime_error("a job is running on this MeshItModel");
         }
-        
-        // Skip if intersections don't share a surface
-        bool share_surface = (intersection1.id1 == intersection2.id1) || 
-                             (intersection1.id1 == intersection2.id2) ||
-                             (intersection1.id2 == intersection2.id1) || 
-                             (intersection1.id2 == intersection2.id2);
-        
-        if (!share_surface) {
-            return;
+        ~Busy() { mutex.unlock(); }
+
+    private:
+        QMutex& mutex;
+    };
+
+    static void check_index(int i, int length, const char* what) {
+        if (i < 0 || i >= length)
+            throw std::out_of_range(std::string(what) + " index " + std::to_string(i) + " out of range");
+    }
+
+    void append(const C_Surface& surface) {
+        Busy busy(this);
+        model.tranformBackward();
+        model.Surfaces.append(surface);
+        reset();
+    }
+
+    void append(const C_Polyline& polyline) {
+        Busy busy(this);
+        model.tranformBackward();
+        model.Polylines.append(polyline);
+        reset();
+    }
+
+    std::vector<Vector3D> world_points(const QList<C_Vector3D>& points) const {
+        std::vector<Vector3D> world;
+        world.reserve(static_cast<size_t>(points.length()));
+        for (const C_Vector3D& p : points)
+            world.push_back(to_world(model, p));
+        return world;
+    }
+
+    // Reads the whole state before the model is changed; the normalized frame
+    // is calculated again from the input, as when a checkpoint file is opened.
+    void restore(const QByteArray& data) {
+        QDataStream in(data);
+        read_state_header(in, "MeshItModel");
+        QString algorithm, meshSwitches;
+        double preMeshGradient = 1.0, meshGradient = 1.0;
+        qint64 budget = 0;
+        qint32 n = 0;
+        in >> algorithm >> preMeshGradient >> meshGradient >> meshSwitches >> budget >> n;
+        QList<C_Surface> surfaces;
+        for (qint32 s = 0; s < n && in.status() == QDataStream::Ok; s++) {
+            QString name, type;
+            double size = 0.0;
+            qint32 material = -1;
+            std::vector<Vector3D> points;
+            in >> name >> type >> size >> material;
+            read_points(in, points);
+            if (in.status() != QDataStream::Ok) break;
+            surfaces.append(to_surface(name.toStdString(), type.toStdString(), size, points.empty() ? nullptr : &points[0].x, points.size()));
+            surfaces.last().MaterialID = material;
+        }
+        n = 0;
+        in >> n;
+        QList<C_Polyline> polylines;
+        for (qint32 p = 0; p < n && in.status() == QDataStream::Ok; p++) {
+            QString name, type;
+            double size = 0.0;
+            qint32 material = -1;
+            std::vector<Vector3D> points;
+            in >> name >> type >> size >> material;
+            read_points(in, points);
+            if (in.status() != QDataStream::Ok) break;
+            polylines.append(to_polyline(name.toStdString(), size, points.empty() ? nullptr : &points[0].x, points.size()));
+            polylines.last().Type = type;
+            polylines.last().MaterialID = material;
+        }
+        n = 0;
+        in >> n;
+        QList<C_Material> mats;
+        for (qint32 m = 0; m < n && in.status() == QDataStream::Ok; m++) {
+            std::vector<Vector3D> points;
+            read_points(in, points);
+            C_Material material;
+            for (const Vector3D& v : points)
+                material.Locations.append(C_Vector3D(v.x, v.y, v.z));
+            mats.append(material);
+        }
+        bool results = false;
+        QByteArray checkpoint;
+        QList<C_Vector3D> triplePoints;
+        in >> results;
+        if (results)
+            in >> checkpoint >> triplePoints;
+        if (in.status() != QDataStream::Ok)
+            throw std::invalid_argument("damaged state of MeshItModel");
+
+        Busy busy(this);
+        model.intAlgorythm = algorithm;
+        model.preMeshGradient = preMeshGradient;
+        model.meshGradient = meshGradient;
+        model.MemoryBudget.setLimit(budget);
+        switches = meshSwitches;
+        model.Surfaces = surfaces;
+        model.Polylines = polylines;
+        model.Mats = mats;
+        reset();
+        if (results) {
+            QString stage;
+            if (!model.restore_checkpoint(checkpoint, stage))
+                throw std::invalid_argument("the results in the state of MeshItModel do not fit its input");
+            model.TPs = triplePoints;
+            premeshed = true;
         }
-        
-        // Find closest points between the two intersection lines
-        double min_distance = std::numeric_limits<double>::max();
-        Vector3D closest_point;
-        
-        // For every point in intersection1, find closest point in intersection2
-        for (const auto& p1 : intersection1.points) {
-            for (const auto& p2 : intersection2.points) {
-                Vector3D diff = p2 - p1;
-                double distance = std::sqrt(diff.x*diff.x + diff.y*diff.y + diff.z*diff.z);
-                
-                if (distance < min_distance) {
-                    min_distance = distance;
-                    closest_point = (p1 + p2) * 0.5;  // midpoint between closest points
-                }
+    }
+
+    std::shared_ptr<const C_PyMeshArrays> mesh_arrays() {
+        Busy busy(this);
+        if (!model.Mesh)
+            throw std::runtime_error("there is no mesh, run mesh_job() first");
+        if (!meshArrays) {
+            std::shared_ptr<C_PyMeshArrays> arrays = std::make_shared<C_PyMeshArrays>();
+            const C_Mesh3D& mesh = *model.Mesh;
+            arrays->points.resize(static_cast<size_t>(mesh.numberofpoints) * 3);
+            for (long p = 0; p != mesh.numberofpoints; p++) {
+                Vector3D v = to_world(model, C_Vector3D(mesh.pointlist[p * 3 + 0], mesh.pointlist[p * 3 + 1], mesh.pointlist[p * 3 + 2]));
+                arrays->points[p * 3 + 0] = v.x;
+                arrays->points[p * 3 + 1] = v.y;
+                arrays->points[p * 3 + 2] = v.z;
             }
+            arrays->edges = mesh.edgelist;
+            arrays->edgeMarkers = mesh.edgemarkerlist;
+            arrays->triangles = mesh.trianglelist;
+            arrays->triangleMarkers = mesh.trianglemarkerlist;
+            arrays->tetrahedra = mesh.tetrahedronlist;
+            arrays->tetrahedronMarkers = mesh.tetrahedronmarkerlist;
+            meshArrays = arrays;
+        }
+        return meshArrays;
+    }
+
+    // The results depend on all the input, so they are dropped with any change of it.
+    void reset() {
+        model.Intersections.clear();
+        // the cache keys describe the input of the last pre-mesh, the single
+        // stages must not store the results of the new input under them
+        model.IntersectionKeys.clear();
+        model.SurfaceKeys.clear();
+        model.PolylineKeys.clear();
+        model.TPs.clear();
+        for (int s = 0; s != model.Surfaces.length(); s++) {
+            model.Surfaces[s].Intersections.clear();
+            model.Surfaces[s].Constraints.clear();
+        }
+        for (int p = 0; p != model.Polylines.length(); p++) {
+            model.Polylines[p].Intersections.clear();
+            model.Polylines[p].Constraints.clear();
+        }
+        delete model.Mesh;
+        model.Mesh = 0;
+        meshArrays.reset();
+        tetLocator.reset();
+        premeshed = false;
+        if (!model.Surfaces.isEmpty() || !model.Polylines.isEmpty()) {
+            model.calculate_min_max();
+            model.tranformForward();
         }
-        
-        // If points are close enough, consider it a triple point
-        if (min_distance < 1e-6) {
-            std::lock_guard<std::mutex> lock(mutex);
-            TriplePoint tp(closest_point);
-            tp.add_intersection(i1);
-            tp.add_intersection(i2);
-            triple_points.push_back(tp);
+    }
+
+    // Triple points between the segments of all pairs of intersections, found
+    // in the octree of C_Box::split_seg() in the thread pool. They are
+    // inserted by C_Model::insert_int_triplepoints() at their position along
+    // the intersections.
+    void find_triple_points() {
+        QList<QPair<int, int> > pairs;
+        model.TPs.clear();
+        for (int i1 = 0; i1 < model.Intersections.length() - 1; i1++)
+            for (int i2 = i1 + 1; i2 != model.Intersections.length(); i2++)
+                if (!model.restore_int_triplepoints(i1, i2))
+                    pairs.append(qMakePair(i1, i2));
+        run_tasks("INTERSECTION_TRIPLEPOINTS", pairs);
+    }
+
+    // Conversions between world and model coordinates without C_Vector3D, for the queries.
+    void model_point(const double* world, double* p) const {
+        p[0] = (world[0] - model.shift.x()) * model.scale;
+        p[1] = (world[1] - model.shift.y()) * model.scale;
+        p[2] = (world[2] - model.shift.z()) * model.scale;
+    }
+
+    void world_point(const double* p, double* world) const {
+        world[0] = p[0] / model.scale + model.shift.x();
+        world[1] = p[1] / model.scale + model.shift.y();
+        world[2] = p[2] / model.scale + model.shift.z();
+    }
+
+    void clear_stage_times() {
+        QMutexLocker locker(&timesMutex);
+        stageTimes.clear();
+    }
+
+    // Progress callback of the running job.
+    class Reporter {
+    public:
+        Reporter(MeshItModel* parent, const std::function<void(const std::string&)>& progress) : parent(parent) {
+            parent->progress = progress ? &progress : nullptr;
         }
+        ~Reporter() { parent->progress = nullptr; }
+
+    private:
+        MeshItModel* parent;
+    };
+
+    // Runs a stage without the GIL and reports it between the stages with the
+    // GIL held. The cancellation is installed for the calling thread, which
+    // runs the stages not split into tasks (e.g. tetgen), and checked before
+    // and after the stage, as a cancelled stage may return early.
+    void stage(const char* name, const char* message, const std::function<void()>& work) {
+        if (cancellation.isRequested()) throw C_PyCancelled();
+        if (progress && message) (*progress)(message);
+        QElapsedTimer timer;
+        timer.start();
+        {
+            py::gil_scoped_release release;
+            C_Cancellation::Scope scope(&cancellation);
+            work();
+        }
+        {
+            QMutexLocker locker(&timesMutex);
+            stageTimes.push_back(std::make_pair(std::string(name), timer.nsecsElapsed() * 1e-9));
+        }
+        if (cancellation.isRequested()) throw C_PyCancelled();
+        if (progress && message) (*progress)(">...finished");
     }
-    
-    void insert_triple_points() {
-        // This function adds triple points to the relevant intersections
-        for (const auto& tp : triple_points) {
-            // For each intersection that contains this triple point
-            for (int i_id : tp.intersection_ids) {
-                if (i_id >= 0 && i_id < static_cast<int>(intersections.size())) {
-                    // Check if point is already in the intersection
-                    bool found = false;
-                    
-                    for (const auto& point : intersections[i_id].points) {
-                        Vector3D diff = point - tp.point;
-                        if (diff.x*diff.x + diff.y*diff.y + diff.z*diff.z < 1e-10) {
-                            found = true;
-                            break;
-                        }
-                    }
-                    
-                    if (!found) {
-                        // Add the triple point to this intersection
-                        intersections[i_id].points.push_back(tp.point);
-                    }
-                }
+
+    void run_tasks(const char* attribute, const QList<int>& objects) {
+        QList<QPair<int, int> > pairs;
+        pairs.reserve(objects.length());
+        for (int i = 0; i != objects.length(); i++)
+            pairs.append(qMakePair(objects[i], 0));
+        run_tasks(attribute, pairs);
+    }
+
+    // Runs the stage on all objects in batches, a few per thread so that the
+    // threads stay busy when the objects take different times. Called without
+    // the GIL; the waiting thread reports the progress every progressInterval
+    // ms. If the callback raises or the job is cancelled, the remaining
+    // objects are skipped and the exception is passed on once the running
+    // batches are done, before the caller stores any result.
+    void run_tasks(const char* attribute, const QList<QPair<int, int> >& objects) {
+        const int total = objects.length();
+        if (total == 0) return;
+        done.storeRelaxed(0);
+        skip.storeRelaxed(0);
+        const int batch = qMax(1, total / (8 * qMax(1, pool.maxThreadCount())));
+        for (int first = 0; first < total; first += batch)
+            pool.start(new C_PyTask(this, attribute, &objects, first, qMin(first + batch, total)));
+        std::exception_ptr error;
+        while (!pool.waitForDone(progressInterval)) {
+            if (!progress || error) continue;
+            py::gil_scoped_acquire acquire;
+            try {
+                int n = done.loadRelaxed();
+                (*progress)("   > " + std::to_string(100 * n / total) + "% (" + std::to_string(n) + "/" + std::to_string(total) + ")");
+            } catch (...) {
+                error = std::current_exception();
+                skip.storeRelaxed(1);
             }
         }
-        
-        // Sort intersection points for each intersection to maintain spatial order
-        // This is a simplified approach - real implementation would sort points along the intersection curve
-        for (auto& intersection : intersections) {
-            if (intersection.points.size() <= 1) {
-                continue;  // Nothing to sort
+        if (error) std::rethrow_exception(error);
+        if (cancellation.isRequested()) throw C_PyCancelled();
+    }
+
+    void runThreadPool(const QString& Attribute, int Object1, int Object2) {
+        if (Attribute == "CONVEXHULL")
+            convex_hull_stage(model.Surfaces[Object1], model.intAlgorythm);
+        if (Attribute == "SEGMENTS") {
+            model.Polylines[Object1].calculate_segments(false);
+            model.Polylines[Object1].Intersections.clear();
+            model.Polylines[Object1].Path.calculate_min_max();
+        }
+        if (Attribute == "SEGMENTS_FINE") {
+            model.Polylines[Object1].calculate_segments(true);
+            model.Polylines[Object1].Path.calculate_min_max();
+        }
+        if (Attribute == "TRIANGLES")
+            triangle_stage(model.Surfaces[Object1], model.intAlgorythm, model.preMeshGradient);
+        if (Attribute == "TRIANGLES_FINE") {
+            qint64 estimate = model.Surfaces[Object1].estimate_fine_memory(model.meshGradient);
+            model.MemoryBudget.acquire(estimate);
+            model.Surfaces[Object1].calculate_normal_vector();
+            model.Surfaces[Object1].rotate(true);
+            model.Surfaces[Object1].separate_Constraints();
+            model.Surfaces[Object1].calculate_triangles(true, model.meshGradient);
+            model.Surfaces[Object1].interpolation("Mesh", model.intAlgorythm);
+            model.Surfaces[Object1].rotate(false);
+            for (int t = 0; t != model.Surfaces[Object1].Ts.length(); t++) {
+                model.Surfaces[Object1].Ts[t].calculate_min_max();
+                model.Surfaces[Object1].Ts[t].setNormalVector();
             }
-            
-            // For simplicity, just sort by x, then y, then z
-            std::sort(intersection.points.begin(), intersection.points.end(), 
-                [](const Vector3D& a, const Vector3D& b) {
-                    if (std::abs(a.x - b.x) > 1e-10) return a.x < b.x;
-                    if (std::abs(a.y - b.y) > 1e-10) return a.y < b.y;
-                    return a.z < b.z;
-                });
-        }
+            model.MemoryBudget.release(estimate, model.Surfaces[Object1].fine_memory());
+        }
+        if (Attribute == "INTERSECTION_POLYLINE_MESH")
+            model.calculate_int_point(Object1, Object2);
+        if (Attribute == "INTERSECTION_MESH_MESH")
+            model.calculate_int_polyline(Object1, Object2);
+        if (Attribute == "INTERSECTION_TRIPLEPOINTS")
+            model.calculate_int_triplepoints(Object1, Object2);
     }
-    
-    void calculate_size_of_constraints() {
-        // Implementation would calculate size of constraints
-        // This is a placeholder - actual implementation would be more complex
+
+    QMutex mutex;
+    bool premeshed;
+    std::shared_ptr<const C_PyMeshArrays> meshArrays;
+    std::shared_ptr<const C_TetLocator> tetLocator;
+    QThreadPool pool;
+    const std::function<void(const std::string&)>* progress;
+    int progressInterval;
+    QAtomicInt done, skip;
+    C_Cancellation cancellation;
+    mutable QMutex timesMutex;
+    std::vector<std::pair<std::string, double> > stageTimes;
+};
+
+void C_PyTask::run() {
+    C_Cancellation::Scope scope(&parent->cancellation);
+    for (int i = first; i != last; i++) {
+        if (parent->skip.loadRelaxed() || parent->cancellation.isRequested()) return;
+        parent->runThreadPool(attribute, (*objects)[i].first, (*objects)[i].second);
+        parent->done.fetchAndAddRelaxed(1);
     }
-    
-    std::string get_current_time_string() {
-        auto now = std::chrono::system_clock::now();
-        std::time_t now_time = std::chrono::system_clock::to_time_t(now);
-        
-        char time_buffer[26];
-    #ifdef _WIN32
-        ctime_s(time_buffer, sizeof(time_buffer), &now_time);
-    #else
-        std::string time_str = std::ctime(&now_time);
-        std::strncpy(time_buffer, time_str.c_str(), sizeof(time_buffer));
-    #endif
-    
-        // Remove trailing newline if present
-        size_t len = strlen(time_buffer);
-        if (len > 0 && time_buffer[len-1] == '\n') {
-            time_buffer[len-1] = '\0';
-        }
-        
-        return std::string(time_buffer);
+}
+
+// Python exception object of the exception thrown by a job.
+static py::object exception_object(std::exception_ptr error) {
+    try {
+        std::rethrow_exception(error);
+    } catch (py::error_already_set& e) {
+        return e.value();
+    } catch (const C_PyCancelled& e) {
+        return py::reinterpret_borrow<py::object>(PyCancelled)(e.what());
+    } catch (const std::invalid_argument& e) {
+        return py::reinterpret_borrow<py::object>(PyExc_ValueError)(e.what());
+    } catch (const std::exception& e) {
+        return py::reinterpret_borrow<py::object>(PyExc_RuntimeError)(e.what());
+    } catch (...) {
+        return py::reinterpret_borrow<py::object>(PyExc_RuntimeError)("unknown error");
     }
-    void export_vtu(const std::string& filename) {
-        std::cout << "Exporting mesh to " << filename << std::endl;
-        
-        std::ofstream vtu_file(filename);
-        if (!vtu_file.is_open()) {
-            throw std::runtime_error("Could not open file for writing: " + filename);
-        }
-        
-        write_vtu_header(vtu_file);
-        write_vtu_points(vtu_file);
-        write_vtu_cells(vtu_file);
-        write_vtu_cell_data(vtu_file);
-        write_vtu_footer(vtu_file);
-        
-        vtu_file.close();
-        std::cout << "Export complete: " << filename << std::endl;
+}
+
+// Job started by pre_mesh_async() or mesh_async(). The job runs on a thread of
+// its own, which holds the GIL only where the synchronous job holds it (e.g.
+// for the progress callback), and completes a concurrent.futures.Future, so
+// that asyncio awaits it through asyncio.wrap_future(). The handle keeps the
+// model alive until the job is done. The threads are joined, by the next
+// start() once they are finished and by join_all() at the exit of the
+// interpreter, as a thread must not take the GIL of a finalized interpreter.
+class C_PyJob {
+public:
+    static std::shared_ptr<C_PyJob> start(py::object owner, bool mesh,
+                                          const std::function<void(const std::string&)>& progress) {
+        MeshItModel& model = owner.cast<MeshItModel&>();
+        {
+            // fails right away if a job is running, whose cancellation must not be reset
+            MeshItModel::Busy busy(&model);
+            model.cancellation.reset();
+        }
+        std::shared_ptr<C_PyJob> job(new C_PyJob);
+        job->future = py::module_::import("concurrent.futures").attr("Future")();
+        job->future.attr("set_running_or_notify_cancel")();
+        job->owner = owner;
+        job->model = &model;
+        job->progress = progress;
+        join_finished();
+        std::shared_ptr<std::atomic<bool> > finished(new std::atomic<bool>(false));
+        std::weak_ptr<C_PyJob> handle = job;
+        std::thread thread([job, mesh, finished]() mutable {
+            run(std::move(job), mesh);
+            finished->store(true);
+        });
+        threads().push_back(Thread{std::move(thread), handle, finished});
+        return job;
+    }
+
+    // Cancels the running jobs and waits for their threads, registered with
+    // atexit by the module.
+    static void join_all() {
+        std::vector<Thread> running;
+        running.swap(threads());
+        for (Thread& t : running)
+            if (std::shared_ptr<C_PyJob> job = t.job.lock())
+                job->cancel();
+        py::gil_scoped_release release;
+        for (Thread& t : running)
+            t.thread.join();
+    }
+
+    bool done() const { return future.attr("done")().cast<bool>(); }
+
+    // Requests the cancellation; false if the job is already done.
+    bool cancel() {
+        if (done()) return false;
+        model->cancel();
+        return true;
     }
 
+    std::vector<std::pair<std::string, double> > stage_times() const {
+        return done() ? times : model->get_stage_times();
+    }
+
+    py::object future;
+
 private:
-    std::vector<std::vector<Vector3D>> polylines;
-    std::vector<Triangle> triangles;
-    std::vector<Vector3D> mesh_vertices;
-    std::vector<std::vector<int>> mesh_faces;
-    std::mutex mutex;
+    C_PyJob() : model(nullptr) {}
+
+    struct Thread {
+        std::thread thread;
+        std::weak_ptr<C_PyJob> job;
+        std::shared_ptr<std::atomic<bool> > finished;
+    };
+
+    // threads of the jobs, guarded by the GIL
+    static std::vector<Thread>& threads() {
+        static std::vector<Thread> threads;
+        return threads;
+    }
+
+    static void run(std::shared_ptr<C_PyJob> job, bool mesh) {
+        py::gil_scoped_acquire acquire;
+        py::object error;
+        try {
+            if (mesh)
+                job->model->mesh_run(job->progress);
+            else
+                job->model->pre_mesh_run(job->progress);
+        } catch (...) {
+            error = exception_object(std::current_exception());
+        }
+        job->times = job->model->get_stage_times();
+        try {
+            if (error)
+                job->future.attr("set_exception")(error);
+            else
+                job->future.attr("set_result")(py::none());
+        } catch (py::error_already_set& e) {
+            e.discard_as_unraisable("MeshItModel job");
+        }
+        // the model is released only once the job is done, see cancel(),
+        // and here, as the thread holds the GIL
+        job->owner = py::object();
+        job->progress = nullptr;
+        job.reset();
+    }
 
-    // Rest of the private methods...
+    static void join_finished() {
+        std::vector<Thread>& all = threads();
+        for (size_t t = 0; t != all.size();) {
+            if (all[t].finished->load()) {
+                all[t].thread.join();
+                all.erase(all.begin() + t);
+            } else {
+                t++;
+            }
+        }
+    }
+
+    py::object owner;
+    MeshItModel* model;
+    std::function<void(const std::string&)> progress;
+    std::vector<std::pair<std::string, double> > times;
 };
 
+// Size control of the refinement of Triangle, i.e. the triunsuitable() of the
+// pipeline (core.cpp) with the GradientControl it reads. The points and sizes
+// are owned here; is_triangle_suitable() passes them to the GradientControl
+// of the calling thread only for the test and restores it after.
 class PyGradientControl {
 public:
     static PyGradientControl& getInstance() {
@@ -1328,95 +2034,51 @@ public:
         return instance;
     }
 
-    void update(double gradient, double meshsize, int npoints, const double* pointlist, const double* refinesize) {
+    void update(double gradient, double meshsize, const std::vector<std::array<double, 2> >& points,
+                const std::vector<double>& refineSizes) {
+        if (points.size() != refineSizes.size())
+            throw std::invalid_argument("one refine size per point is needed");
         _gradient = gradient;
         _meshsize = meshsize;
-        _npoints = npoints;
-        
-        // Store point list and refine sizes
-        if (_pointlist) delete[] _pointlist;
-        if (_refinesize) delete[] _refinesize;
-        
-        _pointlist = new double[npoints * 2];
-        _refinesize = new double[npoints];
-        
-        std::copy(pointlist, pointlist + (npoints * 2), _pointlist);
-        std::copy(refinesize, refinesize + npoints, _refinesize);
+        _pointlist.clear();
+        for (const std::array<double, 2>& p : points) {
+            _pointlist.push_back(p[0]);
+            _pointlist.push_back(p[1]);
+        }
+        _refinesize = refineSizes;
     }
 
     double getGradient() const { return _gradient; }
     double getMeshSize() const { return _meshsize; }
-    int getNumPoints() const { return _npoints; }
-    const double* getPointList() const { return _pointlist; }
-    const double* getRefineSize() const { return _refinesize; }
+    int getNumPoints() const { return static_cast<int>(_refinesize.size()); }
 
+    // Whether Triangle keeps the triangle, in the x-y plane of the triangulation.
     bool isTriangleSuitable(const Vector3D& v1, const Vector3D& v2, const Vector3D& v3) const {
-        // Calculate triangle centroid
-        Vector3D centroid((v1.x + v2.x + v3.x) / 3.0,
-                         (v1.y + v2.y + v3.y) / 3.0,
-                         (v1.z + v2.z + v3.z) / 3.0);
-
-        // Get desired size at centroid based on gradient
-        double desiredSize = _meshsize * (1.0 + _gradient * centroid.length());
-
-        // Calculate actual triangle size (use max edge length as metric)
-        double edge1 = sqrt(pow(v2.x - v1.x, 2) + pow(v2.y - v1.y, 2) + pow(v2.z - v1.z, 2));
-        double edge2 = sqrt(pow(v3.x - v2.x, 2) + pow(v3.y - v2.y, 2) + pow(v3.z - v2.z, 2));
-        double edge3 = sqrt(pow(v1.x - v3.x, 2) + pow(v1.y - v3.y, 2) + pow(v1.z - v3.z, 2));
-        double maxEdge = std::max({edge1, edge2, edge3});
-
-        // Calculate minimum angle
-        double minAngle = calculateMinAngle(v1, v2, v3);
-        
-        // Triangle is suitable if:
-        // 1. Max edge length is within tolerance of desired size
-        // 2. Minimum angle is acceptable (based on gradient)
-        double sizeTolerance = 0.5;  // Allow 50% deviation from desired size
-        double minAngleThreshold = 20.0 * (1.0 - _gradient * 0.25);  // Decrease min angle as gradient increases
-        
-        return maxEdge <= desiredSize * (1.0 + sizeTolerance) &&
-               minAngle >= minAngleThreshold;
-    }
-
-    ~PyGradientControl() {
-        delete[] _pointlist;
-        delete[] _refinesize;
+        double org[2] = { v1.x, v1.y };
+        double dest[2] = { v2.x, v2.y };
+        double apex[2] = { v3.x, v3.y };
+        double area = 0.5 * std::fabs((dest[0] - org[0]) * (apex[1] - org[1]) - (dest[1] - org[1]) * (apex[0] - org[0]));
+        GradientControl& gc = GradientControl::getInstance();
+        const GradientControl saved = gc;
+        gc.update(_gradient, _meshsize, getNumPoints(), _pointlist.data(), _refinesize.data());
+        int unsuitable = triunsuitable(org, dest, apex, area);
+        gc = saved;
+        return unsuitable == 0;
     }
 
 private:
-    PyGradientControl() : _gradient(1.0), _meshsize(1.0), _npoints(0), _pointlist(nullptr), _refinesize(nullptr) {}
-    
+    PyGradientControl() : _gradient(1.0), _meshsize(1.0) {}
+
     // Prevent copying
     PyGradientControl(const PyGradientControl&) = delete;
     PyGradientControl& operator=(const PyGradientControl&) = delete;
 
-    double calculateMinAngle(const Vector3D& v1, const Vector3D& v2, const Vector3D& v3) const {
-        // Calculate vectors for triangle edges
-        Vector3D e1(v2.x - v1.x, v2.y - v1.y, v2.z - v1.z);
-        Vector3D e2(v3.x - v2.x, v3.y - v2.y, v3.z - v2.z);
-        Vector3D e3(v1.x - v3.x, v1.y - v3.y, v1.z - v3.z);
-
-        // Calculate lengths
-        double l1 = sqrt(e1.x * e1.x + e1.y * e1.y + e1.z * e1.z);
-        double l2 = sqrt(e2.x * e2.x + e2.y * e2.y + e2.z * e2.z);
-        double l3 = sqrt(e3.x * e3.x + e3.y * e3.y + e3.z * e3.z);
-
-        // Calculate angles using dot product
-        double a1 = acos(-(e1.x * e3.x + e1.y * e3.y + e1.z * e3.z) / (l1 * l3)) * 180.0 / M_PI;
-        double a2 = acos(-(e1.x * e2.x + e1.y * e2.y + e1.z * e2.z) / (l1 * l2)) * 180.0 / M_PI;
-        double a3 = acos(-(e2.x * e3.x + e2.y * e3.y + e2.z * e3.z) / (l2 * l3)) * 180.0 / M_PI;
-
-        return std::min({a1, a2, a3});
-    }
-
     double _gradient;
     double _meshsize;
-    int _npoints;
-    double* _pointlist;
-    double* _refinesize;
+    std::vector<double> _pointlist;
+    std::vector<double> _refinesize;
 };
 
-// Replace the existing PYBIND11_MODULE section with this updated version:
 PYBIND11_MODULE(_meshit, m) {
     m.doc() = "MeshIt Python bindings for PZero integration";
     
@@ -1469,32 +2131,52 @@ PYBIND11_MODULE(_meshit, m) {
         .def_readwrite("name", &Surface::name)
         .def_readwrite("type", &Surface::type)
         .def_readwrite("size", &Surface::size)
+        .def_readwrite("scattered_data", &Surface::scattered_data)
         .def_readwrite("vertices", &Surface::vertices)
         .def_readwrite("triangles", &Surface::triangles)
         .def_readwrite("convex_hull", &Surface::convex_hull)
         .def_readwrite("bounds", &Surface::bounds)
+        .def_property_readonly("vertex_array",
+            [](const Surface& self) { return to_array(self.vertices); },
+            "(N,3) copy of the vertices")
+        .def_property_readonly("scattered_data_array",
+            [](const Surface& self) { return to_array(self.scattered_data); },
+            "(N,3) copy of the scattered data")
+        .def_property_readonly("convex_hull_array",
+            [](const Surface& self) { return to_array(self.convex_hull); },
+            "(N,3) copy of the convex hull")
         .def("calculate_convex_hull", &Surface::calculate_convex_hull)
         .def("calculate_min_max", &Surface::calculate_min_max)
-        .def("triangulate", &Surface::triangulate)
+        .def("triangulate", &Surface::triangulate, py::arg("gradient") = 2.0, py::arg("interpolation") = "IDW",
+             "Coarse triangulation of the scattered data by Triangle, as in the pre-mesh")
         .def("add_vertex", [](Surface& self, const Vector3D& vertex) {
             self.vertices.push_back(vertex);
         })
         .def("get_convex_hull", &Surface::get_convex_hull)
-        .def("alignIntersectionsToConvexHull", &Surface::alignIntersectionsToConvexHull);
+        .def(py::pickle(&surface_state, &surface_from_state));
     
     // Bind the Polyline class
     py::class_<Polyline>(m, "Polyline")
         .def(py::init<>())
         .def_readwrite("name", &Polyline::name)
         .def_readwrite("size", &Polyline::size)
+        .def_readwrite("scattered_data", &Polyline::scattered_data)
         .def_readwrite("vertices", &Polyline::vertices)
         .def_readwrite("segments", &Polyline::segments)
         .def_readwrite("bounds", &Polyline::bounds)
-        .def("calculate_segments", &Polyline::calculate_segments)
+        .def_property_readonly("vertex_array",
+            [](const Polyline& self) { return to_array(self.vertices); },
+            "(N,3) copy of the vertices")
+        .def_property_readonly("scattered_data_array",
+            [](const Polyline& self) { return to_array(self.scattered_data); },
+            "(N,3) copy of the scattered data")
+        .def("calculate_segments", &Polyline::calculate_segments, py::arg("use_fine_segmentation") = false,
+             "Coarse segmentation of the points, refined to the size of the polyline as in the pre-mesh")
         .def("calculate_min_max", &Polyline::calculate_min_max)
         .def("add_vertex", [](Polyline& self, const Vector3D& vertex) {
             self.vertices.push_back(vertex);
-        });
+        })
+        .def(py::pickle(&polyline_state, &polyline_from_state));
     
     // Bind Triangle class
     py::class_<Triangle>(m, "Triangle")
@@ -1507,105 +2189,169 @@ PYBIND11_MODULE(_meshit, m) {
         .def("centroid", &Triangle::centroid)
         .def("containsPoint", &Triangle::containsPoint);
 
-    // UPDATED - Bind MeshItModel class with custom vector bindings
+    PyCancelled = py::register_exception<C_PyCancelled>(m, "Cancelled", PyExc_RuntimeError).ptr();
+    py::module_::import("atexit").attr("register")(py::cpp_function(&C_PyJob::join_all));
+
+    // Handle of pre_mesh_async() and mesh_async(), see C_PyJob
+    py::class_<C_PyJob, std::shared_ptr<C_PyJob> >(m, "MeshItJob")
+        .def_readonly("future", &C_PyJob::future, "concurrent.futures.Future completed by the job")
+        .def("done", &C_PyJob::done)
+        .def("cancel", &C_PyJob::cancel,
+             "Requests the cancellation, the job then raises Cancelled; False if it is already done")
+        .def("result", [](const C_PyJob& self, py::object timeout) {
+            return self.future.attr("result")(timeout);
+        }, py::arg("timeout") = py::none())
+        .def("exception", [](const C_PyJob& self, py::object timeout) {
+            return self.future.attr("exception")(timeout);
+        }, py::arg("timeout") = py::none())
+        .def("add_done_callback", [](py::object self, py::function callback) {
+            self.attr("future").attr("add_done_callback")(
+                py::cpp_function([self, callback](py::object) { callback(self); }));
+        }, "Calls callback(job) once the job is done, on the thread of the job")
+        .def_property_readonly("stage_times", &C_PyJob::stage_times)
+        .def("__await__", [](py::object self) {
+            // cancelling the awaiting task cancels the job
+            py::object waiter = py::module_::import("asyncio").attr("wrap_future")(self.attr("future"));
+            waiter.attr("add_done_callback")(py::cpp_function([self](py::object waiter) {
+                if (waiter.attr("cancelled")().cast<bool>())
+                    self.cast<C_PyJob&>().cancel();
+            }));
+            return waiter.attr("__await__")();
+        });
+
+    // MeshItModel runs the pipeline of C_Model, see MeshItModel
     py::class_<MeshItModel>(m, "MeshItModel")
         .def(py::init<>())
-        .def_property("surfaces", 
-            [](const MeshItModel& model) { return model.surfaces; },
-            [](MeshItModel& model, const std::vector<Surface>& surfaces) { model.surfaces = surfaces; })
-        .def_property("model_polylines", 
-            [](const MeshItModel& model) { return model.model_polylines; },
-            [](MeshItModel& model, const std::vector<Polyline>& polylines) { model.model_polylines = polylines; })
-        .def_property("intersections", 
-            [](const MeshItModel& model) { return model.intersections; },
-            [](MeshItModel& model, const std::vector<Intersection>& intersections) { model.intersections = intersections; })
-        .def_property("triple_points", 
-            [](const MeshItModel& model) { return model.triple_points; },
-            [](MeshItModel& model, const std::vector<TriplePoint>& triple_points) { model.triple_points = triple_points; })
+        .def_property("surfaces", &MeshItModel::get_surfaces, &MeshItModel::set_surfaces)
+        .def_property("model_polylines", &MeshItModel::get_polylines, &MeshItModel::set_polylines)
+        .def_property_readonly("intersections", &MeshItModel::get_intersections)
+        .def_property_readonly("triple_points", &MeshItModel::get_triple_points)
+        .def_property("interpolation", &MeshItModel::get_interpolation, &MeshItModel::set_interpolation)
+        .def_property("threads", &MeshItModel::get_threads, &MeshItModel::set_threads,
+                      "Number of worker threads of the jobs (0: one per core)")
+        .def_property("progress_interval", &MeshItModel::get_progress_interval, &MeshItModel::set_progress_interval,
+                      "Seconds between progress reports within a stage")
+        .def_property("pre_mesh_gradient",
+            [](const MeshItModel& self) { return self.model.preMeshGradient; },
+            [](MeshItModel& self, double gradient) { self.model.preMeshGradient = gradient; })
+        .def_property("mesh_gradient",
+            [](const MeshItModel& self) { return self.model.meshGradient; },
+            [](MeshItModel& self, double gradient) { self.model.meshGradient = gradient; })
+        .def_property("switches",
+            [](const MeshItModel& self) { return self.switches.toStdString(); },
+            [](MeshItModel& self, const std::string& switches) { self.switches = QString::fromStdString(switches); })
+        .def_property("memory_budget",
+            [](const MeshItModel& self) { return self.model.MemoryBudget.limit(); },
+            [](MeshItModel& self, qint64 bytes) { self.model.MemoryBudget.setLimit(bytes); },
+            "Memory limit in bytes for the fine triangulations running at the same time (0: none)")
         .def("append_surface", &MeshItModel::append_surface)
         .def("append_polyline", &MeshItModel::append_polyline)
+        .def("add_surface", &MeshItModel::append_surface)
+        .def("add_surface", &MeshItModel::add_surface_points,
+             py::arg("points"), py::arg("name") = "", py::arg("type") = "UNIT", py::arg("size") = 0.0)
+        .def("add_polyline", &MeshItModel::add_polyline,
+             py::arg("points"), py::arg("name") = "", py::arg("size") = 0.0)
+        .def("add_material", &MeshItModel::add_material, py::arg("locations"))
         .def("set_mesh_quality", &MeshItModel::set_mesh_quality)
         .def("set_mesh_algorithm", &MeshItModel::set_mesh_algorithm)
         .def("enable_constraints", &MeshItModel::enable_constraints)
-        .def("add_polyline", &MeshItModel::add_polyline)
-        .def("add_surface", [](MeshItModel& self, const Surface& surface) {
-            self.surfaces.push_back(surface);
-        })
-        .def("add_triangle", &MeshItModel::add_triangle)
+        .def("pre_mesh_job", &MeshItModel::pre_mesh_job, py::arg("progress_callback") = nullptr)
+        .def("mesh_job", &MeshItModel::mesh_job, py::arg("progress_callback") = nullptr)
+        .def("pre_mesh_async", [](py::object self, const std::function<void(const std::string&)>& progress) {
+            return C_PyJob::start(self, false, progress);
+        }, py::arg("progress_callback") = nullptr,
+           "Starts pre_mesh_job() on a thread of its own and returns a MeshItJob, which can be awaited")
+        .def("mesh_async", [](py::object self, const std::function<void(const std::string&)>& progress) {
+            return C_PyJob::start(self, true, progress);
+        }, py::arg("progress_callback") = nullptr,
+           "Starts mesh_job() on a thread of its own and returns a MeshItJob, which can be awaited")
+        .def("cancel", &MeshItModel::cancel)
+        .def_property_readonly("stage_times", &MeshItModel::get_stage_times,
+                               "(stage, seconds) of the stages of the last job")
         .def("pre_mesh", &MeshItModel::pre_mesh)
-        .def("handle_constraints", &MeshItModel::handle_constraints)
         .def("mesh", &MeshItModel::mesh)
-        .def("mesh_delaunay", &MeshItModel::mesh_delaunay)
-        .def("mesh_advancing_front", &MeshItModel::mesh_advancing_front)
-        .def("mesh_simple", &MeshItModel::mesh_simple)
-        .def("pre_mesh_job", &MeshItModel::pre_mesh_job)
         .def("calculate_surface_surface_intersection", &MeshItModel::calculate_surface_surface_intersection)
         .def("calculate_polyline_surface_intersection", &MeshItModel::calculate_polyline_surface_intersection)
         .def("calculate_size_of_intersections", &MeshItModel::calculate_size_of_intersections)
-        .def("calculate_triple_points", &MeshItModel::calculate_triple_points)
+        .def("calculate_triple_points", &MeshItModel::calculate_all_triple_points,
+             "Triple points of all pairs of intersections, searched segment by segment in an octree")
+        .def("calculate_triple_points", &MeshItModel::calculate_triple_points, py::arg("i1"), py::arg("i2"))
         .def("insert_triple_points", &MeshItModel::insert_triple_points)
         .def("calculate_size_of_constraints", &MeshItModel::calculate_size_of_constraints)
-        .def("export_vtu", &MeshItModel::export_vtu);
+        .def("get_mesh_points", &MeshItModel::get_mesh_points)
+        .def("get_edges", &MeshItModel::get_edges)
+        .def("get_edge_markers", &MeshItModel::get_edge_markers)
+        .def("get_triangles", &MeshItModel::get_triangles)
+        .def("get_triangle_markers", &MeshItModel::get_triangle_markers)
+        .def("get_tetrahedra", &MeshItModel::get_tetrahedra)
+        .def("get_tetrahedron_markers", &MeshItModel::get_tetrahedron_markers)
+        .def("get_surface_points", &MeshItModel::get_surface_points)
+        .def("get_surface_triangles", &MeshItModel::get_surface_triangles)
+        .def("get_polyline_points", &MeshItModel::get_polyline_points)
+        .def("get_intersection_points", &MeshItModel::get_intersection_points)
+        .def("locate_points", &MeshItModel::locate_points, py::arg("points"), py::arg("barycentric") = false,
+             "Tetrahedron enclosing each of the (N,3) points (-1 outside), with (N,4) barycentric coordinates if requested")
+        .def("closest_points", &MeshItModel::closest_points, py::arg("surface"), py::arg("points"),
+             "Closest points (N,3) on the triangulation of a surface, their triangles (N) and distances (N)")
+        .def("intersect_wells", &MeshItModel::intersect_wells, py::arg("wells"), py::arg("surfaces") = std::vector<int>(),
+             "Crossings of (K,3) well trajectories with the triangulated surfaces as a dict of arrays")
+        .def("export_vtu", &MeshItModel::export_vtu)
+        .def("to_bytes", &MeshItModel::to_bytes,
+             "Binary state of the input, the settings and the results of the last job")
+        .def_static("from_bytes", &MeshItModel::from_bytes, py::arg("state"),
+                    "MeshItModel of a state of to_bytes(), read in place from any contiguous buffer")
+        .def(py::pickle(&MeshItModel::to_bytes,
+                        [](const py::bytes& state) { return MeshItModel::from_bytes(py::buffer(state)); }));
     
     // Add helper methods to create surfaces and polylines
-    m.def("create_surface", [](const std::vector<std::vector<double>>& vertices,
-                               const std::vector<std::vector<int>>& triangles,
-                               const std::string& name = "",
-                               const std::string& type = "Default") {
+    m.def("create_surface", [](const PointArray& vertices, const IndexArray& triangles,
+                               const std::string& name, const std::string& type) {
         Surface surface;
         surface.name = name;
         surface.type = type;
-        
-        for (const auto& v : vertices) {
-            if (v.size() >= 3) {
-                surface.vertices.push_back(Vector3D(v[0], v[1], v[2]));
-            }
+        surface.vertices = to_points(vertices);
+        if (triangles.size() != 0) {
+            if (triangles.ndim() != 2 || triangles.shape(1) != 3)
+                throw std::invalid_argument("triangles have to be an (M,3) array");
+            const int* t = triangles.data();
+            for (py::ssize_t i = 0; i != triangles.shape(0); i++)
+                surface.triangles.push_back({t[i * 3 + 0], t[i * 3 + 1], t[i * 3 + 2]});
         }
-        
-        surface.triangles = triangles;
         surface.calculate_min_max();
         return surface;
-    });
+    }, py::arg("vertices"), py::arg("triangles") = IndexArray(), py::arg("name") = "", py::arg("type") = "Default");
     
-    m.def("create_polyline", [](const std::vector<std::vector<double>>& vertices,
-                                const std::string& name = "") {
+    m.def("create_polyline", [](const PointArray& vertices, const std::string& name) {
         Polyline polyline;
         polyline.name = name;
-        
-        for (const auto& v : vertices) {
-            if (v.size() >= 3) {
-                polyline.vertices.push_back(Vector3D(v[0], v[1], v[2]));
-            }
-        }
-        
+        polyline.vertices = to_points(vertices);
         polyline.calculate_min_max();
         return polyline;
-    });
+    }, py::arg("vertices"), py::arg("name") = "");
 
-    // Add standalone function to compute convex hull
-    m.def("compute_convex_hull", [](const std::vector<std::vector<double>>& points) {
-        std::vector<Vector3D> vertices;
-        for (const auto& p : points) {
-            if (p.size() >= 3) {
-                vertices.push_back(Vector3D(p[0], p[1], p[2]));
-            }
-        }
-        
-        std::vector<Vector3D> hull = compute_convex_hull(vertices);
-        
-        // Convert back to list of lists for Python
-        std::vector<std::vector<double>> result;
-        for (const auto& v : hull) {
-            result.push_back({v.x, v.y, v.z});
-        }
-        
-        return result;
-    }, "Compute the convex hull of a set of 3D points");
+    m.def("interpolate", &interpolate, py::arg("scattered_data"), py::arg("xy"), py::arg("method") = "IDW",
+          "z at the (M,2) xy locations of the surface through the (N,3) scattered data (IDW, SPLINE or KRIGING)");
+
+    m.def("compute_convex_hull", [](const PointArray& points) {
+        return to_array(compute_convex_hull(to_points(points)));
+    }, py::arg("points"), "Convex hull (H,3) of the (N,3) scattered data of a surface");
+
+    m.def("unique_points", &unique_points, py::arg("points"), py::arg("tolerance") = 1e-10,
+          "Distinct (K,3) points in the order of their first occurrence and the (N) index of the distinct point of every point");
+
+    m.def("refine_polyline", &refine_polyline, py::arg("points"), py::arg("length"), py::arg("closed") = false,
+          "The (N,3) polyline with points inserted so that its segments are about length long");
+
+    m.def("triangulate_polygon", &triangulate_polygon, py::arg("points"), py::arg("segments") = IndexArray(),
+          py::arg("holes") = py::array_t<double>(), py::arg("min_angle") = 20.0, py::arg("max_area") = 0.0,
+          "Constrained Delaunay triangulation (K,2) vertices and (T,3) triangles of the (N,2) points by Triangle");
 
-    // Update GradientControl bindings
+    // Size control of the refinement, see PyGradientControl
     py::class_<PyGradientControl>(m, "GradientControl")
         .def_static("get_instance", &PyGradientControl::getInstance, py::return_value_policy::reference)
-        .def("update", &PyGradientControl::update)
+        .def("update", &PyGradientControl::update, py::arg("gradient"), py::arg("meshsize"),
+             py::arg("points") = std::vector<std::array<double, 2> >(), py::arg("refine_sizes") = std::vector<double>(),
+             "Sets the gradient, the mesh size and the points (x, y) with their refine sizes")
         .def("get_gradient", &PyGradientControl::getGradient)
         .def("get_mesh_size", &PyGradientControl::getMeshSize)
         .def("get_num_points", &PyGradientControl::getNumPoints)
@@ -0,0 +1,491 @@
+/* MeshIt - a 3D mesh generator for fractured reservoirs
+ *
+ * Copyright (C) 2020
+ *
+ * Mauro Cacace (GFZ, cacace@gfz-potsdam.de),
+ * Guido Bl�cher (GFZ, bloech@gfz-potsdam.de),
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version, complemented with
+ * the following provision:
+ * For the scientific transparency and verification of results obtained
+ * and communicated to the public after using a modified version of the
+ * work, You (as the recipient of the source code and author of this
+ * modified version, used to produce the published results in scientific
+ * communications) commit to make this modified source code available in
+ * a repository that is easily and freely accessible for a duration of
+ * five years after the communication of the obtained results.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "geometry.h"
+#include "query.h"
+
+/* Upper bound of the cells along one axis, 128^3 cells at most. */
+#define GRID_MAX_CELLS 128
+
+C_Grid::C_Grid()
+{
+	for (int d = 0; d != 3; d++)
+	{
+		this->min[d] = this->max[d] = 0.0;
+		this->size[d] = 1.0;
+		this->n[d] = 1;
+	}
+	this->start = QVector<int>(2, 0);
+}
+
+void
+C_Grid::build(const QVector<double> &boxes)
+{
+	const int count = boxes.size() / 6;
+	*this = C_Grid();
+	if (count == 0)
+		return;
+
+	for (int d = 0; d != 3; d++)
+	{
+		this->min[d] = boxes[d];
+		this->max[d] = boxes[3 + d];
+	}
+	for (int i = 1; i != count; i++)
+		for (int d = 0; d != 3; d++)
+		{
+			this->min[d] = qMin(this->min[d], boxes[6 * i + d]);
+			this->max[d] = qMax(this->max[d], boxes[6 * i + 3 + d]);
+		}
+
+	/* about two items per cell, counted over the axes with an extent */
+	double extent[3], largest = 0.0, volume = 1.0;
+	int axes = 0;
+	for (int d = 0; d != 3; d++)
+	{
+		extent[d] = this->max[d] - this->min[d];
+		largest = qMax(largest, extent[d]);
+	}
+	for (int d = 0; d != 3; d++)
+		if (extent[d] > 1e-9 * largest)
+		{
+			axes++;
+			volume *= extent[d];
+		}
+	double h = axes == 0 ? 1.0 : std::pow(volume / qMax(1, count / 2), 1.0 / axes);
+	for (int d = 0; d != 3; d++)
+	{
+		this->n[d] = extent[d] > 1e-9 * largest ? qBound(1, (int)std::ceil(extent[d] / h), GRID_MAX_CELLS) : 1;
+		this->size[d] = extent[d] > 0.0 ? extent[d] / this->n[d] : 1.0;
+	}
+
+	/* counting pass, then filling pass */
+	this->start = QVector<int>(this->n[0] * this->n[1] * this->n[2] + 1, 0);
+	for (int pass = 0; pass != 2; pass++)
+	{
+		QVector<int> next = this->start;
+		for (int i = 0; i != count; i++)
+		{
+			int lo[3], hi[3];
+			this->cellOf(&boxes[6 * i], lo);
+			this->cellOf(&boxes[6 * i + 3], hi);
+			for (int a = lo[0]; a <= hi[0]; a++)
+				for (int b = lo[1]; b <= hi[1]; b++)
+					for (int c = lo[2]; c <= hi[2]; c++)
+					{
+						int cell = (a * this->n[1] + b) * this->n[2] + c;
+						if (pass == 0)
+							this->start[cell + 1]++;
+						else
+							this->index[next[cell]++] = i;
+					}
+		}
+		if (pass == 0)
+		{
+			for (int cell = 0; cell != this->start.size() - 1; cell++)
+				this->start[cell + 1] += this->start[cell];
+			this->index = QVector<int>(this->start.last());
+		}
+	}
+}
+
+bool
+C_Grid::contains(const double p[3], double tolerance) const
+{
+	for (int d = 0; d != 3; d++)
+		if (p[d] < this->min[d] - tolerance || p[d] > this->max[d] + tolerance)
+			return false;
+	return true;
+}
+
+void
+C_Grid::cellOf(const double p[3], int c[3]) const
+{
+	for (int d = 0; d != 3; d++)
+		c[d] = qBound(0, (int)std::floor((p[d] - this->min[d]) / this->size[d]), this->n[d] - 1);
+}
+
+const int *
+C_Grid::items(int i, int j, int k, int *count) const
+{
+	int cell = (i * this->n[1] + j) * this->n[2] + k;
+	*count = this->start[cell + 1] - this->start[cell];
+	return this->index.constData() + this->start[cell];
+}
+
+/* Bound of the cell indices of C_PointHash, far from the limits of qint64. */
+#define POINT_HASH_MAX_CELL 4503599627370496.0	// 2^52
+
+C_PointHash::C_PointHash(double tolerance, double extent)
+{
+	this->tolerance = tolerance;
+	this->cell = std::max(tolerance, std::ldexp(std::fabs(extent), -48));
+	if (!(this->cell > 0.0) || std::isinf(this->cell))
+		this->cell = 1.0;
+}
+
+void
+C_PointHash::cellOf(const double p[3], qint64 c[3]) const
+{
+	// clamped, as points within the tolerance stay in the same or neighbouring cells
+	for (int d = 0; d != 3; d++)
+	{
+		double q = std::floor(p[d] / this->cell);
+		if (!(q > -POINT_HASH_MAX_CELL))
+			q = -POINT_HASH_MAX_CELL;
+		else if (q > POINT_HASH_MAX_CELL)
+			q = POINT_HASH_MAX_CELL;
+		c[d] = (qint64)q;
+	}
+}
+
+quint64
+C_PointHash::key(qint64 i, qint64 j, qint64 k)
+{
+	return ((quint64)i * 73856093u) ^ ((quint64)j * 19349663u) ^ ((quint64)k * 83492791u);
+}
+
+int
+C_PointHash::find(const double p[3]) const
+{
+	const double tolerance2 = this->tolerance * this->tolerance;
+	qint64 c[3];
+	this->cellOf(p, c);
+	int found = -1;
+	for (qint64 i = c[0] - 1; i <= c[0] + 1; i++)
+		for (qint64 j = c[1] - 1; j <= c[1] + 1; j++)
+			for (qint64 k = c[2] - 1; k <= c[2] + 1; k++)
+				for (QMultiHash<quint64, int>::const_iterator it = this->cells.constFind(key(i, j, k)); it != this->cells.constEnd() && it.key() == key(i, j, k); ++it)
+				{
+					if (it.value() < found)
+						continue;
+					const double *q = this->points.constData() + 3 * it.value();
+					double dx = p[0] - q[0], dy = p[1] - q[1], dz = p[2] - q[2];
+					double distance2 = dx * dx + dy * dy + dz * dz;
+					if (distance2 < tolerance2 || distance2 == 0.0)
+						found = it.value();
+				}
+	return found;
+}
+
+int
+C_PointHash::add(const double p[3])
+{
+	const int index = this->count();
+	qint64 c[3];
+	this->cellOf(p, c);
+	this->points.append(p[0]);
+	this->points.append(p[1]);
+	this->points.append(p[2]);
+	this->cells.insert(key(c[0], c[1], c[2]), index);
+	return index;
+}
+
+int
+C_PointHash::insert(const double p[3])
+{
+	int index = this->find(p);
+	return index >= 0 ? index : this->add(p);
+}
+
+int
+C_PointHash::find(const C_Vector3D &p) const
+{
+	const double xyz[3] = { p.x(), p.y(), p.z() };
+	return this->find(xyz);
+}
+
+int
+C_PointHash::add(const C_Vector3D &p)
+{
+	const double xyz[3] = { p.x(), p.y(), p.z() };
+	return this->add(xyz);
+}
+
+int
+C_PointHash::count() const
+{
+	return this->points.size() / 3;
+}
+
+/* Signed volume (times six) of the tetrahedron a, b, c, d. */
+static double volume6(const double *a, const double *b, const double *c, const double *d)
+{
+	double u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+	double v[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+	double w[3] = { d[0] - a[0], d[1] - a[1], d[2] - a[2] };
+	return u[0] * (v[1] * w[2] - v[2] * w[1]) - u[1] * (v[0] * w[2] - v[2] * w[0]) + u[2] * (v[0] * w[1] - v[1] * w[0]);
+}
+
+C_TetLocator::C_TetLocator(const C_Mesh3D &mesh)
+{
+	const int count = (int)mesh.numberoftetrahedra;
+	QVector<double> boxes(6 * count);
+	this->vertices = QVector<double>(12 * count);
+	for (int t = 0; t != count; t++)
+	{
+		double *v = this->vertices.data() + 12 * t;
+		for (int c = 0; c != 4; c++)
+			mesh.getCoordinates(mesh.tetrahedronlist[4 * t + c], v + 3 * c);
+		for (int d = 0; d != 3; d++)
+		{
+			boxes[6 * t + d] = qMin(qMin(v[d], v[3 + d]), qMin(v[6 + d], v[9 + d]));
+			boxes[6 * t + 3 + d] = qMax(qMax(v[d], v[3 + d]), qMax(v[6 + d], v[9 + d]));
+		}
+	}
+	this->grid.build(boxes);
+}
+
+int
+C_TetLocator::locate(const double p[3], double barycentric[4]) const
+{
+	const double tolerance = 1e-12;
+	if (this->vertices.isEmpty() || !this->grid.contains(p, tolerance))
+		return -1;
+	int c[3], count;
+	this->grid.cellOf(p, c);
+	const int *items = this->grid.items(c[0], c[1], c[2], &count);
+	for (int i = 0; i != count; i++)
+	{
+		const double *v = this->vertices.constData() + 12 * items[i];
+		double total = volume6(v, v + 3, v + 6, v + 9);
+		if (total == 0.0)
+			continue;
+		double w[4] = {
+			volume6(p, v + 3, v + 6, v + 9) / total,
+			volume6(v, p, v + 6, v + 9) / total,
+			volume6(v, v + 3, p, v + 9) / total,
+			volume6(v, v + 3, v + 6, p) / total
+		};
+		if (w[0] >= -tolerance && w[1] >= -tolerance && w[2] >= -tolerance && w[3] >= -tolerance)
+		{
+			if (barycentric)
+				for (int k = 0; k != 4; k++)
+					barycentric[k] = w[k];
+			return items[i];
+		}
+	}
+	return -1;
+}
+
+C_TriangleLocator::C_TriangleLocator(const C_Surface &surface)
+{
+	const int count = surface.Ts.length();
+	QVector<double> boxes(6 * count);
+	this->vertices = QVector<double>(9 * count);
+	for (int t = 0; t != count; t++)
+	{
+		double *v = this->vertices.data() + 9 * t;
+		for (int c = 0; c != 3; c++)
+		{
+			v[3 * c + 0] = surface.Ts[t].Ns[c]->x();
+			v[3 * c + 1] = surface.Ts[t].Ns[c]->y();
+			v[3 * c + 2] = surface.Ts[t].Ns[c]->z();
+		}
+		for (int d = 0; d != 3; d++)
+		{
+			boxes[6 * t + d] = qMin(v[d], qMin(v[3 + d], v[6 + d]));
+			boxes[6 * t + 3 + d] = qMax(v[d], qMax(v[3 + d], v[6 + d]));
+		}
+	}
+	this->grid.build(boxes);
+}
+
+bool
+C_TriangleLocator::isEmpty() const
+{
+	return this->vertices.isEmpty();
+}
+
+/* Closest point on the triangle a, b, c to p (Ericson, Real-Time Collision
+ * Detection, 5.1.5), by the region of p relative to the vertices and edges. */
+static void closestOnTriangle(const double *p, const double *a, const double *b, const double *c, double *q)
+{
+	double ab[3], ac[3], ap[3], bp[3], cp[3];
+	for (int d = 0; d != 3; d++)
+	{
+		ab[d] = b[d] - a[d];
+		ac[d] = c[d] - a[d];
+		ap[d] = p[d] - a[d];
+		bp[d] = p[d] - b[d];
+		cp[d] = p[d] - c[d];
+	}
+	double d1 = ab[0] * ap[0] + ab[1] * ap[1] + ab[2] * ap[2];
+	double d2 = ac[0] * ap[0] + ac[1] * ap[1] + ac[2] * ap[2];
+	double d3 = ab[0] * bp[0] + ab[1] * bp[1] + ab[2] * bp[2];
+	double d4 = ac[0] * bp[0] + ac[1] * bp[1] + ac[2] * bp[2];
+	double d5 = ab[0] * cp[0] + ab[1] * cp[1] + ab[2] * cp[2];
+	double d6 = ac[0] * cp[0] + ac[1] * cp[1] + ac[2] * cp[2];
+	double s = 0.0, t = 0.0;
+	double va = d3 * d6 - d5 * d4, vb = d5 * d2 - d1 * d6, vc = d1 * d4 - d3 * d2;
+	if (d1 <= 0.0 && d2 <= 0.0)
+		;	// vertex a
+	else if (d3 >= 0.0 && d4 <= d3)
+		s = 1.0;	// vertex b
+	else if (d6 >= 0.0 && d5 <= d6)
+		t = 1.0;	// vertex c
+	else if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+		s = d1 / (d1 - d3);	// edge ab
+	else if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+		t = d2 / (d2 - d6);	// edge ac
+	else if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0)
+	{
+		t = (d4 - d3) / ((d4 - d3) + (d5 - d6));	// edge bc
+		s = 1.0 - t;
+	}
+	else
+	{
+		double denom = 1.0 / (va + vb + vc);	// inside
+		s = vb * denom;
+		t = vc * denom;
+	}
+	for (int d = 0; d != 3; d++)
+		q[d] = a[d] + s * ab[d] + t * ac[d];
+}
+
+/* The cells are searched in shells around the cell of p, until the closest
+ * point found is nearer than any cell outside the searched shells. */
+int
+C_TriangleLocator::closest(const double p[3], double point[3]) const
+{
+	if (this->vertices.isEmpty())
+		return -1;
+	const C_Grid &g = this->grid;
+	const double cell = qMin(g.size[0], qMin(g.size[1], g.size[2]));
+	const int shells = qMax(g.n[0], qMax(g.n[1], g.n[2]));
+	int c[3];
+	g.cellOf(p, c);
+	int best = -1;
+	double bestDistance = std::numeric_limits<double>::max();
+	for (int r = 0; r <= shells; r++)
+	{
+		for (int i = qMax(0, c[0] - r); i <= qMin(g.n[0] - 1, c[0] + r); i++)
+			for (int j = qMax(0, c[1] - r); j <= qMin(g.n[1] - 1, c[1] + r); j++)
+				for (int k = qMax(0, c[2] - r); k <= qMin(g.n[2] - 1, c[2] + r); k++)
+				{
+					if (qAbs(i - c[0]) != r && qAbs(j - c[1]) != r && qAbs(k - c[2]) != r)
+						continue;	// searched in a previous shell
+					int count;
+					const int *items = g.items(i, j, k, &count);
+					for (int n = 0; n != count; n++)
+					{
+						const double *v = this->vertices.constData() + 9 * items[n];
+						double q[3];
+						closestOnTriangle(p, v, v + 3, v + 6, q);
+						double distance = (q[0] - p[0]) * (q[0] - p[0]) + (q[1] - p[1]) * (q[1] - p[1]) + (q[2] - p[2]) * (q[2] - p[2]);
+						if (distance < bestDistance || (distance == bestDistance && items[n] < best))
+						{
+							bestDistance = distance;
+							best = items[n];
+							point[0] = q[0];
+							point[1] = q[1];
+							point[2] = q[2];
+						}
+					}
+				}
+		/* all triangles beyond the shells are at least r cells away */
+		if (best != -1 && std::sqrt(bestDistance) <= r * cell)
+			break;
+	}
+	return best;
+}
+
+/* Segment-triangle crossing (Moeller-Trumbore), the parameter of the segment
+ * is returned in t. */
+static bool crossesTriangle(const double *a, const double *b, const double *v0, const double *v1, const double *v2, double *t)
+{
+	const double epsilon = 1e-14;
+	double dir[3], e1[3], e2[3], s[3];
+	for (int d = 0; d != 3; d++)
+	{
+		dir[d] = b[d] - a[d];
+		e1[d] = v1[d] - v0[d];
+		e2[d] = v2[d] - v0[d];
+		s[d] = a[d] - v0[d];
+	}
+	double h[3] = { dir[1] * e2[2] - dir[2] * e2[1], dir[2] * e2[0] - dir[0] * e2[2], dir[0] * e2[1] - dir[1] * e2[0] };
+	double det = e1[0] * h[0] + e1[1] * h[1] + e1[2] * h[2];
+	if (std::fabs(det) < epsilon)
+		return false;	// parallel to the triangle
+	double inv = 1.0 / det;
+	double u = inv * (s[0] * h[0] + s[1] * h[1] + s[2] * h[2]);
+	if (u < -epsilon || u > 1.0 + epsilon)
+		return false;
+	double q[3] = { s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0] };
+	double v = inv * (dir[0] * q[0] + dir[1] * q[1] + dir[2] * q[2]);
+	if (v < -epsilon || u + v > 1.0 + epsilon)
+		return false;
+	*t = inv * (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]);
+	return *t >= -epsilon && *t <= 1.0 + epsilon;
+}
+
+void
+C_TriangleLocator::intersect(const double a[3], const double b[3], QList<QPair<double, int> > *hits) const
+{
+	if (this->vertices.isEmpty())
+		return;
+	double lo[3], hi[3];
+	for (int d = 0; d != 3; d++)
+	{
+		lo[d] = qMin(a[d], b[d]);
+		hi[d] = qMax(a[d], b[d]);
+		if (hi[d] < this->grid.min[d] || lo[d] > this->grid.max[d])
+			return;
+	}
+	int clo[3], chi[3];
+	this->grid.cellOf(lo, clo);
+	this->grid.cellOf(hi, chi);
+	/* a triangle overlapping several cells is tested once */
+	QVector<int> candidates;
+	for (int i = clo[0]; i <= chi[0]; i++)
+		for (int j = clo[1]; j <= chi[1]; j++)
+			for (int k = clo[2]; k <= chi[2]; k++)
+			{
+				int count;
+				const int *items = this->grid.items(i, j, k, &count);
+				for (int n = 0; n != count; n++)
+					candidates.append(items[n]);
+			}
+	std::sort(candidates.begin(), candidates.end());
+	candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+	const int first = hits->length();
+	for (int n = 0; n != candidates.size(); n++)
+	{
+		const double *v = this->vertices.constData() + 9 * candidates[n];
+		double t;
+		if (crossesTriangle(a, b, v, v + 3, v + 6, &t))
+			hits->append(qMakePair(qBound(0.0, t, 1.0), candidates[n]));
+	}
+	std::sort(hits->begin() + first, hits->end());
+}
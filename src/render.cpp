@@ -0,0 +1,787 @@
+/* MeshIt - a 3D mesh generator for fractured reservoirs
+ *
+ * Copyright (C) 2020
+ *
+ * Mauro Cacace (GFZ, cacace@gfz-potsdam.de),
+ * Guido Bl�cher (GFZ, bloech@gfz-potsdam.de),
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version, complemented with
+ * the following provision:
+ * For the scientific transparency and verification of results obtained
+ * and communicated to the public after using a modified version of the
+ * work, You (as the recipient of the source code and author of this
+ * modified version, used to produce the published results in scientific
+ * communications) commit to make this modified source code available in
+ * a repository that is easily and freely accessible for a duration of
+ * five years after the communication of the obtained results.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <vector>
+
+#include <QtGui/QOpenGLContext>
+#include <QtGui/QOpenGLFunctions>
+
+#include "render.h"
+
+/********** Class C_RenderBuffer **********/
+
+C_RenderBuffer::C_RenderBuffer(Primitive primitive)
+{
+	this->primitive = primitive;
+	this->material = true;
+	this->unlit = false;
+	this->stippled = false;
+	this->width = 0.0f;
+}
+
+void C_RenderBuffer::clear()
+{
+	positions.clear();
+	normals.clear();
+	colors.clear();
+	indices.clear();
+	keys.clear();
+	lines.clear();
+}
+
+void C_RenderBuffer::reserve(int vertices, int primitives)
+{
+	positions.reserve(3 * vertices);
+	colors.reserve(4 * vertices);
+	if (primitive == TRIANGLES)
+		normals.reserve(3 * vertices);
+	indices.reserve((primitive == TRIANGLES ? 3 : primitive == LINES ? 2 : 1) * primitives);
+}
+
+quint32 C_RenderBuffer::addVertex(const double p[3], const float color[4])
+{
+	quint32 index = quint32(positions.size() / 3);
+	for (int i = 0; i != 3; i++)
+		positions.append(float(p[i]));
+	for (int i = 0; i != 4; i++)
+		colors.append(color[i]);
+	return index;
+}
+
+quint32 C_RenderBuffer::addVertex(const double p[3], const double normal[3], const float color[4])
+{
+	for (int i = 0; i != 3; i++)
+		normals.append(float(normal[i]));
+	return addVertex(p, color);
+}
+
+quint32 C_RenderBuffer::sharedVertex(quint64 key, const double p[3], const float color[4])
+{
+	QHash<quint64, quint32>::const_iterator it = keys.constFind(key);
+	if (it != keys.constEnd())
+		return it.value();
+	quint32 index = addVertex(p, color);
+	keys.insert(key, index);
+	return index;
+}
+
+void C_RenderBuffer::addPoint(quint32 a)
+{
+	indices.append(a);
+}
+
+void C_RenderBuffer::addLine(quint32 a, quint32 b)
+{
+	indices.append(a);
+	indices.append(b);
+}
+
+void C_RenderBuffer::addUniqueLine(quint32 a, quint32 b)
+{
+	quint64 key = a < b ? (quint64(a) << 32) | b : (quint64(b) << 32) | a;
+	if (lines.contains(key))
+		return;
+	lines.insert(key);
+	addLine(a, b);
+}
+
+void C_RenderBuffer::addTriangle(quint32 a, quint32 b, quint32 c)
+{
+	indices.append(a);
+	indices.append(b);
+	indices.append(c);
+}
+
+int C_RenderBuffer::vertexCount() const
+{
+	return positions.size() / 3;
+}
+
+int C_RenderBuffer::primitiveCount() const
+{
+	return indices.size() / (primitive == TRIANGLES ? 3 : primitive == LINES ? 2 : 1);
+}
+
+bool C_RenderBuffer::isEmpty() const
+{
+	return indices.isEmpty();
+}
+
+bool C_RenderBuffer::hasNormals() const
+{
+	return !normals.isEmpty() && normals.size() == positions.size();
+}
+
+/********** Class C_GLBuffer **********/
+
+quint64 C_GLBuffer::changes = 0;
+
+quint64 C_GLBuffer::generation()
+{
+	return changes;
+}
+
+C_GLBuffer::C_GLBuffer()
+{
+	clear();
+}
+
+void C_GLBuffer::clear()
+{
+	vertexBuffer = 0;
+	indexBuffer = 0;
+	mode = GL_TRIANGLES;
+	count = 0;
+	vertices = 0;
+	normals = false;
+	material = true;
+	unlit = false;
+	stippled = false;
+	width = 0.0f;
+}
+
+void C_GLBuffer::upload(const C_RenderBuffer &buffer)
+{
+	QOpenGLContext *context = QOpenGLContext::currentContext();
+	if (!context)
+		return;
+	QOpenGLFunctions *gl = context->functions();
+
+	mode = buffer.primitive == C_RenderBuffer::POINTS ? GL_POINTS : buffer.primitive == C_RenderBuffer::LINES ? GL_LINES : GL_TRIANGLES;
+	count = GLsizei(buffer.indices.size());
+	vertices = GLsizei(buffer.vertexCount());
+	normals = buffer.hasNormals();
+	material = buffer.material;
+	unlit = buffer.unlit;
+	stippled = buffer.stippled;
+	width = buffer.width;
+	changes++;
+	if (vertices == 0) {
+		count = 0;
+		return;
+	}
+
+	if (!vertexBuffer)
+		gl->glGenBuffers(1, &vertexBuffer);
+	if (!indexBuffer)
+		gl->glGenBuffers(1, &indexBuffer);
+
+	/* positions, normals and colours back to back in one buffer */
+	qopengl_GLsizeiptr positionSize = buffer.positions.size() * sizeof(float);
+	qopengl_GLsizeiptr normalSize = normals ? buffer.normals.size() * sizeof(float) : 0;
+	qopengl_GLsizeiptr colorSize = buffer.colors.size() * sizeof(float);
+	gl->glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	gl->glBufferData(GL_ARRAY_BUFFER, positionSize + normalSize + colorSize, NULL, GL_STATIC_DRAW);
+	gl->glBufferSubData(GL_ARRAY_BUFFER, 0, positionSize, buffer.positions.constData());
+	if (normals)
+		gl->glBufferSubData(GL_ARRAY_BUFFER, positionSize, normalSize, buffer.normals.constData());
+	gl->glBufferSubData(GL_ARRAY_BUFFER, positionSize + normalSize, colorSize, buffer.colors.constData());
+	gl->glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	uploadIndices(buffer.indices);
+}
+
+void C_GLBuffer::uploadIndices(const QVector<quint32> &indices)
+{
+	QOpenGLContext *context = QOpenGLContext::currentContext();
+	count = 0;
+	changes++;
+	if (!context || !indexBuffer)
+		return;
+	QOpenGLFunctions *gl = context->functions();
+
+	count = GLsizei(indices.size());
+	gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	gl->glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(quint32), indices.constData(), GL_DYNAMIC_DRAW);
+	gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void C_GLBuffer::draw() const
+{
+	QOpenGLContext *context = QOpenGLContext::currentContext();
+	if (count == 0 || !context)
+		return;
+	QOpenGLFunctions *gl = context->functions();
+	const GLfloat white[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+	/* Without lighting a material has no effect, the primitives get the
+	 * current colour as they did with glMaterial. */
+	bool colors = !material || glIsEnabled(GL_LIGHTING);
+
+	glPushAttrib(GL_ENABLE_BIT | GL_LIGHTING_BIT | GL_POINT_BIT | GL_LINE_BIT);
+	glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+	if (unlit) {
+		glDisable(GL_LIGHT0);
+		glLightModelfv(GL_LIGHT_MODEL_AMBIENT, white);
+	}
+	if (stippled)
+		glEnable(GL_LINE_STIPPLE);
+	if (width > 0.0f) {
+		glPointSize(width);
+		glLineWidth(width);
+	}
+
+	gl->glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(3, GL_FLOAT, 0, (const GLvoid *)0);
+	if (normals) {
+		glEnableClientState(GL_NORMAL_ARRAY);
+		glNormalPointer(GL_FLOAT, 0, (const GLvoid *)(3 * vertices * sizeof(float)));
+	}
+	if (colors) {
+		if (material) {
+			glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
+			glEnable(GL_COLOR_MATERIAL);
+		}
+		glEnableClientState(GL_COLOR_ARRAY);
+		glColorPointer(4, GL_FLOAT, 0, (const GLvoid *)((normals ? 6 : 3) * vertices * sizeof(float)));
+	}
+	glDrawElements(mode, count, GL_UNSIGNED_INT, (const GLvoid *)0);
+	gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	gl->glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glPopClientAttrib();
+	glPopAttrib();
+
+	/* The current colour is undefined after a colour array, it is left black
+	 * so that unlit objects drawn later do not take e.g. a selection colour. */
+	if (colors)
+		glColor3f(0.0f, 0.0f, 0.0f);
+}
+
+void C_GLBuffer::release()
+{
+	QOpenGLContext *context = QOpenGLContext::currentContext();
+	if (context) {
+		QOpenGLFunctions *gl = context->functions();
+		if (vertexBuffer)
+			gl->glDeleteBuffers(1, &vertexBuffer);
+		if (indexBuffer)
+			gl->glDeleteBuffers(1, &indexBuffer);
+	}
+	clear();
+	changes++;
+}
+
+/********** Class C_CutIndex **********/
+
+/* Kinds of shown elements and boundaries: faces and edges. */
+#define CUT_FACES 0
+#define CUT_EDGES 1
+
+C_CutIndex::C_CutIndex()
+{
+	clear();
+}
+
+void C_CutIndex::clear()
+{
+	centroids.clear();
+	groups.clear();
+	for (int a = 0; a != 3; a++)
+		order[a].clear();
+	faceStart = QVector<int>(1, 0);
+	states.clear();
+	faces.clear();
+	faceLines.clear();
+	owners.clear();
+	opposites.clear();
+	for (int k = 0; k != 2; k++) {
+		boundaryIndex[k].clear();
+		boundary[k].clear();
+	}
+	lines.clear();
+	lineKeys.clear();
+	sharedFaces.clear();
+	showFaces.clear();
+	showEdges.clear();
+	selected = false;
+	finished = false;
+}
+
+void C_CutIndex::addElement(const double centroid[3], int group)
+{
+	for (int a = 0; a != 3; a++)
+		centroids.append(float(centroid[a]));
+	groups.append(group);
+	faceStart.append(faces.size());
+}
+
+int C_CutIndex::line(quint32 a, quint32 b)
+{
+	quint64 key = a < b ? (quint64(a) << 32) | b : (quint64(b) << 32) | a;
+	int index = lineKeys.value(key, -1);
+	if (index == -1) {
+		index = lines.size() / 2;
+		lines.append(a);
+		lines.append(b);
+		lineKeys.insert(key, index);
+	}
+	return index;
+}
+
+void C_CutIndex::addFace(quint32 face, const quint32 edge[3])
+{
+	faces.append(face);
+	for (int k = 0; k != 3; k++)
+		faceLines.append(line(edge[k], edge[(k + 1) % 3]));
+	owners.append(groups.size() - 1);
+	opposites.append(-1);
+	faceStart.last() = faces.size();
+}
+
+void C_CutIndex::addFace(quint32 face, const quint32 edge[3], const quint32 points[3])
+{
+	SharedFace shared;
+	for (int k = 0; k != 3; k++)
+		shared.points[k] = points[k];
+	std::sort(shared.points, shared.points + 3);
+	shared.face = faces.size();
+	sharedFaces.append(shared);
+	addFace(face, edge);
+}
+
+void C_CutIndex::finish()
+{
+	const float *c = centroids.constData();
+	for (int a = 0; a != 3; a++) {
+		order[a].resize(count());
+		for (int e = 0; e != count(); e++)
+			order[a][e] = e;
+		std::stable_sort(order[a].begin(), order[a].end(), [c, a](int i, int j) { return c[3 * i + a] < c[3 * j + a]; });
+	}
+
+	/* Shared triangles with the same points are next to each other once
+	 * sorted, a triangle of a proper mesh is shared by two elements at most. */
+	std::sort(sharedFaces.begin(), sharedFaces.end(), [](const SharedFace &f, const SharedFace &g) {
+		return std::lexicographical_compare(f.points, f.points + 3, g.points, g.points + 3);
+	});
+	for (int f = 1; f < sharedFaces.size(); f++) {
+		const SharedFace &a = sharedFaces[f - 1];
+		const SharedFace &b = sharedFaces[f];
+		if (std::equal(a.points, a.points + 3, b.points) && opposites[a.face] == -1) {
+			opposites[a.face] = b.face;
+			opposites[b.face] = a.face;
+		}
+	}
+
+	states = QVector<char>(count(), 0);
+	for (int k = 0; k != 2; k++)
+		boundaryIndex[k] = QVector<int>(faces.size(), -1);
+	lineKeys.clear();
+	sharedFaces.clear();
+	sharedFaces.squeeze();
+	finished = true;
+}
+
+bool C_CutIndex::isFinished() const
+{
+	return finished;
+}
+
+int C_CutIndex::count() const
+{
+	return groups.size();
+}
+
+/* Range [first,last) of the elements sorted along axis with from <= c <= to. */
+void C_CutIndex::range(int axis, float from, float to, int &first, int &last) const
+{
+	const float *c = centroids.constData();
+	const QVector<int> &sorted = order[axis];
+	first = int(std::lower_bound(sorted.begin(), sorted.end(), from, [c, axis](int i, float v) { return c[3 * i + axis] < v; }) - sorted.begin());
+	last = int(std::upper_bound(sorted.begin(), sorted.end(), to, [c, axis](float v, int i) { return v < c[3 * i + axis]; }) - sorted.begin());
+}
+
+/* Shown kinds of an element with the last selection, a bit per kind. */
+char C_CutIndex::stateOf(int element) const
+{
+	const float *c = centroids.constData() + 3 * element;
+	for (int a = 0; a != 3; a++)
+		if (enable[a] && (direction[a] ? c[a] < cut[a] : c[a] > cut[a]))
+			return 0;
+	int g = groups[element];
+	char state = 0;
+	if (g >= 0 && g < showFaces.size() && showFaces[g])
+		state |= 1 << CUT_FACES;
+	if (g >= 0 && g < showEdges.size() && showEdges[g])
+		state |= 1 << CUT_EDGES;
+	return state;
+}
+
+bool C_CutIndex::isBoundary(int face, int kind) const
+{
+	int e = owners[face];
+	if (!(states[e] & (1 << kind)))
+		return false;
+	int opposite = opposites[face];
+	if (opposite == -1)
+		return true;
+	int n = owners[opposite];
+	return !(states[n] & (1 << kind)) || groups[n] != groups[e];
+}
+
+/* Adds the triangle to or removes it from the boundaries. */
+void C_CutIndex::updateFace(int face)
+{
+	for (int k = 0; k != 2; k++) {
+		int &index = boundaryIndex[k][face];
+		bool onBoundary = isBoundary(face, k);
+		if (onBoundary && index == -1) {
+			index = boundary[k].size();
+			boundary[k].append(face);
+		} else if (!onBoundary && index != -1) {
+			int moved = boundary[k].last();
+			boundary[k][index] = moved;
+			boundaryIndex[k][moved] = index;
+			boundary[k].removeLast();
+			index = -1;
+		}
+	}
+}
+
+void C_CutIndex::updateElement(int element, char state)
+{
+	if (states[element] == state)
+		return;
+	states[element] = state;
+	for (int f = faceStart[element]; f != faceStart[element + 1]; f++) {
+		updateFace(f);
+		if (opposites[f] != -1)
+			updateFace(opposites[f]);
+	}
+}
+
+void C_CutIndex::select(const bool enable[3], const double value[3], const bool direction[3], const QVector<bool> &showFaces, const QVector<bool> &showEdges, QVector<quint32> &faceIndices, QVector<quint32> &edgeIndices)
+{
+	faceIndices.clear();
+	edgeIndices.clear();
+	if (!finished)
+		return;
+
+	float previous[3];
+	bool incremental = selected && showFaces == this->showFaces && showEdges == this->showEdges;
+	for (int a = 0; a != 3; a++) {
+		incremental = incremental && enable[a] == this->enable[a] && (!enable[a] || direction[a] == this->direction[a]);
+		previous[a] = this->cut[a];
+		this->enable[a] = enable[a];
+		this->cut[a] = float(value[a]);
+		this->direction[a] = direction[a];
+	}
+	this->showFaces = showFaces;
+	this->showEdges = showEdges;
+	selected = true;
+
+	int first, last;
+	if (incremental) {
+		/* only the elements between the previous and the new cut values
+		 * can change */
+		for (int a = 0; a != 3; a++) {
+			if (!enable[a] || previous[a] == cut[a])
+				continue;
+			range(a, qMin(previous[a], cut[a]), qMax(previous[a], cut[a]), first, last);
+			for (int i = first; i != last; i++)
+				updateElement(order[a][i], stateOf(order[a][i]));
+		}
+	} else {
+		/* the elements kept by the most selective plane */
+		int axis = -1;
+		int from = 0, to = count();
+		for (int a = 0; a != 3; a++) {
+			if (!enable[a])
+				continue;
+			if (direction[a])
+				range(a, cut[a], std::numeric_limits<float>::infinity(), first, last);
+			else
+				range(a, -std::numeric_limits<float>::infinity(), cut[a], first, last);
+			if (axis == -1 || last - first < to - from) {
+				axis = a;
+				from = first;
+				to = last;
+			}
+		}
+		states.fill(0);
+		for (int k = 0; k != 2; k++) {
+			boundaryIndex[k].fill(-1);
+			boundary[k].clear();
+		}
+		QVector<int> shown;
+		for (int i = from; i != to; i++) {
+			int e = axis == -1 ? i : order[axis][i];
+			states[e] = stateOf(e);
+			if (states[e])
+				shown.append(e);
+		}
+		for (int i = 0; i != shown.size(); i++)
+			for (int f = faceStart[shown[i]]; f != faceStart[shown[i] + 1]; f++)
+				updateFace(f);
+	}
+
+	faceIndices.reserve(3 * boundary[CUT_FACES].size());
+	for (int i = 0; i != boundary[CUT_FACES].size(); i++) {
+		quint32 face = faces[boundary[CUT_FACES][i]];
+		faceIndices.append(face);
+		faceIndices.append(face + 1);
+		faceIndices.append(face + 2);
+	}
+	std::vector<char> done(lines.size() / 2, 0);
+	for (int i = 0; i != boundary[CUT_EDGES].size(); i++) {
+		int face = boundary[CUT_EDGES][i];
+		for (int k = 0; k != 3; k++) {
+			int l = faceLines[3 * face + k];
+			if (done[l])
+				continue;
+			done[l] = 1;
+			edgeIndices.append(lines[2 * l]);
+			edgeIndices.append(lines[2 * l + 1]);
+		}
+	}
+}
+
+/********** Class C_PointLOD **********/
+
+/* Cells per axis of the sample grid of a node, nodes with at most
+ * LOD_LEAF_POINTS points and nodes at depth LOD_DEPTH keep all their points. */
+#define LOD_GRID 16
+#define LOD_LEAF_POINTS 512
+#define LOD_DEPTH 20
+
+C_PointLOD::C_PointLOD()
+{
+	clear();
+}
+
+void C_PointLOD::clear()
+{
+	nodes.clear();
+	points.clear();
+	selected.clear();
+	hasSelection = false;
+}
+
+void C_PointLOD::build(const QVector<float> &positions)
+{
+	clear();
+	int n = positions.size() / 3;
+	if (n == 0)
+		return;
+
+	float lower[3], upper[3];
+	for (int a = 0; a != 3; a++)
+		lower[a] = upper[a] = positions[a];
+	for (int i = 1; i != n; i++)
+		for (int a = 0; a != 3; a++) {
+			lower[a] = qMin(lower[a], positions[3 * i + a]);
+			upper[a] = qMax(upper[a], positions[3 * i + a]);
+		}
+
+	Node root;
+	root.half = 0.0f;
+	for (int a = 0; a != 3; a++) {
+		root.center[a] = 0.5f * (lower[a] + upper[a]);
+		root.half = qMax(root.half, 0.5f * (upper[a] - lower[a]));
+	}
+	/* a margin keeps the points on the upper faces inside */
+	root.half = qMax(1.001f * root.half, std::numeric_limits<float>::min());
+	root.first = 0;
+	root.count = 0;
+	root.end = n;
+	std::fill(root.children, root.children + 8, -1);
+	nodes.append(root);
+
+	points.resize(n);
+	for (int i = 0; i != n; i++)
+		points[i] = quint32(i);
+	QVector<quint32> scratch(n);
+	split(0, 0, positions, scratch);
+	nodes.squeeze();
+}
+
+void C_PointLOD::split(int node, int depth, const QVector<float> &positions, QVector<quint32> &scratch)
+{
+	const Node n = nodes[node];
+	if (n.end - n.first <= LOD_LEAF_POINTS || depth == LOD_DEPTH) {
+		nodes[node].count = n.end - n.first;
+		return;
+	}
+
+	/* sample: the first point in every cell of the grid */
+	std::vector<char> cells(LOD_GRID * LOD_GRID * LOD_GRID, 0);
+	float scale = LOD_GRID / (2.0f * n.half);
+	int sample = n.first;
+	for (int i = n.first; i != n.end; i++) {
+		const float *p = positions.constData() + 3 * points[i];
+		int cell = 0;
+		for (int a = 0; a != 3; a++)
+			cell = LOD_GRID * cell + qBound(0, int((p[a] - n.center[a] + n.half) * scale), LOD_GRID - 1);
+		if (!cells[cell]) {
+			cells[cell] = 1;
+			std::swap(points[i], points[sample++]);
+		}
+	}
+	nodes[node].count = sample - n.first;
+
+	/* the other points by octant */
+	int counts[8] = { 0 };
+	for (int i = sample; i != n.end; i++) {
+		const float *p = positions.constData() + 3 * points[i];
+		counts[(p[0] >= n.center[0]) | (p[1] >= n.center[1]) << 1 | (p[2] >= n.center[2]) << 2]++;
+	}
+	int offsets[8];
+	offsets[0] = sample;
+	for (int c = 1; c != 8; c++)
+		offsets[c] = offsets[c - 1] + counts[c - 1];
+	int next[8];
+	std::copy(offsets, offsets + 8, next);
+	for (int i = sample; i != n.end; i++) {
+		const float *p = positions.constData() + 3 * points[i];
+		scratch[next[(p[0] >= n.center[0]) | (p[1] >= n.center[1]) << 1 | (p[2] >= n.center[2]) << 2]++] = points[i];
+	}
+	std::copy(scratch.constBegin() + sample, scratch.constBegin() + n.end, points.begin() + sample);
+
+	for (int c = 0; c != 8; c++) {
+		if (counts[c] == 0)
+			continue;
+		Node child;
+		child.half = 0.5f * n.half;
+		for (int a = 0; a != 3; a++)
+			child.center[a] = n.center[a] + ((c >> a) & 1 ? child.half : -child.half);
+		child.first = offsets[c];
+		child.count = 0;
+		child.end = offsets[c] + counts[c];
+		std::fill(child.children, child.children + 8, -1);
+		nodes[node].children[c] = nodes.size();
+		nodes.append(child);
+		split(nodes[node].children[c], depth + 1, positions, scratch);
+	}
+}
+
+const QVector<quint32> &C_PointLOD::order() const
+{
+	return points;
+}
+
+int C_PointLOD::count() const
+{
+	return points.size();
+}
+
+int C_PointLOD::nodeCount() const
+{
+	return nodes.size();
+}
+
+bool C_PointLOD::select(const double projection[16], const double modelview[16], int height, int budget)
+{
+	/* rows of the product of projection and modelview */
+	double m[4][4];
+	for (int r = 0; r != 4; r++)
+		for (int c = 0; c != 4; c++) {
+			m[r][c] = 0.0;
+			for (int k = 0; k != 4; k++)
+				m[r][c] += projection[4 * k + r] * modelview[4 * c + k];
+		}
+
+	/* frustum planes w+x, w-x, w+y, w-y, w+z and w-z, normalized */
+	double planes[6][4];
+	for (int p = 0; p != 6; p++) {
+		double sign = p % 2 ? -1.0 : 1.0;
+		double length = 0.0;
+		for (int c = 0; c != 4; c++) {
+			planes[p][c] = m[3][c] + sign * m[p / 2][c];
+			if (c != 3)
+				length += planes[p][c] * planes[p][c];
+		}
+		length = length > 0.0 ? ::sqrt(length) : 1.0;
+		for (int c = 0; c != 4; c++)
+			planes[p][c] /= length;
+	}
+	/* pixels per unit of length at w = 1 */
+	double pixels = 0.5 * height * ::sqrt(m[1][0] * m[1][0] + m[1][1] * m[1][1] + m[1][2] * m[1][2]);
+
+	bool perspective = m[3][0] != 0.0 || m[3][1] != 0.0 || m[3][2] != 0.0;
+
+	/* size of the node on the screen in pixels, -1 if it is outside the frustum */
+	auto screenSize = [&](const Node &node) {
+		double radius = ::sqrt(3.0) * node.half;
+		for (int p = 0; p != 6; p++)
+			if (planes[p][0] * node.center[0] + planes[p][1] * node.center[1] + planes[p][2] * node.center[2] + planes[p][3] < -radius)
+				return -1.0;
+		double w = m[3][0] * node.center[0] + m[3][1] * node.center[1] + m[3][2] * node.center[2] + m[3][3];
+		/* a node around the eye of a perspective view covers the screen */
+		if (perspective && w <= radius)
+			return std::numeric_limits<double>::max();
+		return 2.0 * node.half * pixels / w;
+	};
+
+	QVector<quint32> indices;
+	indices.reserve(qMin(budget, points.size()));
+	std::priority_queue<std::pair<double, int> > queue;
+	if (!nodes.isEmpty()) {
+		double size = screenSize(nodes[0]);
+		if (size >= 0.0)
+			queue.push(std::make_pair(size, 0));
+	}
+	while (!queue.empty() && indices.size() < budget) {
+		double size = queue.top().first;
+		const Node &node = nodes[queue.top().second];
+		queue.pop();
+
+		int take = qMin(node.count, budget - int(indices.size()));
+		for (int i = 0; i != take; i++)
+			indices.append(quint32(node.first + i));
+
+		/* the children only add points if the cells of the sample are larger than a pixel */
+		if (size <= LOD_GRID)
+			continue;
+		for (int c = 0; c != 8; c++) {
+			if (node.children[c] < 0)
+				continue;
+			double childSize = screenSize(nodes[node.children[c]]);
+			if (childSize >= 0.0)
+				queue.push(std::make_pair(childSize, node.children[c]));
+		}
+	}
+
+	bool changed = !hasSelection || indices != selected;
+	selected.swap(indices);
+	hasSelection = true;
+	return changed;
+}
+
+const QVector<quint32> &C_PointLOD::selection() const
+{
+	return selected;
+}
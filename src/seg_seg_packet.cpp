@@ -0,0 +1,228 @@
+/* MeshIt - a 3D mesh generator for fractured reservoirs
+ *
+ * Copyright (C) 2020
+ *
+ * Mauro Cacace (GFZ, cacace@gfz-potsdam.de),
+ * Guido Bl�cher (GFZ, bloech@gfz-potsdam.de),
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version, complemented with
+ * the following provision:
+ * For the scientific transparency and verification of results obtained
+ * and communicated to the public after using a modified version of the
+ * work, You (as the recipient of the source code and author of this
+ * modified version, used to produce the published results in scientific
+ * communications) commit to make this modified source code available in
+ * a repository that is easily and freely accessible for a duration of
+ * five years after the communication of the obtained results.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SEG_SEG_PACKET_X86
+#include <immintrin.h>
+#endif
+
+#include "seg_seg_packet.h"
+#include "simd.h"
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+typedef unsigned int (*SegSegPacketKernel)(const double *, const double *, const C_SegmentPacket &, double, double (*)[SEGMENT_PACKET_WIDTH]);
+
+void
+seg_seg_packet_set(C_SegmentPacket *packet, int lane, const double q1[3], const double q2[3])
+{
+	packet->x[0][lane] = q1[0];
+	packet->y[0][lane] = q1[1];
+	packet->z[0][lane] = q1[2];
+	packet->x[1][lane] = q2[0];
+	packet->y[1][lane] = q2[1];
+	packet->z[1][lane] = q2[2];
+}
+
+/* The arithmetic follows C_Line::calculateSkewLineTransversal() term by term:
+ * R21 = P21 x Q21 is the common normal, D, Ds and Dt are the determinants of
+ * Cramer's rule for the intersection of the plane (P1, P21, R21) with the
+ * line (Q1, Q21). */
+static unsigned int
+transversal_scalar(const double *p1, const double *p2, const C_SegmentPacket &Q, double tolerance2, double (*midpoint)[SEGMENT_PACKET_WIDTH])
+{
+	const double P21[3] = { p2[0] - p1[0], p2[1] - p1[1], p2[2] - p1[2] };
+	unsigned int mask = 0;
+	for (int l = 0; l < Q.count; l++)
+	{
+		double Q21[3] = { Q.x[1][l] - Q.x[0][l], Q.y[1][l] - Q.y[0][l], Q.z[1][l] - Q.z[0][l] };
+		double R21[3] = { P21[1] * Q21[2] - Q21[1] * P21[2], P21[2] * Q21[0] - Q21[2] * P21[0], P21[0] * Q21[1] - Q21[0] * P21[1] };
+		double PQ1[3] = { p1[0] - Q.x[0][l], p1[1] - Q.y[0][l], p1[2] - Q.z[0][l] };
+		if (R21[0] * R21[0] + R21[1] * R21[1] + R21[2] * R21[2] == 0)
+			continue;
+		double D = P21[0] * Q21[1] * R21[2] + Q21[0] * R21[1] * P21[2] + R21[0] * P21[1] * Q21[2] - R21[0] * Q21[1] * P21[2] - Q21[0] * P21[1] * R21[2] - P21[0] * R21[1] * Q21[2];
+		double Ds = R21[0] * Q21[1] * PQ1[2] + Q21[0] * PQ1[1] * R21[2] + PQ1[0] * R21[1] * Q21[2] - PQ1[0] * Q21[1] * R21[2] - Q21[0] * R21[1] * PQ1[2] - R21[0] * PQ1[1] * Q21[2];
+		double Dt = P21[0] * PQ1[1] * R21[2] + PQ1[0] * R21[1] * P21[2] + R21[0] * P21[1] * PQ1[2] - R21[0] * PQ1[1] * P21[2] - PQ1[0] * P21[1] * R21[2] - P21[0] * R21[1] * PQ1[2];
+		double s = Ds / D;
+		double t = Dt / D;
+		if (!(0 <= s && s < 1 && 0 <= t && t < 1))
+			continue;
+		double a[3] = { p1[0] + s * P21[0], p1[1] + s * P21[1], p1[2] + s * P21[2] };
+		double b[3] = { Q.x[0][l] + t * Q21[0], Q.y[0][l] + t * Q21[1], Q.z[0][l] + t * Q21[2] };
+		double d[3] = { a[0] - b[0], a[1] - b[1], a[2] - b[2] };
+		if (!(d[0] * d[0] + d[1] * d[1] + d[2] * d[2] < tolerance2))
+			continue;
+		for (int n = 0; n != 3; n++)
+			midpoint[n][l] = (a[n] + b[n]) / 2;
+		mask |= 1u << l;
+	}
+	return mask;
+}
+
+#ifdef SEG_SEG_PACKET_X86
+
+/* a*b*c evaluated as (a*b)*c */
+static inline __m128d
+mul3_sse2(__m128d a, __m128d b, __m128d c)
+{
+	return _mm_mul_pd(_mm_mul_pd(a, b), c);
+}
+
+static inline __m128d
+det3_sse2(const __m128d *a, const __m128d *b, const __m128d *c)
+{
+	/* a0*b1*c2 + b0*c1*a2 + c0*a1*b2 - c0*b1*a2 - b0*a1*c2 - a0*c1*b2 */
+	__m128d d = _mm_add_pd(_mm_add_pd(mul3_sse2(a[0], b[1], c[2]), mul3_sse2(b[0], c[1], a[2])), mul3_sse2(c[0], a[1], b[2]));
+	d = _mm_sub_pd(d, mul3_sse2(c[0], b[1], a[2]));
+	d = _mm_sub_pd(d, mul3_sse2(b[0], a[1], c[2]));
+	return _mm_sub_pd(d, mul3_sse2(a[0], c[1], b[2]));
+}
+
+static unsigned int
+transversal_sse2(const double *p1, const double *p2, const C_SegmentPacket &Q, double tolerance2, double (*midpoint)[SEGMENT_PACKET_WIDTH])
+{
+	const __m128d zero = _mm_setzero_pd();
+	const __m128d one = _mm_set1_pd(1.0);
+	const __m128d two = _mm_set1_pd(2.0);
+	const __m128d P1[3] = { _mm_set1_pd(p1[0]), _mm_set1_pd(p1[1]), _mm_set1_pd(p1[2]) };
+	const __m128d P21[3] = { _mm_set1_pd(p2[0] - p1[0]), _mm_set1_pd(p2[1] - p1[1]), _mm_set1_pd(p2[2] - p1[2]) };
+	unsigned int mask = 0;
+	for (int h = 0; h != SEGMENT_PACKET_WIDTH; h += 2)
+	{
+		__m128d Q1[3] = { _mm_loadu_pd(&Q.x[0][h]), _mm_loadu_pd(&Q.y[0][h]), _mm_loadu_pd(&Q.z[0][h]) };
+		__m128d Q21[3] = { _mm_sub_pd(_mm_loadu_pd(&Q.x[1][h]), Q1[0]), _mm_sub_pd(_mm_loadu_pd(&Q.y[1][h]), Q1[1]), _mm_sub_pd(_mm_loadu_pd(&Q.z[1][h]), Q1[2]) };
+		__m128d R21[3] = {
+			_mm_sub_pd(_mm_mul_pd(P21[1], Q21[2]), _mm_mul_pd(Q21[1], P21[2])),
+			_mm_sub_pd(_mm_mul_pd(P21[2], Q21[0]), _mm_mul_pd(Q21[2], P21[0])),
+			_mm_sub_pd(_mm_mul_pd(P21[0], Q21[1]), _mm_mul_pd(Q21[0], P21[1])) };
+		__m128d PQ1[3] = { _mm_sub_pd(P1[0], Q1[0]), _mm_sub_pd(P1[1], Q1[1]), _mm_sub_pd(P1[2], Q1[2]) };
+		__m128d R2 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(R21[0], R21[0]), _mm_mul_pd(R21[1], R21[1])), _mm_mul_pd(R21[2], R21[2]));
+		__m128d D = det3_sse2(P21, Q21, R21);
+		__m128d s = _mm_div_pd(det3_sse2(R21, Q21, PQ1), D);
+		__m128d t = _mm_div_pd(det3_sse2(P21, PQ1, R21), D);
+		__m128d hit = _mm_cmpneq_pd(R2, zero);
+		hit = _mm_and_pd(hit, _mm_and_pd(_mm_cmple_pd(zero, s), _mm_cmplt_pd(s, one)));
+		hit = _mm_and_pd(hit, _mm_and_pd(_mm_cmple_pd(zero, t), _mm_cmplt_pd(t, one)));
+		__m128d a[3], b[3], d2 = zero;
+		for (int n = 0; n != 3; n++)
+		{
+			a[n] = _mm_add_pd(P1[n], _mm_mul_pd(s, P21[n]));
+			b[n] = _mm_add_pd(Q1[n], _mm_mul_pd(t, Q21[n]));
+			__m128d d = _mm_sub_pd(a[n], b[n]);
+			d2 = n == 0 ? _mm_mul_pd(d, d) : _mm_add_pd(d2, _mm_mul_pd(d, d));
+		}
+		hit = _mm_and_pd(hit, _mm_cmplt_pd(d2, _mm_set1_pd(tolerance2)));
+		for (int n = 0; n != 3; n++)
+			_mm_storeu_pd(&midpoint[n][h], _mm_div_pd(_mm_add_pd(a[n], b[n]), two));
+		mask |= (unsigned int)_mm_movemask_pd(hit) << h;
+	}
+	return mask & ((1u << Q.count) - 1);
+}
+
+TARGET_AVX2 static inline __m256d
+mul3_avx2(__m256d a, __m256d b, __m256d c)
+{
+	return _mm256_mul_pd(_mm256_mul_pd(a, b), c);
+}
+
+TARGET_AVX2 static inline __m256d
+det3_avx2(const __m256d *a, const __m256d *b, const __m256d *c)
+{
+	__m256d d = _mm256_add_pd(_mm256_add_pd(mul3_avx2(a[0], b[1], c[2]), mul3_avx2(b[0], c[1], a[2])), mul3_avx2(c[0], a[1], b[2]));
+	d = _mm256_sub_pd(d, mul3_avx2(c[0], b[1], a[2]));
+	d = _mm256_sub_pd(d, mul3_avx2(b[0], a[1], c[2]));
+	return _mm256_sub_pd(d, mul3_avx2(a[0], c[1], b[2]));
+}
+
+TARGET_AVX2 static unsigned int
+transversal_avx2(const double *p1, const double *p2, const C_SegmentPacket &Q, double tolerance2, double (*midpoint)[SEGMENT_PACKET_WIDTH])
+{
+	const __m256d zero = _mm256_setzero_pd();
+	const __m256d one = _mm256_set1_pd(1.0);
+	const __m256d two = _mm256_set1_pd(2.0);
+	const __m256d P1[3] = { _mm256_set1_pd(p1[0]), _mm256_set1_pd(p1[1]), _mm256_set1_pd(p1[2]) };
+	const __m256d P21[3] = { _mm256_set1_pd(p2[0] - p1[0]), _mm256_set1_pd(p2[1] - p1[1]), _mm256_set1_pd(p2[2] - p1[2]) };
+	__m256d Q1[3] = { _mm256_loadu_pd(Q.x[0]), _mm256_loadu_pd(Q.y[0]), _mm256_loadu_pd(Q.z[0]) };
+	__m256d Q21[3] = { _mm256_sub_pd(_mm256_loadu_pd(Q.x[1]), Q1[0]), _mm256_sub_pd(_mm256_loadu_pd(Q.y[1]), Q1[1]), _mm256_sub_pd(_mm256_loadu_pd(Q.z[1]), Q1[2]) };
+	__m256d R21[3] = {
+		_mm256_sub_pd(_mm256_mul_pd(P21[1], Q21[2]), _mm256_mul_pd(Q21[1], P21[2])),
+		_mm256_sub_pd(_mm256_mul_pd(P21[2], Q21[0]), _mm256_mul_pd(Q21[2], P21[0])),
+		_mm256_sub_pd(_mm256_mul_pd(P21[0], Q21[1]), _mm256_mul_pd(Q21[0], P21[1])) };
+	__m256d PQ1[3] = { _mm256_sub_pd(P1[0], Q1[0]), _mm256_sub_pd(P1[1], Q1[1]), _mm256_sub_pd(P1[2], Q1[2]) };
+	__m256d R2 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(R21[0], R21[0]), _mm256_mul_pd(R21[1], R21[1])), _mm256_mul_pd(R21[2], R21[2]));
+	__m256d D = det3_avx2(P21, Q21, R21);
+	__m256d s = _mm256_div_pd(det3_avx2(R21, Q21, PQ1), D);
+	__m256d t = _mm256_div_pd(det3_avx2(P21, PQ1, R21), D);
+	__m256d hit = _mm256_cmp_pd(R2, zero, _CMP_NEQ_UQ);
+	hit = _mm256_and_pd(hit, _mm256_and_pd(_mm256_cmp_pd(zero, s, _CMP_LE_OQ), _mm256_cmp_pd(s, one, _CMP_LT_OQ)));
+	hit = _mm256_and_pd(hit, _mm256_and_pd(_mm256_cmp_pd(zero, t, _CMP_LE_OQ), _mm256_cmp_pd(t, one, _CMP_LT_OQ)));
+	__m256d a[3], b[3], d2 = zero;
+	for (int n = 0; n != 3; n++)
+	{
+		a[n] = _mm256_add_pd(P1[n], _mm256_mul_pd(s, P21[n]));
+		b[n] = _mm256_add_pd(Q1[n], _mm256_mul_pd(t, Q21[n]));
+		__m256d d = _mm256_sub_pd(a[n], b[n]);
+		d2 = n == 0 ? _mm256_mul_pd(d, d) : _mm256_add_pd(d2, _mm256_mul_pd(d, d));
+	}
+	hit = _mm256_and_pd(hit, _mm256_cmp_pd(d2, _mm256_set1_pd(tolerance2), _CMP_LT_OQ));
+	for (int n = 0; n != 3; n++)
+		_mm256_storeu_pd(midpoint[n], _mm256_div_pd(_mm256_add_pd(a[n], b[n]), two));
+	return (unsigned int)_mm256_movemask_pd(hit) & ((1u << Q.count) - 1);
+}
+
+#endif	// SEG_SEG_PACKET_X86
+
+static SegSegPacketKernel
+select_kernel(SimdLevel level)
+{
+#ifdef SEG_SEG_PACKET_X86
+	if (level >= SIMD_AVX2 && simd_level() >= SIMD_AVX2)
+		return transversal_avx2;
+	if (level >= SIMD_SSE2 && simd_level() >= SIMD_SSE2)
+		return transversal_sse2;
+#endif
+	return transversal_scalar;
+}
+
+unsigned int
+seg_seg_packet_transversal(const double p1[3], const double p2[3], const C_SegmentPacket &packet, double tolerance2, double midpoint[3][SEGMENT_PACKET_WIDTH])
+{
+	static const SegSegPacketKernel kernel = select_kernel(simd_level());
+	return kernel(p1, p2, packet, tolerance2, midpoint);
+}
+
+unsigned int
+seg_seg_packet_transversal_level(SimdLevel level, const double p1[3], const double p2[3], const C_SegmentPacket &packet, double tolerance2, double midpoint[3][SEGMENT_PACKET_WIDTH])
+{
+	return select_kernel(level)(p1, p2, packet, tolerance2, midpoint);
+}
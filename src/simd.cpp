@@ -0,0 +1,92 @@
+/* MeshIt - a 3D mesh generator for fractured reservoirs
+ *
+ * Copyright (C) 2020
+ *
+ * Mauro Cacace (GFZ, cacace@gfz-potsdam.de),
+ * Guido Bl�cher (GFZ, bloech@gfz-potsdam.de),
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version, complemented with
+ * the following provision:
+ * For the scientific transparency and verification of results obtained
+ * and communicated to the public after using a modified version of the
+ * work, You (as the recipient of the source code and author of this
+ * modified version, used to produce the published results in scientific
+ * communications) commit to make this modified source code available in
+ * a repository that is easily and freely accessible for a duration of
+ * five years after the communication of the obtained results.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+#include "simd.h"
+
+static SimdLevel
+detect()
+{
+#if defined(__x86_64__) || defined(_M_X64)
+	SimdLevel level = SIMD_SSE2;
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] >= 7)
+	{
+		__cpuid(info, 1);
+		/* OSXSAVE and AVX, and the OS saves the YMM registers */
+		bool avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+		__cpuidex(info, 7, 0);
+		if (avx && (info[1] & (1 << 5)) != 0)
+			level = SIMD_AVX2;
+	}
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		level = SIMD_AVX2;
+#endif
+#else
+	SimdLevel level = SIMD_SCALAR;
+#endif
+	const char *force = getenv("MESHIT_SIMD");
+	if (force && strcmp(force, "scalar") == 0)
+		level = SIMD_SCALAR;
+	else if (force && strcmp(force, "sse2") == 0 && level > SIMD_SSE2)
+		level = SIMD_SSE2;
+	return level;
+}
+
+SimdLevel
+simd_level()
+{
+	static const SimdLevel level = detect();
+	return level;
+}
+
+const char *
+simd_level_name(SimdLevel level)
+{
+	switch (level)
+	{
+	case SIMD_AVX2:
+		return "avx2";
+	case SIMD_SSE2:
+		return "sse2";
+	default:
+		return "scalar";
+	}
+}
@@ -0,0 +1,110 @@
+/* MeshIt - a 3D mesh generator for fractured reservoirs
+ *
+ * Copyright (C) 2020
+ *
+ * Mauro Cacace (GFZ, cacace@gfz-potsdam.de),
+ * Guido Bl�cher (GFZ, bloech@gfz-potsdam.de),
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version, complemented with
+ * the following provision:
+ * For the scientific transparency and verification of results obtained
+ * and communicated to the public after using a modified version of the
+ * work, You (as the recipient of the source code and author of this
+ * modified version, used to produce the published results in scientific
+ * communications) commit to make this modified source code available in
+ * a repository that is easily and freely accessible for a duration of
+ * five years after the communication of the obtained results.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stagecache.h"
+
+/* Entry layout: magic, format version, payload size, SHA-1 of the payload, payload. */
+static const char magic[8] = { 'M', 'E', 'S', 'H', 'I', 'T', 'S', 'C' };
+static const quint32 version = 1;
+
+C_StageCache::C_StageCache()
+{}
+
+void
+C_StageCache::setDirectory(const QString &directory)
+{
+	this->dir = directory;
+	if (!directory.isEmpty())
+		QDir().mkpath(directory);
+}
+
+QString
+C_StageCache::directory() const
+{
+	return this->dir;
+}
+
+bool
+C_StageCache::isEnabled() const
+{
+	return !this->dir.isEmpty();
+}
+
+QString
+C_StageCache::path(const char *stage, const QByteArray &key) const
+{
+	return this->dir + "/" + stage + "/" + QString::fromLatin1(key.left(2)) + "/" + QString::fromLatin1(key);
+}
+
+bool
+C_StageCache::load(const char *stage, const QByteArray &key, QByteArray &data) const
+{
+	if (!this->isEnabled() || key.isEmpty())
+		return false;
+	QFile file(this->path(stage, key));
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+	QByteArray header = file.read(sizeof(magic));
+	if (header != QByteArray::fromRawData(magic, sizeof(magic)))
+		return false;
+	QDataStream in(&file);
+	in.setVersion(QDataStream::Qt_6_0);
+	quint32 fileVersion;
+	quint64 size;
+	QByteArray checksum;
+	in >> fileVersion >> size >> checksum;
+	if (in.status() != QDataStream::Ok || fileVersion != version || size > (quint64)file.size())
+		return false;
+	data = file.read(size);
+	if ((quint64)data.size() != size || QCryptographicHash::hash(data, QCryptographicHash::Sha1) != checksum)
+	{
+		data.clear();
+		return false;
+	}
+	return true;
+}
+
+bool
+C_StageCache::store(const char *stage, const QByteArray &key, const QByteArray &data) const
+{
+	if (!this->isEnabled() || key.isEmpty())
+		return false;
+	QString filename = this->path(stage, key);
+	QDir().mkpath(QFileInfo(filename).path());
+	/* QSaveFile writes to a temporary file in the same directory and renames it on commit() */
+	QSaveFile file(filename);
+	if (!file.open(QIODevice::WriteOnly))
+		return false;
+	file.write(magic, sizeof(magic));
+	QDataStream out(&file);
+	out.setVersion(QDataStream::Qt_6_0);
+	out << version << (quint64)data.size() << QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+	file.write(data);
+	return file.commit();
+}
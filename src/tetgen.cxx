@@ -16,6 +16,7 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "tetgen.h"
+#include "cancellation.h"
 
 //// io_cxx ///////////////////////////////////////////////////////////////////
 ////                                                                       ////
@@ -9270,6 +9271,12 @@ int tetgenmesh::insertpoint(point insertpt, triface *searchtet, face *splitsh,
   int t1ver;
   int i, j, k, s;
 
+  // Every vertex, including the Steiner points of the refinement, is inserted
+  //   here, so a cancelled job stops after at most one more insertion.
+  if (C_Cancellation::requested()) {
+    terminatetetgen(this, C_Cancellation::TETGEN_CANCELLED);
+  }
+
   if (b->verbose > 2) {
     printf("      Insert point %d\n", pointmark(insertpt));
   }
@@ -0,0 +1,236 @@
+/* MeshIt - a 3D mesh generator for fractured reservoirs
+ *
+ * Copyright (C) 2020
+ *
+ * Mauro Cacace (GFZ, cacace@gfz-potsdam.de),
+ * Guido Bl�cher (GFZ, bloech@gfz-potsdam.de),
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version, complemented with
+ * the following provision:
+ * For the scientific transparency and verification of results obtained
+ * and communicated to the public after using a modified version of the
+ * work, You (as the recipient of the source code and author of this
+ * modified version, used to produce the published results in scientific
+ * communications) commit to make this modified source code available in
+ * a repository that is easily and freely accessible for a duration of
+ * five years after the communication of the obtained results.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define TRI_TRI_PACKET_X86
+#include <immintrin.h>
+#endif
+
+#include "simd.h"
+#include "tri_tri_packet.h"
+
+/* Twice the EPSILON of intersections.h: distances are only taken as non-zero
+ * if they are far from the zero tolerance of tri_tri_intersect_with_isectline(),
+ * so rounding differences (e.g. FMA contraction of the scalar code) can never
+ * reject a pair which the scalar test accepts. */
+#define USE_EPSILON_TEST 1
+#define EPSILON 2e-12
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+typedef unsigned int (*TriTriPacketKernel)(const double *, const double *, const double *, const C_TrianglePacket &);
+
+void
+tri_tri_packet_set(C_TrianglePacket *packet, int lane, const double v0[3], const double v1[3], const double v2[3])
+{
+	const double *v[3] = { v0, v1, v2 };
+	for (int n = 0; n != 3; n++)
+	{
+		packet->x[n][lane] = v[n][0];
+		packet->y[n][lane] = v[n][1];
+		packet->z[n][lane] = v[n][2];
+	}
+}
+
+/* Plane of T1 in the form of intersections.h: N1.X+d1=0. It is the same for
+ * all implementations, so it is always computed in scalar arithmetic. */
+static inline void
+plane(const double *v0, const double *v1, const double *v2, double *n, double *d)
+{
+	double e1[3] = { v1[0] - v0[0], v1[1] - v0[1], v1[2] - v0[2] };
+	double e2[3] = { v2[0] - v0[0], v2[1] - v0[1], v2[2] - v0[2] };
+	n[0] = e1[1] * e2[2] - e2[1] * e1[2];
+	n[1] = e1[2] * e2[0] - e2[2] * e1[0];
+	n[2] = e1[0] * e2[1] - e2[0] * e1[1];
+	*d = -(n[0] * v0[0] + n[1] * v0[1] + n[2] * v0[2]);
+}
+
+static unsigned int
+candidates_scalar(const double *v0, const double *v1, const double *v2, const C_TrianglePacket &P)
+{
+	const double *V[3] = { v0, v1, v2 };
+	double N1[3], d1;
+	plane(v0, v1, v2, N1, &d1);
+	unsigned int mask = 0;
+	for (int l = 0; l < P.count; l++)
+	{
+		double du[3];
+		for (int n = 0; n != 3; n++)
+		{
+			du[n] = N1[0] * P.x[n][l] + N1[1] * P.y[n][l] + N1[2] * P.z[n][l] + d1;
+#if USE_EPSILON_TEST==1
+			if (fabs(du[n]) < EPSILON)
+				du[n] = 0.0;
+#endif
+		}
+		if (du[0] * du[1] > 0.0 && du[0] * du[2] > 0.0)
+			continue;
+		double e1[3] = { P.x[1][l] - P.x[0][l], P.y[1][l] - P.y[0][l], P.z[1][l] - P.z[0][l] };
+		double e2[3] = { P.x[2][l] - P.x[0][l], P.y[2][l] - P.y[0][l], P.z[2][l] - P.z[0][l] };
+		double N2[3] = { e1[1] * e2[2] - e2[1] * e1[2], e1[2] * e2[0] - e2[2] * e1[0], e1[0] * e2[1] - e2[0] * e1[1] };
+		double d2 = -(N2[0] * P.x[0][l] + N2[1] * P.y[0][l] + N2[2] * P.z[0][l]);
+		double dv[3];
+		for (int n = 0; n != 3; n++)
+		{
+			dv[n] = N2[0] * V[n][0] + N2[1] * V[n][1] + N2[2] * V[n][2] + d2;
+#if USE_EPSILON_TEST==1
+			if (fabs(dv[n]) < EPSILON)
+				dv[n] = 0.0;
+#endif
+		}
+		if (dv[0] * dv[1] > 0.0 && dv[0] * dv[2] > 0.0)
+			continue;
+		mask |= 1u << l;
+	}
+	return mask;
+}
+
+#ifdef TRI_TRI_PACKET_X86
+
+/* SSE2 is part of x86-64, two lanes per register. */
+static unsigned int
+candidates_sse2(const double *v0, const double *v1, const double *v2, const C_TrianglePacket &P)
+{
+	const double *V[3] = { v0, v1, v2 };
+	double N1[3], d1;
+	plane(v0, v1, v2, N1, &d1);
+	const __m128d zero = _mm_setzero_pd();
+	const __m128d eps = _mm_set1_pd(EPSILON);
+	const __m128d sign = _mm_set1_pd(-0.0);
+	unsigned int mask = 0;
+	for (int h = 0; h != TRIANGLE_PACKET_WIDTH; h += 2)
+	{
+		__m128d ux[3], uy[3], uz[3], du[3], dv[3];
+		for (int n = 0; n != 3; n++)
+		{
+			ux[n] = _mm_loadu_pd(&P.x[n][h]);
+			uy[n] = _mm_loadu_pd(&P.y[n][h]);
+			uz[n] = _mm_loadu_pd(&P.z[n][h]);
+			du[n] = _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(_mm_set1_pd(N1[0]), ux[n]), _mm_mul_pd(_mm_set1_pd(N1[1]), uy[n])), _mm_mul_pd(_mm_set1_pd(N1[2]), uz[n])), _mm_set1_pd(d1));
+#if USE_EPSILON_TEST==1
+			du[n] = _mm_andnot_pd(_mm_cmplt_pd(_mm_andnot_pd(sign, du[n]), eps), du[n]);
+#endif
+		}
+		__m128d rejectA = _mm_and_pd(_mm_cmpgt_pd(_mm_mul_pd(du[0], du[1]), zero), _mm_cmpgt_pd(_mm_mul_pd(du[0], du[2]), zero));
+		__m128d e1x = _mm_sub_pd(ux[1], ux[0]), e1y = _mm_sub_pd(uy[1], uy[0]), e1z = _mm_sub_pd(uz[1], uz[0]);
+		__m128d e2x = _mm_sub_pd(ux[2], ux[0]), e2y = _mm_sub_pd(uy[2], uy[0]), e2z = _mm_sub_pd(uz[2], uz[0]);
+		__m128d n2x = _mm_sub_pd(_mm_mul_pd(e1y, e2z), _mm_mul_pd(e2y, e1z));
+		__m128d n2y = _mm_sub_pd(_mm_mul_pd(e1z, e2x), _mm_mul_pd(e2z, e1x));
+		__m128d n2z = _mm_sub_pd(_mm_mul_pd(e1x, e2y), _mm_mul_pd(e2x, e1y));
+		__m128d d2 = _mm_xor_pd(sign, _mm_add_pd(_mm_add_pd(_mm_mul_pd(n2x, ux[0]), _mm_mul_pd(n2y, uy[0])), _mm_mul_pd(n2z, uz[0])));
+		for (int n = 0; n != 3; n++)
+		{
+			dv[n] = _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(n2x, _mm_set1_pd(V[n][0])), _mm_mul_pd(n2y, _mm_set1_pd(V[n][1]))), _mm_mul_pd(n2z, _mm_set1_pd(V[n][2]))), d2);
+#if USE_EPSILON_TEST==1
+			dv[n] = _mm_andnot_pd(_mm_cmplt_pd(_mm_andnot_pd(sign, dv[n]), eps), dv[n]);
+#endif
+		}
+		__m128d rejectB = _mm_and_pd(_mm_cmpgt_pd(_mm_mul_pd(dv[0], dv[1]), zero), _mm_cmpgt_pd(_mm_mul_pd(dv[0], dv[2]), zero));
+		mask |= (unsigned int)(~_mm_movemask_pd(_mm_or_pd(rejectA, rejectB)) & 0x3) << h;
+	}
+	return mask & ((1u << P.count) - 1);
+}
+
+TARGET_AVX2 static unsigned int
+candidates_avx2(const double *v0, const double *v1, const double *v2, const C_TrianglePacket &P)
+{
+	const double *V[3] = { v0, v1, v2 };
+	double N1[3], d1;
+	plane(v0, v1, v2, N1, &d1);
+	const __m256d zero = _mm256_setzero_pd();
+	const __m256d eps = _mm256_set1_pd(EPSILON);
+	const __m256d sign = _mm256_set1_pd(-0.0);
+	__m256d ux[3], uy[3], uz[3], du[3], dv[3];
+	for (int n = 0; n != 3; n++)
+	{
+		ux[n] = _mm256_loadu_pd(P.x[n]);
+		uy[n] = _mm256_loadu_pd(P.y[n]);
+		uz[n] = _mm256_loadu_pd(P.z[n]);
+		du[n] = _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(N1[0]), ux[n]), _mm256_mul_pd(_mm256_set1_pd(N1[1]), uy[n])), _mm256_mul_pd(_mm256_set1_pd(N1[2]), uz[n])), _mm256_set1_pd(d1));
+#if USE_EPSILON_TEST==1
+		du[n] = _mm256_andnot_pd(_mm256_cmp_pd(_mm256_andnot_pd(sign, du[n]), eps, _CMP_LT_OQ), du[n]);
+#endif
+	}
+	__m256d rejectA = _mm256_and_pd(_mm256_cmp_pd(_mm256_mul_pd(du[0], du[1]), zero, _CMP_GT_OQ), _mm256_cmp_pd(_mm256_mul_pd(du[0], du[2]), zero, _CMP_GT_OQ));
+	__m256d e1x = _mm256_sub_pd(ux[1], ux[0]), e1y = _mm256_sub_pd(uy[1], uy[0]), e1z = _mm256_sub_pd(uz[1], uz[0]);
+	__m256d e2x = _mm256_sub_pd(ux[2], ux[0]), e2y = _mm256_sub_pd(uy[2], uy[0]), e2z = _mm256_sub_pd(uz[2], uz[0]);
+	__m256d n2x = _mm256_sub_pd(_mm256_mul_pd(e1y, e2z), _mm256_mul_pd(e2y, e1z));
+	__m256d n2y = _mm256_sub_pd(_mm256_mul_pd(e1z, e2x), _mm256_mul_pd(e2z, e1x));
+	__m256d n2z = _mm256_sub_pd(_mm256_mul_pd(e1x, e2y), _mm256_mul_pd(e2x, e1y));
+	__m256d d2 = _mm256_xor_pd(sign, _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(n2x, ux[0]), _mm256_mul_pd(n2y, uy[0])), _mm256_mul_pd(n2z, uz[0])));
+	for (int n = 0; n != 3; n++)
+	{
+		dv[n] = _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(n2x, _mm256_set1_pd(V[n][0])), _mm256_mul_pd(n2y, _mm256_set1_pd(V[n][1]))), _mm256_mul_pd(n2z, _mm256_set1_pd(V[n][2]))), d2);
+#if USE_EPSILON_TEST==1
+		dv[n] = _mm256_andnot_pd(_mm256_cmp_pd(_mm256_andnot_pd(sign, dv[n]), eps, _CMP_LT_OQ), dv[n]);
+#endif
+	}
+	__m256d rejectB = _mm256_and_pd(_mm256_cmp_pd(_mm256_mul_pd(dv[0], dv[1]), zero, _CMP_GT_OQ), _mm256_cmp_pd(_mm256_mul_pd(dv[0], dv[2]), zero, _CMP_GT_OQ));
+	unsigned int mask = ~_mm256_movemask_pd(_mm256_or_pd(rejectA, rejectB)) & 0xf;
+	return mask & ((1u << P.count) - 1);
+}
+
+#endif	// TRI_TRI_PACKET_X86
+
+static TriTriPacketKernel
+select_kernel(SimdLevel level)
+{
+#ifdef TRI_TRI_PACKET_X86
+	if (level >= SIMD_AVX2 && simd_level() >= SIMD_AVX2)
+		return candidates_avx2;
+	if (level >= SIMD_SSE2 && simd_level() >= SIMD_SSE2)
+		return candidates_sse2;
+#endif
+	return candidates_scalar;
+}
+
+unsigned int
+tri_tri_packet_candidates(const double v0[3], const double v1[3], const double v2[3], const C_TrianglePacket &packet)
+{
+	static const TriTriPacketKernel kernel = select_kernel(simd_level());
+	return kernel(v0, v1, v2, packet);
+}
+
+unsigned int
+tri_tri_packet_candidates_level(SimdLevel level, const double v0[3], const double v1[3], const double v2[3], const C_TrianglePacket &packet)
+{
+	return select_kernel(level)(v0, v1, v2, packet);
+}
+
+const char *
+tri_tri_packet_isa()
+{
+	return simd_level_name(simd_level());
+}